@@ -0,0 +1,29 @@
+# Writes a SPIR-V binary out as a header with its words in a constexpr array.
+# cmake -DINPUT=<module.spv> -DOUTPUT=<header.h> -DSYMBOL=<array name> -P EmbedSpirv.cmake
+
+file(READ ${INPUT} HEX HEX)
+string(LENGTH "${HEX}" HEX_LENGTH)
+math(EXPR REMAINDER "${HEX_LENGTH} % 8")
+if(HEX_LENGTH EQUAL 0 OR NOT REMAINDER EQUAL 0)
+    message(FATAL_ERROR "${INPUT} is not a SPIR-V module!")
+endif()
+
+# SPIR-V words are little endian, four bytes make one literal, eight literals a line
+string(REGEX REPLACE "(..)(..)(..)(..)" "0x\\4\\3\\2\\1, " WORDS "${HEX}")
+set(WORD "0x[0-9a-f]+, ")
+string(REGEX REPLACE "(${WORD}${WORD}${WORD}${WORD}${WORD}${WORD}${WORD}${WORD})" "\\1\n        " WORDS "${WORDS}")
+string(REPLACE ", \n" ",\n" WORDS "${WORDS}")
+string(STRIP "${WORDS}" WORDS)
+
+get_filename_component(SOURCE_NAME ${INPUT} NAME)
+file(WRITE ${OUTPUT}
+"#pragma once
+#include <cstdint>
+
+//Generated from ${SOURCE_NAME} by cmake/EmbedSpirv.cmake
+namespace evoke::vulkan::shaders {
+    inline constexpr uint32_t ${SYMBOL}[] = {
+        ${WORDS}
+    };
+}
+")
@@ -0,0 +1,70 @@
+#include "AllocationCounter.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+namespace evoke::core {
+    namespace {
+        std::atomic<uint64_t> s_allocations{0};
+        std::atomic<uint64_t> s_bytes{0};
+        thread_local uint64_t t_allocations = 0;
+        thread_local uint64_t t_bytes = 0;
+
+        void count(size_t size){
+            s_allocations.fetch_add(1, std::memory_order_relaxed);
+            s_bytes.fetch_add(size, std::memory_order_relaxed);
+            t_allocations++;
+            t_bytes += size;
+        }
+
+        void* allocate(size_t size){
+            count(size);
+            if (void* memory = std::malloc(size == 0 ? 1 : size)) {
+                return memory;
+            }
+            throw std::bad_alloc();
+        }
+
+        void* allocate_aligned(size_t size, size_t alignment){
+            count(size);
+#ifdef _WIN32
+            void* memory = _aligned_malloc(size == 0 ? 1 : size, alignment);
+#else
+            //aligned_alloc wants a non-zero multiple of the alignment
+            void* memory = std::aligned_alloc(alignment, size == 0 ? alignment : (size + alignment - 1) / alignment * alignment);
+#endif
+            if (memory) {
+                return memory;
+            }
+            throw std::bad_alloc();
+        }
+
+        void free_aligned(void* memory){
+#ifdef _WIN32
+            _aligned_free(memory);
+#else
+            std::free(memory);
+#endif
+        }
+    }
+
+    AllocationStats AllocationCounter::get_total(){
+        return {s_allocations.load(std::memory_order_relaxed), s_bytes.load(std::memory_order_relaxed)};
+    }
+
+    AllocationStats AllocationCounter::get_thread_total(){
+        return {t_allocations, t_bytes};
+    }
+}
+
+//The array and nothrow forms forward to these
+void* operator new(size_t size) { return evoke::core::allocate(size); }
+void* operator new(size_t size, std::align_val_t alignment) { return evoke::core::allocate_aligned(size, static_cast<size_t>(alignment)); }
+
+void operator delete(void* memory) noexcept { std::free(memory); }
+void operator delete(void* memory, size_t) noexcept { std::free(memory); }
+void operator delete(void* memory, std::align_val_t) noexcept { evoke::core::free_aligned(memory); }
+void operator delete(void* memory, size_t, std::align_val_t) noexcept { evoke::core::free_aligned(memory); }
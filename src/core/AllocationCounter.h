@@ -0,0 +1,39 @@
+#pragma once
+#include <cstdint>
+
+namespace evoke::core {
+    struct AllocationStats {
+        uint64_t allocations = 0;
+        uint64_t bytes = 0;
+
+        AllocationStats operator-(const AllocationStats& other) const {
+            return {allocations - other.allocations, bytes - other.bytes};
+        }
+    };
+
+    //Counts every call of the global operator new, which AllocationCounter.cpp replaces. The render
+    //loop is meant to reach a steady state without any: frame temporaries go to FrameArenas, recycled
+    //objects to ObjectPool.
+    class AllocationCounter {
+    public:
+        //All threads since startup
+        static AllocationStats get_total();
+        //Calling thread only
+        static AllocationStats get_thread_total();
+    };
+
+    //Allocations of the calling thread while the scope lives, e.g. to assert a warmed up frame
+    //does not allocate:
+    //    AllocationScope scope;
+    //    core.draw_frame();
+    //    assert(scope.get().allocations == 0);
+    class AllocationScope {
+    public:
+        AllocationScope() : m_start(AllocationCounter::get_thread_total()) {}
+
+        AllocationStats get() const { return AllocationCounter::get_thread_total() - m_start; }
+
+    private:
+        AllocationStats m_start;
+    };
+}
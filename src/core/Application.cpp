@@ -1,6 +1,7 @@
 #include "Application.h"
 #include <iostream>
 #include "../utils/Logger.h"
+#include "../utils/Profiler.h"
 
 namespace evoke::core {
     void Application::run() {
@@ -10,21 +11,81 @@ namespace evoke::core {
     }
     
     void Application::init_app() {
+        Clock::time_point startup_start = Clock::now();
         evoke::utils::Logger::info("Initializing application!");
         
         m_window.init_window();
-        m_vulkan_core.init_vulkan(m_window.get_glfw_window());
+        m_vulkan_core.init_vulkan(m_window.get_glfw_window(), startup_start);
+        
+        scene::SceneState initial_state{};
+        m_simulation.init(m_window.get_input_queue(), initial_state);
+        m_simulation.set_update(update_scene);
         
         evoke::utils::Logger::info("Application initialized successfully!");
     }
     
-    int frame = 0;
-    auto lastTime = std::chrono::high_resolution_clock::now();
-    double fps = 0.0;
-    
     void Application::main_loop() {
+        m_running = true;
+        m_simulation.start();
+        m_render_thread = std::thread(&Application::render_loop, this);
+        
+        //GLFW events must be handled on the main thread, blocking here keeps it off the CPU
         while (!glfwWindowShouldClose(m_window.get_glfw_window())) {
-            glfwPollEvents();
+            glfwWaitEvents();
+        }
+        
+        m_running = false;
+        m_render_thread.join();
+        m_simulation.stop();
+        
+        vkDeviceWaitIdle(m_vulkan_core.get_device());
+    }
+    
+    void Application::render_loop() {
+        int frame = 0;
+        auto lastTime = std::chrono::high_resolution_clock::now();
+        double fps = 0.0;
+        
+        std::vector<glm::mat4> transforms;
+        scene::SceneState state;
+        scene::DirtyBits dirty;
+        std::vector<InputEvent> clicks;
+        std::vector<glm::vec2> pick_points;
+        std::vector<scene::RayHit> pick_hits;
+        
+        while (m_running) {
+            //Show the scene between the last two ticks, one tick behind the simulation
+            bool fresh = m_simulation.acquire_snapshot();
+            const scene::SceneSnapshot& snapshot = m_simulation.get_snapshot();
+            snapshot.interpolate(m_simulation.get_alpha(Clock::now()), fresh, state, dirty);
+            
+            m_vulkan_core.set_camera(state.camera);
+            m_vulkan_core.set_input_time(snapshot.input_time);
+            if (!state.instances.empty()) {
+                //Only instances the scene marked are converted and handed on
+                transforms.resize(state.instances.size());
+                dirty.for_each([&](size_t i) { transforms[i] = state.instances[i].matrix(); });
+                m_vulkan_core.set_instance_transforms(transforms, dirty);
+            }
+            dirty.clear();
+            
+            //Clicks are picked against what the last frame showed
+            m_window.get_pick_queue().drain(clicks);
+            if (!clicks.empty()) {
+                pick_points.clear();
+                for (const InputEvent& click : clicks) {
+                    pick_points.push_back({static_cast<float>(click.x), static_cast<float>(click.y)});
+                }
+                clicks.clear();
+                
+                m_vulkan_core.pick_instances(pick_points, pick_hits);
+                for (const scene::RayHit& hit : pick_hits) {
+                    if (hit.hit()) {
+                        evoke::utils::Logger::info("Picked instance ", hit.user_data, " at distance ", hit.distance, "!");
+                    }
+                }
+            }
+            
             m_vulkan_core.draw_frame();
             frame++;
 
@@ -35,17 +96,42 @@ namespace evoke::core {
             // Update every second
             if (elapsed >= 1.0) {
                 fps = frame / elapsed;
-                std::cout << "FPS: " << fps << "\n";
+                const vulkan::FramePacingStats& pacing = m_vulkan_core.get_pacing_stats();
+                std::cout << "FPS: " << fps << " | Ticks: " << m_simulation.get_tick()
+                          << " | CPU " << pacing.cpu_time << " ms, GPU " << pacing.gpu_time << " ms, sleep " << pacing.sleep_time
+                          << " ms, latency " << pacing.frame_latency << " ms, input " << pacing.input_latency << " ms\n";
+                
+                std::cout << "Counters:";
+                for (const auto& [name, value] : utils::Profiler::get_counters()) {
+                    std::cout << " " << name << " " << value;
+                }
+                std::cout << "\n";
                 frame = 0;
                 lastTime = currentTime;
             }
         }
-
-        vkDeviceWaitIdle(m_vulkan_core.get_device());
+    }
+    
+    void Application::update_scene(scene::SceneState& state, const InputState& input, double step) {
+        //Arrow keys orbit the camera around its target
+        float direction = 0.0f;
+        if (input.key_down(GLFW_KEY_LEFT)) {
+            direction -= 1.0f;
+        }
+        if (input.key_down(GLFW_KEY_RIGHT)) {
+            direction += 1.0f;
+        }
+        if (direction == 0.0f) {
+            return;
+        }
+        
+        glm::vec3 offset = state.camera.position - state.camera.target;
+        glm::mat4 rotation = glm::rotate(glm::mat4(1.0f), direction * static_cast<float>(step), state.camera.up);
+        state.camera.position = state.camera.target + glm::vec3(rotation * glm::vec4(offset, 0.0f));
     }
     
     void Application::clean_up(){
         m_window.clean_up();
         m_vulkan_core.clean_up();
     }
-}
\ No newline at end of file
+}
@@ -1,6 +1,9 @@
 #pragma once
 #include "../renderer/VulkanCore.h"
 #include "Window.h"
+#include "Simulation.h"
+#include <atomic>
+#include <thread>
 
 namespace evoke::core {
     class Application {
@@ -10,10 +13,17 @@ namespace evoke::core {
     private:
         Window m_window;
         vulkan::VulkanCore m_vulkan_core;
+        Simulation m_simulation;
         
+        //The main thread only pumps window events, rendering runs here
+        std::thread m_render_thread;
+        std::atomic<bool> m_running{false};
         
         void init_app();
         void main_loop();
+        void render_loop();
         void clean_up();
+        
+        static void update_scene(scene::SceneState& state, const InputState& input, double step);
     };
-}
\ No newline at end of file
+}
@@ -0,0 +1,29 @@
+#include "FrameArenas.h"
+#include <algorithm>
+
+namespace evoke::core {
+    void FrameArenas::init(uint32_t thread_count, uint32_t frames_in_flight, size_t block_size){
+        m_thread_count = thread_count;
+        m_frame = 0;
+
+        m_arenas.clear();
+        for (uint32_t i = 0; i < thread_count * frames_in_flight; i++) {
+            m_arenas.push_back(std::make_unique<LinearArena>(block_size));
+        }
+    }
+
+    void FrameArenas::begin_frame(uint32_t frame){
+        m_frame = frame;
+        for (uint32_t thread = 0; thread < m_thread_count; thread++) {
+            m_arenas[frame * m_thread_count + thread]->reset();
+        }
+    }
+
+    size_t FrameArenas::get_peak() const {
+        size_t peak = 0;
+        for (const auto& arena : m_arenas) {
+            peak = std::max(peak, arena->get_peak());
+        }
+        return peak;
+    }
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include "LinearArena.h"
+#include "JobSystem.h"
+
+namespace evoke::core {
+    //One LinearArena per thread and frame in flight. A frame's arenas are reset when its slot comes
+    //around again, so temporaries may live until the frame finished on the GPU. Threads are told apart
+    //by JobSystem::thread_index, only the thread that calls begin_frame and the job system's workers
+    //may use them.
+    class FrameArenas {
+    public:
+        void init(uint32_t thread_count, uint32_t frames_in_flight, size_t block_size = 256 * 1024);
+
+        //After the frame's fence wait, before any thread allocates from the frame
+        void begin_frame(uint32_t frame);
+
+        //Arena of the calling thread for the current frame
+        LinearArena& get() { return *m_arenas[m_frame * m_thread_count + JobSystem::thread_index()]; }
+
+        //Largest amount a single arena needed so far
+        size_t get_peak() const;
+
+    private:
+        std::vector<std::unique_ptr<LinearArena>> m_arenas;
+        uint32_t m_thread_count = 0;
+        uint32_t m_frame = 0;
+    };
+}
@@ -0,0 +1,38 @@
+#include "Input.h"
+
+namespace evoke::core {
+    void InputQueue::push(const InputEvent& event){
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_events.push_back(event);
+    }
+
+    void InputQueue::drain(std::vector<InputEvent>& events){
+        std::lock_guard<std::mutex> lock(m_mutex);
+        events.insert(events.end(), m_events.begin(), m_events.end());
+        m_events.clear();
+    }
+
+    void InputState::apply(const InputEvent& event){
+        //GLFW_RELEASE is 0, press and repeat both mean held
+        switch (event.type) {
+            case InputType::Key:
+                if (event.code >= 0 && event.code < MAX_KEYS) {
+                    keys[event.code] = event.action != 0;
+                }
+                break;
+            case InputType::MouseButton:
+                if (event.code >= 0 && event.code < MAX_BUTTONS) {
+                    buttons[event.code] = event.action != 0;
+                }
+                break;
+            case InputType::CursorMove:
+                cursor_x = event.x;
+                cursor_y = event.y;
+                break;
+            case InputType::Scroll:
+                scroll_x += event.x;
+                scroll_y += event.y;
+                break;
+        }
+    }
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace evoke::core {
+    using Clock = std::chrono::steady_clock;
+
+    enum class InputType {
+        Key,
+        MouseButton,
+        CursorMove,
+        Scroll
+    };
+
+    //Captured on the event thread with the time GLFW delivered it
+    struct InputEvent {
+        InputType type;
+        int code = 0;       //GLFW key or mouse button
+        int action = 0;     //GLFW_PRESS, GLFW_RELEASE or GLFW_REPEAT
+        double x = 0.0;     //Cursor position or scroll offset
+        double y = 0.0;
+        Clock::time_point timestamp;
+    };
+
+    //Hands events from the event thread to the simulation thread
+    class InputQueue {
+    public:
+        void push(const InputEvent& event);
+        //Appends everything queued so far to events
+        void drain(std::vector<InputEvent>& events);
+
+    private:
+        std::mutex m_mutex;
+        std::vector<InputEvent> m_events;
+    };
+
+    //Held keys and buttons as seen by the simulation after applying events in order
+    struct InputState {
+        static constexpr int MAX_KEYS = 512;
+        static constexpr int MAX_BUTTONS = 8;
+
+        bool keys[MAX_KEYS] = {};
+        bool buttons[MAX_BUTTONS] = {};
+        double cursor_x = 0.0;
+        double cursor_y = 0.0;
+        double scroll_x = 0.0;
+        double scroll_y = 0.0;
+
+        void apply(const InputEvent& event);
+        bool key_down(int key) const { return key >= 0 && key < MAX_KEYS && keys[key]; }
+        bool button_down(int button) const { return button >= 0 && button < MAX_BUTTONS && buttons[button]; }
+    };
+}
@@ -0,0 +1,114 @@
+#include "JobSystem.h"
+#include "../utils/Logger.h"
+#include <algorithm>
+
+namespace evoke::core {
+    void JobSystem::init(uint32_t worker_count){
+        if (worker_count == 0) {
+            worker_count = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+        }
+        
+        evoke::utils::Logger::info("Starting job system with ", worker_count, " workers!");
+
+        m_running = true;
+        for (uint32_t i = 0; i < worker_count; i++) {
+            m_workers.emplace_back([this, i]() {
+                t_thread_index = i + 1;
+                worker_loop();
+            });
+        }
+    }
+
+    void JobSystem::clean_up(){
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_running = false;
+        }
+        m_condition.notify_all();
+
+        for (auto& worker : m_workers) {
+            worker.join();
+        }
+        m_workers.clear();
+    }
+
+    void JobSystem::run_batches(uint32_t count, uint32_t batch_size, BatchFunction function, void* context){
+        if (count == 0) {
+            return;
+        }
+
+        batch_size = std::max(batch_size, 1u);
+        uint32_t batch_count = (count + batch_size - 1) / batch_size;
+
+        //Not worth a round trip through the queue
+        if (batch_count == 1 || m_workers.empty()) {
+            function(context, 0, count);
+            return;
+        }
+
+        std::atomic<uint32_t> remaining = batch_count;
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (uint32_t batch = 0; batch < batch_count; batch++) {
+                uint32_t begin = batch * batch_size;
+                uint32_t end = std::min(begin + batch_size, count);
+
+                m_jobs.push_back({function, context, &remaining, begin, end});
+            }
+        }
+        m_condition.notify_all();
+
+        //Help with queued jobs instead of blocking
+        while (remaining.load(std::memory_order_acquire) > 0) {
+            if (!run_one_job()) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    void JobSystem::worker_loop(){
+        while (true) {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_condition.wait(lock, [this]() { return !m_running || m_next_job < m_jobs.size(); });
+
+                if (!pop_job(job)) {
+                    return;
+                }
+            }
+            run_job(job);
+        }
+    }
+
+    bool JobSystem::run_one_job(){
+        Job job;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!pop_job(job)) {
+                return false;
+            }
+        }
+        run_job(job);
+        return true;
+    }
+
+    bool JobSystem::pop_job(Job& job){
+        if (m_next_job == m_jobs.size()) {
+            return false;
+        }
+
+        job = m_jobs[m_next_job++];
+        if (m_next_job == m_jobs.size()) {
+            m_jobs.clear();
+            m_next_job = 0;
+        }
+        return true;
+    }
+
+    void JobSystem::run_job(const Job& job){
+        job.function(job.context, job.begin, job.end);
+        job.remaining->fetch_sub(1, std::memory_order_release);
+    }
+}
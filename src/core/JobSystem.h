@@ -0,0 +1,64 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <memory>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace evoke::core {
+    //Fixed pool of worker threads. The calling thread helps out while it waits,
+    //so nested or single threaded use never deadlocks.
+    class JobSystem {
+    public:
+        //0 starts one worker per hardware thread, minus the calling thread
+        void init(uint32_t worker_count = 0);
+        void clean_up();
+
+        //Runs func(begin, end) over [0, count) in batches and returns once all batches finished.
+        //Batches call func by reference, queuing them never allocates.
+        template <typename Func>
+        void parallel_for(uint32_t count, uint32_t batch_size, Func&& func) {
+            using Callable = std::remove_reference_t<Func>;
+            run_batches(count, batch_size, [](void* context, uint32_t begin, uint32_t end) {
+                (*static_cast<Callable*>(context))(begin, end);
+            }, const_cast<void*>(static_cast<const void*>(std::addressof(func))));
+        }
+
+        uint32_t get_worker_count() const { return static_cast<uint32_t>(m_workers.size()); }
+        //Threads that may run jobs, the workers plus the one calling parallel_for
+        uint32_t get_thread_count() const { return get_worker_count() + 1; }
+        //0 on threads outside the pool, 1 to worker count on the workers
+        static uint32_t thread_index() { return t_thread_index; }
+
+    private:
+        using BatchFunction = void (*)(void* context, uint32_t begin, uint32_t end);
+
+        struct Job {
+            BatchFunction function;
+            void* context;
+            std::atomic<uint32_t>* remaining;
+            uint32_t begin;
+            uint32_t end;
+        };
+
+        static inline thread_local uint32_t t_thread_index = 0;
+
+        std::vector<std::thread> m_workers;
+        //Consumed from m_next_job on and cleared once drained, so the capacity is reused
+        std::vector<Job> m_jobs;
+        size_t m_next_job = 0;
+        std::mutex m_mutex;
+        std::condition_variable m_condition;
+        bool m_running = false;
+
+        void run_batches(uint32_t count, uint32_t batch_size, BatchFunction function, void* context);
+        void worker_loop();
+        bool run_one_job();
+        //m_mutex must be held
+        bool pop_job(Job& job);
+        static void run_job(const Job& job);
+    };
+}
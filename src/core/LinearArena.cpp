@@ -0,0 +1,72 @@
+#include "LinearArena.h"
+#include <algorithm>
+#include <cstdint>
+
+namespace evoke::core {
+    namespace {
+        //What new_delete_resource hands out without extra alignment work
+        constexpr size_t BLOCK_ALIGNMENT = alignof(std::max_align_t);
+    }
+
+    LinearArena::LinearArena(size_t block_size, std::pmr::memory_resource* upstream) : m_upstream(upstream), m_block_size(std::max<size_t>(block_size, 64)) {
+    }
+
+    LinearArena::~LinearArena(){
+        release();
+    }
+
+    void LinearArena::reset(){
+        //Overflowed last time, replace the blocks with one that fits the whole peak
+        if (m_blocks.size() > 1) {
+            size_t capacity = std::max(get_capacity(), m_peak);
+            release();
+            m_blocks.push_back({static_cast<std::byte*>(m_upstream->allocate(capacity, BLOCK_ALIGNMENT)), capacity});
+        }
+
+        m_current = 0;
+        m_offset = 0;
+        m_used = 0;
+    }
+
+    size_t LinearArena::get_capacity() const {
+        size_t capacity = 0;
+        for (const Block& block : m_blocks) {
+            capacity += block.size;
+        }
+        return capacity;
+    }
+
+    void* LinearArena::do_allocate(size_t bytes, size_t alignment){
+        while (m_current < m_blocks.size()) {
+            Block& block = m_blocks[m_current];
+            uintptr_t address = reinterpret_cast<uintptr_t>(block.data) + m_offset;
+            size_t padding = (alignment - address % alignment) % alignment;
+
+            if (m_offset + padding + bytes <= block.size) {
+                m_offset += padding + bytes;
+                m_used += padding + bytes;
+                m_peak = std::max(m_peak, m_used);
+                return block.data + m_offset - bytes;
+            }
+
+            //The rest of this block is wasted until the next reset
+            m_used += block.size - m_offset;
+            m_current++;
+            m_offset = 0;
+        }
+
+        size_t size = std::max(m_block_size, bytes + alignment);
+        m_blocks.push_back({static_cast<std::byte*>(m_upstream->allocate(size, BLOCK_ALIGNMENT)), size});
+        m_current = m_blocks.size() - 1;
+        return do_allocate(bytes, alignment);
+    }
+
+    void LinearArena::release(){
+        for (const Block& block : m_blocks) {
+            m_upstream->deallocate(block.data, block.size, BLOCK_ALIGNMENT);
+        }
+        m_blocks.clear();
+        m_current = 0;
+        m_offset = 0;
+    }
+}
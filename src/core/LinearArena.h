@@ -0,0 +1,51 @@
+#pragma once
+#include <cstddef>
+#include <memory_resource>
+#include <vector>
+
+namespace evoke::core {
+    //Bump allocator for temporaries that all die together, usable by any std::pmr container.
+    //Blocks come from the upstream resource and survive reset, overflow blocks are merged into one
+    //block of the peak size, so once an arena has seen its largest frame it stops allocating.
+    //Deallocation does nothing. Not thread safe, one arena per thread.
+    class LinearArena : public std::pmr::memory_resource {
+    public:
+        explicit LinearArena(size_t block_size = 64 * 1024, std::pmr::memory_resource* upstream = std::pmr::new_delete_resource());
+        ~LinearArena() override;
+
+        LinearArena(const LinearArena&) = delete;
+        LinearArena& operator=(const LinearArena&) = delete;
+
+        //Everything allocated since the last reset becomes invalid
+        void reset();
+
+        //Bytes handed out since the last reset, alignment padding included
+        size_t get_used() const { return m_used; }
+        //Highest get_used before any reset
+        size_t get_peak() const { return m_peak; }
+        size_t get_capacity() const;
+
+    protected:
+        void* do_allocate(size_t bytes, size_t alignment) override;
+        void do_deallocate(void*, size_t, size_t) override {}
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+    private:
+        struct Block {
+            std::byte* data;
+            size_t size;
+        };
+
+        std::pmr::memory_resource* m_upstream;
+        size_t m_block_size;
+
+        std::vector<Block> m_blocks;
+        size_t m_current = 0;
+        size_t m_offset = 0;
+
+        size_t m_used = 0;
+        size_t m_peak = 0;
+
+        void release();
+    };
+}
@@ -0,0 +1,104 @@
+#include "Simulation.h"
+#include "../utils/Logger.h"
+#include <algorithm>
+
+namespace evoke::core {
+    void Simulation::init(InputQueue& input_queue, const scene::SceneState& initial_state, double step){
+        m_input_queue = &input_queue;
+        m_state = initial_state;
+        m_step = std::chrono::duration<double>(step);
+
+        //The renderer has something to show before the first tick
+        scene::SceneSnapshot& snapshot = m_snapshots.write_buffer();
+        snapshot.time = Clock::now();
+        snapshot.previous = m_state;
+        snapshot.current = m_state;
+        m_snapshots.publish();
+    }
+
+    void Simulation::start(){
+        utils::Logger::info("Starting simulation at ", 1.0 / m_step.count(), " ticks per second!");
+
+        m_running = true;
+        m_thread = std::thread(&Simulation::run, this);
+    }
+
+    void Simulation::stop(){
+        m_running = false;
+        if (m_thread.joinable()) {
+            m_thread.join();
+        }
+    }
+
+    float Simulation::get_alpha(Clock::time_point now) const {
+        double alpha = std::chrono::duration<double>(now - get_snapshot().time).count() / m_step.count();
+        return static_cast<float>(std::clamp(alpha, 0.0, 1.0));
+    }
+
+    void Simulation::apply_input(Clock::time_point tick_time){
+        m_input_queue->drain(m_pending_events);
+
+        //Events belong to the first tick at or after the moment they happened
+        auto due = std::stable_partition(m_pending_events.begin(), m_pending_events.end(), [&](const InputEvent& event) { return event.timestamp <= tick_time; });
+        std::stable_sort(m_pending_events.begin(), due, [](const InputEvent& l, const InputEvent& r) { return l.timestamp < r.timestamp; });
+
+        for (auto it = m_pending_events.begin(); it != due; it++) {
+            m_input_state.apply(*it);
+            m_last_input_time = std::max(m_last_input_time, it->timestamp);
+        }
+        m_pending_events.erase(m_pending_events.begin(), due);
+    }
+
+    void Simulation::run(){
+        const auto step = std::chrono::duration_cast<Clock::duration>(m_step);
+        Clock::time_point next_tick = Clock::now();
+
+        scene::SceneState previous = m_state;
+
+        while (m_running) {
+            Clock::time_point now = Clock::now();
+            uint32_t ticks = 0;
+
+            while (now >= next_tick && ticks < MAX_CATCH_UP_TICKS) {
+                apply_input(next_tick);
+
+                previous = m_state;
+                m_state.written.clear();
+                if (m_update) {
+                    m_update(m_state, m_input_state, m_step.count());
+                }
+                m_input_state.scroll_x = 0.0;
+                m_input_state.scroll_y = 0.0;
+                m_batch_written.merge(m_state.written);
+
+                next_tick += step;
+                ticks++;
+                m_tick++;
+            }
+
+            //Too far behind, e.g. after a breakpoint, skip ahead instead of spiraling
+            if (ticks == MAX_CATCH_UP_TICKS && now >= next_tick) {
+                next_tick = now + step;
+            }
+
+            if (ticks > 0) {
+                scene::SceneSnapshot& snapshot = m_snapshots.write_buffer();
+                snapshot.tick = m_tick;
+                snapshot.time = next_tick - step;
+                snapshot.input_time = m_last_input_time;
+                snapshot.previous = previous;
+                snapshot.current = m_state;
+
+                //A snapshot the reader skipped hands its changes on to the next one
+                m_unread_written.merge(m_batch_written);
+                snapshot.changed = m_unread_written;
+                if (m_snapshots.publish()) {
+                    std::swap(m_unread_written, m_batch_written);
+                }
+                m_batch_written.clear();
+            }
+
+            std::this_thread::sleep_until(next_tick);
+        }
+    }
+}
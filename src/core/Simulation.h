@@ -0,0 +1,58 @@
+#pragma once
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <vector>
+#include "Input.h"
+#include "../scene/Scene.h"
+#include "../utils/TripleBuffer.h"
+
+namespace evoke::core {
+    //Runs the scene update at a fixed rate on its own thread, independent of the frame rate.
+    //Every batch of ticks is published as a snapshot the render thread picks up without blocking.
+    class Simulation {
+    public:
+        using UpdateFunction = std::function<void(scene::SceneState& state, const InputState& input, double step)>;
+
+        void init(InputQueue& input_queue, const scene::SceneState& initial_state, double step = 1.0 / 60.0);
+        void set_update(UpdateFunction update) { m_update = std::move(update); }
+
+        void start();
+        void stop();
+
+        //Render side, returns true if a newer snapshot arrived since the last call
+        bool acquire_snapshot() { return m_snapshots.acquire(); }
+        const scene::SceneSnapshot& get_snapshot() const { return m_snapshots.read_buffer(); }
+        //Interpolation factor between the snapshot's previous and current state at the given time
+        float get_alpha(Clock::time_point now) const;
+
+        double get_step() const { return m_step.count(); }
+        uint64_t get_tick() const { return m_tick; }
+
+    private:
+        //Ticks run back to back before the simulation gives up catching up and drops time
+        static constexpr uint32_t MAX_CATCH_UP_TICKS = 5;
+
+        InputQueue* m_input_queue = nullptr;
+        UpdateFunction m_update;
+        std::chrono::duration<double> m_step{1.0 / 60.0};
+
+        scene::SceneState m_state;
+        //Instances written during the current batch of ticks, and since the last snapshot the reader is
+        //known to have acquired
+        scene::DirtyBits m_batch_written;
+        scene::DirtyBits m_unread_written;
+        InputState m_input_state;
+        std::vector<InputEvent> m_pending_events;
+        Clock::time_point m_last_input_time;
+        std::atomic<uint64_t> m_tick{0};
+
+        utils::TripleBuffer<scene::SceneSnapshot> m_snapshots;
+
+        std::thread m_thread;
+        std::atomic<bool> m_running{false};
+
+        void run();
+        void apply_input(Clock::time_point tick_time);
+    };
+}
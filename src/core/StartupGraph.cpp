@@ -0,0 +1,119 @@
+#include "StartupGraph.h"
+#include "../utils/Logger.h"
+#include "../utils/Profiler.h"
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+
+namespace evoke::core {
+    StageId StartupGraph::add(const char* name, std::vector<StageId> dependencies, std::function<void()> function){
+        StageId id = static_cast<StageId>(m_stages.size());
+        for (StageId dependency : dependencies) {
+            if (dependency >= id) {
+                throw std::runtime_error("startup stage depends on a stage added after it!");
+            }
+            m_stages[dependency].dependents.push_back(id);
+        }
+
+        m_stages.push_back({name, std::move(dependencies), {}, std::move(function)});
+        return id;
+    }
+
+    void StartupGraph::run(JobSystem& job_system){
+        if (m_stages.empty()) {
+            return;
+        }
+
+        std::mutex mutex;
+        std::condition_variable condition;
+        std::vector<StageId> ready;
+        size_t finished = 0;
+        std::exception_ptr error;
+
+        //Reversed so the stack hands out stages in the order they were added
+        for (size_t i = m_stages.size(); i-- > 0;) {
+            m_stages[i].waiting = static_cast<uint32_t>(m_stages[i].dependencies.size());
+            if (m_stages[i].waiting == 0) {
+                ready.push_back(static_cast<StageId>(i));
+            }
+        }
+
+        Clock::time_point start = Clock::now();
+        auto elapsed_ms = [start]() { return std::chrono::duration<double, std::milli>(Clock::now() - start).count(); };
+
+        //Every thread takes ready stages until the graph is done. Stages may use the job system
+        //themselves, whoever waits on their batches helps run them.
+        uint32_t threads = std::min(job_system.get_thread_count(), static_cast<uint32_t>(m_stages.size()));
+        job_system.parallel_for(threads, 1, [&](uint32_t, uint32_t) {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (true) {
+                condition.wait(lock, [&]() { return !ready.empty() || finished == m_stages.size() || error; });
+                if (error || ready.empty()) {
+                    return;
+                }
+
+                Stage& stage = m_stages[ready.back()];
+                ready.pop_back();
+                lock.unlock();
+
+                std::exception_ptr stage_error;
+                stage.start_ms = elapsed_ms();
+                try {
+                    stage.function();
+                } catch (...) {
+                    stage_error = std::current_exception();
+                }
+                stage.end_ms = elapsed_ms();
+
+                lock.lock();
+                finished++;
+                if (stage_error) {
+                    if (!error) {
+                        error = stage_error;
+                    }
+                } else {
+                    for (StageId dependent : stage.dependents) {
+                        if (--m_stages[dependent].waiting == 0) {
+                            ready.push_back(dependent);
+                        }
+                    }
+                }
+                condition.notify_all();
+            }
+        });
+
+        m_total_ms = elapsed_ms();
+
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    void StartupGraph::report() const {
+        //Longest chain of dependent stages, the graph cannot finish faster than that
+        std::vector<double> path(m_stages.size(), 0.0);
+        double critical_path = 0.0;
+        double stage_total = 0.0;
+
+        for (size_t i = 0; i < m_stages.size(); i++) {
+            const Stage& stage = m_stages[i];
+            double duration = stage.end_ms - stage.start_ms;
+
+            for (StageId dependency : stage.dependencies) {
+                path[i] = std::max(path[i], path[dependency]);
+            }
+            path[i] += duration;
+            critical_path = std::max(critical_path, path[i]);
+            stage_total += duration;
+
+            utils::Logger::info("Startup stage ", stage.name, " took ", duration, " ms, started at ", stage.start_ms, " ms!");
+            utils::Profiler::set_counter("startup." + std::string(stage.name) + "_ms", duration);
+        }
+
+        utils::Logger::info("Startup took ", m_total_ms, " ms for ", stage_total, " ms of stages, critical path ", critical_path, " ms!");
+        utils::Profiler::set_counter("startup.total_ms", m_total_ms);
+    }
+}
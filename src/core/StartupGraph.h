@@ -0,0 +1,42 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "Input.h"
+#include "JobSystem.h"
+
+namespace evoke::core {
+    using StageId = uint32_t;
+
+    //Startup work as a dependency graph. A stage starts as soon as everything it depends on finished,
+    //independent stages run at the same time on the job system. Stages on different branches must not
+    //touch the same state unless it is thread safe.
+    class StartupGraph {
+    public:
+        //Dependencies have to be added first, so the graph can never contain a cycle
+        StageId add(const char* name, std::vector<StageId> dependencies, std::function<void()> function);
+
+        //Blocks until every stage finished. The first exception stops stages that did not start yet
+        //and is rethrown once the running ones returned.
+        void run(JobSystem& job_system);
+
+        //Logs the stage timings of the last run with its critical path, and publishes them as
+        //startup.<stage>_ms profiler counters
+        void report() const;
+        double get_total_ms() const { return m_total_ms; }
+
+    private:
+        struct Stage {
+            const char* name;
+            std::vector<StageId> dependencies;
+            std::vector<StageId> dependents;
+            std::function<void()> function;
+            uint32_t waiting = 0;
+            double start_ms = 0.0;
+            double end_ms = 0.0;
+        };
+
+        std::vector<Stage> m_stages;
+        double m_total_ms = 0.0;
+    };
+}
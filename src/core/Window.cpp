@@ -11,6 +11,10 @@ namespace evoke::core {
         
         m_glfw_window = glfwCreateWindow(WIDTH, HEIGHT, NAME, nullptr, nullptr);
         glfwSetWindowUserPointer(m_glfw_window, this);
+        glfwSetKeyCallback(m_glfw_window, key_callback);
+        glfwSetMouseButtonCallback(m_glfw_window, mouse_button_callback);
+        glfwSetCursorPosCallback(m_glfw_window, cursor_position_callback);
+        glfwSetScrollCallback(m_glfw_window, scroll_callback);
         
         evoke::utils::Logger::info("Window Width: ", WIDTH);
         evoke::utils::Logger::info("Window Height: ", HEIGHT);
@@ -26,4 +30,35 @@ namespace evoke::core {
         
         evoke::utils::Logger::info("Window cleaned up successfully!");
     }
-}
\ No newline at end of file
+    
+    void Window::key_callback(GLFWwindow* window, int key, int scancode, int action, int mods){
+        auto* self = static_cast<Window*>(glfwGetWindowUserPointer(window));
+        self->m_input_queue.push({InputType::Key, key, action, 0.0, 0.0, Clock::now()});
+    }
+    
+    void Window::mouse_button_callback(GLFWwindow* window, int button, int action, int mods){
+        auto* self = static_cast<Window*>(glfwGetWindowUserPointer(window));
+        Clock::time_point now = Clock::now();
+        self->m_input_queue.push({InputType::MouseButton, button, action, 0.0, 0.0, now});
+        
+        if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS) {
+            double x, y;
+            int width, height;
+            glfwGetCursorPos(window, &x, &y);
+            glfwGetWindowSize(window, &width, &height);
+            if (width > 0 && height > 0) {
+                self->m_pick_queue.push({InputType::MouseButton, button, action, x / width, y / height, now});
+            }
+        }
+    }
+    
+    void Window::cursor_position_callback(GLFWwindow* window, double x, double y){
+        auto* self = static_cast<Window*>(glfwGetWindowUserPointer(window));
+        self->m_input_queue.push({InputType::CursorMove, 0, 0, x, y, Clock::now()});
+    }
+    
+    void Window::scroll_callback(GLFWwindow* window, double x, double y){
+        auto* self = static_cast<Window*>(glfwGetWindowUserPointer(window));
+        self->m_input_queue.push({InputType::Scroll, 0, 0, x, y, Clock::now()});
+    }
+}
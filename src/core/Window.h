@@ -1,6 +1,7 @@
 #pragma once
 #include <GLFW/glfw3.h>
 #include <cstdint>
+#include "Input.h"
 
 namespace evoke::core {
     class Window{
@@ -13,8 +14,19 @@ namespace evoke::core {
         void clean_up();
         
         GLFWwindow* get_glfw_window() { return m_glfw_window; }
+        InputQueue& get_input_queue() { return m_input_queue; }
+        //Left clicks with the cursor in [0, 1] window coordinates, for picking on the render thread
+        InputQueue& get_pick_queue() { return m_pick_queue; }
         
     private:
         GLFWwindow* m_glfw_window;
+        InputQueue m_input_queue;
+        InputQueue m_pick_queue;
+        
+        //GLFW callbacks, timestamp events on the event thread and queue them for the simulation
+        static void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods);
+        static void mouse_button_callback(GLFWwindow* window, int button, int action, int mods);
+        static void cursor_position_callback(GLFWwindow* window, double x, double y);
+        static void scroll_callback(GLFWwindow* window, double x, double y);
     };
 }
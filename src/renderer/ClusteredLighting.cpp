@@ -0,0 +1,202 @@
+#include "ClusteredLighting.h"
+#include "../utils/Logger.h"
+#include <algorithm>
+#include <cstring>
+
+namespace evoke::vulkan {
+    namespace {
+        //local_size_x of light_bin.comp
+        constexpr uint32_t BIN_WORKGROUP_SIZE = 64;
+
+        //Matches the start of LightBuffer in lighting_common.glsl, the lights follow it
+        struct LightingHeader {
+            glm::mat4 view;
+            glm::mat4 inverse_projection;
+            glm::vec4 ambient;
+            glm::vec2 extent;
+            float near_plane;
+            float far_plane;
+            uint32_t light_count;
+            uint32_t pad[3];
+        };
+        static_assert(sizeof(LightingHeader) == 176, "the header must match the std430 layout of the shaders");
+
+        //Matches BinStatsBuffer in light_bin.comp
+        struct BinStats {
+            uint32_t occupied_clusters;
+            uint32_t overflowed_clusters;
+            uint32_t dropped_lights;
+            uint32_t max_cluster_lights;
+        };
+
+        void buffer_barrier(VkCommandBuffer command_buffer, VkBuffer buffer, VkPipelineStageFlags2 src_stage_mask, VkAccessFlags2 src_access_mask, VkPipelineStageFlags2 dst_stage_mask, VkAccessFlags2 dst_access_mask){
+            VkBufferMemoryBarrier2 barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2;
+            barrier.srcStageMask = src_stage_mask;
+            barrier.srcAccessMask = src_access_mask;
+            barrier.dstStageMask = dst_stage_mask;
+            barrier.dstAccessMask = dst_access_mask;
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.buffer = buffer;
+            barrier.offset = 0;
+            barrier.size = VK_WHOLE_SIZE;
+
+            VkDependencyInfo dependency_info{};
+            dependency_info.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+            dependency_info.bufferMemoryBarrierCount = 1;
+            dependency_info.pBufferMemoryBarriers = &barrier;
+
+            vkCmdPipelineBarrier2(command_buffer, &dependency_info);
+        }
+
+        //Lights and clusters as bindings 0 and 1, binning adds its counters as 2. The same layout the shaders reflect to.
+        VkDescriptorSetLayout get_lighting_layout(evResources& resources, VkShaderStageFlags stage, uint32_t binding_count){
+            std::vector<VkDescriptorSetLayoutBinding> bindings(binding_count);
+            for (uint32_t i = 0; i < binding_count; i++) {
+                bindings[i].binding = i;
+                bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+                bindings[i].descriptorCount = 1;
+                bindings[i].stageFlags = stage;
+            }
+            return resources.get_set_layout(bindings);
+        }
+    }
+
+    void ClusteredLighting::init(VkDevice device, const FeatureTiers& tiers, evResources& resources, ReadbackService& readback, uint32_t frames_in_flight, uint32_t max_lights){
+        m_device = device;
+        m_resources = &resources;
+        m_readback = &readback;
+        m_max_lights = max_lights;
+        m_frames.resize(frames_in_flight);
+
+        m_bin_pipeline = m_pipeline_builder.create_compute_pipeline(device, "light_bin.spv", 0, resources);
+
+        //Compute and fragment reflect to different set layouts, so each frame gets a set for both
+        VkDescriptorSetLayout binning_layout = get_lighting_layout(resources, VK_SHADER_STAGE_COMPUTE_BIT, 3);
+        VkDescriptorSetLayout fragment_layout = get_lighting_layout(resources, VK_SHADER_STAGE_FRAGMENT_BIT, 2);
+
+        VkDescriptorPoolSize pool_size{};
+        pool_size.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        pool_size.descriptorCount = 5 * frames_in_flight;
+
+        VkDescriptorPoolCreateInfo pool_info{};
+        pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        pool_info.maxSets = 2 * frames_in_flight;
+        pool_info.poolSizeCount = 1;
+        pool_info.pPoolSizes = &pool_size;
+
+        if (vkCreateDescriptorPool(device, &pool_info, nullptr, &m_descriptor_pool) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create lighting descriptor pool!");
+        }
+
+        for (auto& frame : m_frames) {
+            frame.lights = resources.create_buffer(sizeof(LightingHeader) + sizeof(PointLight) * max_lights, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, streaming_memory(tiers));
+            frame.clusters = resources.create_buffer(sizeof(uint32_t) * (MAX_CLUSTER_LIGHTS + 1) * CLUSTER_COUNT, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+            frame.bin_stats = resources.create_buffer(sizeof(BinStats), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+            frame.mapped_lights = resources.map_buffer(frame.lights);
+
+            VkDescriptorSetLayout layouts[] = {binning_layout, fragment_layout};
+            VkDescriptorSet sets[2];
+
+            VkDescriptorSetAllocateInfo alloc_info{};
+            alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+            alloc_info.descriptorPool = m_descriptor_pool;
+            alloc_info.descriptorSetCount = 2;
+            alloc_info.pSetLayouts = layouts;
+
+            if (vkAllocateDescriptorSets(device, &alloc_info, sets) != VK_SUCCESS) {
+                throw std::runtime_error("failed to allocate lighting descriptor sets!");
+            }
+            frame.binning_set = sets[0];
+            frame.fragment_set = sets[1];
+
+            VkDescriptorBufferInfo buffer_infos[] = {
+                {resources.get(frame.lights).handle, 0, VK_WHOLE_SIZE},
+                {resources.get(frame.clusters).handle, 0, VK_WHOLE_SIZE},
+                {resources.get(frame.bin_stats).handle, 0, VK_WHOLE_SIZE}
+            };
+
+            //Bindings 0 to 2 of the binning set, then 0 and 1 of the fragment set
+            VkWriteDescriptorSet writes[5]{};
+            for (uint32_t i = 0; i < 5; i++) {
+                uint32_t binding = i < 3 ? i : i - 3;
+                writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+                writes[i].dstSet = i < 3 ? frame.binning_set : frame.fragment_set;
+                writes[i].dstBinding = binding;
+                writes[i].descriptorCount = 1;
+                writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+                writes[i].pBufferInfo = &buffer_infos[binding];
+            }
+            vkUpdateDescriptorSets(device, 5, writes, 0, nullptr);
+        }
+    }
+
+    void ClusteredLighting::clean_up(){
+        for (auto& frame : m_frames) {
+            frame.binning_set = VK_NULL_HANDLE;
+            frame.fragment_set = VK_NULL_HANDLE;
+        }
+        vkDestroyDescriptorPool(m_device, m_descriptor_pool, nullptr);
+    }
+
+    void ClusteredLighting::set_lights(const std::vector<PointLight>& lights){
+        m_lights.assign(lights.begin(), lights.begin() + std::min<size_t>(lights.size(), m_max_lights));
+    }
+
+    void ClusteredLighting::prepare(uint32_t frame, const scene::Camera& camera, VkExtent2D extent){
+        float aspect = static_cast<float>(extent.width) / static_cast<float>(extent.height);
+
+        LightingHeader header{};
+        header.view = camera.view();
+        header.inverse_projection = glm::inverse(camera.projection(aspect));
+        header.ambient = glm::vec4(m_ambient, 0.0f);
+        header.extent = glm::vec2(static_cast<float>(extent.width), static_cast<float>(extent.height));
+        header.near_plane = camera.near_plane;
+        header.far_plane = camera.far_plane;
+        header.light_count = static_cast<uint32_t>(m_lights.size());
+
+        uint8_t* mapped = static_cast<uint8_t*>(m_frames[frame].mapped_lights);
+        memcpy(mapped, &header, sizeof(header));
+        if (!m_lights.empty()) {
+            memcpy(mapped + sizeof(header), m_lights.data(), sizeof(PointLight) * m_lights.size());
+        }
+
+        m_stats.lights = header.light_count;
+    }
+
+    void ClusteredLighting::record_binning(VkCommandBuffer command_buffer, uint32_t frame){
+        const FrameBuffers& buffers = m_frames[frame];
+        const evPipeline& pipeline = m_resources->get(m_bin_pipeline);
+
+        VkBuffer bin_stats = m_resources->get(buffers.bin_stats).handle;
+
+        //The counters are accumulated with atomics, every frame starts from zero
+        vkCmdFillBuffer(command_buffer, bin_stats, 0, VK_WHOLE_SIZE, 0);
+        buffer_barrier(command_buffer, bin_stats,
+            VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+            VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT);
+
+        vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline.handle);
+        vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline.layout, 0, 1, &buffers.binning_set, 0, nullptr);
+        vkCmdDispatch(command_buffer, (CLUSTER_COUNT + BIN_WORKGROUP_SIZE - 1) / BIN_WORKGROUP_SIZE, 1, 1);
+
+        buffer_barrier(command_buffer, m_resources->get(buffers.clusters).handle,
+            VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+            VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT);
+
+        m_readback->read_buffer(command_buffer, bin_stats, 0, sizeof(BinStats), [this](const void* data, VkDeviceSize) {
+            BinStats stats;
+            memcpy(&stats, data, sizeof(stats));
+            m_stats.occupied_clusters = stats.occupied_clusters;
+            m_stats.overflowed_clusters = stats.overflowed_clusters;
+            m_stats.dropped_lights = stats.dropped_lights;
+            m_stats.max_cluster_lights = stats.max_cluster_lights;
+
+            if (stats.overflowed_clusters > 0 && !m_overflow_reported) {
+                utils::Logger::error(stats.overflowed_clusters, " light clusters hold more than ", MAX_CLUSTER_LIGHTS, " lights, ", stats.dropped_lights, " lights were dropped!");
+                m_overflow_reported = true;
+            }
+        });
+    }
+}
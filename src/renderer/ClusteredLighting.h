@@ -0,0 +1,86 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <vector>
+#include "VulkanPipeline.h"
+#include "FeatureTiers.h"
+#include "evResources.h"
+#include "ReadbackService.h"
+#include "../scene/Camera.h"
+
+namespace evoke::vulkan {
+    //Matches PointLight in src/shaders/lighting_common.glsl
+    struct PointLight {
+        glm::vec3 position{0.0f};
+        float radius = 1.0f;            //No light reaches past this
+        glm::vec3 color{1.0f};
+        float intensity = 1.0f;
+    };
+    static_assert(sizeof(PointLight) == 32, "lights must match the std430 layout of the shaders");
+
+    struct LightingStats {
+        uint32_t lights = 0;
+        //Measured by the binning pass and read back, so they trail the light count by a few frames
+        uint32_t occupied_clusters = 0;
+        //Clusters touched by more than MAX_CLUSTER_LIGHTS lights, the ones past it are dropped
+        uint32_t overflowed_clusters = 0;
+        uint32_t dropped_lights = 0;
+        uint32_t max_cluster_lights = 0;
+    };
+
+    //Clustered forward lighting. Every frame a compute pass bins the lights into a froxel grid of screen
+    //tiles times exponential depth slices, and frag.spv only loops over the lights of its fragment's
+    //cluster, so the cost per pixel follows the lights nearby instead of the total light count.
+    class ClusteredLighting {
+    public:
+        //Must match lighting_common.glsl
+        static constexpr uint32_t CLUSTERS_X = 16;
+        static constexpr uint32_t CLUSTERS_Y = 9;
+        static constexpr uint32_t CLUSTERS_Z = 24;
+        static constexpr uint32_t CLUSTER_COUNT = CLUSTERS_X * CLUSTERS_Y * CLUSTERS_Z;
+        //Lights of a cluster past this are dropped
+        static constexpr uint32_t MAX_CLUSTER_LIGHTS = 127;
+
+        void init(VkDevice device, const FeatureTiers& tiers, evResources& resources, ReadbackService& readback, uint32_t frames_in_flight, uint32_t max_lights = 4096);
+        void clean_up();
+
+        //Lights past max_lights are ignored
+        void set_lights(const std::vector<PointLight>& lights);
+        //Light every lit fragment receives, white by default so scenes without lights keep their colors
+        void set_ambient(const glm::vec3& ambient) { m_ambient = ambient; }
+
+        //Writes the frame's lights and camera, the frame's buffers must no longer be in use by the GPU
+        void prepare(uint32_t frame, const scene::Camera& camera, VkExtent2D extent);
+        //Outside of rendering, before the frame's shading pass
+        void record_binning(VkCommandBuffer command_buffer, uint32_t frame);
+
+        //Set 0 of every pipeline shading with frag.spv
+        VkDescriptorSet get_descriptor_set(uint32_t frame) const { return m_frames[frame].fragment_set; }
+        const LightingStats& get_stats() const { return m_stats; }
+
+    private:
+        //Per frame in flight, the lights persistently mapped
+        struct FrameBuffers {
+            BufferHandle lights;
+            BufferHandle clusters;
+            //Counters of the binning pass, see BinStats
+            BufferHandle bin_stats;
+            void* mapped_lights = nullptr;
+            VkDescriptorSet binning_set = VK_NULL_HANDLE;
+            VkDescriptorSet fragment_set = VK_NULL_HANDLE;
+        };
+
+        VkDevice m_device = VK_NULL_HANDLE;
+        evResources* m_resources = nullptr;
+        ReadbackService* m_readback = nullptr;
+        Pipeline m_pipeline_builder;
+        PipelineHandle m_bin_pipeline;
+        VkDescriptorPool m_descriptor_pool = VK_NULL_HANDLE;
+
+        std::vector<FrameBuffers> m_frames;
+        std::vector<PointLight> m_lights;
+        uint32_t m_max_lights = 0;
+        glm::vec3 m_ambient{1.0f};
+        LightingStats m_stats;
+        bool m_overflow_reported = false;
+    };
+}
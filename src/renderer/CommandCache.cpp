@@ -0,0 +1,82 @@
+#include "CommandCache.h"
+#include <stdexcept>
+
+namespace evoke::vulkan {
+    void CommandCache::init(VkDevice device, uint32_t queue_family, uint32_t slot_count){
+        m_device = device;
+
+        VkCommandPoolCreateInfo pool_info{};
+        pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+        pool_info.queueFamilyIndex = queue_family;
+
+        if (vkCreateCommandPool(device, &pool_info, nullptr, &m_command_pool) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create command cache pool!");
+        }
+
+        std::vector<VkCommandBuffer> command_buffers(slot_count);
+
+        VkCommandBufferAllocateInfo allocate_info{};
+        allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocate_info.commandPool = m_command_pool;
+        allocate_info.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        allocate_info.commandBufferCount = slot_count;
+
+        if (vkAllocateCommandBuffers(device, &allocate_info, command_buffers.data()) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate cached command buffers!");
+        }
+
+        m_slots.clear();
+        for (VkCommandBuffer command_buffer : command_buffers) {
+            m_slots.push_back({command_buffer});
+        }
+        m_stats = {};
+    }
+
+    void CommandCache::clean_up(){
+        //Frees the command buffers with it
+        vkDestroyCommandPool(m_device, m_command_pool, nullptr);
+        m_command_pool = VK_NULL_HANDLE;
+        m_slots.clear();
+    }
+
+    bool CommandCache::begin(uint32_t slot, uint64_t hash, VkCommandBuffer& command_buffer){
+        Slot& cached = m_slots[slot];
+        command_buffer = cached.command_buffer;
+
+        if (cached.valid && cached.hash == hash) {
+            m_stats.replayed++;
+            return false;
+        }
+
+        //Passes begin their own rendering, nothing is inherited from the primary
+        VkCommandBufferInheritanceInfo inheritance_info{};
+        inheritance_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+
+        VkCommandBufferBeginInfo begin_info{};
+        begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        begin_info.pInheritanceInfo = &inheritance_info;
+
+        //Resets the previous recording implicitly
+        if (vkBeginCommandBuffer(command_buffer, &begin_info) != VK_SUCCESS) {
+            throw std::runtime_error("failed to begin recording cached command buffer!");
+        }
+
+        cached.hash = hash;
+        cached.valid = true;
+        m_stats.recorded++;
+        return true;
+    }
+
+    void CommandCache::invalidate(){
+        for (Slot& slot : m_slots) {
+            slot.valid = false;
+        }
+    }
+
+    CommandCacheStats CommandCache::take_stats(){
+        CommandCacheStats stats = m_stats;
+        m_stats = {};
+        return stats;
+    }
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <vector>
+
+namespace evoke::vulkan {
+    struct CommandCacheStats {
+        uint32_t recorded = 0;
+        uint32_t replayed = 0;
+    };
+
+    //Secondary command buffers kept together with a hash of everything they were recorded from.
+    //A slot is recorded again only when its hash changed or the cache was invalidated, otherwise the
+    //previous recording is replayed as is. Hashes cover handles, not contents, so data written to
+    //buffers between frames never invalidates a slot.
+    class CommandCache {
+    public:
+        //Owns a command pool on the queue family, secondaries are executed from its primaries
+        void init(VkDevice device, uint32_t queue_family, uint32_t slot_count);
+        void clean_up();
+
+        //Returns the slot's command buffer. If it is out of date it has been begun and true is returned,
+        //the caller records and ends it. The slot's previous submission must have finished.
+        bool begin(uint32_t slot, uint64_t hash, VkCommandBuffer& command_buffer);
+
+        //Records everything again, e.g. after pipelines were rebuilt under the same handles
+        void invalidate();
+
+        //Counts since the last call
+        CommandCacheStats take_stats();
+
+    private:
+        struct Slot {
+            VkCommandBuffer command_buffer = VK_NULL_HANDLE;
+            uint64_t hash = 0;
+            bool valid = false;
+        };
+
+        VkDevice m_device = VK_NULL_HANDLE;
+        VkCommandPool m_command_pool = VK_NULL_HANDLE;
+        std::vector<Slot> m_slots;
+        CommandCacheStats m_stats;
+    };
+}
@@ -0,0 +1,215 @@
+#include "ComputePrimitives.h"
+#include <algorithm>
+#include <numeric>
+
+namespace evoke::vulkan {
+    namespace {
+        //Even, so a sort ends in the buffers it started in
+        static_assert((32 / ComputePrimitives::RADIX_BITS) % 2 == 0, "radix passes per key word must be even!");
+
+        uint32_t group_count(uint32_t threads, uint32_t workgroup_size){
+            return std::max((threads + workgroup_size - 1) / workgroup_size, 1u);
+        }
+
+        //Compute results become visible to later kernels and to the indirect arguments they read
+        void compute_barrier(VkCommandBuffer command_buffer){
+            VkMemoryBarrier2 barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+            barrier.srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+            barrier.srcAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+            barrier.dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT;
+            barrier.dstAccessMask = VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT | VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT;
+
+            VkDependencyInfo dependency_info{};
+            dependency_info.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+            dependency_info.memoryBarrierCount = 1;
+            dependency_info.pMemoryBarriers = &barrier;
+
+            vkCmdPipelineBarrier2(command_buffer, &dependency_info);
+        }
+    }
+
+    void ComputePrimitives::init(VkDevice device, const evPhysicalDevice& physical_device, evResources& resources, uint32_t max_elements){
+        m_resources = &resources;
+        m_max_elements = std::clamp(max_elements, 1u, MAX_ELEMENTS);
+
+        const DeviceFeatureSupport& support = physical_device.get().feature_support;
+        if (!support.buffer_device_address || !support.subgroup_arithmetic) {
+            utils::Logger::error("Compute primitives need buffer device address and subgroup arithmetic, compute primitives disabled!");
+            return;
+        }
+
+        m_scan_reduce_pipeline = m_pipeline_builder.create_compute_pipeline(device, "scan_reduce.spv", sizeof(ScanPushConstants), resources);
+        m_scan_block_pipeline = m_pipeline_builder.create_compute_pipeline(device, "scan_block.spv", sizeof(ScanPushConstants), resources);
+        m_radix_count_pipeline = m_pipeline_builder.create_compute_pipeline(device, "radix_count.spv", sizeof(RadixSortPushConstants), resources);
+        m_radix_scatter_pipeline = m_pipeline_builder.create_compute_pipeline(device, "radix_scatter.spv", sizeof(RadixSortPushConstants), resources);
+        m_compact_pipeline = m_pipeline_builder.create_compute_pipeline(device, "compact.spv", sizeof(CompactPushConstants), resources);
+
+        //Compaction scans max_elements flags, the largest scan any primitive runs
+        uint32_t sum_words = 1;
+        for (uint32_t count = m_max_elements; count > SCAN_BLOCK;) {
+            count = group_count(count, SCAN_BLOCK);
+            sum_words += count;
+        }
+        uint32_t tiles = group_count(m_max_elements, WORKGROUP_SIZE);
+
+        const VkBufferUsageFlags storage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+        const VkDeviceSize words = sizeof(uint32_t);
+        m_scan_sums = resources.create_buffer(words * sum_words, storage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        m_histogram = resources.create_buffer(words * RADIX_BINS * tiles, storage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        m_sort_keys = resources.create_buffer(words * 2 * m_max_elements, storage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        m_sort_payloads = resources.create_buffer(words * m_max_elements, storage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        m_offsets = resources.create_buffer(words * m_max_elements, storage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+        m_enabled = true;
+        utils::Logger::info("Compute primitives created for ", m_max_elements, " elements!");
+    }
+
+    void ComputePrimitives::clean_up(){
+        if (!m_enabled) {
+            return;
+        }
+        m_enabled = false;
+
+        for (BufferHandle buffer : {m_scan_sums, m_histogram, m_sort_keys, m_sort_payloads, m_offsets}) {
+            m_resources->destroy_buffer(buffer);
+        }
+        for (PipelineHandle pipeline : {m_scan_reduce_pipeline, m_scan_block_pipeline, m_radix_count_pipeline, m_radix_scatter_pipeline, m_compact_pipeline}) {
+            m_resources->destroy_pipeline(pipeline);
+        }
+    }
+
+    void ComputePrimitives::record_exclusive_scan(VkCommandBuffer command_buffer, VkDeviceAddress values, VkDeviceAddress results, uint32_t count){
+        if (!m_enabled || count == 0) {
+            return;
+        }
+        check_count(count);
+
+        record_scan(command_buffer, values, results, count, m_resources->get(m_scan_sums).address);
+    }
+
+    void ComputePrimitives::record_scan(VkCommandBuffer command_buffer, VkDeviceAddress values, VkDeviceAddress results, uint32_t count, VkDeviceAddress block_sums){
+        uint32_t blocks = group_count(count, SCAN_BLOCK);
+
+        ScanPushConstants push_constants{};
+        push_constants.values = values;
+        push_constants.results = results;
+        push_constants.block_sums = block_sums;
+        push_constants.count = count;
+
+        //Block sums are scanned in place like any other array, their own sums go right behind them
+        if (blocks > 1) {
+            dispatch(command_buffer, m_scan_reduce_pipeline, &push_constants, sizeof(push_constants), blocks);
+            compute_barrier(command_buffer);
+            record_scan(command_buffer, block_sums, block_sums, blocks, block_sums + sizeof(uint32_t) * blocks);
+            push_constants.add_block_sums = 1;
+        }
+
+        dispatch(command_buffer, m_scan_block_pipeline, &push_constants, sizeof(push_constants), blocks);
+        compute_barrier(command_buffer);
+    }
+
+    void ComputePrimitives::record_radix_sort(VkCommandBuffer command_buffer, VkDeviceAddress keys, VkDeviceAddress payloads, uint32_t count, uint32_t key_bits){
+        if (!m_enabled || count == 0) {
+            return;
+        }
+        check_count(count);
+        if (key_bits != 32 && key_bits != 64) {
+            throw std::runtime_error("radix sort keys must be 32 or 64 bit!");
+        }
+
+        uint32_t tiles = group_count(count, WORKGROUP_SIZE);
+        VkDeviceAddress histogram = m_resources->get(m_histogram).address;
+        VkDeviceAddress block_sums = m_resources->get(m_scan_sums).address;
+
+        RadixSortPushConstants push_constants{};
+        push_constants.keys = keys;
+        push_constants.sorted_keys = m_resources->get(m_sort_keys).address;
+        push_constants.payloads = payloads;
+        push_constants.sorted_payloads = m_resources->get(m_sort_payloads).address;
+        push_constants.histogram = histogram;
+        push_constants.count = count;
+        push_constants.key_words = key_bits / 32;
+        push_constants.has_payloads = payloads != 0;
+
+        for (uint32_t shift = 0; shift < key_bits; shift += RADIX_BITS) {
+            push_constants.shift = shift;
+
+            dispatch(command_buffer, m_radix_count_pipeline, &push_constants, sizeof(push_constants), tiles);
+            compute_barrier(command_buffer);
+            record_scan(command_buffer, histogram, histogram, RADIX_BINS * tiles, block_sums);
+            dispatch(command_buffer, m_radix_scatter_pipeline, &push_constants, sizeof(push_constants), tiles);
+            compute_barrier(command_buffer);
+
+            std::swap(push_constants.keys, push_constants.sorted_keys);
+            std::swap(push_constants.payloads, push_constants.sorted_payloads);
+        }
+    }
+
+    void ComputePrimitives::record_compact(VkCommandBuffer command_buffer, VkDeviceAddress values, VkDeviceAddress flags, VkDeviceAddress results, VkDeviceAddress result_count, uint32_t count){
+        if (!m_enabled || count == 0) {
+            return;
+        }
+        check_count(count);
+
+        VkDeviceAddress offsets = m_resources->get(m_offsets).address;
+        record_scan(command_buffer, flags, offsets, count, m_resources->get(m_scan_sums).address);
+
+        CompactPushConstants push_constants{};
+        push_constants.values = values;
+        push_constants.flags = flags;
+        push_constants.offsets = offsets;
+        push_constants.results = results;
+        push_constants.result_count = result_count;
+        push_constants.count = count;
+
+        dispatch(command_buffer, m_compact_pipeline, &push_constants, sizeof(push_constants), group_count(count, WORKGROUP_SIZE));
+        compute_barrier(command_buffer);
+    }
+
+    void ComputePrimitives::dispatch(VkCommandBuffer command_buffer, PipelineHandle pipeline, const void* push_constants, uint32_t size, uint32_t group_count){
+        const evPipeline& compute_pipeline = m_resources->get(pipeline);
+        vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, compute_pipeline.handle);
+        vkCmdPushConstants(command_buffer, compute_pipeline.layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, size, push_constants);
+        vkCmdDispatch(command_buffer, group_count, 1, 1);
+    }
+
+    void ComputePrimitives::check_count(uint32_t count) const{
+        if (count > m_max_elements) {
+            throw std::runtime_error("more elements than the compute primitives were created for!");
+        }
+    }
+
+    std::vector<uint32_t> exclusive_scan_reference(std::span<const uint32_t> values){
+        std::vector<uint32_t> results(values.size());
+        std::exclusive_scan(values.begin(), values.end(), results.begin(), 0u);
+        return results;
+    }
+
+    void radix_sort_reference(std::vector<uint64_t>& keys, std::vector<uint32_t>& payloads){
+        std::vector<uint32_t> order(keys.size());
+        std::iota(order.begin(), order.end(), 0u);
+        std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return keys[a] < keys[b]; });
+
+        std::vector<uint64_t> sorted_keys(keys.size());
+        std::vector<uint32_t> sorted_payloads(payloads.size());
+        for (size_t i = 0; i < order.size(); i++) {
+            sorted_keys[i] = keys[order[i]];
+            if (!payloads.empty()) {
+                sorted_payloads[i] = payloads[order[i]];
+            }
+        }
+        keys = std::move(sorted_keys);
+        payloads = std::move(sorted_payloads);
+    }
+
+    std::vector<uint32_t> compact_reference(std::span<const uint32_t> values, std::span<const uint32_t> flags){
+        std::vector<uint32_t> results;
+        for (size_t i = 0; i < values.size(); i++) {
+            if (flags[i] != 0) {
+                results.push_back(values[i]);
+            }
+        }
+        return results;
+    }
+}
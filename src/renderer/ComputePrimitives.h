@@ -0,0 +1,104 @@
+#pragma once
+#include <span>
+#include <vector>
+#include "VulkanPipeline.h"
+#include "evPhysicalDevice.h"
+#include "evResources.h"
+
+namespace evoke::vulkan {
+    //Matches the push constant blocks of scan_reduce.comp and scan_block.comp
+    struct ScanPushConstants {
+        VkDeviceAddress values;
+        VkDeviceAddress results;
+        VkDeviceAddress block_sums;
+        uint32_t count;
+        uint32_t add_block_sums;
+    };
+
+    //Matches the push constant block in primitives_common.glsl
+    struct RadixSortPushConstants {
+        VkDeviceAddress keys;
+        VkDeviceAddress sorted_keys;
+        VkDeviceAddress payloads;
+        VkDeviceAddress sorted_payloads;
+        VkDeviceAddress histogram;
+        uint32_t count;
+        uint32_t shift;
+        uint32_t key_words;
+        uint32_t has_payloads;
+    };
+
+    //Matches the push constant block in compact.comp
+    struct CompactPushConstants {
+        VkDeviceAddress values;
+        VkDeviceAddress flags;
+        VkDeviceAddress offsets;
+        VkDeviceAddress results;
+        VkDeviceAddress result_count;
+        uint32_t count;
+        uint32_t pad;
+    };
+
+    //GPU building blocks over arrays of 32 bit words reached through device addresses: exclusive
+    //scan, stable LSD radix sort of 32 or 64 bit keys with optional payloads, and stream compaction.
+    //Scans are reduce-then-scan with subgroup operations inside the workgroup, the sort counts
+    //4 bit digits per tile, scans the digit-major histogram with the same scan and scatters tiles
+    //sorted by digit in shared memory. Everything is recorded outside of rendering, results are
+    //visible to later compute shaders and indirect reads.
+    class ComputePrimitives {
+    public:
+        //Must match primitives_common.glsl
+        static constexpr uint32_t WORKGROUP_SIZE = 256;
+        static constexpr uint32_t SCAN_BLOCK = WORKGROUP_SIZE * 4;
+        static constexpr uint32_t RADIX_BITS = 4;
+        static constexpr uint32_t RADIX_BINS = 1u << RADIX_BITS;
+        //One sort tile per workgroup, bounded by the smallest maxComputeWorkGroupCount
+        static constexpr uint32_t MAX_ELEMENTS = 65535u * WORKGROUP_SIZE;
+
+        //Disabled without buffer device address or subgroup arithmetic in compute shaders, every
+        //record is a no-op then. Scratch is sized for max_elements 64 bit keys.
+        void init(VkDevice device, const evPhysicalDevice& physical_device, evResources& resources, uint32_t max_elements);
+        void clean_up();
+
+        bool is_enabled() const { return m_enabled; }
+        uint32_t get_max_elements() const { return m_max_elements; }
+
+        //results[i] is the sum of values before i, values and results may be the same buffer
+        void record_exclusive_scan(VkCommandBuffer command_buffer, VkDeviceAddress values, VkDeviceAddress results, uint32_t count);
+        //Ascending and stable, in place. 64 bit keys are stored low word first, payloads may be 0.
+        void record_radix_sort(VkCommandBuffer command_buffer, VkDeviceAddress keys, VkDeviceAddress payloads, uint32_t count, uint32_t key_bits = 32);
+        //Copies the values whose flag is 1 to results in order and their number to result_count,
+        //flags must be 0 or 1
+        void record_compact(VkCommandBuffer command_buffer, VkDeviceAddress values, VkDeviceAddress flags, VkDeviceAddress results, VkDeviceAddress result_count, uint32_t count);
+
+    private:
+        evResources* m_resources = nullptr;
+        bool m_enabled = false;
+        uint32_t m_max_elements = 0;
+
+        Pipeline m_pipeline_builder;
+        PipelineHandle m_scan_reduce_pipeline;
+        PipelineHandle m_scan_block_pipeline;
+        PipelineHandle m_radix_count_pipeline;
+        PipelineHandle m_radix_scatter_pipeline;
+        PipelineHandle m_compact_pipeline;
+
+        //Block sums of every scan level back to back
+        BufferHandle m_scan_sums;
+        BufferHandle m_histogram;
+        //Ping-pong copies for the sort, an even number of passes ends back in the caller's buffers
+        BufferHandle m_sort_keys;
+        BufferHandle m_sort_payloads;
+        BufferHandle m_offsets;
+
+        void record_scan(VkCommandBuffer command_buffer, VkDeviceAddress values, VkDeviceAddress results, uint32_t count, VkDeviceAddress block_sums);
+        void dispatch(VkCommandBuffer command_buffer, PipelineHandle pipeline, const void* push_constants, uint32_t size, uint32_t group_count);
+        void check_count(uint32_t count) const;
+    };
+
+    //CPU references with the semantics of the GPU primitives, for validation
+    std::vector<uint32_t> exclusive_scan_reference(std::span<const uint32_t> values);
+    //Stable by key, payloads are moved along with their keys
+    void radix_sort_reference(std::vector<uint64_t>& keys, std::vector<uint32_t>& payloads);
+    std::vector<uint32_t> compact_reference(std::span<const uint32_t> values, std::span<const uint32_t> flags);
+}
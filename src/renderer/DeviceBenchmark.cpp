@@ -0,0 +1,324 @@
+#include "DeviceBenchmark.h"
+#include "ShaderLibrary.h"
+#include "VulkanPipeline.h"
+#include <cstring>
+
+namespace evoke::vulkan {
+    namespace {
+        constexpr uint32_t FILL_SIZE = 2048;
+        constexpr uint32_t FILL_CLEARS = 16;
+        //Specialized into device_benchmark.comp
+        constexpr uint32_t COMPUTE_ITERATIONS = 1024;
+        constexpr uint32_t COMPUTE_GROUP_SIZE = 256;
+        constexpr uint32_t COMPUTE_INVOCATIONS = 1024 * 1024;
+
+        //Everything the benchmark creates, released in one place whichever step fails
+        struct BenchmarkObjects {
+            VkDevice device = VK_NULL_HANDLE;
+            VkCommandPool command_pool = VK_NULL_HANDLE;
+            VkQueryPool query_pool = VK_NULL_HANDLE;
+            VkImage image = VK_NULL_HANDLE;
+            VkDeviceMemory image_memory = VK_NULL_HANDLE;
+            VkBuffer buffer = VK_NULL_HANDLE;
+            VkDeviceMemory buffer_memory = VK_NULL_HANDLE;
+            VkDescriptorSetLayout set_layout = VK_NULL_HANDLE;
+            VkDescriptorPool descriptor_pool = VK_NULL_HANDLE;
+            VkPipelineLayout pipeline_layout = VK_NULL_HANDLE;
+            VkShaderModule shader = VK_NULL_HANDLE;
+            VkPipeline pipeline = VK_NULL_HANDLE;
+
+            void clean_up(){
+                if (device == VK_NULL_HANDLE) {
+                    return;
+                }
+                vkDestroyPipeline(device, pipeline, nullptr);
+                vkDestroyShaderModule(device, shader, nullptr);
+                vkDestroyPipelineLayout(device, pipeline_layout, nullptr);
+                vkDestroyDescriptorPool(device, descriptor_pool, nullptr);
+                vkDestroyDescriptorSetLayout(device, set_layout, nullptr);
+                vkDestroyBuffer(device, buffer, nullptr);
+                vkFreeMemory(device, buffer_memory, nullptr);
+                vkDestroyImage(device, image, nullptr);
+                vkFreeMemory(device, image_memory, nullptr);
+                vkDestroyQueryPool(device, query_pool, nullptr);
+                vkDestroyCommandPool(device, command_pool, nullptr);
+                vkDestroyDevice(device, nullptr);
+            }
+        };
+
+        bool allocate_memory(VkDevice device, const VkPhysicalDeviceMemoryProperties& memory_properties, const VkMemoryRequirements& requirements, VkDeviceMemory& memory){
+            for (uint32_t i = 0; i < memory_properties.memoryTypeCount; i++) {
+                bool allowed = requirements.memoryTypeBits & (1u << i);
+                if (allowed && (memory_properties.memoryTypes[i].propertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)) {
+                    VkMemoryAllocateInfo alloc_info{};
+                    alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+                    alloc_info.allocationSize = requirements.size;
+                    alloc_info.memoryTypeIndex = i;
+                    return vkAllocateMemory(device, &alloc_info, nullptr, &memory) == VK_SUCCESS;
+                }
+            }
+            return false;
+        }
+
+        const EmbeddedShader* find_shader(const char* name){
+            for (size_t i = 0; i < EMBEDDED_SHADER_COUNT; i++) {
+                if (strcmp(EMBEDDED_SHADERS[i].name, name) == 0) {
+                    return &EMBEDDED_SHADERS[i];
+                }
+            }
+            return nullptr;
+        }
+
+        bool create_objects(const evPhysicalDeviceInfo& info, BenchmarkObjects& objects){
+            uint32_t family = info.queue_family_indices.graphics_family.value();
+
+            float priority = 1.0f;
+            VkDeviceQueueCreateInfo queue_info{};
+            queue_info.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+            queue_info.queueFamilyIndex = family;
+            queue_info.queueCount = 1;
+            queue_info.pQueuePriorities = &priority;
+
+            VkDeviceCreateInfo device_info{};
+            device_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+            device_info.queueCreateInfoCount = 1;
+            device_info.pQueueCreateInfos = &queue_info;
+
+            if (vkCreateDevice(info.handle, &device_info, nullptr, &objects.device) != VK_SUCCESS) {
+                return false;
+            }
+            VkDevice device = objects.device;
+
+            VkCommandPoolCreateInfo pool_info{};
+            pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+            pool_info.queueFamilyIndex = family;
+            if (vkCreateCommandPool(device, &pool_info, nullptr, &objects.command_pool) != VK_SUCCESS) {
+                return false;
+            }
+
+            VkQueryPoolCreateInfo query_info{};
+            query_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+            query_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+            query_info.queryCount = 4;
+            if (vkCreateQueryPool(device, &query_info, nullptr, &objects.query_pool) != VK_SUCCESS) {
+                return false;
+            }
+
+            //Fill target
+            VkImageCreateInfo image_info{};
+            image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+            image_info.imageType = VK_IMAGE_TYPE_2D;
+            image_info.format = VK_FORMAT_R8G8B8A8_UNORM;
+            image_info.extent = {FILL_SIZE, FILL_SIZE, 1};
+            image_info.mipLevels = 1;
+            image_info.arrayLayers = 1;
+            image_info.samples = VK_SAMPLE_COUNT_1_BIT;
+            image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+            image_info.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+            image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            if (vkCreateImage(device, &image_info, nullptr, &objects.image) != VK_SUCCESS) {
+                return false;
+            }
+
+            VkMemoryRequirements image_requirements;
+            vkGetImageMemoryRequirements(device, objects.image, &image_requirements);
+            if (!allocate_memory(device, info.memory_properties, image_requirements, objects.image_memory)) {
+                return false;
+            }
+            vkBindImageMemory(device, objects.image, objects.image_memory, 0);
+
+            //Compute output
+            VkBufferCreateInfo buffer_info{};
+            buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+            buffer_info.size = sizeof(float) * COMPUTE_INVOCATIONS;
+            buffer_info.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+            if (vkCreateBuffer(device, &buffer_info, nullptr, &objects.buffer) != VK_SUCCESS) {
+                return false;
+            }
+
+            VkMemoryRequirements buffer_requirements;
+            vkGetBufferMemoryRequirements(device, objects.buffer, &buffer_requirements);
+            if (!allocate_memory(device, info.memory_properties, buffer_requirements, objects.buffer_memory)) {
+                return false;
+            }
+            vkBindBufferMemory(device, objects.buffer, objects.buffer_memory, 0);
+
+            VkDescriptorSetLayoutBinding binding{};
+            binding.binding = 0;
+            binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            binding.descriptorCount = 1;
+            binding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+            VkDescriptorSetLayoutCreateInfo set_layout_info{};
+            set_layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+            set_layout_info.bindingCount = 1;
+            set_layout_info.pBindings = &binding;
+            if (vkCreateDescriptorSetLayout(device, &set_layout_info, nullptr, &objects.set_layout) != VK_SUCCESS) {
+                return false;
+            }
+
+            VkDescriptorPoolSize pool_size{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1};
+            VkDescriptorPoolCreateInfo descriptor_pool_info{};
+            descriptor_pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+            descriptor_pool_info.maxSets = 1;
+            descriptor_pool_info.poolSizeCount = 1;
+            descriptor_pool_info.pPoolSizes = &pool_size;
+            if (vkCreateDescriptorPool(device, &descriptor_pool_info, nullptr, &objects.descriptor_pool) != VK_SUCCESS) {
+                return false;
+            }
+
+            VkPipelineLayoutCreateInfo pipeline_layout_info{};
+            pipeline_layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+            pipeline_layout_info.setLayoutCount = 1;
+            pipeline_layout_info.pSetLayouts = &objects.set_layout;
+            if (vkCreatePipelineLayout(device, &pipeline_layout_info, nullptr, &objects.pipeline_layout) != VK_SUCCESS) {
+                return false;
+            }
+
+            const EmbeddedShader* shader = find_shader("device_benchmark.spv");
+            if (shader == nullptr) {
+                return false;
+            }
+
+            VkShaderModuleCreateInfo module_info{};
+            module_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+            module_info.codeSize = shader->word_count * sizeof(uint32_t);
+            module_info.pCode = shader->code;
+            if (vkCreateShaderModule(device, &module_info, nullptr, &objects.shader) != VK_SUCCESS) {
+                return false;
+            }
+
+            SpecializationConstants specialization;
+            specialization.set(0, COMPUTE_GROUP_SIZE).set(1, COMPUTE_ITERATIONS);
+            VkSpecializationInfo specialization_info = specialization.info();
+
+            VkComputePipelineCreateInfo pipeline_info{};
+            pipeline_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+            pipeline_info.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+            pipeline_info.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+            pipeline_info.stage.module = objects.shader;
+            pipeline_info.stage.pName = "main";
+            pipeline_info.stage.pSpecializationInfo = &specialization_info;
+            pipeline_info.layout = objects.pipeline_layout;
+            return vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipeline_info, nullptr, &objects.pipeline) == VK_SUCCESS;
+        }
+
+        void record(VkCommandBuffer command_buffer, const BenchmarkObjects& objects, VkDescriptorSet descriptor_set){
+            vkCmdResetQueryPool(command_buffer, objects.query_pool, 0, 4);
+
+            //Plain barriers, the throwaway device enables no synchronization2
+            VkImageMemoryBarrier barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            barrier.srcAccessMask = 0;
+            barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.image = objects.image;
+            barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+            vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+            VkClearColorValue clear_color{};
+            vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, objects.query_pool, 0);
+            for (uint32_t i = 0; i < FILL_CLEARS; i++) {
+                clear_color.float32[0] = static_cast<float>(i) / FILL_CLEARS;
+                vkCmdClearColorImage(command_buffer, objects.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &clear_color, 1, &barrier.subresourceRange);
+            }
+            vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, objects.query_pool, 1);
+
+            vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, objects.pipeline);
+            vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, objects.pipeline_layout, 0, 1, &descriptor_set, 0, nullptr);
+            vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, objects.query_pool, 2);
+            vkCmdDispatch(command_buffer, COMPUTE_INVOCATIONS / COMPUTE_GROUP_SIZE, 1, 1);
+            vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, objects.query_pool, 3);
+        }
+    }
+
+    DeviceBenchmarkResult benchmark_device(const evPhysicalDeviceInfo& info){
+        DeviceBenchmarkResult result;
+
+        uint32_t family = info.queue_family_indices.graphics_family.value();
+        uint32_t family_count = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(info.handle, &family_count, nullptr);
+        std::vector<VkQueueFamilyProperties> families(family_count);
+        vkGetPhysicalDeviceQueueFamilyProperties(info.handle, &family_count, families.data());
+
+        if (families[family].timestampValidBits == 0 || info.properties.limits.timestampPeriod <= 0.0f) {
+            return result;
+        }
+
+        BenchmarkObjects objects;
+        if (!create_objects(info, objects)) {
+            objects.clean_up();
+            return result;
+        }
+        VkDevice device = objects.device;
+
+        VkDescriptorSetAllocateInfo set_info{};
+        set_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        set_info.descriptorPool = objects.descriptor_pool;
+        set_info.descriptorSetCount = 1;
+        set_info.pSetLayouts = &objects.set_layout;
+
+        VkDescriptorSet descriptor_set;
+        VkCommandBuffer command_buffer;
+
+        VkCommandBufferAllocateInfo command_info{};
+        command_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        command_info.commandPool = objects.command_pool;
+        command_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        command_info.commandBufferCount = 1;
+
+        if (vkAllocateDescriptorSets(device, &set_info, &descriptor_set) != VK_SUCCESS || vkAllocateCommandBuffers(device, &command_info, &command_buffer) != VK_SUCCESS) {
+            objects.clean_up();
+            return result;
+        }
+
+        VkDescriptorBufferInfo buffer_info{objects.buffer, 0, VK_WHOLE_SIZE};
+        VkWriteDescriptorSet write{};
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstSet = descriptor_set;
+        write.dstBinding = 0;
+        write.descriptorCount = 1;
+        write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        write.pBufferInfo = &buffer_info;
+        vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+
+        VkCommandBufferBeginInfo begin_info{};
+        begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        vkBeginCommandBuffer(command_buffer, &begin_info);
+        record(command_buffer, objects, descriptor_set);
+        vkEndCommandBuffer(command_buffer);
+
+        VkQueue queue;
+        vkGetDeviceQueue(device, family, 0, &queue);
+
+        VkSubmitInfo submit_info{};
+        submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submit_info.commandBufferCount = 1;
+        submit_info.pCommandBuffers = &command_buffer;
+
+        uint64_t timestamps[4] = {};
+        bool submitted = vkQueueSubmit(queue, 1, &submit_info, VK_NULL_HANDLE) == VK_SUCCESS && vkQueueWaitIdle(queue) == VK_SUCCESS;
+        if (submitted && vkGetQueryPoolResults(device, objects.query_pool, 0, 4, sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT) == VK_SUCCESS) {
+            double period = info.properties.limits.timestampPeriod;
+            double fill_seconds = static_cast<double>(timestamps[1] - timestamps[0]) * period * 1e-9;
+            double compute_seconds = static_cast<double>(timestamps[3] - timestamps[2]) * period * 1e-9;
+
+            if (fill_seconds > 0.0 && compute_seconds > 0.0) {
+                double pixels = static_cast<double>(FILL_SIZE) * FILL_SIZE * FILL_CLEARS;
+                //Four lanes per iteration, two operations per FMA
+                double flops = static_cast<double>(COMPUTE_INVOCATIONS) * COMPUTE_ITERATIONS * 4 * 2;
+
+                result.fill_rate = pixels / fill_seconds * 1e-9;
+                result.compute = flops / compute_seconds * 1e-9;
+                result.valid = true;
+            }
+        }
+
+        objects.clean_up();
+        return result;
+    }
+}
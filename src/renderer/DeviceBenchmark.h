@@ -0,0 +1,20 @@
+#pragma once
+#include <cmath>
+#include "evPhysicalDevice.h"
+
+namespace evoke::vulkan {
+    struct DeviceBenchmarkResult {
+        bool valid = false;
+        //Gigapixels per second cleared
+        double fill_rate = 0.0;
+        //GFLOP/s of dependent FMAs
+        double compute = 0.0;
+
+        double score() const { return std::sqrt(fill_rate * compute); }
+    };
+
+    //Measures a device with GPU timestamps on a throwaway logical device: clears of a large image
+    //and an FMA kernel. Takes a few milliseconds, only meant to break ties between similar GPUs.
+    //Not valid when the graphics queue has no timestamps or a step fails.
+    DeviceBenchmarkResult benchmark_device(const evPhysicalDeviceInfo& info);
+}
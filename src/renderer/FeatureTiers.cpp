@@ -0,0 +1,122 @@
+#include "FeatureTiers.h"
+#include <cstdlib>
+#include "../utils/Logger.h"
+
+namespace evoke::vulkan {
+    namespace {
+        //A BAR window this size or smaller is the legacy one, too small to hold streamed buffers
+        constexpr VkDeviceSize LEGACY_BAR_SIZE = 256ull * 1024 * 1024;
+
+        std::string mib(VkDeviceSize bytes){
+            return std::to_string(bytes / (1024 * 1024)) + " MiB";
+        }
+
+        std::string missing(const std::vector<const char*>& features){
+            std::string list;
+            for (const char* feature : features) {
+                list += list.empty() ? feature : std::string(", ") + feature;
+            }
+            return list;
+        }
+    }
+
+    FeatureTiers select_feature_tiers(const evPhysicalDevice& physical_device){
+        const DeviceFeatureSupport& support = physical_device.get().feature_support;
+        FeatureTiers tiers;
+
+        bool mesh_extension = physical_device.get().extensions_info.has(VK_EXT_MESH_SHADER_EXTENSION_NAME);
+        if (mesh_extension && support.task_shader && support.mesh_shader && support.buffer_device_address) {
+            tiers.geometry = GeometryTier::MeshShader;
+            tiers.report.push_back("geometry: mesh shaders, task and mesh shaders with buffer device address");
+        } else if (support.buffer_device_address && support.multi_draw_indirect) {
+            tiers.geometry = GeometryTier::ComputeCull;
+            tiers.report.push_back("geometry: compute culling, no mesh shaders");
+        } else {
+            std::vector<const char*> absent;
+            if (!support.buffer_device_address) {
+                absent.push_back("buffer device address");
+            }
+            if (!support.multi_draw_indirect) {
+                absent.push_back("multi draw indirect");
+            }
+            tiers.geometry = GeometryTier::Direct;
+            tiers.report.push_back("geometry: direct, missing " + missing(absent));
+        }
+
+        tiers.compact_draws = support.draw_indirect_count;
+        tiers.report.push_back(tiers.compact_draws ? "indirect draws: count buffer" : "indirect draws: fixed count, no draw indirect count");
+
+        if (support.bindless_textures) {
+            tiers.descriptors = DescriptorTier::Bindless;
+            tiers.report.push_back("descriptors: bindless, update after bind and non uniform indexing");
+        } else {
+            tiers.descriptors = DescriptorTier::Classic;
+            tiers.report.push_back("descriptors: classic, descriptor indexing incomplete");
+        }
+
+        if (support.host_visible_device_memory > LEGACY_BAR_SIZE) {
+            tiers.uploads = UploadTier::ReBar;
+            tiers.report.push_back("uploads: resizable BAR, " + mib(support.host_visible_device_memory) + " of VRAM host visible");
+        } else {
+            tiers.uploads = UploadTier::Staging;
+            tiers.report.push_back(support.host_visible_device_memory > 0
+                ? "uploads: staging, only " + mib(support.host_visible_device_memory) + " of VRAM host visible"
+                : std::string("uploads: staging, no host visible VRAM"));
+        }
+
+        if (std::getenv("EVOKE_STATIC_PIPELINES")) {
+            tiers.state = StateTier::Static;
+            tiers.report.push_back("pipeline state: static, forced by EVOKE_STATIC_PIPELINES");
+        } else if (support.dynamic_blend) {
+            tiers.state = StateTier::DynamicBlend;
+            tiers.report.push_back("pipeline state: dynamic depth, cull and blend, extended dynamic state 3");
+        } else {
+            tiers.state = StateTier::Dynamic;
+            tiers.report.push_back("pipeline state: dynamic depth and cull, blend baked, no extended dynamic state 3");
+        }
+
+        //Required for device creation, the queues synchronize with nothing else
+        tiers.report.push_back("sync: timeline semaphores, core since Vulkan 1.2");
+
+        utils::Logger::info("Feature tiers for ", physical_device.get().properties.deviceName, "!");
+        for (const std::string& line : tiers.report) {
+            utils::Logger::info("  ", line, "!");
+        }
+
+        return tiers;
+    }
+
+    VkMemoryPropertyFlags streaming_memory(const FeatureTiers& tiers){
+        VkMemoryPropertyFlags flags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+        if (tiers.uploads == UploadTier::ReBar) {
+            flags |= VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+        }
+        return flags;
+    }
+
+    const char* to_string(GeometryTier tier){
+        switch (tier) {
+            case GeometryTier::MeshShader: return "mesh shader";
+            case GeometryTier::ComputeCull: return "compute cull";
+            case GeometryTier::Direct: return "direct";
+        }
+        return "unknown";
+    }
+
+    const char* to_string(DescriptorTier tier){
+        return tier == DescriptorTier::Bindless ? "bindless" : "classic";
+    }
+
+    const char* to_string(UploadTier tier){
+        return tier == UploadTier::ReBar ? "resizable BAR" : "staging";
+    }
+
+    const char* to_string(StateTier tier){
+        switch (tier) {
+            case StateTier::DynamicBlend: return "dynamic blend";
+            case StateTier::Dynamic: return "dynamic";
+            case StateTier::Static: return "static";
+        }
+        return "unknown";
+    }
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "evPhysicalDevice.h"
+
+namespace evoke::vulkan {
+    //Capability tiers, picked once at startup. Render paths are templates over their tier, so the
+    //branches between tiers are resolved at compile time and only the entry point selects the
+    //instantiation.
+    enum class GeometryTier {
+        MeshShader,     //Task shader culls, mesh shader emits the visible meshlets
+        ComputeCull,    //Compute shader culls into an indirect draw buffer
+        Direct          //No culling, the whole index buffer is drawn
+    };
+
+    enum class DescriptorTier {
+        Bindless,       //One texture array bound once, instances carry their texture index
+        Classic         //One descriptor set per texture, bound per batch
+    };
+
+    enum class UploadTier {
+        ReBar,          //Device local memory is written through a mapping, no copies
+        Staging         //Host visible staging buffer and a copy on the GPU
+    };
+
+    enum class StateTier {
+        DynamicBlend,   //Dynamic depth, cull and front face plus blend state, extended dynamic state 3
+        Dynamic,        //Depth, cull and front face set while recording, core since Vulkan 1.3
+        Static          //Every state baked, one pipeline per permutation
+    };
+
+    struct FeatureTiers {
+        GeometryTier geometry = GeometryTier::Direct;
+        //The compute cull path draws only the surviving commands through a count buffer
+        bool compact_draws = false;
+        DescriptorTier descriptors = DescriptorTier::Classic;
+        UploadTier uploads = UploadTier::Staging;
+        //Static when EVOKE_STATIC_PIPELINES is set, for drivers with broken dynamic state
+        StateTier state = StateTier::Static;
+
+        //One line per tier with the reason it was chosen
+        std::vector<std::string> report;
+    };
+
+    FeatureTiers select_feature_tiers(const evPhysicalDevice& physical_device);
+
+    //Memory for buffers the CPU rewrites every frame, VRAM when it can be mapped
+    VkMemoryPropertyFlags streaming_memory(const FeatureTiers& tiers);
+
+    const char* to_string(GeometryTier tier);
+    const char* to_string(DescriptorTier tier);
+    const char* to_string(UploadTier tier);
+    const char* to_string(StateTier tier);
+}
@@ -0,0 +1,159 @@
+#include "FrameCapture.h"
+#include "../utils/Logger.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "../../external/glfw/deps/stb_image_write.h"
+
+namespace evoke::vulkan {
+    namespace {
+        bool is_bgra(VkFormat format){
+            return format == VK_FORMAT_B8G8R8A8_UNORM || format == VK_FORMAT_B8G8R8A8_SRGB;
+        }
+
+        bool is_rgba(VkFormat format){
+            return format == VK_FORMAT_R8G8B8A8_UNORM || format == VK_FORMAT_R8G8B8A8_SRGB;
+        }
+
+        std::string frame_name(uint32_t index){
+            char name[32];
+            snprintf(name, sizeof(name), "frame_%06u", index);
+            return name;
+        }
+    }
+
+    void FrameCapture::start(const FrameCaptureSettings& settings){
+        stop();
+
+        std::error_code error;
+        std::filesystem::create_directories(settings.directory, error);
+        if (error) {
+            utils::Logger::error("Failed to create capture directory ", settings.directory, "!");
+            return;
+        }
+
+        m_settings = settings;
+        m_settings.frame_interval = std::max(settings.frame_interval, 1u);
+        m_frame_counter = 0;
+        m_requested = 0;
+        m_stats = {};
+        m_stopping = false;
+
+        m_writer = std::thread(&FrameCapture::writer_loop, this);
+        m_active = true;
+
+        utils::Logger::info("Capturing frames to ", settings.directory, "!");
+    }
+
+    void FrameCapture::stop(){
+        m_active = false;
+        if (!m_writer.joinable()) {
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+        m_condition.notify_all();
+        m_writer.join();
+
+        utils::Logger::info("Frame capture stopped, ", m_stats.written, " frames written, ", m_stats.dropped, " dropped!");
+    }
+
+    bool FrameCapture::should_capture(){
+        if (!m_active) {
+            return false;
+        }
+
+        if (m_settings.max_frames > 0 && m_requested >= m_settings.max_frames) {
+            return false;
+        }
+
+        bool capture = m_frame_counter++ % m_settings.frame_interval == 0;
+        if (capture) {
+            m_requested++;
+        }
+        return capture;
+    }
+
+    void FrameCapture::submit(const void* pixels, VkExtent2D extent, VkFormat format){
+        std::unique_lock<std::mutex> lock(m_mutex);
+        uint32_t index = m_stats.captured++;
+
+        if (m_queue.size() >= m_settings.max_queued) {
+            m_stats.dropped++;
+            return;
+        }
+
+        Frame frame{index, extent, format, {}};
+        lock.unlock();
+
+        size_t size = static_cast<size_t>(extent.width) * extent.height * 4;
+        frame.pixels.resize(size);
+        memcpy(frame.pixels.data(), pixels, size);
+
+        lock.lock();
+        m_queue.push_back(std::move(frame));
+        lock.unlock();
+        m_condition.notify_one();
+    }
+
+    FrameCaptureStats FrameCapture::get_stats() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_stats;
+    }
+
+    void FrameCapture::writer_loop(){
+        while (true) {
+            Frame frame;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_condition.wait(lock, [this] { return m_stopping || !m_queue.empty(); });
+                if (m_queue.empty()) {
+                    return;
+                }
+                frame = std::move(m_queue.front());
+                m_queue.pop_front();
+            }
+
+            write_frame(frame);
+        }
+    }
+
+    void FrameCapture::write_frame(Frame& frame){
+        if (is_bgra(frame.format)) {
+            for (size_t i = 0; i < frame.pixels.size(); i += 4) {
+                std::swap(frame.pixels[i], frame.pixels[i + 2]);
+            }
+        } else if (!is_rgba(frame.format) && m_settings.format == CaptureFormat::Png) {
+            utils::Logger::error("Frame capture cannot encode format ", frame.format, " as PNG!");
+            return;
+        }
+
+        std::filesystem::path path = std::filesystem::path(m_settings.directory) / frame_name(frame.index);
+        bool written = false;
+
+        if (m_settings.format == CaptureFormat::Png) {
+            path += ".png";
+            int stride = static_cast<int>(frame.extent.width) * 4;
+            written = stbi_write_png(path.string().c_str(), static_cast<int>(frame.extent.width), static_cast<int>(frame.extent.height), 4, frame.pixels.data(), stride) != 0;
+        } else {
+            path += "_" + std::to_string(frame.extent.width) + "x" + std::to_string(frame.extent.height) + ".rgba";
+            std::ofstream file(path, std::ios::binary);
+            file.write(reinterpret_cast<const char*>(frame.pixels.data()), static_cast<std::streamsize>(frame.pixels.size()));
+            written = file.good();
+        }
+
+        if (!written) {
+            utils::Logger::error("Failed to write capture ", path.string(), "!");
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stats.written++;
+    }
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace evoke::vulkan {
+    enum class CaptureFormat {
+        Raw,        //Tightly packed texels, RGBA order for 8 bit formats, size in the file name
+        Png
+    };
+
+    struct FrameCaptureSettings {
+        std::string directory = "captures";
+        CaptureFormat format = CaptureFormat::Png;
+        //Captures every nth frame
+        uint32_t frame_interval = 1;
+        //Stops by itself after this many frames, 0 runs until stopped
+        uint32_t max_frames = 0;
+        //Frames waiting for the writer beyond this are dropped rather than stalling the renderer
+        uint32_t max_queued = 8;
+    };
+
+    struct FrameCaptureStats {
+        uint32_t captured = 0;
+        uint32_t written = 0;
+        uint32_t dropped = 0;
+    };
+
+    //Streams read back frames to disk on a writer thread, e.g. for golden image tests or to turn
+    //benchmark runs into videos. Files are numbered by capture order, frame_000000.png and so on.
+    class FrameCapture {
+    public:
+        ~FrameCapture() { stop(); }
+
+        void start(const FrameCaptureSettings& settings);
+        //Writes everything still queued, then joins the writer
+        void stop();
+
+        bool is_active() const { return m_active; }
+        //Called once per rendered frame, true if this one should be read back
+        bool should_capture();
+        //Copies the pixels, conversion and encoding happen on the writer thread
+        void submit(const void* pixels, VkExtent2D extent, VkFormat format);
+
+        FrameCaptureStats get_stats() const;
+
+    private:
+        struct Frame {
+            uint32_t index;
+            VkExtent2D extent;
+            VkFormat format;
+            std::vector<uint8_t> pixels;
+        };
+
+        FrameCaptureSettings m_settings;
+        std::atomic<bool> m_active{false};
+        uint32_t m_frame_counter = 0;
+        uint32_t m_requested = 0;
+
+        std::thread m_writer;
+        std::deque<Frame> m_queue;
+        mutable std::mutex m_mutex;
+        std::condition_variable m_condition;
+        bool m_stopping = false;
+
+        FrameCaptureStats m_stats;
+
+        void writer_loop();
+        void write_frame(Frame& frame);
+    };
+}
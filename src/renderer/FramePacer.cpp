@@ -0,0 +1,183 @@
+#include "FramePacer.h"
+#include "../utils/Logger.h"
+#include <thread>
+
+namespace evoke::vulkan {
+    namespace {
+        //Present waits give up after this so a minimized window cannot hang the render thread
+        constexpr uint64_t PRESENT_WAIT_TIMEOUT = 100'000'000;
+        //Completions further apart than this are hitches, not the display's refresh
+        constexpr float MAX_PRESENT_INTERVAL = 100.0f;
+        constexpr size_t MAX_PENDING_PRESENTS = 8;
+
+        float milliseconds(core::Clock::duration duration){
+            return std::chrono::duration<float, std::milli>(duration).count();
+        }
+
+        void smooth(float& value, float sample){
+            value = value == 0.0f ? sample : value * 0.9f + sample * 0.1f;
+        }
+    }
+
+    void FramePacer::init(VkDevice device, const evPhysicalDevice& physical_device, uint32_t frames_in_flight){
+        m_device = device;
+
+        if (physical_device.get().feature_support.present_wait) {
+            m_wait_for_present = reinterpret_cast<PFN_vkWaitForPresentKHR>(vkGetDeviceProcAddr(device, "vkWaitForPresentKHR"));
+            m_present_wait = m_wait_for_present != nullptr;
+        }
+        m_stats.present_wait = m_present_wait;
+
+        //Two timestamps per frame in flight, around the whole command buffer
+        const VkPhysicalDeviceLimits& limits = physical_device.get().properties.limits;
+        if (limits.timestampComputeAndGraphics) {
+            VkQueryPoolCreateInfo query_pool_info{};
+            query_pool_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+            query_pool_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+            query_pool_info.queryCount = frames_in_flight * 2;
+
+            if (vkCreateQueryPool(device, &query_pool_info, nullptr, &m_query_pool) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create timestamp query pool!");
+            }
+            m_timestamp_period = limits.timestampPeriod;
+        }
+        m_timestamps_written.assign(frames_in_flight, false);
+
+        utils::Logger::info("Frame pacing uses ", m_present_wait ? "present wait" : "fence completion", "!");
+    }
+
+    void FramePacer::clean_up(){
+        if (m_query_pool != VK_NULL_HANDLE) {
+            vkDestroyQueryPool(m_device, m_query_pool, nullptr);
+            m_query_pool = VK_NULL_HANDLE;
+        }
+    }
+
+    void FramePacer::reset(){
+        m_pending_presents.clear();
+        m_last_completion = {};
+    }
+
+    bool FramePacer::wait_for_present(VkSwapchainKHR swapchain){
+        if (m_pending_presents.empty()) {
+            return false;
+        }
+
+        VkResult result = m_wait_for_present(m_device, swapchain, m_pending_presents.back().id, PRESENT_WAIT_TIMEOUT);
+        if (result != VK_SUCCESS) {
+            m_pending_presents.clear();
+            return false;
+        }
+
+        record_completion(core::Clock::now());
+        return true;
+    }
+
+    void FramePacer::record_completion(core::Clock::time_point completion){
+        const PendingPresent& present = m_pending_presents.back();
+
+        if (m_last_completion != core::Clock::time_point{}) {
+            float interval = milliseconds(completion - m_last_completion);
+            if (interval < MAX_PRESENT_INTERVAL) {
+                smooth(m_stats.present_interval, interval);
+            }
+        }
+        m_last_completion = completion;
+
+        smooth(m_stats.frame_latency, milliseconds(completion - present.cpu_start));
+
+        //Only the first image showing an input counts, later ones would just measure idle time
+        if (present.input_time > m_last_measured_input) {
+            smooth(m_stats.input_latency, milliseconds(completion - present.input_time));
+            m_last_measured_input = present.input_time;
+        }
+
+        m_pending_presents.clear();
+    }
+
+    void FramePacer::wait_for_frame_start(VkSwapchainKHR swapchain, VkFence previous_fence){
+        if (m_mode == PacingMode::Uncapped) {
+            m_stats.sleep_time = 0.0f;
+            return;
+        }
+
+        //Without present wait the previous frame's GPU completion stands in for its present,
+        //which understates latency by the time spent in the presentation engine
+        if (m_present_wait) {
+            if (!wait_for_present(swapchain)) {
+                return;
+            }
+        } else {
+            if (m_pending_presents.empty()) {
+                return;
+            }
+            vkWaitForFences(m_device, 1, &previous_fence, VK_TRUE, UINT64_MAX);
+            record_completion(core::Clock::now());
+        }
+
+        //The next image is due one interval after the last one, start just early enough to make it
+        float work = m_stats.cpu_time + m_stats.gpu_time + m_margin;
+        auto due = m_last_completion + std::chrono::duration_cast<core::Clock::duration>(std::chrono::duration<float, std::milli>(m_stats.present_interval));
+        auto start = due - std::chrono::duration_cast<core::Clock::duration>(std::chrono::duration<float, std::milli>(work));
+
+        core::Clock::time_point now = core::Clock::now();
+        if (start > now) {
+            std::this_thread::sleep_until(start);
+            smooth(m_stats.sleep_time, milliseconds(start - now));
+        } else {
+            smooth(m_stats.sleep_time, 0.0f);
+        }
+    }
+
+    void FramePacer::begin_frame(uint32_t frame, core::Clock::time_point input_time){
+        m_cpu_start = core::Clock::now();
+        m_input_time = input_time;
+
+        if (m_query_pool == VK_NULL_HANDLE || !m_timestamps_written[frame]) {
+            return;
+        }
+
+        //The slot's fence signaled, so the results are available
+        uint64_t timestamps[2];
+        if (vkGetQueryPoolResults(m_device, m_query_pool, frame * 2, 2, sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS) {
+            m_last_gpu_time = static_cast<float>(timestamps[1] - timestamps[0]) * m_timestamp_period / 1'000'000.0f;
+            smooth(m_stats.gpu_time, m_last_gpu_time);
+        }
+    }
+
+    void FramePacer::record_begin(VkCommandBuffer command_buffer, uint32_t frame){
+        if (m_query_pool == VK_NULL_HANDLE) {
+            return;
+        }
+        vkCmdResetQueryPool(command_buffer, m_query_pool, frame * 2, 2);
+        vkCmdWriteTimestamp2(command_buffer, VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT, m_query_pool, frame * 2);
+    }
+
+    void FramePacer::record_end(VkCommandBuffer command_buffer, uint32_t frame){
+        if (m_query_pool == VK_NULL_HANDLE) {
+            return;
+        }
+        vkCmdWriteTimestamp2(command_buffer, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, m_query_pool, frame * 2 + 1);
+        m_timestamps_written[frame] = true;
+    }
+
+    void FramePacer::prepare_present(VkPresentInfoKHR& present_info, VkPresentIdKHR& present_id){
+        smooth(m_stats.cpu_time, milliseconds(core::Clock::now() - m_cpu_start));
+
+        m_present_id++;
+        m_pending_presents.push_back({m_present_id, m_cpu_start, m_input_time});
+        if (m_pending_presents.size() > MAX_PENDING_PRESENTS) {
+            m_pending_presents.pop_front();
+        }
+
+        if (!m_present_wait) {
+            return;
+        }
+
+        present_id.sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR;
+        present_id.pNext = present_info.pNext;
+        present_id.swapchainCount = 1;
+        present_id.pPresentIds = &m_pending_presents.back().id;
+        present_info.pNext = &present_id;
+    }
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include <atomic>
+#include <deque>
+#include "evPhysicalDevice.h"
+#include "../core/Input.h"
+
+namespace evoke::vulkan {
+    enum class PacingMode {
+        Uncapped,       //Start every frame as soon as a frame slot is free
+        LowLatency      //Delay the CPU so the frame finishes just before the next vblank
+    };
+
+    //All times in milliseconds, smoothed over recent frames
+    struct FramePacingStats {
+        float cpu_time = 0.0f;
+        float gpu_time = 0.0f;
+        float present_interval = 0.0f;
+        float sleep_time = 0.0f;
+        //Start of CPU work until the image was on screen
+        float frame_latency = 0.0f;
+        //Newest input event until the first image reflecting it was on screen
+        float input_latency = 0.0f;
+        bool present_wait = false;
+    };
+
+    //Predicts when the next image has to be done and sleeps away the slack before the CPU starts on it.
+    //With VK_KHR_present_wait the prediction is anchored on real present times, otherwise on the
+    //completion of the previous frame's fence with GPU time taken from timestamp queries.
+    class FramePacer {
+    public:
+        void init(VkDevice device, const evPhysicalDevice& physical_device, uint32_t frames_in_flight);
+        void clean_up();
+
+        void set_mode(PacingMode mode) { m_mode = mode; }
+        PacingMode get_mode() const { return m_mode; }
+        //Safety margin kept between the predicted finish and the vblank
+        void set_latency_margin(float milliseconds) { m_margin = milliseconds; }
+
+        //Present ids restart with every swapchain
+        void reset();
+
+        //Before the frame's fence wait. previous_fence belongs to the most recently submitted frame.
+        void wait_for_frame_start(VkSwapchainKHR swapchain, VkFence previous_fence);
+        //After the frame's fence wait, reads the GPU time of the last submission that used this slot
+        void begin_frame(uint32_t frame, core::Clock::time_point input_time);
+
+        void record_begin(VkCommandBuffer command_buffer, uint32_t frame);
+        void record_end(VkCommandBuffer command_buffer, uint32_t frame);
+
+        //Chains a present id into the present info when supported, present_id must outlive the present call
+        void prepare_present(VkPresentInfoKHR& present_info, VkPresentIdKHR& present_id);
+
+        const FramePacingStats& get_stats() const { return m_stats; }
+        //Unsmoothed GPU time of the newest finished frame, 0 without timestamps
+        float get_last_gpu_time() const { return m_last_gpu_time; }
+
+    private:
+        struct PendingPresent {
+            uint64_t id;
+            core::Clock::time_point cpu_start;
+            core::Clock::time_point input_time;
+        };
+
+        VkDevice m_device = VK_NULL_HANDLE;
+        std::atomic<PacingMode> m_mode{PacingMode::LowLatency};
+        std::atomic<float> m_margin{1.0f};
+
+        bool m_present_wait = false;
+        PFN_vkWaitForPresentKHR m_wait_for_present = nullptr;
+        uint64_t m_present_id = 0;
+        std::deque<PendingPresent> m_pending_presents;
+
+        VkQueryPool m_query_pool = VK_NULL_HANDLE;
+        float m_timestamp_period = 0.0f;
+        std::vector<bool> m_timestamps_written;
+        float m_last_gpu_time = 0.0f;
+
+        core::Clock::time_point m_cpu_start;
+        core::Clock::time_point m_input_time;
+        core::Clock::time_point m_last_measured_input;
+        core::Clock::time_point m_last_completion;
+
+        FramePacingStats m_stats;
+
+        //Records when the oldest pending present reached the screen, returns false if none was waited on
+        bool wait_for_present(VkSwapchainKHR swapchain);
+        void record_completion(core::Clock::time_point completion);
+    };
+}
@@ -0,0 +1,405 @@
+#include "LodRenderer.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+namespace evoke::vulkan {
+    namespace {
+        constexpr uint32_t SELECTION_BATCH_SIZE = 1024;
+        //local_size_x of instance_scatter.comp
+        constexpr uint32_t SCATTER_WORKGROUP_SIZE = 64;
+
+        void buffer_barrier(VkCommandBuffer command_buffer, VkBuffer buffer, VkPipelineStageFlags2 src_stage_mask, VkAccessFlags2 src_access_mask, VkPipelineStageFlags2 dst_stage_mask, VkAccessFlags2 dst_access_mask){
+            VkBufferMemoryBarrier2 barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2;
+            barrier.srcStageMask = src_stage_mask;
+            barrier.srcAccessMask = src_access_mask;
+            barrier.dstStageMask = dst_stage_mask;
+            barrier.dstAccessMask = dst_access_mask;
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.buffer = buffer;
+            barrier.offset = 0;
+            barrier.size = VK_WHOLE_SIZE;
+
+            VkDependencyInfo dependency_info{};
+            dependency_info.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+            dependency_info.bufferMemoryBarrierCount = 1;
+            dependency_info.pBufferMemoryBarriers = &barrier;
+
+            vkCmdPipelineBarrier2(command_buffer, &dependency_info);
+        }
+
+        float max_scale(const glm::mat4& transform){
+            return std::max({glm::length(glm::vec3(transform[0])), glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2]))});
+        }
+    }
+
+    void LodRenderer::init(VkDevice device, const evPhysicalDevice& physical_device, const FeatureTiers& tiers, const VkSurfaceFormatKHR& surface_format, VkFormat depth_format, evResources& resources, core::JobSystem& job_system, uint32_t frames_in_flight){
+        m_resources = &resources;
+        m_job_system = &job_system;
+        m_multi_draw_indirect = physical_device.get().feature_support.multi_draw_indirect;
+        m_streaming_memory = streaming_memory(tiers);
+        m_resident = physical_device.get().feature_support.buffer_device_address;
+        m_frames.resize(frames_in_flight);
+
+        auto vertex_attributes = MeshVertex::getAttributeDescriptions();
+
+        //Binding 1 streams either an index into the resident transforms or the whole model matrix
+        //per instance, one attribute per column
+        VkVertexInputBindingDescription instance_binding{};
+        instance_binding.binding = 1;
+        instance_binding.stride = m_resident ? sizeof(uint32_t) : sizeof(glm::mat4);
+        instance_binding.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+
+        GraphicsPipelineConfig config{};
+        config.shaders = {
+            {VK_SHADER_STAGE_VERTEX_BIT, m_resident ? "mesh_resident_vert.spv" : "mesh_instanced_vert.spv"},
+            {VK_SHADER_STAGE_FRAGMENT_BIT, "frag.spv"}
+        };
+        config.bindings = {MeshVertex::getBindingDescription(), instance_binding};
+        config.attributes.assign(vertex_attributes.begin(), vertex_attributes.end());
+        if (m_resident) {
+            VkVertexInputAttributeDescription attribute{};
+            attribute.binding = 1;
+            attribute.location = 3;
+            attribute.format = VK_FORMAT_R32_UINT;
+            attribute.offset = 0;
+            config.attributes.push_back(attribute);
+        } else {
+            for (uint32_t column = 0; column < 4; column++) {
+                VkVertexInputAttributeDescription attribute{};
+                attribute.binding = 1;
+                attribute.location = 3 + column;
+                attribute.format = VK_FORMAT_R32G32B32A32_SFLOAT;
+                attribute.offset = sizeof(glm::vec4) * column;
+                config.attributes.push_back(attribute);
+            }
+        }
+        config.push_constant_stages = VK_SHADER_STAGE_VERTEX_BIT;
+        config.push_constant_size = m_resident ? sizeof(LodDrawPushConstants) : sizeof(glm::mat4);
+        config.front_face = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+        config.depth_format = depth_format;
+        config.state = tiers.state;
+
+        m_pipelines = m_pipeline_builder.create_opaque_pipelines(device, surface_format, config, resources);
+
+        if (m_resident) {
+            m_scatter_pipeline = m_pipeline_builder.create_compute_pipeline(device, "instance_scatter.spv", sizeof(InstanceScatterPushConstants), resources);
+        }
+    }
+
+    void LodRenderer::set_geometry(BufferHandle vertices, BufferHandle indices, VkIndexType index_type, const std::vector<MeshLod>& lods, const MeshBounds& bounds){
+        m_vertices = vertices;
+        m_indices = indices;
+        m_index_type = index_type;
+        m_lods = lods;
+        m_bounds = bounds;
+
+        //Draw buffers hold one command per LOD
+        destroy_frame_buffers();
+        create_frame_buffers(m_capacity);
+
+        //Margins relative to the mesh, so jitter of a fraction of its size never touches the tree
+        m_bvh.set_margin(bounds.radius * 0.1f);
+        rebuild_bvh();
+    }
+
+    void LodRenderer::set_instances(const std::vector<glm::mat4>& transforms){
+        m_transforms = transforms;
+
+        if (transforms.size() > m_capacity || m_frames[0].draws.is_null()) {
+            destroy_frame_buffers();
+            create_frame_buffers(static_cast<uint32_t>(transforms.size()));
+        }
+        if (m_resident) {
+            mark_all_dirty();
+        }
+        rebuild_bvh();
+    }
+
+    void LodRenderer::update_instances(const std::vector<glm::mat4>& transforms, const scene::DirtyBits& dirty){
+        if (transforms.size() != m_transforms.size() || m_frames[0].draws.is_null()) {
+            set_instances(transforms);
+            return;
+        }
+
+        //Streamed transforms are read from m_transforms every frame, only the resident copy needs the bits
+        dirty.for_each([&](size_t i) {
+            m_transforms[i] = transforms[i];
+            m_bvh.move_proxy(m_proxies[i], instance_bounds(transforms[i]));
+            if (m_resident) {
+                m_dirty[i / 64] |= uint64_t(1) << (i % 64);
+            }
+        });
+    }
+
+    scene::Aabb LodRenderer::instance_bounds(const glm::mat4& transform) const {
+        glm::vec3 center = glm::vec3(transform * glm::vec4(m_bounds.center, 1.0f));
+        float radius = m_bounds.radius * max_scale(transform);
+        return {center - glm::vec3(radius), center + glm::vec3(radius)};
+    }
+
+    void LodRenderer::rebuild_bvh(){
+        m_bvh.clear();
+        m_proxies.resize(m_transforms.size());
+        for (size_t i = 0; i < m_transforms.size(); i++) {
+            m_proxies[i] = m_bvh.create_proxy(instance_bounds(m_transforms[i]), static_cast<uint32_t>(i));
+        }
+    }
+
+    void LodRenderer::mark_all_dirty(){
+        m_dirty.assign((m_transforms.size() + 63) / 64, ~uint64_t(0));
+
+        //Bits past the last instance stay clear so packing never has to check
+        if (size_t tail = m_transforms.size() % 64; tail != 0) {
+            m_dirty.back() = (uint64_t(1) << tail) - 1;
+        }
+    }
+
+    void LodRenderer::create_frame_buffers(uint32_t capacity){
+        m_capacity = capacity;
+        if (capacity == 0 || m_lods.empty()) {
+            return;
+        }
+
+        VkDeviceSize instance_size = m_resident ? sizeof(uint32_t) : sizeof(glm::mat4);
+        for (auto& frame : m_frames) {
+            frame.instances = m_resources->create_buffer(instance_size * capacity, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, m_streaming_memory);
+            frame.draws = m_resources->create_buffer(sizeof(VkDrawIndexedIndirectCommand) * m_lods.size(), VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, m_streaming_memory);
+            void* mapped_instances = m_resources->map_buffer(frame.instances);
+            frame.mapped_instances = m_resident ? nullptr : static_cast<glm::mat4*>(mapped_instances);
+            frame.mapped_indices = m_resident ? static_cast<uint32_t*>(mapped_instances) : nullptr;
+            frame.mapped_draws = static_cast<VkDrawIndexedIndirectCommand*>(m_resources->map_buffer(frame.draws));
+            frame.draw_count = 0;
+        }
+
+        if (m_resident) {
+            m_resident_instances = m_resources->create_buffer(sizeof(glm::mat4) * capacity, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+            //The new buffer holds nothing yet
+            mark_all_dirty();
+        }
+    }
+
+    void LodRenderer::destroy_frame_buffers(){
+        for (auto& frame : m_frames) {
+            if (!frame.instances.is_null()) {
+                m_resources->destroy_buffer(frame.instances);
+                m_resources->destroy_buffer(frame.draws);
+            }
+            if (!frame.updates.is_null()) {
+                m_resources->destroy_buffer(frame.updates);
+            }
+            frame = {};
+        }
+
+        if (!m_resident_instances.is_null()) {
+            m_resources->destroy_buffer(m_resident_instances);
+            m_resident_instances = {};
+        }
+    }
+
+    void LodRenderer::pack_updates(FrameBuffers& buffers){
+        uint32_t count = 0;
+        for (uint64_t word : m_dirty) {
+            count += static_cast<uint32_t>(std::popcount(word));
+        }
+        if (count == 0) {
+            return;
+        }
+
+        //Powers of two so a burst of changes does not reallocate every frame
+        if (count > buffers.update_capacity) {
+            if (!buffers.updates.is_null()) {
+                m_resources->destroy_buffer(buffers.updates);
+            }
+            buffers.update_capacity = std::bit_ceil(count);
+            buffers.updates = m_resources->create_buffer(sizeof(InstanceUpdate) * buffers.update_capacity, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, m_streaming_memory);
+            buffers.mapped_updates = static_cast<InstanceUpdate*>(m_resources->map_buffer(buffers.updates));
+        }
+
+        for (size_t word = 0; word < m_dirty.size(); word++) {
+            for (uint64_t bits = m_dirty[word]; bits != 0; bits &= bits - 1) {
+                uint32_t index = static_cast<uint32_t>(word * 64 + std::countr_zero(bits));
+                InstanceUpdate& update = buffers.mapped_updates[buffers.update_count++];
+                update.transform = m_transforms[index];
+                update.index = index;
+            }
+            m_dirty[word] = 0;
+        }
+
+        m_stats.uploaded_instances = buffers.update_count;
+        m_stats.uploaded_bytes = uint64_t(buffers.update_count) * sizeof(InstanceUpdate);
+    }
+
+    void LodRenderer::prepare(uint32_t frame, const scene::Camera& camera, VkExtent2D extent, std::pmr::memory_resource* scratch){
+        FrameBuffers& buffers = m_frames[frame];
+        buffers.draw_count = 0;
+        buffers.update_count = 0;
+        m_stats = {};
+
+        if (!has_geometry()) {
+            return;
+        }
+
+        float aspect = static_cast<float>(extent.width) / static_cast<float>(extent.height);
+        scene::Frustum frustum = scene::Frustum::from_matrix(camera.view_projection(aspect));
+
+        //Object space error times this over distance gives the error in pixels
+        float pixels_per_unit = static_cast<float>(extent.height) / (2.0f * std::tan(camera.fov_y * 0.5f));
+        int32_t coarsest_lod = static_cast<int32_t>(m_lods.size()) - 1;
+
+        //Only instances whose boxes touch the frustum are looked at, the sphere test trims the corners
+        m_bvh.flatten();
+        m_visible.clear();
+        m_bvh.query_frustum(frustum, m_visible);
+        m_selected_lods.resize(m_visible.size());
+
+        m_job_system->parallel_for(static_cast<uint32_t>(m_visible.size()), SELECTION_BATCH_SIZE, [&](uint32_t begin, uint32_t end) {
+            for (uint32_t i = begin; i < end; i++) {
+                const glm::mat4& transform = m_transforms[m_visible[i]];
+
+                glm::vec3 center = glm::vec3(transform * glm::vec4(m_bounds.center, 1.0f));
+                float scale = max_scale(transform);
+                float radius = m_bounds.radius * scale;
+
+                if (!frustum.intersects_sphere(center, radius)) {
+                    m_selected_lods[i] = -1;
+                    continue;
+                }
+
+                float distance = std::max(glm::length(center - camera.position) - radius, camera.near_plane);
+
+                int32_t lod = coarsest_lod;
+                while (lod > 0 && m_lods[lod].error * scale * pixels_per_unit / distance > m_error_threshold) {
+                    lod--;
+                }
+                m_selected_lods[i] = lod;
+            }
+        });
+
+        //Bucket instances by LOD so each LOD becomes a single instanced draw
+        std::pmr::vector<uint32_t> lod_counts(m_lods.size(), 0, scratch);
+        for (int32_t lod : m_selected_lods) {
+            if (lod >= 0) {
+                lod_counts[lod]++;
+            }
+        }
+
+        std::pmr::vector<uint32_t> lod_offsets(m_lods.size(), 0, scratch);
+        uint32_t offset = 0;
+        for (size_t lod = 0; lod < m_lods.size(); lod++) {
+            lod_offsets[lod] = offset;
+            offset += lod_counts[lod];
+
+            if (lod_counts[lod] == 0) {
+                continue;
+            }
+
+            VkDrawIndexedIndirectCommand& command = buffers.mapped_draws[buffers.draw_count++];
+            command.indexCount = m_lods[lod].index_count;
+            command.instanceCount = lod_counts[lod];
+            command.firstIndex = m_lods[lod].index_offset;
+            command.vertexOffset = 0;
+            command.firstInstance = lod_offsets[lod];
+
+            m_stats.submitted_triangles += uint64_t(m_lods[lod].index_count / 3) * lod_counts[lod];
+            m_stats.full_detail_triangles += uint64_t(m_lods[0].index_count / 3) * lod_counts[lod];
+        }
+        m_stats.visible_instances = offset;
+
+        if (!m_resident) {
+            for (size_t i = 0; i < m_visible.size(); i++) {
+                if (m_selected_lods[i] >= 0) {
+                    buffers.mapped_instances[lod_offsets[m_selected_lods[i]]++] = m_transforms[m_visible[i]];
+                }
+            }
+            m_stats.uploaded_instances = offset;
+            m_stats.uploaded_bytes = uint64_t(offset) * sizeof(glm::mat4);
+            return;
+        }
+
+        for (size_t i = 0; i < m_visible.size(); i++) {
+            if (m_selected_lods[i] >= 0) {
+                buffers.mapped_indices[lod_offsets[m_selected_lods[i]]++] = m_visible[i];
+            }
+        }
+        pack_updates(buffers);
+    }
+
+    void LodRenderer::record_upload(VkCommandBuffer command_buffer, uint32_t frame){
+        const FrameBuffers& buffers = m_frames[frame];
+        if (!m_resident || buffers.update_count == 0) {
+            return;
+        }
+
+        VkBuffer resident = m_resources->get(m_resident_instances).handle;
+
+        //Earlier frames may still be drawing with the old transforms
+        buffer_barrier(command_buffer, resident,
+            VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT, 0,
+            VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT);
+
+        InstanceScatterPushConstants push_constants{};
+        push_constants.updates = m_resources->get(buffers.updates).address;
+        push_constants.instances = m_resources->get(m_resident_instances).address;
+        push_constants.count = buffers.update_count;
+
+        const evPipeline& scatter = m_resources->get(m_scatter_pipeline);
+        vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, scatter.handle);
+        vkCmdPushConstants(command_buffer, scatter.layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push_constants), &push_constants);
+        vkCmdDispatch(command_buffer, (buffers.update_count + SCATTER_WORKGROUP_SIZE - 1) / SCATTER_WORKGROUP_SIZE, 1, 1);
+
+        buffer_barrier(command_buffer, resident,
+            VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+            VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT);
+    }
+
+    void LodRenderer::hash_state(utils::Hasher& hasher, uint32_t frame) const {
+        const FrameBuffers& buffers = m_frames[frame];
+        hasher.add(has_geometry()).add(m_pipelines).add(m_vertices).add(m_indices).add(m_index_type);
+        hasher.add(buffers.instances).add(buffers.draws).add(buffers.draw_count).add(m_resident_instances);
+
+        //Without multi draw indirect the selected draws end up in the command buffer itself
+        if (!m_multi_draw_indirect && buffers.draw_count > 0) {
+            hasher.add_bytes(buffers.mapped_draws, sizeof(VkDrawIndexedIndirectCommand) * buffers.draw_count);
+        }
+    }
+
+    void LodRenderer::record_draw(VkCommandBuffer command_buffer, uint32_t frame, const glm::mat4& view_proj, DepthPass pass, VkDescriptorSet lighting){
+        const FrameBuffers& buffers = m_frames[frame];
+        if (!has_geometry() || buffers.draw_count == 0) {
+            return;
+        }
+
+        const evPipeline& pipeline = m_resources->get(m_pipelines.get(pass));
+        m_pipeline_builder.bind_opaque(command_buffer, m_pipelines, pass, *m_resources);
+
+        //Lights for frag.spv, pre-pass pipelines have no fragment stage
+        if (lighting != VK_NULL_HANDLE && pass != DepthPass::Prepass) {
+            vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.layout, 0, 1, &lighting, 0, nullptr);
+        }
+
+        if (m_resident) {
+            LodDrawPushConstants push_constants{view_proj, m_resources->get(m_resident_instances).address};
+            vkCmdPushConstants(command_buffer, pipeline.layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(push_constants), &push_constants);
+        } else {
+            vkCmdPushConstants(command_buffer, pipeline.layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(view_proj), &view_proj);
+        }
+
+        VkBuffer vertex_buffers[] = {m_resources->get(m_vertices).handle, m_resources->get(buffers.instances).handle};
+        VkDeviceSize offsets[] = {0, 0};
+        vkCmdBindVertexBuffers(command_buffer, 0, 2, vertex_buffers, offsets);
+        vkCmdBindIndexBuffer(command_buffer, m_resources->get(m_indices).handle, 0, m_index_type);
+
+        if (m_multi_draw_indirect) {
+            vkCmdDrawIndexedIndirect(command_buffer, m_resources->get(buffers.draws).handle, 0, buffers.draw_count, sizeof(VkDrawIndexedIndirectCommand));
+            return;
+        }
+
+        for (uint32_t i = 0; i < buffers.draw_count; i++) {
+            const VkDrawIndexedIndirectCommand& command = buffers.mapped_draws[i];
+            vkCmdDrawIndexed(command_buffer, command.indexCount, command.instanceCount, command.firstIndex, command.vertexOffset, command.firstInstance);
+        }
+    }
+}
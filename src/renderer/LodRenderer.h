@@ -0,0 +1,139 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <memory_resource>
+#include "VulkanPipeline.h"
+#include "evPhysicalDevice.h"
+#include "FeatureTiers.h"
+#include "evResources.h"
+#include "../core/JobSystem.h"
+#include "../utils/Hasher.h"
+#include "../scene/Camera.h"
+#include "../scene/DynamicBvh.h"
+#include "../scene/Scene.h"
+#include "../shapes/Mesh.h"
+
+namespace evoke::vulkan {
+    struct LodStats {
+        uint32_t visible_instances = 0;
+        uint64_t submitted_triangles = 0;
+        //What the visible instances would have cost at full detail
+        uint64_t full_detail_triangles = 0;
+        //Transforms that changed since the last frame and were scattered into the resident buffer
+        uint32_t uploaded_instances = 0;
+        uint64_t uploaded_bytes = 0;
+    };
+
+    //Matches the Update struct in instance_scatter.comp
+    struct InstanceUpdate {
+        glm::mat4 transform;
+        uint32_t index;
+        uint32_t pad[3];
+    };
+
+    //Matches the push constant block in instance_scatter.comp
+    struct InstanceScatterPushConstants {
+        VkDeviceAddress updates;
+        VkDeviceAddress instances;
+        uint32_t count;
+        uint32_t pad;
+    };
+
+    //Matches the push constant block in mesh_resident.vert
+    struct LodDrawPushConstants {
+        glm::mat4 view_proj;
+        VkDeviceAddress instances;
+    };
+
+    //Draws many instances of one mesh. Every frame instances are frustum culled through a BVH of
+    //their bounds and assigned the coarsest LOD whose projected error stays under the pixel
+    //threshold, on the job system.
+    //Instances are bucketed by LOD so the draw stream holds one indirect draw per used LOD.
+    //With buffer device address the transforms stay resident in device local memory. update_instances
+    //takes the dirty bits the scene set when it wrote transforms, prepare packs only those and
+    //record_upload scatters them on the GPU, so the per frame stream is just the visible instance indices.
+    //Without it the visible transforms are streamed whole every frame.
+    class LodRenderer {
+    public:
+        void init(VkDevice device, const evPhysicalDevice& physical_device, const FeatureTiers& tiers, const VkSurfaceFormatKHR& surface_format, VkFormat depth_format, evResources& resources, core::JobSystem& job_system, uint32_t frames_in_flight);
+
+        //Vertex and index buffers must hold the whole LOD chain of the mesh
+        void set_geometry(BufferHandle vertices, BufferHandle indices, VkIndexType index_type, const std::vector<MeshLod>& lods, const MeshBounds& bounds);
+        //Replaces all instances
+        void set_instances(const std::vector<glm::mat4>& transforms);
+        //Same instances, only the ones marked in dirty are read
+        void update_instances(const std::vector<glm::mat4>& transforms, const scene::DirtyBits& dirty);
+        bool has_geometry() const { return !m_lods.empty() && !m_transforms.empty(); }
+        size_t get_instance_count() const { return m_transforms.size(); }
+
+        void set_error_threshold(float pixels) { m_error_threshold = pixels; }
+
+        //Culling and LOD selection, the frame's buffers must no longer be in use by the GPU.
+        //Temporaries come from scratch, e.g. a frame arena.
+        void prepare(uint32_t frame, const scene::Camera& camera, VkExtent2D extent, std::pmr::memory_resource* scratch = std::pmr::get_default_resource());
+        //Outside of rendering, before the frame's draws
+        void record_upload(VkCommandBuffer command_buffer, uint32_t frame);
+        //lighting is ClusteredLighting's set for the frame
+        void record_draw(VkCommandBuffer command_buffer, uint32_t frame, const glm::mat4& view_proj, DepthPass pass = DepthPass::Single, VkDescriptorSet lighting = VK_NULL_HANDLE);
+        //Everything record_draw reads besides the arguments, after prepare, see CommandCache
+        void hash_state(utils::Hasher& hasher, uint32_t frame) const;
+
+        const LodStats& get_stats() const { return m_stats; }
+        //Instance bounds with the instance index as user data, flattened by prepare
+        const scene::DynamicBvh& get_bvh() const { return m_bvh; }
+
+    private:
+        //Per frame in flight, persistently mapped
+        struct FrameBuffers {
+            //Visible transforms, or indices into the resident buffer
+            BufferHandle instances;
+            BufferHandle draws;
+            //Changed transforms for the scatter, grown on demand
+            BufferHandle updates;
+            glm::mat4* mapped_instances = nullptr;
+            uint32_t* mapped_indices = nullptr;
+            VkDrawIndexedIndirectCommand* mapped_draws = nullptr;
+            InstanceUpdate* mapped_updates = nullptr;
+            uint32_t draw_count = 0;
+            uint32_t update_count = 0;
+            uint32_t update_capacity = 0;
+        };
+
+        evResources* m_resources = nullptr;
+        core::JobSystem* m_job_system = nullptr;
+        Pipeline m_pipeline_builder;
+        OpaquePipelines m_pipelines;
+        PipelineHandle m_scatter_pipeline;
+        bool m_resident = false;
+        bool m_multi_draw_indirect = false;
+        VkMemoryPropertyFlags m_streaming_memory = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+        BufferHandle m_vertices;
+        BufferHandle m_indices;
+        VkIndexType m_index_type = VK_INDEX_TYPE_UINT32;
+        std::vector<MeshLod> m_lods;
+        MeshBounds m_bounds{};
+
+        std::vector<glm::mat4> m_transforms;
+        scene::DynamicBvh m_bvh;
+        std::vector<scene::ProxyId> m_proxies;
+        //Instances the BVH found in the frustum and the LOD picked for each, -1 if culled
+        std::vector<uint32_t> m_visible;
+        std::vector<int32_t> m_selected_lods;
+        std::vector<FrameBuffers> m_frames;
+        uint32_t m_capacity = 0;
+
+        BufferHandle m_resident_instances;
+        //One bit per instance whose resident transform is stale, clean words are skipped 64 at a time
+        std::vector<uint64_t> m_dirty;
+
+        float m_error_threshold = 1.0f;
+        LodStats m_stats;
+
+        void create_frame_buffers(uint32_t capacity);
+        void destroy_frame_buffers();
+        void mark_all_dirty();
+        scene::Aabb instance_bounds(const glm::mat4& transform) const;
+        void rebuild_bvh();
+        void pack_updates(FrameBuffers& buffers);
+    };
+}
@@ -0,0 +1,152 @@
+#include "MemoryBudget.h"
+#include "../utils/Logger.h"
+#include "../utils/Profiler.h"
+#include <string>
+
+namespace evoke::vulkan {
+    namespace {
+        //Without VK_EXT_memory_budget leave room for other processes and the driver
+        constexpr VkDeviceSize FALLBACK_BUDGET_PERCENT = 80;
+        //A heap over this share of its budget evicts at the next update, down to the target share
+        constexpr double PRESSURE_THRESHOLD = 0.95;
+        constexpr double PRESSURE_TARGET = 0.9;
+
+        constexpr double MIB = 1024.0 * 1024.0;
+    }
+
+    const char* to_string(MemoryCategory category){
+        switch (category) {
+            case MemoryCategory::Geometry: return "geometry";
+            case MemoryCategory::Textures: return "textures";
+            case MemoryCategory::Staging: return "staging";
+            case MemoryCategory::Transient: return "transient";
+            default: return "unknown";
+        }
+    }
+
+    void MemoryBudget::init(VkPhysicalDevice physical_device, bool budget_extension){
+        m_physical_device = physical_device;
+        m_budget_extension = budget_extension;
+
+        VkPhysicalDeviceMemoryProperties memory_properties;
+        vkGetPhysicalDeviceMemoryProperties(physical_device, &memory_properties);
+
+        m_stats.heaps.resize(memory_properties.memoryHeapCount);
+        for (uint32_t i = 0; i < memory_properties.memoryHeapCount; i++) {
+            m_stats.heaps[i].size = memory_properties.memoryHeaps[i].size;
+            m_stats.heaps[i].device_local = (memory_properties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+        }
+
+        m_allocated.assign(memory_properties.memoryHeapCount, 0);
+        m_allocated_at_update.assign(memory_properties.memoryHeapCount, 0);
+        m_driver_usage.assign(memory_properties.memoryHeapCount, 0);
+
+        //Built once, publish runs every frame
+        for (size_t i = 0; i < m_stats.categories.size(); i++) {
+            m_counter_names.push_back(std::string("memory.") + to_string(static_cast<MemoryCategory>(i)) + "_mib");
+        }
+        for (uint32_t i = 0; i < memory_properties.memoryHeapCount; i++) {
+            std::string heap = "memory.heap" + std::to_string(i);
+            m_counter_names.push_back(heap + "_usage_mib");
+            m_counter_names.push_back(heap + "_budget_mib");
+        }
+
+        utils::Logger::info(budget_extension ? "Memory budget from VK_EXT_memory_budget!" : "Memory budget estimated from heap sizes!");
+        update();
+    }
+
+    void MemoryBudget::update(){
+        VkPhysicalDeviceMemoryBudgetPropertiesEXT budget_properties{};
+        budget_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+
+        VkPhysicalDeviceMemoryProperties2 memory_properties{};
+        memory_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+        memory_properties.pNext = m_budget_extension ? &budget_properties : nullptr;
+        vkGetPhysicalDeviceMemoryProperties2(m_physical_device, &memory_properties);
+
+        for (uint32_t i = 0; i < m_stats.heaps.size(); i++) {
+            HeapBudget& heap = m_stats.heaps[i];
+            if (m_budget_extension) {
+                heap.budget = budget_properties.heapBudget[i];
+                m_driver_usage[i] = budget_properties.heapUsage[i];
+            } else {
+                heap.budget = heap.size * FALLBACK_BUDGET_PERCENT / 100;
+                m_driver_usage[i] = m_allocated[i];
+            }
+            m_allocated_at_update[i] = m_allocated[i];
+            refresh_usage(i);
+        }
+
+        for (uint32_t i = 0; i < m_stats.heaps.size(); i++) {
+            const HeapBudget& heap = m_stats.heaps[i];
+            if (static_cast<double>(heap.usage) > static_cast<double>(heap.budget) * PRESSURE_THRESHOLD) {
+                VkDeviceSize target = static_cast<VkDeviceSize>(static_cast<double>(heap.budget) * PRESSURE_TARGET);
+                evict(i, heap.usage - target);
+            }
+        }
+
+        publish();
+    }
+
+    bool MemoryBudget::reserve(uint32_t heap, VkDeviceSize size){
+        refresh_usage(heap);
+        const HeapBudget& budget = m_stats.heaps[heap];
+        if (budget.usage + size <= budget.budget) {
+            return true;
+        }
+
+        evict(heap, budget.usage + size - budget.budget);
+        return budget.usage + size <= budget.budget;
+    }
+
+    VkDeviceSize MemoryBudget::evict(uint32_t heap, VkDeviceSize size){
+        VkDeviceSize freed = 0;
+        for (EvictionCallback& eviction : m_evictions) {
+            if (freed >= size) {
+                break;
+            }
+            freed += eviction(heap, size - freed);
+        }
+
+        if (freed > 0) {
+            m_stats.evicted += freed;
+            utils::Logger::info("Evicted ", static_cast<double>(freed) / MIB, " MiB from heap ", heap, "!");
+        }
+        refresh_usage(heap);
+        return freed;
+    }
+
+    void MemoryBudget::track_allocation(uint32_t heap, MemoryCategory category, VkDeviceSize size){
+        m_allocated[heap] += size;
+        m_stats.categories[static_cast<size_t>(category)] += size;
+        refresh_usage(heap);
+    }
+
+    void MemoryBudget::track_free(uint32_t heap, MemoryCategory category, VkDeviceSize size){
+        m_allocated[heap] -= size;
+        m_stats.categories[static_cast<size_t>(category)] -= size;
+        refresh_usage(heap);
+    }
+
+    void MemoryBudget::refresh_usage(uint32_t heap){
+        //The driver's number is a frame old, add what changed since
+        int64_t change = static_cast<int64_t>(m_allocated[heap]) - static_cast<int64_t>(m_allocated_at_update[heap]);
+        int64_t usage = static_cast<int64_t>(m_driver_usage[heap]) + change;
+        m_stats.heaps[heap].usage = usage > 0 ? static_cast<VkDeviceSize>(usage) : 0;
+    }
+
+    void MemoryBudget::publish() const {
+        size_t name = 0;
+        for (size_t i = 0; i < m_stats.categories.size(); i++) {
+            utils::Profiler::set_counter(m_counter_names[name++], static_cast<double>(m_stats.categories[i]) / MIB);
+        }
+
+        for (size_t i = 0; i < m_stats.heaps.size(); i++) {
+            utils::Profiler::set_counter(m_counter_names[name++], static_cast<double>(m_stats.heaps[i].usage) / MIB);
+            utils::Profiler::set_counter(m_counter_names[name++], static_cast<double>(m_stats.heaps[i].budget) / MIB);
+        }
+
+        utils::Profiler::set_counter("memory.evicted_mib", static_cast<double>(m_stats.evicted) / MIB);
+        utils::Profiler::set_counter("memory.fallbacks", m_stats.fallbacks);
+    }
+}
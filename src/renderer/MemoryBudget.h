@@ -0,0 +1,83 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace evoke::vulkan {
+    enum class MemoryCategory : uint32_t {
+        Geometry,       //Device local buffers: vertices, indices, meshlets, simulation state
+        Textures,       //Sampled images
+        Staging,        //Host memory only used for copies and readbacks
+        Transient,      //Rewritten every frame or recreated with the swapchain: instance buffers, render targets
+        Count
+    };
+
+    const char* to_string(MemoryCategory category);
+
+    struct HeapBudget {
+        VkDeviceSize size = 0;
+        //What the driver lets this process use, 80% of the heap without VK_EXT_memory_budget
+        VkDeviceSize budget = 0;
+        //Everything the process uses on the heap, only the renderer's own allocations without the extension
+        VkDeviceSize usage = 0;
+        bool device_local = false;
+    };
+
+    struct MemoryStats {
+        std::vector<HeapBudget> heaps;
+        std::array<VkDeviceSize, static_cast<size_t>(MemoryCategory::Count)> categories{};
+        //Bytes freed by eviction callbacks since startup
+        VkDeviceSize evicted = 0;
+        //Allocations that did not fit into VRAM and went to system memory
+        uint32_t fallbacks = 0;
+    };
+
+    //Frees memory on the heap, returns the bytes freed, 0 once there is nothing left to drop.
+    //Runs on the render thread and may only free what the GPU no longer reads.
+    using EvictionCallback = std::function<VkDeviceSize(uint32_t heap, VkDeviceSize needed)>;
+
+    //Keeps the renderer's allocations inside the driver's budget. evResources reports every allocation
+    //by category, and allocations that would exceed a heap's budget first run the eviction callbacks,
+    //so caches and detail levels are dropped before the driver starts failing or paging.
+    class MemoryBudget {
+    public:
+        void init(VkPhysicalDevice physical_device, bool budget_extension);
+
+        //Queries the budget of every heap, once per frame. Heaps close to their budget evict right away.
+        void update();
+
+        //Callbacks run in registration order, register the cheapest to rebuild first
+        void add_eviction(EvictionCallback callback) { m_evictions.push_back(std::move(callback)); }
+        //Evicts until size fits into the heap's budget, false when it still does not
+        bool reserve(uint32_t heap, VkDeviceSize size);
+        //Evicts at least size bytes from the heap, e.g. after the driver failed an allocation
+        VkDeviceSize evict(uint32_t heap, VkDeviceSize size);
+
+        void track_allocation(uint32_t heap, MemoryCategory category, VkDeviceSize size);
+        void track_free(uint32_t heap, MemoryCategory category, VkDeviceSize size);
+        void track_fallback() { m_stats.fallbacks++; }
+
+        const MemoryStats& get_stats() const { return m_stats; }
+
+    private:
+        VkPhysicalDevice m_physical_device = VK_NULL_HANDLE;
+        bool m_budget_extension = false;
+
+        std::vector<EvictionCallback> m_evictions;
+        //Per heap, what this renderer allocated now and at the last update
+        std::vector<VkDeviceSize> m_allocated;
+        std::vector<VkDeviceSize> m_allocated_at_update;
+        //Per heap usage reported by the driver at the last update
+        std::vector<VkDeviceSize> m_driver_usage;
+
+        MemoryStats m_stats;
+        //Profiler counters per category, then usage and budget per heap
+        std::vector<std::string> m_counter_names;
+
+        void refresh_usage(uint32_t heap);
+        void publish() const;
+    };
+}
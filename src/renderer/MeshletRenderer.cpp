@@ -0,0 +1,224 @@
+#include "MeshletRenderer.h"
+#include "../shapes/Mesh.h"
+#include <algorithm>
+
+namespace evoke::vulkan {
+    namespace {
+        //Draw count followed by the indirect commands, the count is kept 16 byte aligned
+        constexpr VkDeviceSize DRAW_COMMANDS_OFFSET = 16;
+
+        void buffer_barrier(VkCommandBuffer command_buffer, VkBuffer buffer, VkPipelineStageFlags2 src_stage_mask, VkAccessFlags2 src_access_mask, VkPipelineStageFlags2 dst_stage_mask, VkAccessFlags2 dst_access_mask){
+            VkBufferMemoryBarrier2 barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2;
+            barrier.srcStageMask = src_stage_mask;
+            barrier.srcAccessMask = src_access_mask;
+            barrier.dstStageMask = dst_stage_mask;
+            barrier.dstAccessMask = dst_access_mask;
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.buffer = buffer;
+            barrier.offset = 0;
+            barrier.size = VK_WHOLE_SIZE;
+
+            VkDependencyInfo dependency_info{};
+            dependency_info.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+            dependency_info.bufferMemoryBarrierCount = 1;
+            dependency_info.pBufferMemoryBarriers = &barrier;
+
+            vkCmdPipelineBarrier2(command_buffer, &dependency_info);
+        }
+    }
+
+    void MeshletRenderer::init(VkDevice device, const evPhysicalDevice& physical_device, const FeatureTiers& tiers, const VkSurfaceFormatKHR& surface_format, VkFormat depth_format, evResources& resources){
+        m_device = device;
+        m_resources = &resources;
+
+        m_path = tiers.geometry;
+        m_compact_draws = tiers.compact_draws;
+        m_max_draws = std::max(physical_device.get().properties.limits.maxDrawIndirectCount, 1u);
+
+        GraphicsPipelineConfig config{};
+        config.front_face = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+        config.push_constant_size = sizeof(MeshletPushConstants);
+        config.depth_format = depth_format;
+        config.state = tiers.state;
+
+        if (m_path == GeometryTier::MeshShader) {
+            utils::Logger::info("Meshlet renderer using mesh shaders!");
+
+            m_draw_mesh_tasks = reinterpret_cast<PFN_vkCmdDrawMeshTasksEXT>(vkGetDeviceProcAddr(device, "vkCmdDrawMeshTasksEXT"));
+
+            config.shaders = {
+                {VK_SHADER_STAGE_TASK_BIT_EXT, "meshlet_task.spv"},
+                {VK_SHADER_STAGE_MESH_BIT_EXT, "meshlet_mesh.spv"},
+                {VK_SHADER_STAGE_FRAGMENT_BIT, "frag.spv"}
+            };
+            config.push_constant_stages = VK_SHADER_STAGE_TASK_BIT_EXT | VK_SHADER_STAGE_MESH_BIT_EXT;
+        } else {
+            utils::Logger::info(m_path == GeometryTier::ComputeCull ? "Meshlet renderer using compute culling!" : "Meshlet renderer drawing without culling!");
+
+            auto binding_description = MeshVertex::getBindingDescription();
+            auto attribute_descriptions = MeshVertex::getAttributeDescriptions();
+
+            config.shaders = {
+                {VK_SHADER_STAGE_VERTEX_BIT, "meshlet_vert.spv"},
+                {VK_SHADER_STAGE_FRAGMENT_BIT, "frag.spv"}
+            };
+            config.bindings = {binding_description};
+            config.attributes.assign(attribute_descriptions.begin(), attribute_descriptions.end());
+            config.push_constant_stages = VK_SHADER_STAGE_VERTEX_BIT;
+
+            if (m_path == GeometryTier::ComputeCull) {
+                m_cull_pipeline = m_pipeline_builder.create_compute_pipeline(device, "meshlet_cull.spv", sizeof(MeshletPushConstants), resources);
+            }
+        }
+
+        m_graphics_pipelines = m_pipeline_builder.create_opaque_pipelines(device, surface_format, config, resources);
+
+        switch (m_path) {
+            case GeometryTier::MeshShader:
+                m_compact_draws ? select_tier<GeometryTier::MeshShader, true>() : select_tier<GeometryTier::MeshShader, false>();
+                break;
+            case GeometryTier::ComputeCull:
+                m_compact_draws ? select_tier<GeometryTier::ComputeCull, true>() : select_tier<GeometryTier::ComputeCull, false>();
+                break;
+            case GeometryTier::Direct:
+                select_tier<GeometryTier::Direct, false>();
+                break;
+        }
+    }
+
+    template<GeometryTier Tier, bool CompactDraws>
+    void MeshletRenderer::select_tier(){
+        m_record_cull = &MeshletRenderer::record_cull_tier<Tier, CompactDraws>;
+        m_record_draw = &MeshletRenderer::record_draw_tier<Tier, CompactDraws>;
+    }
+
+    VkBufferUsageFlags MeshletRenderer::geometry_usage() const {
+        VkBufferUsageFlags usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+        if (m_path != GeometryTier::Direct) {
+            usage |= VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+        }
+        return usage;
+    }
+
+    void MeshletRenderer::set_geometry(const MeshletGeometry& geometry){
+        m_geometry = geometry;
+
+        if (!m_draw_buffer.is_null()) {
+            m_resources->destroy_buffer(m_draw_buffer);
+            m_draw_buffer = {};
+        }
+
+        if (m_path == GeometryTier::ComputeCull) {
+            VkDeviceSize size = DRAW_COMMANDS_OFFSET + sizeof(VkDrawIndexedIndirectCommand) * geometry.meshlet_count;
+            m_draw_buffer = m_resources->create_buffer(size, VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+            //A count buffer draw can't be split, past the limit every command keeps its slot instead
+            bool compact_draws = m_compact_draws && geometry.meshlet_count <= m_max_draws;
+            if (m_compact_draws && !compact_draws) {
+                utils::Logger::info("Meshlet count ", geometry.meshlet_count, " exceeds maxDrawIndirectCount ", m_max_draws, ", drawing without the count buffer!");
+            }
+            compact_draws ? select_tier<GeometryTier::ComputeCull, true>() : select_tier<GeometryTier::ComputeCull, false>();
+        }
+    }
+
+    template<GeometryTier Tier, bool CompactDraws>
+    MeshletPushConstants MeshletRenderer::make_push_constants(const glm::mat4& view_proj, const glm::vec3& camera_position) const {
+        MeshletPushConstants push_constants{};
+        push_constants.view_proj = view_proj;
+        push_constants.camera_position = glm::vec4(camera_position, 1.0f);
+        push_constants.meshlet_count = m_geometry.meshlet_count;
+        push_constants.compact_draws = CompactDraws ? 1 : 0;
+
+        if constexpr (Tier != GeometryTier::Direct) {
+            push_constants.vertices = m_resources->get(m_geometry.vertices).address;
+            push_constants.meshlets = m_resources->get(m_geometry.meshlets).address;
+            push_constants.meshlet_vertices = m_resources->get(m_geometry.meshlet_vertices).address;
+            push_constants.meshlet_triangles = m_resources->get(m_geometry.meshlet_triangles).address;
+        }
+
+        if constexpr (Tier == GeometryTier::ComputeCull) {
+            push_constants.draws = m_resources->get(m_draw_buffer).address;
+        }
+
+        return push_constants;
+    }
+
+    template<GeometryTier Tier, bool CompactDraws>
+    void MeshletRenderer::record_cull_tier(VkCommandBuffer command_buffer, const glm::mat4& view_proj, const glm::vec3& camera_position){
+        //Only the compute path culls ahead of the draw
+        if constexpr (Tier == GeometryTier::ComputeCull) {
+            if (!has_geometry()) {
+                return;
+            }
+
+            VkBuffer draw_buffer = m_resources->get(m_draw_buffer).handle;
+
+            //Previous frame may still be reading the commands
+            buffer_barrier(command_buffer, draw_buffer,
+                VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT, VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT,
+                VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT);
+
+            vkCmdFillBuffer(command_buffer, draw_buffer, 0, DRAW_COMMANDS_OFFSET, 0);
+
+            buffer_barrier(command_buffer, draw_buffer,
+                VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+                VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT);
+
+            const evPipeline& cull_pipeline = m_resources->get(m_cull_pipeline);
+            MeshletPushConstants push_constants = make_push_constants<Tier, CompactDraws>(view_proj, camera_position);
+
+            vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, cull_pipeline.handle);
+            vkCmdPushConstants(command_buffer, cull_pipeline.layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push_constants), &push_constants);
+            vkCmdDispatch(command_buffer, (m_geometry.meshlet_count + 63) / 64, 1, 1);
+
+            buffer_barrier(command_buffer, draw_buffer,
+                VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+                VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT, VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT);
+        }
+    }
+
+    template<GeometryTier Tier, bool CompactDraws>
+    void MeshletRenderer::record_draw_tier(VkCommandBuffer command_buffer, const glm::mat4& view_proj, const glm::vec3& camera_position, DepthPass pass, VkDescriptorSet lighting){
+        if (!has_geometry()) {
+            return;
+        }
+
+        const evPipeline& graphics_pipeline = m_resources->get(m_graphics_pipelines.get(pass));
+        MeshletPushConstants push_constants = make_push_constants<Tier, CompactDraws>(view_proj, camera_position);
+
+        m_pipeline_builder.bind_opaque(command_buffer, m_graphics_pipelines, pass, *m_resources);
+
+        //Lights for frag.spv, pre-pass pipelines have no fragment stage
+        if (lighting != VK_NULL_HANDLE && pass != DepthPass::Prepass) {
+            vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphics_pipeline.layout, 0, 1, &lighting, 0, nullptr);
+        }
+
+        if constexpr (Tier == GeometryTier::MeshShader) {
+            vkCmdPushConstants(command_buffer, graphics_pipeline.layout, VK_SHADER_STAGE_TASK_BIT_EXT | VK_SHADER_STAGE_MESH_BIT_EXT, 0, sizeof(push_constants), &push_constants);
+            m_draw_mesh_tasks(command_buffer, (m_geometry.meshlet_count + 31) / 32, 1, 1);
+        } else {
+            vkCmdPushConstants(command_buffer, graphics_pipeline.layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(push_constants), &push_constants);
+
+            VkBuffer vertex_buffers[] = {m_resources->get(m_geometry.vertices).handle};
+            VkDeviceSize offsets[] = {0};
+            vkCmdBindVertexBuffers(command_buffer, 0, 1, vertex_buffers, offsets);
+            vkCmdBindIndexBuffer(command_buffer, m_resources->get(m_geometry.indices).handle, 0, m_geometry.index_type);
+
+            if constexpr (Tier == GeometryTier::Direct) {
+                vkCmdDrawIndexed(command_buffer, m_geometry.index_count, 1, 0, 0, 0);
+            } else {
+                VkBuffer draw_buffer = m_resources->get(m_draw_buffer).handle;
+                if constexpr (CompactDraws) {
+                    vkCmdDrawIndexedIndirectCount(command_buffer, draw_buffer, DRAW_COMMANDS_OFFSET, draw_buffer, 0, m_geometry.meshlet_count, sizeof(VkDrawIndexedIndirectCommand));
+                } else {
+                    for (uint32_t first = 0; first < m_geometry.meshlet_count; first += m_max_draws) {
+                        uint32_t draw_count = std::min(m_geometry.meshlet_count - first, m_max_draws);
+                        vkCmdDrawIndexedIndirect(command_buffer, draw_buffer, DRAW_COMMANDS_OFFSET + sizeof(VkDrawIndexedIndirectCommand) * first, draw_count, sizeof(VkDrawIndexedIndirectCommand));
+                    }
+                }
+            }
+        }
+    }
+}
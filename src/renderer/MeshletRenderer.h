@@ -0,0 +1,95 @@
+#pragma once
+#include <glm/glm.hpp>
+#include "VulkanPipeline.h"
+#include "FeatureTiers.h"
+#include "evResources.h"
+#include "../utils/Hasher.h"
+
+namespace evoke::vulkan {
+    //Matches the push constant block in meshlet_common.glsl
+    struct MeshletPushConstants {
+        glm::mat4 view_proj;
+        glm::vec4 camera_position;
+        uint32_t meshlet_count;
+        uint32_t compact_draws;
+        VkDeviceAddress vertices;
+        VkDeviceAddress meshlets;
+        VkDeviceAddress meshlet_vertices;
+        VkDeviceAddress meshlet_triangles;
+        VkDeviceAddress draws;
+    };
+    static_assert(sizeof(MeshletPushConstants) <= 128, "meshlet push constants exceed the guaranteed minimum");
+
+    //GPU copies of a mesh split by build_meshlets
+    struct MeshletGeometry {
+        BufferHandle vertices;
+        BufferHandle indices;
+        BufferHandle meshlets;
+        BufferHandle meshlet_vertices;
+        BufferHandle meshlet_triangles;
+        uint32_t meshlet_count = 0;
+        uint32_t index_count = 0;
+        VkIndexType index_type = VK_INDEX_TYPE_UINT32;
+    };
+
+    class MeshletRenderer {
+    public:
+        //Builds the pipelines of the geometry tier and selects its recording functions
+        void init(VkDevice device, const evPhysicalDevice& physical_device, const FeatureTiers& tiers, const VkSurfaceFormatKHR& surface_format, VkFormat depth_format, evResources& resources);
+
+        void set_geometry(const MeshletGeometry& geometry);
+        bool has_geometry() const { return m_geometry.meshlet_count > 0; }
+
+        GeometryTier get_path() const { return m_path; }
+
+        //Buffer usage the geometry needs on the chosen path
+        VkBufferUsageFlags geometry_usage() const;
+
+        //Must be recorded outside of dynamic rendering
+        void record_cull(VkCommandBuffer command_buffer, const glm::mat4& view_proj, const glm::vec3& camera_position){
+            (this->*m_record_cull)(command_buffer, view_proj, camera_position);
+        }
+        //lighting is ClusteredLighting's set for the frame
+        void record_draw(VkCommandBuffer command_buffer, const glm::mat4& view_proj, const glm::vec3& camera_position, DepthPass pass = DepthPass::Single, VkDescriptorSet lighting = VK_NULL_HANDLE){
+            (this->*m_record_draw)(command_buffer, view_proj, camera_position, pass, lighting);
+        }
+
+        //Everything recording reads besides the arguments, see CommandCache
+        void hash_state(utils::Hasher& hasher) const {
+            hasher.add(m_geometry).add(m_graphics_pipelines).add(m_cull_pipeline).add(m_draw_buffer);
+        }
+
+    private:
+        VkDevice m_device = VK_NULL_HANDLE;
+        evResources* m_resources = nullptr;
+        Pipeline m_pipeline_builder;
+
+        GeometryTier m_path = GeometryTier::Direct;
+        bool m_compact_draws = false;
+        //maxDrawIndirectCount, larger meshes are drawn in several indirect draws without the count buffer
+        uint32_t m_max_draws = 1;
+
+        using CullFunction = void (MeshletRenderer::*)(VkCommandBuffer, const glm::mat4&, const glm::vec3&);
+        using DrawFunction = void (MeshletRenderer::*)(VkCommandBuffer, const glm::mat4&, const glm::vec3&, DepthPass, VkDescriptorSet);
+        //Instantiations for the device's tier, picked once in init
+        CullFunction m_record_cull = nullptr;
+        DrawFunction m_record_draw = nullptr;
+
+        OpaquePipelines m_graphics_pipelines;
+        PipelineHandle m_cull_pipeline;
+
+        MeshletGeometry m_geometry;
+        BufferHandle m_draw_buffer;
+
+        PFN_vkCmdDrawMeshTasksEXT m_draw_mesh_tasks = nullptr;
+
+        template<GeometryTier Tier, bool CompactDraws>
+        void select_tier();
+        template<GeometryTier Tier, bool CompactDraws>
+        void record_cull_tier(VkCommandBuffer command_buffer, const glm::mat4& view_proj, const glm::vec3& camera_position);
+        template<GeometryTier Tier, bool CompactDraws>
+        void record_draw_tier(VkCommandBuffer command_buffer, const glm::mat4& view_proj, const glm::vec3& camera_position, DepthPass pass, VkDescriptorSet lighting);
+        template<GeometryTier Tier, bool CompactDraws>
+        MeshletPushConstants make_push_constants(const glm::mat4& view_proj, const glm::vec3& camera_position) const;
+    };
+}
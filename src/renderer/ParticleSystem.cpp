@@ -0,0 +1,317 @@
+#include "ParticleSystem.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <memory_resource>
+
+namespace evoke::vulkan {
+    namespace {
+        //Count followed by the entries, kept 16 byte aligned like the meshlet draw buffer
+        constexpr VkDeviceSize LIST_HEADER_SIZE = 16;
+        constexpr uint32_t WORKGROUP_SIZE = 256;
+        constexpr uint32_t EMIT_WORKGROUP_SIZE = 64;
+
+        uint32_t group_count(uint32_t threads, uint32_t workgroup_size){
+            return std::max((threads + workgroup_size - 1) / workgroup_size, 1u);
+        }
+
+        //Compute results become visible to later kernels and to the indirect arguments they read
+        void compute_barrier(VkCommandBuffer command_buffer){
+            VkMemoryBarrier2 barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+            barrier.srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+            barrier.srcAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+            barrier.dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT;
+            barrier.dstAccessMask = VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT | VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT;
+
+            VkDependencyInfo dependency_info{};
+            dependency_info.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+            dependency_info.memoryBarrierCount = 1;
+            dependency_info.pMemoryBarriers = &barrier;
+
+            vkCmdPipelineBarrier2(command_buffer, &dependency_info);
+        }
+    }
+
+    void ParticleSystem::init(VkDevice device, const evPhysicalDevice& physical_device, const VkSurfaceFormatKHR& surface_format, VkFormat depth_format, evResources& resources, QueueSet& queues, uint32_t frames_in_flight, uint32_t capacity, BlendMode blend){
+        m_device = device;
+        m_resources = &resources;
+        m_queues = &queues;
+        m_capacity = std::max(capacity, 1u);
+        m_blend = blend;
+
+        //Every kernel reaches its buffers through device addresses
+        if (!physical_device.get().feature_support.buffer_device_address) {
+            utils::Logger::error("Particles need buffer device address, particle system disabled!");
+            return;
+        }
+
+        m_sort_capacity = 1;
+        while (m_sort_capacity < m_capacity) {
+            m_sort_capacity <<= 1;
+        }
+        uint32_t sort_levels = static_cast<uint32_t>(std::log2(m_sort_capacity));
+
+        m_stats.capacity = m_capacity;
+        m_stats.sort_passes = m_blend == BlendMode::Alpha ? sort_levels * (sort_levels + 1) / 2 : 0;
+        m_stats.async_compute = queues.is_dedicated(QueueType::Compute);
+
+        //Workgroup sizes are specialization constants, the dispatch math here is the only place they are set
+        SpecializationConstants workgroup;
+        workgroup.set(0, WORKGROUP_SIZE);
+        SpecializationConstants emit_workgroup;
+        emit_workgroup.set(0, EMIT_WORKGROUP_SIZE);
+
+        const uint32_t push_constant_size = sizeof(ParticleComputePushConstants);
+        m_reset_pipeline = m_pipeline_builder.create_compute_pipeline(device, "particle_reset.spv", push_constant_size, resources, workgroup);
+        m_simulate_pipeline = m_pipeline_builder.create_compute_pipeline(device, "particle_simulate.spv", push_constant_size, resources, workgroup);
+        m_emit_pipeline = m_pipeline_builder.create_compute_pipeline(device, "particle_emit.spv", push_constant_size, resources, emit_workgroup);
+        m_compact_pipeline = m_pipeline_builder.create_compute_pipeline(device, "particle_compact.spv", push_constant_size, resources, workgroup);
+        m_sort_pipeline = m_pipeline_builder.create_compute_pipeline(device, "particle_sort.spv", push_constant_size, resources, workgroup);
+
+        //No vertex input, quads are expanded from the sorted keys
+        GraphicsPipelineConfig config{};
+        config.shaders = {
+            {VK_SHADER_STAGE_VERTEX_BIT, "particle_vert.spv"},
+            {VK_SHADER_STAGE_FRAGMENT_BIT, "particle_frag.spv"}
+        };
+        config.push_constant_stages = VK_SHADER_STAGE_VERTEX_BIT;
+        config.push_constant_size = sizeof(ParticleDrawPushConstants);
+        config.cull_mode = VK_CULL_MODE_NONE;
+        config.blend = blend;
+        //Hidden behind opaque geometry, but blended particles never occlude each other
+        config.depth_format = depth_format;
+        config.depth_test = true;
+
+        m_draw_pipeline = m_pipeline_builder.create_graphics_pipeline(device, surface_format, config, resources);
+
+        create_buffers();
+        create_command_buffers(frames_in_flight);
+
+        m_enabled = true;
+        utils::Logger::info("Particle system created with ", m_capacity, " particles, ", m_stats.sort_passes, " sort passes, ",
+            m_stats.async_compute ? "async compute" : "compute on the graphics queue", "!");
+    }
+
+    void ParticleSystem::create_buffers(){
+        const VkBufferUsageFlags storage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+
+        //Written on the compute queue and read by the draw on the graphics queue
+        for (uint32_t set = 0; set < 2; set++) {
+            m_particles[set] = m_resources->create_buffer(sizeof(Particle) * m_capacity, storage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, true);
+            m_keys[set] = m_resources->create_buffer(LIST_HEADER_SIZE + sizeof(uint32_t) * 2 * m_sort_capacity, storage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, true);
+            m_draws[set] = m_resources->create_buffer(sizeof(VkDrawIndirectCommand), storage | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, true);
+            m_alive[set] = m_resources->create_buffer(LIST_HEADER_SIZE + sizeof(uint32_t) * m_capacity, storage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        }
+        m_dead = m_resources->create_buffer(LIST_HEADER_SIZE + sizeof(uint32_t) * m_capacity, storage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        //Simulate dispatch followed by one per sort pass, the simulate one is also used without sorting
+        m_dispatches = m_resources->create_buffer(sizeof(VkDispatchIndirectCommand) * (1 + std::max(m_stats.sort_passes, 1u)), storage | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+        ParticleBindings bindings{};
+        for (uint32_t set = 0; set < 2; set++) {
+            bindings.particles[set] = m_resources->get(m_particles[set]).address;
+            bindings.keys[set] = m_resources->get(m_keys[set]).address;
+            bindings.draws[set] = m_resources->get(m_draws[set]).address;
+            bindings.alive[set] = m_resources->get(m_alive[set]).address;
+        }
+        bindings.dead = m_resources->get(m_dead).address;
+        bindings.dispatches = m_resources->get(m_dispatches).address;
+
+        //Never changes, so one host visible copy serves every frame
+        m_bindings = m_resources->create_buffer(sizeof(ParticleBindings), storage, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        *static_cast<ParticleBindings*>(m_resources->map_buffer(m_bindings)) = bindings;
+    }
+
+    void ParticleSystem::create_command_buffers(uint32_t frames_in_flight){
+        VkCommandPoolCreateInfo pool_info{};
+        pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+        pool_info.queueFamilyIndex = m_queues->get_family(QueueType::Compute);
+
+        if (vkCreateCommandPool(m_device, &pool_info, nullptr, &m_command_pool) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create particle command pool!");
+        }
+
+        m_command_buffers.resize(frames_in_flight);
+
+        VkCommandBufferAllocateInfo allocate_info{};
+        allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocate_info.commandPool = m_command_pool;
+        allocate_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocate_info.commandBufferCount = frames_in_flight;
+
+        if (vkAllocateCommandBuffers(m_device, &allocate_info, m_command_buffers.data()) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate particle command buffers!");
+        }
+    }
+
+    void ParticleSystem::clean_up(){
+        if (!m_enabled) {
+            return;
+        }
+
+        vkDestroyCommandPool(m_device, m_command_pool, nullptr);
+        m_command_pool = VK_NULL_HANDLE;
+
+        for (uint32_t set = 0; set < 2; set++) {
+            m_resources->destroy_buffer(m_particles[set]);
+            m_resources->destroy_buffer(m_keys[set]);
+            m_resources->destroy_buffer(m_draws[set]);
+            m_resources->destroy_buffer(m_alive[set]);
+        }
+        m_resources->destroy_buffer(m_dead);
+        m_resources->destroy_buffer(m_dispatches);
+        m_resources->destroy_buffer(m_bindings);
+
+        m_enabled = false;
+    }
+
+    uint32_t ParticleSystem::add_emitter(const ParticleEmitter& emitter){
+        m_emitters.push_back({emitter, 0.0f});
+        m_stats.emitters = static_cast<uint32_t>(m_emitters.size());
+        return m_stats.emitters - 1;
+    }
+
+    void ParticleSystem::dispatch(VkCommandBuffer command_buffer, PipelineHandle pipeline, const ParticleComputePushConstants& push_constants, uint32_t group_count){
+        const evPipeline& compute = m_resources->get(pipeline);
+        vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, compute.handle);
+        vkCmdPushConstants(command_buffer, compute.layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push_constants), &push_constants);
+        vkCmdDispatch(command_buffer, group_count, 1, 1);
+    }
+
+    uint64_t ParticleSystem::update(uint32_t frame, float delta_time, const glm::vec3& camera_position){
+        if (!m_enabled) {
+            return 0;
+        }
+
+        VkCommandBuffer command_buffer = m_command_buffers[frame];
+        vkResetCommandBuffer(command_buffer, 0);
+
+        VkCommandBufferBeginInfo begin_info{};
+        begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+        if (vkBeginCommandBuffer(command_buffer, &begin_info) != VK_SUCCESS) {
+            throw std::runtime_error("failed to begin recording particle command buffer!");
+        }
+
+        ParticleComputePushConstants push_constants{};
+        push_constants.bindings = m_resources->get(m_bindings).address;
+        push_constants.source = m_source;
+        push_constants.capacity = m_capacity;
+        push_constants.gravity = glm::vec4(m_gravity, delta_time);
+        push_constants.camera_position = camera_position;
+
+        //Last update's arguments and lists were written by an earlier submission
+        compute_barrier(command_buffer);
+
+        //Zeroes the draw arguments and lists of both sets, including the one graphics may still be drawing
+        bool reset = m_needs_reset;
+        if (reset) {
+            dispatch(command_buffer, m_reset_pipeline, push_constants, group_count(m_capacity, WORKGROUP_SIZE));
+            compute_barrier(command_buffer);
+            m_needs_reset = false;
+        }
+
+        VkBuffer dispatches = m_resources->get(m_dispatches).handle;
+
+        const evPipeline& simulate = m_resources->get(m_simulate_pipeline);
+        vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, simulate.handle);
+        vkCmdPushConstants(command_buffer, simulate.layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push_constants), &push_constants);
+        vkCmdDispatchIndirect(command_buffer, dispatches, 0);
+        compute_barrier(command_buffer);
+
+        //Emitters only pop free slots and append, so they can all run at once
+        for (Emitter& emitter : m_emitters) {
+            if (!emitter.settings.enabled) {
+                continue;
+            }
+
+            float wanted = emitter.remainder + emitter.settings.rate * delta_time;
+            float whole = std::floor(wanted);
+            emitter.remainder = wanted - whole;
+
+            uint32_t count = static_cast<uint32_t>(std::min(whole, static_cast<float>(m_capacity)));
+            if (count == 0) {
+                continue;
+            }
+
+            const ParticleEmitter& settings = emitter.settings;
+            push_constants.emitter = glm::vec4(settings.position, settings.radius);
+            push_constants.velocity = glm::vec4(settings.velocity, settings.spread);
+            push_constants.color = settings.color;
+            push_constants.lifetime = settings.lifetime;
+            push_constants.emit_count = count;
+            push_constants.seed = ++m_frame_seed * 0x9E3779B9u;
+            dispatch(command_buffer, m_emit_pipeline, push_constants, group_count(count, EMIT_WORKGROUP_SIZE));
+        }
+        compute_barrier(command_buffer);
+
+        dispatch(command_buffer, m_compact_pipeline, push_constants, group_count(m_sort_capacity, WORKGROUP_SIZE));
+
+        //Every pass is recorded, the compact kernel zeroes the ones wider than the alive count
+        if (m_blend == BlendMode::Alpha) {
+            const evPipeline& sort = m_resources->get(m_sort_pipeline);
+            vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, sort.handle);
+
+            VkDeviceSize pass = 1;
+            for (uint32_t k = 2; k <= m_sort_capacity; k <<= 1) {
+                for (uint32_t j = k >> 1; j > 0; j >>= 1) {
+                    compute_barrier(command_buffer);
+                    push_constants.sort_j = j;
+                    push_constants.sort_k = k;
+                    vkCmdPushConstants(command_buffer, sort.layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push_constants), &push_constants);
+                    vkCmdDispatchIndirect(command_buffer, dispatches, pass * sizeof(VkDispatchIndirectCommand));
+                    pass++;
+                }
+            }
+        }
+
+        vkEndCommandBuffer(command_buffer);
+
+        //At most two waits, small enough for the stack
+        std::array<std::byte, 256> scratch_buffer;
+        std::pmr::monotonic_buffer_resource scratch(scratch_buffer.data(), scratch_buffer.size());
+        QueueSubmit submit(&scratch);
+        submit.command_buffers = {command_buffer};
+        //The set written now was last drawn two frames ago, that draw has to be done with it
+        uint64_t reader = m_set_readers[1 - m_source];
+        if (reader > 0) {
+            submit.waits.push_back({QueueType::Graphics, reader, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT});
+        }
+        //A reset also overwrites the set drawn last frame
+        if (reset && m_set_readers[m_source] > 0) {
+            submit.waits.push_back({QueueType::Graphics, m_set_readers[m_source], VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT});
+        }
+        uint64_t value = m_queues->submit(QueueType::Compute, submit);
+
+        m_source = 1 - m_source;
+        m_has_output = true;
+        return value;
+    }
+
+    void ParticleSystem::end_frame(uint64_t graphics_value){
+        if (m_has_output) {
+            m_set_readers[m_source] = graphics_value;
+        }
+    }
+
+    void ParticleSystem::record_draw(VkCommandBuffer command_buffer, const glm::mat4& view, const glm::mat4& view_proj){
+        if (!m_enabled || !m_has_output) {
+            return;
+        }
+
+        //Camera axes are the rows of the view rotation
+        ParticleDrawPushConstants push_constants{};
+        push_constants.view_proj = view_proj;
+        push_constants.camera_right = glm::vec4(view[0][0], view[1][0], view[2][0], m_particle_size);
+        push_constants.camera_up = glm::vec4(view[0][1], view[1][1], view[2][1], 0.0f);
+        push_constants.particles = m_resources->get(m_particles[m_source]).address;
+        push_constants.keys = m_resources->get(m_keys[m_source]).address;
+
+        const evPipeline& pipeline = m_resources->get(m_draw_pipeline);
+        vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.handle);
+        vkCmdPushConstants(command_buffer, pipeline.layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(push_constants), &push_constants);
+        vkCmdDrawIndirect(command_buffer, m_resources->get(m_draws[m_source]).handle, 0, 1, sizeof(VkDrawIndirectCommand));
+    }
+}
@@ -0,0 +1,164 @@
+#pragma once
+#include <glm/glm.hpp>
+#include "VulkanPipeline.h"
+#include "evPhysicalDevice.h"
+#include "evResources.h"
+#include "QueueSet.h"
+#include "../utils/Hasher.h"
+
+namespace evoke::vulkan {
+    //Spawns particles at a fixed rate, only the rate and these parameters ever reach the GPU
+    struct ParticleEmitter {
+        glm::vec3 position{0.0f};
+        float radius = 0.1f;            //Spawn sphere around position
+        glm::vec3 velocity{0.0f, 1.0f, 0.0f};
+        float spread = 0.5f;            //Random speed added in any direction
+        glm::vec4 color{1.0f};
+        float rate = 1000.0f;           //Particles per second
+        float lifetime = 2.0f;          //Seconds, randomized down to half
+        bool enabled = true;
+    };
+
+    //Matches Particle in src/shaders/particle_common.glsl
+    struct Particle {
+        glm::vec3 position;
+        float age;
+        glm::vec3 velocity;
+        float lifetime;
+        glm::vec4 color;
+    };
+    static_assert(sizeof(Particle) == 48, "particles must match the std430 layout of the shaders");
+
+    //Buffer addresses the kernels reach through one pointer, matches Bindings in particle_common.glsl.
+    //Everything the renderer reads exists twice, one copy is simulated while the other is drawn.
+    struct ParticleBindings {
+        VkDeviceAddress particles[2];
+        VkDeviceAddress keys[2];
+        VkDeviceAddress draws[2];
+        VkDeviceAddress alive[2];
+        VkDeviceAddress dead;
+        VkDeviceAddress dispatches;
+    };
+
+    struct ParticleComputePushConstants {
+        VkDeviceAddress bindings;
+        uint32_t source;                //Set simulated from, results go to the other one
+        uint32_t capacity;
+        glm::vec4 emitter;              //xyz position, w radius
+        glm::vec4 velocity;             //xyz velocity, w spread
+        glm::vec4 gravity;              //xyz acceleration, w time step
+        glm::vec4 color;
+        glm::vec3 camera_position;
+        float lifetime;                 //Seconds, of the emitter being dispatched
+        uint32_t emit_count;
+        uint32_t seed;
+        uint32_t sort_j;
+        uint32_t sort_k;
+    };
+    static_assert(sizeof(ParticleComputePushConstants) == 112, "compute push constants must match particle_common.glsl");
+
+    struct ParticleDrawPushConstants {
+        glm::mat4 view_proj;
+        glm::vec4 camera_right;         //w particle size
+        glm::vec4 camera_up;
+        VkDeviceAddress particles;
+        VkDeviceAddress keys;
+    };
+
+    struct ParticleStats {
+        uint32_t capacity = 0;
+        uint32_t emitters = 0;
+        uint32_t sort_passes = 0;
+        bool async_compute = false;
+    };
+
+    //Particle pool that lives entirely on the GPU. Every frame the compute queue simulates the live
+    //particles, returns dead ones to a free list, emits new ones from it, builds a compacted list of
+    //depth keys and bitonic sorts it for blending. The kernels write their own indirect dispatch and
+    //draw arguments, so the CPU records the same fixed set of commands however many particles are alive.
+    class ParticleSystem {
+    public:
+        //Disabled without buffer device address, every call is a no-op then.
+        //Alpha blended particles are sorted back to front every frame, additive ones skip the sort.
+        void init(VkDevice device, const evPhysicalDevice& physical_device, const VkSurfaceFormatKHR& surface_format, VkFormat depth_format, evResources& resources, QueueSet& queues, uint32_t frames_in_flight, uint32_t capacity, BlendMode blend = BlendMode::Alpha);
+        void clean_up();
+
+        bool is_enabled() const { return m_enabled; }
+
+        uint32_t add_emitter(const ParticleEmitter& emitter);
+        ParticleEmitter& get_emitter(uint32_t index) { return m_emitters[index].settings; }
+        void set_gravity(const glm::vec3& gravity) { m_gravity = gravity; }
+        void set_particle_size(float size) { m_particle_size = size; }
+        //Kills every particle with the next update
+        void reset() { m_needs_reset = true; }
+
+        //Records and submits the frame's simulation to the compute queue, returns the timeline value
+        //the draw has to wait for. The frame's command buffer must no longer be in use.
+        uint64_t update(uint32_t frame, float delta_time, const glm::vec3& camera_position);
+        //Graphics timeline value of the submission that draws the last update
+        void end_frame(uint64_t graphics_value);
+
+        void record_draw(VkCommandBuffer command_buffer, const glm::mat4& view, const glm::mat4& view_proj);
+        //Everything record_draw reads besides the arguments, after update, see CommandCache
+        void hash_state(utils::Hasher& hasher) const {
+            hasher.add(m_enabled).add(m_has_output).add(m_particle_size).add(m_draw_pipeline);
+            hasher.add(m_particles[m_source]).add(m_keys[m_source]).add(m_draws[m_source]);
+        }
+
+        const ParticleStats& get_stats() const { return m_stats; }
+
+    private:
+        struct Emitter {
+            ParticleEmitter settings;
+            //Fraction of a particle carried over to the next frame
+            float remainder = 0.0f;
+        };
+
+        VkDevice m_device = VK_NULL_HANDLE;
+        evResources* m_resources = nullptr;
+        QueueSet* m_queues = nullptr;
+        bool m_enabled = false;
+
+        Pipeline m_pipeline_builder;
+        PipelineHandle m_reset_pipeline;
+        PipelineHandle m_simulate_pipeline;
+        PipelineHandle m_emit_pipeline;
+        PipelineHandle m_compact_pipeline;
+        PipelineHandle m_sort_pipeline;
+        PipelineHandle m_draw_pipeline;
+
+        VkCommandPool m_command_pool = VK_NULL_HANDLE;
+        std::vector<VkCommandBuffer> m_command_buffers;
+
+        BufferHandle m_particles[2];
+        BufferHandle m_keys[2];
+        BufferHandle m_draws[2];
+        BufferHandle m_alive[2];
+        BufferHandle m_dead;
+        BufferHandle m_dispatches;
+        BufferHandle m_bindings;
+
+        uint32_t m_capacity = 0;
+        //Capacity rounded up to a power of two, the size of the sorting network
+        uint32_t m_sort_capacity = 0;
+        BlendMode m_blend = BlendMode::Alpha;
+
+        std::vector<Emitter> m_emitters;
+        glm::vec3 m_gravity{0.0f, -9.81f, 0.0f};
+        float m_particle_size = 0.05f;
+
+        //Set the next update simulates from, the other one is what the last update produced
+        uint32_t m_source = 0;
+        bool m_needs_reset = true;
+        bool m_has_output = false;
+        uint32_t m_frame_seed = 0;
+        //Graphics timeline value of the last draw that read each set
+        uint64_t m_set_readers[2] = {0, 0};
+
+        ParticleStats m_stats;
+
+        void create_buffers();
+        void create_command_buffers(uint32_t frames_in_flight);
+        void dispatch(VkCommandBuffer command_buffer, PipelineHandle pipeline, const ParticleComputePushConstants& push_constants, uint32_t group_count);
+    };
+}
@@ -0,0 +1,249 @@
+#include "PrimitiveBenchmark.h"
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <random>
+
+namespace evoke::vulkan {
+    namespace {
+        //Work and staging buffers hold this many regions, each large enough for 64 bit keys
+        constexpr uint32_t REGION_COUNT = 4;
+
+        struct Benchmark {
+            std::string name;
+            //Writes the inputs into the staging regions
+            std::function<void(uint32_t* regions[REGION_COUNT])> setup;
+            std::function<void(VkCommandBuffer command_buffer, const VkDeviceAddress regions[REGION_COUNT])> record;
+            std::function<bool(uint32_t* regions[REGION_COUNT])> check;
+        };
+
+        void memory_barrier(VkCommandBuffer command_buffer, VkPipelineStageFlags2 src_stage_mask, VkAccessFlags2 src_access_mask, VkPipelineStageFlags2 dst_stage_mask, VkAccessFlags2 dst_access_mask){
+            VkMemoryBarrier2 barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+            barrier.srcStageMask = src_stage_mask;
+            barrier.srcAccessMask = src_access_mask;
+            barrier.dstStageMask = dst_stage_mask;
+            barrier.dstAccessMask = dst_access_mask;
+
+            VkDependencyInfo dependency_info{};
+            dependency_info.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+            dependency_info.memoryBarrierCount = 1;
+            dependency_info.pMemoryBarriers = &barrier;
+
+            vkCmdPipelineBarrier2(command_buffer, &dependency_info);
+        }
+
+        uint64_t read_key(const uint32_t* keys, uint32_t index, uint32_t key_words){
+            uint64_t key = keys[index * key_words];
+            if (key_words == 2) {
+                key |= static_cast<uint64_t>(keys[index * key_words + 1]) << 32;
+            }
+            return key;
+        }
+
+        Benchmark sort_benchmark(uint32_t count, uint32_t key_bits, ComputePrimitives& primitives, std::vector<uint64_t>& keys, std::vector<uint32_t>& payloads){
+            uint32_t key_words = key_bits / 32;
+
+            Benchmark benchmark;
+            benchmark.name = "radix sort " + std::to_string(key_bits) + " bit keys with payloads";
+            benchmark.setup = [count, key_bits, key_words, &keys, &payloads](uint32_t* regions[REGION_COUNT]) {
+                std::mt19937_64 random(key_bits);
+                keys.resize(count);
+                payloads.resize(count);
+                for (uint32_t i = 0; i < count; i++) {
+                    keys[i] = key_bits == 32 ? random() & 0xFFFFFFFFull : random();
+                    payloads[i] = i;
+                    regions[0][i * key_words] = static_cast<uint32_t>(keys[i]);
+                    if (key_words == 2) {
+                        regions[0][i * key_words + 1] = static_cast<uint32_t>(keys[i] >> 32);
+                    }
+                    regions[1][i] = i;
+                }
+            };
+            benchmark.record = [count, key_bits, &primitives](VkCommandBuffer command_buffer, const VkDeviceAddress regions[REGION_COUNT]) {
+                primitives.record_radix_sort(command_buffer, regions[0], regions[1], count, key_bits);
+            };
+            benchmark.check = [count, key_words, &keys, &payloads](uint32_t* regions[REGION_COUNT]) {
+                radix_sort_reference(keys, payloads);
+                for (uint32_t i = 0; i < count; i++) {
+                    if (read_key(regions[0], i, key_words) != keys[i] || regions[1][i] != payloads[i]) {
+                        return false;
+                    }
+                }
+                return true;
+            };
+            return benchmark;
+        }
+    }
+
+    std::vector<PrimitiveBenchmarkResult> benchmark_primitives(VkDevice device, const evPhysicalDevice& physical_device, evResources& resources, QueueSet& queues, uint32_t count){
+        std::vector<PrimitiveBenchmarkResult> results;
+
+        const evPhysicalDeviceInfo& info = physical_device.get();
+        uint32_t family = queues.get_family(QueueType::Graphics);
+        uint32_t family_count = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(info.handle, &family_count, nullptr);
+        std::vector<VkQueueFamilyProperties> families(family_count);
+        vkGetPhysicalDeviceQueueFamilyProperties(info.handle, &family_count, families.data());
+
+        if (families[family].timestampValidBits == 0 || info.properties.limits.timestampPeriod <= 0.0f) {
+            return results;
+        }
+
+        ComputePrimitives primitives;
+        primitives.init(device, physical_device, resources, count);
+        if (!primitives.is_enabled()) {
+            return results;
+        }
+        count = std::min(count, primitives.get_max_elements());
+
+        //Inputs go through staging so the timed work reads and writes device local memory only
+        const VkDeviceSize region_size = sizeof(uint32_t) * 2 * count;
+        const VkDeviceSize buffer_size = region_size * REGION_COUNT;
+        BufferHandle work = resources.create_buffer(buffer_size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        BufferHandle staging = resources.create_buffer(buffer_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        uint8_t* mapped = static_cast<uint8_t*>(resources.map_buffer(staging));
+
+        uint32_t* regions[REGION_COUNT];
+        VkDeviceAddress addresses[REGION_COUNT];
+        for (uint32_t i = 0; i < REGION_COUNT; i++) {
+            regions[i] = reinterpret_cast<uint32_t*>(mapped + region_size * i);
+            addresses[i] = resources.get(work).address + region_size * i;
+        }
+
+        VkCommandPoolCreateInfo pool_info{};
+        pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+        pool_info.queueFamilyIndex = family;
+
+        VkQueryPoolCreateInfo query_info{};
+        query_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        query_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        query_info.queryCount = 2;
+
+        VkCommandPool command_pool;
+        VkQueryPool query_pool;
+        if (vkCreateCommandPool(device, &pool_info, nullptr, &command_pool) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create benchmark command pool!");
+        }
+        if (vkCreateQueryPool(device, &query_info, nullptr, &query_pool) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create benchmark query pool!");
+        }
+
+        VkCommandBufferAllocateInfo allocate_info{};
+        allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocate_info.commandPool = command_pool;
+        allocate_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocate_info.commandBufferCount = 1;
+
+        VkCommandBuffer command_buffer;
+        if (vkAllocateCommandBuffers(device, &allocate_info, &command_buffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate benchmark command buffer!");
+        }
+
+        //Inputs and references live until the check, the lambdas refer to them
+        std::vector<uint32_t> values;
+        std::vector<uint32_t> flags;
+        std::vector<uint64_t> keys32, keys64;
+        std::vector<uint32_t> payloads32, payloads64;
+        std::mt19937 random(count);
+
+        std::vector<Benchmark> benchmarks;
+        benchmarks.push_back({
+            "exclusive scan",
+            [&](uint32_t* regions[REGION_COUNT]) {
+                values.resize(count);
+                for (uint32_t i = 0; i < count; i++) {
+                    values[i] = random() % 16;
+                }
+                memcpy(regions[0], values.data(), sizeof(uint32_t) * count);
+            },
+            [&](VkCommandBuffer command_buffer, const VkDeviceAddress regions[REGION_COUNT]) {
+                primitives.record_exclusive_scan(command_buffer, regions[0], regions[1], count);
+            },
+            [&](uint32_t* regions[REGION_COUNT]) {
+                std::vector<uint32_t> expected = exclusive_scan_reference(values);
+                return std::equal(expected.begin(), expected.end(), regions[1]);
+            }
+        });
+        benchmarks.push_back(sort_benchmark(count, 32, primitives, keys32, payloads32));
+        benchmarks.push_back(sort_benchmark(count, 64, primitives, keys64, payloads64));
+        benchmarks.push_back({
+            "stream compaction",
+            [&](uint32_t* regions[REGION_COUNT]) {
+                values.resize(count);
+                flags.resize(count);
+                for (uint32_t i = 0; i < count; i++) {
+                    values[i] = random();
+                    flags[i] = random() % 2;
+                }
+                memcpy(regions[0], values.data(), sizeof(uint32_t) * count);
+                memcpy(regions[1], flags.data(), sizeof(uint32_t) * count);
+            },
+            [&](VkCommandBuffer command_buffer, const VkDeviceAddress regions[REGION_COUNT]) {
+                primitives.record_compact(command_buffer, regions[0], regions[1], regions[2], regions[3], count);
+            },
+            [&](uint32_t* regions[REGION_COUNT]) {
+                std::vector<uint32_t> expected = compact_reference(values, flags);
+                return regions[3][0] == expected.size() && std::equal(expected.begin(), expected.end(), regions[2]);
+            }
+        });
+
+        for (Benchmark& benchmark : benchmarks) {
+            benchmark.setup(regions);
+
+            VkCommandBufferBeginInfo begin_info{};
+            begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+            begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+            vkBeginCommandBuffer(command_buffer, &begin_info);
+
+            VkBufferCopy copy{0, 0, buffer_size};
+            vkCmdCopyBuffer(command_buffer, resources.get(staging).handle, resources.get(work).handle, 1, &copy);
+            memory_barrier(command_buffer,
+                VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+                VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT);
+
+            vkCmdResetQueryPool(command_buffer, query_pool, 0, 2);
+            vkCmdWriteTimestamp2(command_buffer, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, query_pool, 0);
+            benchmark.record(command_buffer, addresses);
+            vkCmdWriteTimestamp2(command_buffer, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, query_pool, 1);
+
+            memory_barrier(command_buffer,
+                VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+                VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_READ_BIT);
+            vkCmdCopyBuffer(command_buffer, resources.get(work).handle, resources.get(staging).handle, 1, &copy);
+            memory_barrier(command_buffer,
+                VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+                VK_PIPELINE_STAGE_2_HOST_BIT, VK_ACCESS_2_HOST_READ_BIT);
+
+            vkEndCommandBuffer(command_buffer);
+
+            QueueSubmit submit{};
+            submit.command_buffers = {command_buffer};
+            queues.wait(QueueType::Graphics, queues.submit(QueueType::Graphics, submit));
+
+            PrimitiveBenchmarkResult result;
+            result.name = benchmark.name;
+            result.count = count;
+
+            uint64_t timestamps[2] = {};
+            if (vkGetQueryPoolResults(device, query_pool, 0, 2, sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT) == VK_SUCCESS) {
+                double seconds = static_cast<double>(timestamps[1] - timestamps[0]) * info.properties.limits.timestampPeriod * 1e-9;
+                result.milliseconds = seconds * 1e3;
+                result.keys_per_second = seconds > 0.0 ? count / seconds : 0.0;
+            }
+            result.matches_reference = benchmark.check(regions);
+            results.push_back(result);
+
+            vkResetCommandBuffer(command_buffer, 0);
+        }
+
+        vkDestroyQueryPool(device, query_pool, nullptr);
+        vkDestroyCommandPool(device, command_pool, nullptr);
+        resources.destroy_buffer(staging);
+        resources.destroy_buffer(work);
+        primitives.clean_up();
+
+        return results;
+    }
+}
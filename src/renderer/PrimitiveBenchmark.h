@@ -0,0 +1,23 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "ComputePrimitives.h"
+#include "QueueSet.h"
+
+namespace evoke::vulkan {
+    struct PrimitiveBenchmarkResult {
+        std::string name;
+        uint32_t count = 0;
+        double milliseconds = 0.0;
+        //Elements per second through the primitive, keys for the sorts
+        double keys_per_second = 0.0;
+        //Output equals the CPU reference
+        bool matches_reference = false;
+    };
+
+    //Times scan, 32 and 64 bit radix sort and compaction of count random elements with GPU timestamps
+    //on the graphics queue, then checks each output against the CPU reference. Waits for every
+    //submission, meant for startup with EVOKE_PRIMITIVE_BENCHMARK set. Empty when the primitives are
+    //disabled or the queue has no timestamps.
+    std::vector<PrimitiveBenchmarkResult> benchmark_primitives(VkDevice device, const evPhysicalDevice& physical_device, evResources& resources, QueueSet& queues, uint32_t count);
+}
@@ -0,0 +1,156 @@
+#include "QueueSet.h"
+#include <algorithm>
+
+namespace evoke::vulkan {
+    void QueueSet::init(const evDevice& device, const evPhysicalDevice& physical_device){
+        m_device = device.get().handle;
+        const QueueFamilyIndices& indices = physical_device.get().queue_family_indices;
+
+        Queue& graphics = m_queues[index(QueueType::Graphics)];
+        graphics.queue = device.get().graphics_queue;
+        graphics.family = indices.graphics_family.value();
+        graphics.dedicated = true;
+
+        Queue& compute = m_queues[index(QueueType::Compute)];
+        compute.queue = device.get().compute_queue;
+        compute.family = indices.compute_family.value_or(graphics.family);
+        compute.dedicated = indices.compute_family.has_value();
+
+        Queue& transfer = m_queues[index(QueueType::Transfer)];
+        transfer.queue = device.get().transfer_queue;
+        transfer.family = indices.transfer_family.value_or(graphics.family);
+        transfer.dedicated = indices.transfer_family.has_value();
+
+        for (Queue& queue : m_queues) {
+            VkSemaphoreTypeCreateInfo type_info{};
+            type_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+            type_info.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+            type_info.initialValue = 0;
+
+            VkSemaphoreCreateInfo semaphore_info{};
+            semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+            semaphore_info.pNext = &type_info;
+
+            if (vkCreateSemaphore(m_device, &semaphore_info, nullptr, &queue.timeline) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create timeline semaphore!");
+            }
+            queue.lock = lock_for(queue.queue);
+        }
+
+        m_present_queue = device.get().presentation_queue;
+        m_present_lock = lock_for(m_present_queue);
+
+        utils::Logger::info("Async compute queue: ", compute.dedicated ? "dedicated" : "shared with graphics", ", transfer queue: ", transfer.dedicated ? "dedicated" : "shared with graphics", "!");
+    }
+
+    void QueueSet::clean_up(){
+        for (Queue& queue : m_queues) {
+            vkDestroySemaphore(m_device, queue.timeline, nullptr);
+            queue = {};
+        }
+        m_locks.clear();
+    }
+
+    std::mutex* QueueSet::lock_for(VkQueue queue){
+        auto found = std::find_if(m_locks.begin(), m_locks.end(), [&](const auto& entry) { return entry.first == queue; });
+        if (found != m_locks.end()) {
+            return found->second.get();
+        }
+        m_locks.emplace_back(queue, std::make_unique<std::mutex>());
+        return m_locks.back().second.get();
+    }
+
+    uint64_t QueueSet::submit(QueueType type, const QueueSubmit& submit){
+        Queue& queue = m_queues[index(type)];
+
+        //Submits are small, the lists fit on the stack and only spill to the heap for unusual ones
+        std::array<std::byte, 1024> scratch_buffer;
+        std::pmr::monotonic_buffer_resource scratch(scratch_buffer.data(), scratch_buffer.size());
+
+        std::pmr::vector<VkCommandBufferSubmitInfo> command_buffers(&scratch);
+        for (VkCommandBuffer command_buffer : submit.command_buffers) {
+            VkCommandBufferSubmitInfo command_buffer_info{};
+            command_buffer_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO;
+            command_buffer_info.commandBuffer = command_buffer;
+            command_buffers.push_back(command_buffer_info);
+        }
+
+        std::pmr::vector<VkSemaphoreSubmitInfo> waits(submit.binary_waits.begin(), submit.binary_waits.end(), &scratch);
+        for (const QueueWait& wait : submit.waits) {
+            VkSemaphoreSubmitInfo wait_info{};
+            wait_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+            wait_info.semaphore = m_queues[index(wait.queue)].timeline;
+            wait_info.value = wait.value;
+            wait_info.stageMask = wait.stages;
+            waits.push_back(wait_info);
+        }
+
+        std::lock_guard<std::mutex> lock(*queue.lock);
+
+        //Values are handed out under the queue's lock, so each timeline only ever moves forward
+        std::pmr::vector<VkSemaphoreSubmitInfo> signals(submit.binary_signals.begin(), submit.binary_signals.end(), &scratch);
+        VkSemaphoreSubmitInfo timeline_signal{};
+        timeline_signal.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+        timeline_signal.semaphore = queue.timeline;
+        timeline_signal.value = ++queue.value;
+        timeline_signal.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+        signals.push_back(timeline_signal);
+
+        VkSubmitInfo2 submit_info{};
+        submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2;
+        submit_info.waitSemaphoreInfoCount = static_cast<uint32_t>(waits.size());
+        submit_info.pWaitSemaphoreInfos = waits.data();
+        submit_info.commandBufferInfoCount = static_cast<uint32_t>(command_buffers.size());
+        submit_info.pCommandBufferInfos = command_buffers.data();
+        submit_info.signalSemaphoreInfoCount = static_cast<uint32_t>(signals.size());
+        submit_info.pSignalSemaphoreInfos = signals.data();
+
+        if (vkQueueSubmit2(queue.queue, 1, &submit_info, submit.fence) != VK_SUCCESS) {
+            throw std::runtime_error("failed to submit to queue!");
+        }
+
+        return queue.value;
+    }
+
+    VkResult QueueSet::present(const VkPresentInfoKHR& present_info){
+        std::lock_guard<std::mutex> lock(*m_present_lock);
+        return vkQueuePresentKHR(m_present_queue, &present_info);
+    }
+
+    void QueueSet::wait(QueueType type, uint64_t value){
+        VkSemaphoreWaitInfo wait_info{};
+        wait_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+        wait_info.semaphoreCount = 1;
+        wait_info.pSemaphores = &m_queues[index(type)].timeline;
+        wait_info.pValues = &value;
+
+        vkWaitSemaphores(m_device, &wait_info, UINT64_MAX);
+    }
+
+    uint64_t QueueSet::get_completed(QueueType type) const {
+        uint64_t value = 0;
+        vkGetSemaphoreCounterValue(m_device, m_queues[index(type)].timeline, &value);
+        return value;
+    }
+
+    void QueueSet::wait_idle(){
+        for (size_t i = 0; i < m_queues.size(); i++) {
+            uint64_t value;
+            {
+                std::lock_guard<std::mutex> lock(*m_queues[i].lock);
+                value = m_queues[i].value;
+            }
+            wait(static_cast<QueueType>(i), value);
+        }
+    }
+
+    std::vector<uint32_t> QueueSet::get_families() const {
+        std::vector<uint32_t> families;
+        for (const Queue& queue : m_queues) {
+            if (std::find(families.begin(), families.end(), queue.family) == families.end()) {
+                families.push_back(queue.family);
+            }
+        }
+        return families;
+    }
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include <array>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <vector>
+#include "evDevice.h"
+#include "evPhysicalDevice.h"
+
+namespace evoke::vulkan {
+    enum class QueueType : uint32_t {
+        Graphics,
+        Compute,
+        Transfer,
+        Count
+    };
+
+    //Waits until the given queue's timeline reached value
+    struct QueueWait {
+        QueueType queue;
+        uint64_t value;
+        VkPipelineStageFlags2 stages;
+    };
+
+    //Lists live in memory, pass a frame arena for per frame submits
+    struct QueueSubmit {
+        explicit QueueSubmit(std::pmr::memory_resource* memory = std::pmr::get_default_resource())
+            : command_buffers(memory), waits(memory), binary_waits(memory), binary_signals(memory) {}
+
+        std::pmr::vector<VkCommandBuffer> command_buffers;
+        std::pmr::vector<QueueWait> waits;
+        //Binary semaphores, e.g. for swapchain acquire and present
+        std::pmr::vector<VkSemaphoreSubmitInfo> binary_waits;
+        std::pmr::vector<VkSemaphoreSubmitInfo> binary_signals;
+        VkFence fence = VK_NULL_HANDLE;
+    };
+
+    //Graphics, async compute and transfer queues. Every queue type owns a timeline semaphore that each
+    //submission advances, so work on one queue can wait for work on another without fences.
+    //Submits are thread safe, types that share a VkQueue because the device has no dedicated family share its lock.
+    class QueueSet {
+    public:
+        void init(const evDevice& device, const evPhysicalDevice& physical_device);
+        void clean_up();
+
+        //Returns the timeline value that signals once the submission finished
+        uint64_t submit(QueueType type, const QueueSubmit& submit);
+        VkResult present(const VkPresentInfoKHR& present_info);
+
+        //Host side waits on a queue's timeline
+        void wait(QueueType type, uint64_t value);
+        uint64_t get_completed(QueueType type) const;
+        void wait_idle();
+
+        VkQueue get_queue(QueueType type) const { return m_queues[index(type)].queue; }
+        uint32_t get_family(QueueType type) const { return m_queues[index(type)].family; }
+        VkSemaphore get_timeline(QueueType type) const { return m_queues[index(type)].timeline; }
+        //False when the type falls back to the graphics queue
+        bool is_dedicated(QueueType type) const { return m_queues[index(type)].dedicated; }
+
+        //Distinct families in use, for resources shared between queues
+        std::vector<uint32_t> get_families() const;
+
+    private:
+        struct Queue {
+            VkQueue queue = VK_NULL_HANDLE;
+            uint32_t family = 0;
+            bool dedicated = false;
+            VkSemaphore timeline = VK_NULL_HANDLE;
+            uint64_t value = 0;
+            std::mutex* lock = nullptr;
+        };
+
+        VkDevice m_device = VK_NULL_HANDLE;
+        std::array<Queue, static_cast<size_t>(QueueType::Count)> m_queues;
+
+        VkQueue m_present_queue = VK_NULL_HANDLE;
+        std::mutex* m_present_lock = nullptr;
+
+        //One lock per distinct VkQueue
+        std::vector<std::pair<VkQueue, std::unique_ptr<std::mutex>>> m_locks;
+
+        static size_t index(QueueType type) { return static_cast<size_t>(type); }
+        std::mutex* lock_for(VkQueue queue);
+    };
+}
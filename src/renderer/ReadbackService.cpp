@@ -0,0 +1,158 @@
+#include "ReadbackService.h"
+#include <algorithm>
+
+namespace evoke::vulkan {
+    namespace {
+        //Beyond this finished staging buffers are freed instead of kept for reuse
+        constexpr size_t MAX_FREE_STAGING = 16;
+        constexpr VkDeviceSize MIN_STAGING_SIZE = 64 * 1024;
+
+        void memory_barrier(VkCommandBuffer command_buffer, VkPipelineStageFlags2 src_stage_mask, VkAccessFlags2 src_access_mask, VkPipelineStageFlags2 dst_stage_mask, VkAccessFlags2 dst_access_mask){
+            VkMemoryBarrier2 barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+            barrier.srcStageMask = src_stage_mask;
+            barrier.srcAccessMask = src_access_mask;
+            barrier.dstStageMask = dst_stage_mask;
+            barrier.dstAccessMask = dst_access_mask;
+
+            VkDependencyInfo dependency_info{};
+            dependency_info.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+            dependency_info.memoryBarrierCount = 1;
+            dependency_info.pMemoryBarriers = &barrier;
+
+            vkCmdPipelineBarrier2(command_buffer, &dependency_info);
+        }
+    }
+
+    void ReadbackService::init(evResources& resources){
+        m_resources = &resources;
+
+        //The CPU reads every byte, uncached memory would make that crawl
+        const VkMemoryPropertyFlags cached = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+        m_memory_properties = resources.has_memory_type(cached) ? cached : VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+        utils::Logger::info("Readbacks use ", (m_memory_properties & VK_MEMORY_PROPERTY_HOST_CACHED_BIT) ? "host cached" : "host coherent", " memory!");
+    }
+
+    void ReadbackService::clean_up(){
+        for (Request& request : m_recorded) {
+            m_resources->destroy_buffer(request.staging.buffer);
+        }
+        for (size_t i = 0; i < m_in_flight.size(); i++) {
+            m_resources->destroy_buffer(m_in_flight[i].staging.buffer);
+        }
+        for (Staging& staging : m_free) {
+            m_resources->destroy_buffer(staging.buffer);
+        }
+        m_recorded.clear();
+        m_in_flight.clear();
+        m_free.clear();
+    }
+
+    VkDeviceSize ReadbackService::trim(uint32_t heap){
+        VkDeviceSize freed = 0;
+        std::erase_if(m_free, [&](const Staging& staging) {
+            const evBuffer& buffer = m_resources->get(staging.buffer);
+            if (buffer.heap != heap) {
+                return false;
+            }
+            freed += buffer.allocation_size;
+            m_resources->destroy_buffer(staging.buffer);
+            m_stats.staging_buffers--;
+            return true;
+        });
+        return freed;
+    }
+
+    ReadbackService::Staging ReadbackService::acquire_staging(VkDeviceSize size){
+        //Smallest free buffer that fits
+        auto best = m_free.end();
+        for (auto it = m_free.begin(); it != m_free.end(); ++it) {
+            if (it->capacity >= size && (best == m_free.end() || it->capacity < best->capacity)) {
+                best = it;
+            }
+        }
+
+        if (best != m_free.end()) {
+            Staging staging = *best;
+            m_free.erase(best);
+            return staging;
+        }
+
+        Staging staging;
+        staging.capacity = std::max(size, MIN_STAGING_SIZE);
+        staging.buffer = m_resources->create_buffer(staging.capacity, VK_BUFFER_USAGE_TRANSFER_DST_BIT, m_memory_properties);
+        m_resources->map_buffer(staging.buffer);
+        m_stats.staging_buffers++;
+        return staging;
+    }
+
+    void ReadbackService::release_staging(const Staging& staging){
+        if (m_free.size() < MAX_FREE_STAGING) {
+            m_free.push_back(staging);
+            return;
+        }
+        m_resources->destroy_buffer(staging.buffer);
+        m_stats.staging_buffers--;
+    }
+
+    void ReadbackService::read_buffer(VkCommandBuffer command_buffer, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size, ReadbackCallback callback){
+        Staging staging = acquire_staging(size);
+
+        memory_barrier(command_buffer, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, VK_ACCESS_2_MEMORY_WRITE_BIT, VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_READ_BIT);
+
+        VkBufferCopy copy_region{};
+        copy_region.srcOffset = offset;
+        copy_region.dstOffset = 0;
+        copy_region.size = size;
+        vkCmdCopyBuffer(command_buffer, buffer, m_resources->get(staging.buffer).handle, 1, &copy_region);
+
+        memory_barrier(command_buffer, VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_2_HOST_BIT, VK_ACCESS_2_HOST_READ_BIT);
+
+        m_recorded.push_back({staging, size, std::move(callback)});
+    }
+
+    void ReadbackService::read_image(VkCommandBuffer command_buffer, VkImage image, VkExtent2D extent, uint32_t texel_size, ReadbackCallback callback){
+        VkDeviceSize size = static_cast<VkDeviceSize>(extent.width) * extent.height * texel_size;
+        Staging staging = acquire_staging(size);
+
+        VkBufferImageCopy region{};
+        region.bufferOffset = 0;
+        region.bufferRowLength = 0;
+        region.bufferImageHeight = 0;
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.mipLevel = 0;
+        region.imageSubresource.baseArrayLayer = 0;
+        region.imageSubresource.layerCount = 1;
+        region.imageOffset = {0, 0, 0};
+        region.imageExtent = {extent.width, extent.height, 1};
+        vkCmdCopyImageToBuffer(command_buffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, m_resources->get(staging.buffer).handle, 1, &region);
+
+        memory_barrier(command_buffer, VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_2_HOST_BIT, VK_ACCESS_2_HOST_READ_BIT);
+
+        m_recorded.push_back({staging, size, std::move(callback)});
+    }
+
+    void ReadbackService::end_frame(uint64_t timeline_value){
+        for (Request& request : m_recorded) {
+            request.timeline_value = timeline_value;
+            m_in_flight.push_back(std::move(request));
+        }
+        m_recorded.clear();
+        m_stats.in_flight = static_cast<uint32_t>(m_in_flight.size());
+    }
+
+    void ReadbackService::poll(uint64_t completed_value){
+        while (!m_in_flight.empty() && m_in_flight.front().timeline_value <= completed_value) {
+            Request request = std::move(m_in_flight.front());
+            m_in_flight.pop_front();
+
+            m_resources->invalidate_buffer(request.staging.buffer);
+            request.callback(m_resources->get(request.staging.buffer).mapped, request.size);
+            m_stats.bytes_delivered += request.size;
+
+            release_staging(request.staging);
+        }
+        m_stats.in_flight = static_cast<uint32_t>(m_in_flight.size());
+    }
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <functional>
+#include <vector>
+#include "evResources.h"
+#include "../utils/RingQueue.h"
+
+namespace evoke::vulkan {
+    //Bytes copied back from the GPU, only valid during the callback
+    using ReadbackCallback = std::function<void(const void* data, VkDeviceSize size)>;
+
+    struct ReadbackStats {
+        uint32_t in_flight = 0;
+        uint32_t staging_buffers = 0;
+        uint64_t bytes_delivered = 0;
+    };
+
+    //Copies buffers and images into host cached staging buffers as part of a frame's command buffer.
+    //Results are handed to their callbacks from poll once that frame's submission finished, usually
+    //a frame or two later, so reading back never stalls the CPU or the GPU.
+    class ReadbackService {
+    public:
+        void init(evResources& resources);
+        void clean_up();
+
+        //Copies size bytes at offset. Writes to buffer earlier in the command buffer are waited for.
+        void read_buffer(VkCommandBuffer command_buffer, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size, ReadbackCallback callback);
+        //The image has to be in TRANSFER_SRC_OPTIMAL, rows arrive tightly packed
+        void read_image(VkCommandBuffer command_buffer, VkImage image, VkExtent2D extent, uint32_t texel_size, ReadbackCallback callback);
+
+        //Everything recorded since the last call completes with this graphics timeline value
+        void end_frame(uint64_t timeline_value);
+        //Runs the callbacks of every readback whose submission reached completed_value, never waits
+        void poll(uint64_t completed_value);
+
+        //Destroys the pooled staging buffers on the heap, an eviction callback for the memory budget
+        VkDeviceSize trim(uint32_t heap);
+
+        const ReadbackStats& get_stats() const { return m_stats; }
+
+    private:
+        struct Staging {
+            BufferHandle buffer;
+            VkDeviceSize capacity = 0;
+        };
+
+        struct Request {
+            Staging staging;
+            VkDeviceSize size = 0;
+            ReadbackCallback callback;
+            uint64_t timeline_value = 0;
+        };
+
+        evResources* m_resources = nullptr;
+        VkMemoryPropertyFlags m_memory_properties = 0;
+
+        //Recorded into the current frame, the value is known once it is submitted
+        std::vector<Request> m_recorded;
+        //Ordered by timeline value. A ring, so a readback every frame does not allocate once warmed up.
+        utils::RingQueue<Request> m_in_flight;
+        //Staging buffers of finished readbacks, reused before allocating
+        std::vector<Staging> m_free;
+
+        ReadbackStats m_stats;
+
+        Staging acquire_staging(VkDeviceSize size);
+        void release_staging(const Staging& staging);
+    };
+}
@@ -0,0 +1,71 @@
+#include "ResolutionScaler.h"
+#include "../utils/Profiler.h"
+#include <algorithm>
+#include <cmath>
+
+namespace evoke::vulkan {
+    namespace {
+        //Frames are kept between these shares of the target, changes aim for the middle
+        constexpr float UPPER_BOUND = 0.95f;
+        constexpr float LOWER_BOUND = 0.8f;
+        constexpr float AIM = 0.875f;
+        //Largest change of the scale per adjustment
+        constexpr float MAX_DROP = 0.1f;
+        constexpr float MAX_RAISE = 0.02f;
+        //Timestamps are read back frames in flight later, a change needs that long to be measured
+        constexpr uint32_t COOLDOWN_FRAMES = 3;
+    }
+
+    void ResolutionScaler::set_settings(const ResolutionSettings& settings){
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_settings = settings;
+        m_settings.max_scale = std::clamp(settings.max_scale, 0.1f, 1.0f);
+        m_settings.min_scale = std::clamp(settings.min_scale, 0.1f, m_settings.max_scale);
+        m_settings.sharpness = std::clamp(settings.sharpness, 0.0f, 1.0f);
+    }
+
+    ResolutionSettings ResolutionScaler::get_settings() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_settings;
+    }
+
+    void ResolutionScaler::update(float gpu_time){
+        ResolutionSettings settings = get_settings();
+        m_sharpness = settings.sharpness;
+
+        //Spikes count right away, improvements only once they last
+        if (gpu_time > 0.0f) {
+            float weight = gpu_time > m_gpu_time ? 0.5f : 0.1f;
+            m_gpu_time = m_gpu_time == 0.0f ? gpu_time : m_gpu_time + (gpu_time - m_gpu_time) * weight;
+        }
+
+        if (!settings.enabled || m_gpu_time == 0.0f || settings.target_frame_time <= 0.0f) {
+            m_scale = settings.max_scale;
+        } else if (m_cooldown > 0) {
+            m_cooldown--;
+        } else {
+            float ratio = m_gpu_time / settings.target_frame_time;
+            if (ratio > UPPER_BOUND || ratio < LOWER_BOUND) {
+                float desired = m_scale * std::sqrt(AIM / ratio);
+                float scale = std::clamp(desired, m_scale - MAX_DROP, m_scale + MAX_RAISE);
+                scale = std::clamp(scale, settings.min_scale, settings.max_scale);
+
+                if (scale != m_scale) {
+                    m_scale = scale;
+                    m_cooldown = COOLDOWN_FRAMES;
+                }
+            }
+        }
+        m_scale = std::clamp(m_scale, settings.min_scale, settings.max_scale);
+
+        utils::Profiler::add_sample("resolution.scale", m_scale);
+        utils::Profiler::add_sample("resolution.gpu_ms", gpu_time);
+    }
+
+    VkExtent2D ResolutionScaler::scale_extent(VkExtent2D extent) const {
+        return {
+            std::max(static_cast<uint32_t>(static_cast<float>(extent.width) * m_scale), 1u),
+            std::max(static_cast<uint32_t>(static_cast<float>(extent.height) * m_scale), 1u)
+        };
+    }
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <mutex>
+#include <vulkan/vulkan.h>
+
+namespace evoke::vulkan {
+    struct ResolutionSettings {
+        bool enabled = true;
+        //GPU milliseconds per frame the scale is adjusted to hold
+        float target_frame_time = 16.0f;
+        //Per axis. The render target is the swapchain's size, so the scale never goes above 1.
+        float min_scale = 0.5f;
+        float max_scale = 1.0f;
+        //Of the upscale pass, 0 is plain bilinear
+        float sharpness = 0.5f;
+    };
+
+    //Picks the render scale for the next frame from measured GPU frame times. The cost of a frame
+    //mostly follows its pixel count, so the scale moves with the square root of the time ratio.
+    //It drops quickly when frames run long and recovers slowly, with a dead band around the target
+    //so it does not oscillate. Publishes resolution.scale and resolution.gpu_ms to the profiler.
+    class ResolutionScaler {
+    public:
+        //Safe from any thread, applied at the next update
+        void set_settings(const ResolutionSettings& settings);
+        ResolutionSettings get_settings() const;
+
+        //Once per frame with the newest GPU frame time, 0 when the device has no timestamps
+        void update(float gpu_time);
+
+        float get_scale() const { return m_scale; }
+        float get_sharpness() const { return m_scale < 1.0f ? m_sharpness : 0.0f; }
+        //Never empty, even for tiny windows
+        VkExtent2D scale_extent(VkExtent2D extent) const;
+
+    private:
+        mutable std::mutex m_mutex;
+        ResolutionSettings m_settings;
+
+        float m_scale = 1.0f;
+        float m_sharpness = 0.0f;
+        float m_gpu_time = 0.0f;
+        //Frames to wait for a scale change to show up in the measurements
+        uint32_t m_cooldown = 0;
+    };
+}
@@ -0,0 +1,215 @@
+#include "ShaderLibrary.h"
+#include "../utils/Logger.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <stdexcept>
+
+namespace evoke::vulkan {
+    namespace {
+        //Matches the naming in CMakeLists.txt: shader.vert -> vert.spv, cull.comp -> cull.spv, shape.vert -> shape_vert.spv
+        [[maybe_unused]] std::string shader_name(const std::filesystem::path& source){
+            std::string stem = source.stem().string();
+            std::string stage = source.extension().string().substr(1);
+
+            if (stem == "shader") {
+                return stage + ".spv";
+            }
+            if (stage == "comp") {
+                return stem + ".spv";
+            }
+            return stem + "_" + stage + ".spv";
+        }
+
+        [[maybe_unused]] bool is_shader_stage(const std::filesystem::path& path){
+            static const char* stages[] = {".vert", ".frag", ".comp", ".task", ".mesh"};
+            std::string extension = path.extension().string();
+            return std::any_of(std::begin(stages), std::end(stages), [&](const char* stage) { return extension == stage; });
+        }
+    }
+
+    void ShaderLibrary::init(){
+        for (size_t i = 0; i < EMBEDDED_SHADER_COUNT; i++) {
+            const EmbeddedShader& shader = EMBEDDED_SHADERS[i];
+            m_embedded[shader.name] = std::span<const uint32_t>(shader.code, shader.word_count);
+        }
+
+        utils::Logger::info("Shader library holds ", m_embedded.size(), " embedded shaders!");
+
+#ifdef EVOKE_SHADER_HOT_RELOAD
+        std::error_code error;
+        std::filesystem::create_directories(EVOKE_SHADER_RELOAD_DIR, error);
+        if (error) {
+            utils::Logger::error("Failed to create shader reload directory, hot reload is off!");
+            return;
+        }
+
+        m_stopping = false;
+        m_watching = true;
+        m_watcher = std::thread(&ShaderLibrary::watch_loop, this);
+        utils::Logger::info("Watching ", EVOKE_SHADER_SOURCE_DIR, " for shader changes!");
+#endif
+    }
+
+    void ShaderLibrary::clean_up(){
+        if (m_watcher.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_stopping = true;
+            }
+            m_condition.notify_all();
+            m_watcher.join();
+        }
+        m_watching = false;
+
+        m_tracked.clear();
+        m_pending.clear();
+        m_reloaded.clear();
+        m_embedded.clear();
+    }
+
+    std::span<const uint32_t> ShaderLibrary::get(const std::string& name) const {
+        auto reloaded = m_reloaded.find(name);
+        if (reloaded != m_reloaded.end()) {
+            return reloaded->second;
+        }
+
+        auto embedded = m_embedded.find(name);
+        if (embedded == m_embedded.end()) {
+            throw std::runtime_error("unknown shader " + name + "!");
+        }
+        return embedded->second;
+    }
+
+    void ShaderLibrary::track(PipelineHandle handle, std::vector<std::string> shaders, std::function<void()> rebuild){
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_tracked.push_back({handle, std::move(shaders), std::move(rebuild)});
+    }
+
+    void ShaderLibrary::untrack(PipelineHandle handle){
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::erase_if(m_tracked, [&](const TrackedPipeline& tracked) { return tracked.handle == handle; });
+    }
+
+    bool ShaderLibrary::has_reloads() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return !m_pending.empty();
+    }
+
+    void ShaderLibrary::apply_reloads(){
+        std::unordered_map<std::string, std::vector<uint32_t>> pending;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            pending.swap(m_pending);
+        }
+
+        for (auto& [name, code] : pending) {
+            m_reloaded[name] = std::move(code);
+        }
+
+        uint32_t rebuilt = 0;
+        for (TrackedPipeline& tracked : m_tracked) {
+            bool affected = std::any_of(tracked.shaders.begin(), tracked.shaders.end(), [&](const std::string& name) { return pending.contains(name); });
+            if (!affected) {
+                continue;
+            }
+
+            try {
+                tracked.rebuild();
+                rebuilt++;
+            } catch (const std::exception& e) {
+                utils::Logger::error("Failed to rebuild pipeline: ", e.what());
+            }
+        }
+
+        utils::Logger::info("Reloaded ", pending.size(), " shaders, rebuilt ", rebuilt, " pipelines!");
+    }
+
+    void ShaderLibrary::watch_loop(){
+#ifdef EVOKE_SHADER_HOT_RELOAD
+        auto scan = [] {
+            std::unordered_map<std::string, std::filesystem::file_time_type> stamps;
+            std::error_code error;
+            for (const auto& entry : std::filesystem::directory_iterator(EVOKE_SHADER_SOURCE_DIR, error)) {
+                if (entry.is_regular_file()) {
+                    stamps[entry.path().string()] = entry.last_write_time(error);
+                }
+            }
+            return stamps;
+        };
+
+        auto stamps = scan();
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_condition.wait_for(lock, std::chrono::milliseconds(250), [this] { return m_stopping.load(); });
+                if (m_stopping) {
+                    return;
+                }
+            }
+
+            auto current = scan();
+            std::vector<std::filesystem::path> changed;
+            bool include_changed = false;
+
+            for (const auto& [path, stamp] : current) {
+                auto previous = stamps.find(path);
+                if (previous != stamps.end() && previous->second == stamp) {
+                    continue;
+                }
+
+                if (is_shader_stage(path)) {
+                    changed.push_back(path);
+                } else {
+                    include_changed = true;
+                }
+            }
+            stamps = std::move(current);
+
+            //Includes are not tracked per shader, a changed one recompiles everything
+            if (include_changed) {
+                changed.clear();
+                for (const auto& [path, stamp] : stamps) {
+                    if (is_shader_stage(path)) {
+                        changed.push_back(path);
+                    }
+                }
+            }
+
+            for (const std::filesystem::path& source : changed) {
+                compile(source);
+            }
+        }
+#endif
+    }
+
+    void ShaderLibrary::compile([[maybe_unused]] const std::filesystem::path& source){
+#ifdef EVOKE_SHADER_HOT_RELOAD
+        //glslc -O instead of the build's spirv-opt pass, the turnaround matters more here
+        std::string name = shader_name(source);
+        std::filesystem::path output = std::filesystem::path(EVOKE_SHADER_RELOAD_DIR) / name;
+        std::string command = std::string("\"") + EVOKE_GLSLC + "\" --target-env=vulkan1.3 -O -o \"" + output.string() + "\" \"" + source.string() + "\"";
+
+        //glslc prints the compile errors itself
+        if (std::system(command.c_str()) != 0) {
+            utils::Logger::error("Failed to compile ", source.filename().string(), "!");
+            return;
+        }
+
+        std::ifstream file(output, std::ios::ate | std::ios::binary);
+        size_t size = file.is_open() ? static_cast<size_t>(file.tellg()) : 0;
+        if (size == 0 || size % sizeof(uint32_t) != 0) {
+            utils::Logger::error("Failed to read compiled shader ", name, "!");
+            return;
+        }
+
+        std::vector<uint32_t> code(size / sizeof(uint32_t));
+        file.seekg(0);
+        file.read(reinterpret_cast<char*>(code.data()), static_cast<std::streamsize>(size));
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pending[name] = std::move(code);
+#endif
+    }
+}
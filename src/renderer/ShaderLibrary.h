@@ -0,0 +1,70 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <span>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "evResources.h"
+
+namespace evoke::vulkan {
+    //One optimized SPIR-V module compiled into the binary
+    struct EmbeddedShader {
+        const char* name;
+        const uint32_t* code;
+        size_t word_count;
+    };
+
+    //Generated by CMake from src/shaders, see cmake/EmbedSpirv.cmake
+    extern const EmbeddedShader EMBEDDED_SHADERS[];
+    extern const size_t EMBEDDED_SHADER_COUNT;
+
+    //Serves SPIR-V by name, e.g. "shape_vert.spv" for shape.vert. Without hot reload that is the
+    //embedded code, nothing is read from disk. Built with EVOKE_SHADER_HOT_RELOAD a watcher thread
+    //recompiles changed sources and the pipelines using them are rebuilt in place, handles stay valid.
+    class ShaderLibrary {
+    public:
+        void init();
+        void clean_up();
+
+        //Valid until the next apply_reloads, throws for unknown names
+        std::span<const uint32_t> get(const std::string& name) const;
+
+        bool hot_reload_enabled() const { return m_watching; }
+        //Remembers how to rebuild a pipeline when one of its shaders changes, may be called from any thread
+        void track(PipelineHandle handle, std::vector<std::string> shaders, std::function<void()> rebuild);
+        void untrack(PipelineHandle handle);
+
+        //True once the watcher has compiled a changed shader
+        bool has_reloads() const;
+        //Swaps in the new code and rebuilds the pipelines using it, the GPU must be idle.
+        //A pipeline that fails to build keeps its old version.
+        void apply_reloads();
+
+    private:
+        struct TrackedPipeline {
+            PipelineHandle handle;
+            std::vector<std::string> shaders;
+            std::function<void()> rebuild;
+        };
+
+        std::unordered_map<std::string, std::span<const uint32_t>> m_embedded;
+        std::unordered_map<std::string, std::vector<uint32_t>> m_reloaded;
+        std::vector<TrackedPipeline> m_tracked;
+
+        bool m_watching = false;
+        std::thread m_watcher;
+        std::atomic<bool> m_stopping{false};
+        mutable std::mutex m_mutex;
+        std::condition_variable m_condition;
+        std::unordered_map<std::string, std::vector<uint32_t>> m_pending;
+
+        void watch_loop();
+        void compile(const std::filesystem::path& source);
+    };
+}
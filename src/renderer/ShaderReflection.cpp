@@ -0,0 +1,438 @@
+#include "ShaderReflection.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace evoke::vulkan {
+    namespace {
+        constexpr uint32_t SPIRV_MAGIC = 0x07230203;
+        constexpr uint32_t NONE = ~0u;
+
+        //The subset of the SPIR-V spec the reflection needs
+        enum Op : uint32_t {
+            OpEntryPoint = 15,
+            OpTypeBool = 20,
+            OpTypeInt = 21,
+            OpTypeFloat = 22,
+            OpTypeVector = 23,
+            OpTypeMatrix = 24,
+            OpTypeImage = 25,
+            OpTypeSampler = 26,
+            OpTypeSampledImage = 27,
+            OpTypeArray = 28,
+            OpTypeRuntimeArray = 29,
+            OpTypeStruct = 30,
+            OpTypePointer = 32,
+            OpConstant = 43,
+            OpSpecConstant = 50,
+            OpVariable = 59,
+            OpDecorate = 71,
+            OpMemberDecorate = 72,
+            OpTypeAccelerationStructureKHR = 5341
+        };
+
+        enum Decoration : uint32_t {
+            DecorationBlock = 2,
+            DecorationBufferBlock = 3,
+            DecorationArrayStride = 6,
+            DecorationMatrixStride = 7,
+            DecorationBuiltIn = 11,
+            DecorationLocation = 30,
+            DecorationBinding = 33,
+            DecorationDescriptorSet = 34,
+            DecorationOffset = 35
+        };
+
+        enum StorageClass : uint32_t {
+            StorageUniformConstant = 0,
+            StorageInput = 1,
+            StorageUniform = 2,
+            StoragePushConstant = 9,
+            StorageStorageBuffer = 12,
+            StoragePhysicalStorageBuffer = 5349
+        };
+
+        enum Dim : uint32_t {
+            DimBuffer = 5,
+            DimSubpassData = 6
+        };
+
+        struct Id {
+            uint32_t opcode = 0;
+            //Set for values, types have none
+            uint32_t result_type = 0;
+            //Operands after the result id
+            const uint32_t* operands = nullptr;
+            uint32_t operand_count = 0;
+
+            uint32_t set = NONE;
+            uint32_t binding = NONE;
+            uint32_t location = NONE;
+            uint32_t array_stride = 0;
+            bool builtin = false;
+            bool block = false;
+            bool buffer_block = false;
+
+            std::vector<uint32_t> member_offsets;
+            std::vector<uint32_t> member_matrix_strides;
+        };
+
+        class Module {
+        public:
+            Module(const uint32_t* code, size_t word_count) {
+                if (word_count < 5 || code[0] != SPIRV_MAGIC) {
+                    throw std::runtime_error("invalid SPIR-V module!");
+                }
+                m_ids.resize(code[3]);
+
+                size_t offset = 5;
+                while (offset < word_count) {
+                    uint32_t count = code[offset] >> 16;
+                    uint32_t opcode = code[offset] & 0xFFFF;
+                    if (count == 0 || offset + count > word_count) {
+                        throw std::runtime_error("truncated SPIR-V instruction!");
+                    }
+                    parse(opcode, code + offset + 1, count - 1);
+                    offset += count;
+                }
+            }
+
+            VkShaderStageFlagBits stage = VK_SHADER_STAGE_ALL;
+            std::vector<uint32_t> variables;
+
+            Id& get(uint32_t id) {
+                if (id >= m_ids.size()) {
+                    throw std::runtime_error("SPIR-V id out of bounds!");
+                }
+                return m_ids[id];
+            }
+
+            //Byte size of a type as laid out by its Offset and stride decorations
+            uint32_t size_of(uint32_t type_id, uint32_t matrix_stride = 0) {
+                Id& type = get(type_id);
+                switch (type.opcode) {
+                    case OpTypeBool:
+                    case OpTypeInt:
+                    case OpTypeFloat:
+                        return type.opcode == OpTypeBool ? 4 : type.operands[0] / 8;
+                    case OpTypeVector:
+                        return size_of(type.operands[0]) * type.operands[1];
+                    case OpTypeMatrix:
+                        return (matrix_stride > 0 ? matrix_stride : size_of(type.operands[0])) * type.operands[1];
+                    case OpTypeArray:
+                        return (type.array_stride > 0 ? type.array_stride : size_of(type.operands[0])) * constant(type.operands[1]);
+                    case OpTypeRuntimeArray:
+                        return 0;
+                    case OpTypePointer:
+                        return 8;
+                    case OpTypeStruct: {
+                        uint32_t size = 0;
+                        for (uint32_t member = 0; member < type.operand_count; member++) {
+                            uint32_t offset = member < type.member_offsets.size() ? type.member_offsets[member] : size;
+                            uint32_t stride = member < type.member_matrix_strides.size() ? type.member_matrix_strides[member] : 0;
+                            size = std::max(size, offset + size_of(type.operands[member], stride));
+                        }
+                        return size;
+                    }
+                    default:
+                        throw std::runtime_error("unsupported SPIR-V type in reflection!");
+                }
+            }
+
+            //Specialization constants reflect their default value
+            uint32_t constant(uint32_t id) {
+                Id& value = get(id);
+                if (value.opcode != OpConstant && value.opcode != OpSpecConstant) {
+                    throw std::runtime_error("SPIR-V array length is not a constant!");
+                }
+                return value.operands[0];
+            }
+
+        private:
+            std::vector<Id> m_ids;
+
+            //Types and variables keep a pointer to their operands, the code outlives the module
+            void parse(uint32_t opcode, const uint32_t* words, uint32_t count) {
+                switch (opcode) {
+                    case OpEntryPoint:
+                        if (stage == VK_SHADER_STAGE_ALL) {
+                            stage = stage_of(words[0]);
+                        }
+                        break;
+                    case OpDecorate:
+                        decorate(get(words[0]), words[1], count > 2 ? words[2] : 0);
+                        break;
+                    case OpMemberDecorate: {
+                        Id& target = get(words[0]);
+                        uint32_t member = words[1];
+                        if (words[2] == DecorationOffset) {
+                            grow(target.member_offsets, member)[member] = words[3];
+                        } else if (words[2] == DecorationMatrixStride) {
+                            grow(target.member_matrix_strides, member)[member] = words[3];
+                        } else if (words[2] == DecorationBuiltIn) {
+                            target.builtin = true;
+                        }
+                        break;
+                    }
+                    case OpConstant:
+                    case OpSpecConstant:
+                    case OpVariable:
+                        //Values have their result type before the result id
+                        define(words[1], opcode, words + 2, count - 2);
+                        get(words[1]).result_type = words[0];
+                        if (opcode == OpVariable) {
+                            variables.push_back(words[1]);
+                        }
+                        break;
+                    case OpTypeBool:
+                    case OpTypeInt:
+                    case OpTypeFloat:
+                    case OpTypeVector:
+                    case OpTypeMatrix:
+                    case OpTypeImage:
+                    case OpTypeSampler:
+                    case OpTypeSampledImage:
+                    case OpTypeArray:
+                    case OpTypeRuntimeArray:
+                    case OpTypeStruct:
+                    case OpTypePointer:
+                    case OpTypeAccelerationStructureKHR:
+                        define(words[0], opcode, words + 1, count - 1);
+                        break;
+                    default:
+                        break;
+                }
+            }
+
+            void define(uint32_t id, uint32_t opcode, const uint32_t* operands, uint32_t count) {
+                Id& target = get(id);
+                target.opcode = opcode;
+                target.operands = operands;
+                target.operand_count = count;
+            }
+
+            static std::vector<uint32_t>& grow(std::vector<uint32_t>& values, uint32_t index) {
+                if (values.size() <= index) {
+                    values.resize(index + 1, 0);
+                }
+                return values;
+            }
+
+            static void decorate(Id& target, uint32_t decoration, uint32_t value) {
+                switch (decoration) {
+                    case DecorationBlock: target.block = true; break;
+                    case DecorationBufferBlock: target.buffer_block = true; break;
+                    case DecorationArrayStride: target.array_stride = value; break;
+                    case DecorationBuiltIn: target.builtin = true; break;
+                    case DecorationLocation: target.location = value; break;
+                    case DecorationBinding: target.binding = value; break;
+                    case DecorationDescriptorSet: target.set = value; break;
+                    default: break;
+                }
+            }
+
+            static VkShaderStageFlagBits stage_of(uint32_t execution_model) {
+                switch (execution_model) {
+                    case 0: return VK_SHADER_STAGE_VERTEX_BIT;
+                    case 1: return VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT;
+                    case 2: return VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT;
+                    case 3: return VK_SHADER_STAGE_GEOMETRY_BIT;
+                    case 4: return VK_SHADER_STAGE_FRAGMENT_BIT;
+                    case 5: return VK_SHADER_STAGE_COMPUTE_BIT;
+                    case 5364: return VK_SHADER_STAGE_TASK_BIT_EXT;
+                    case 5365: return VK_SHADER_STAGE_MESH_BIT_EXT;
+                    default: throw std::runtime_error("unsupported SPIR-V execution model!");
+                }
+            }
+        };
+
+        VkFormat input_format(Module& module, uint32_t type_id) {
+            Id& type = module.get(type_id);
+            uint32_t components = 1;
+            if (type.opcode == OpTypeVector) {
+                components = type.operands[1];
+                type_id = type.operands[0];
+            }
+
+            //Packed inputs like unorm colors cannot be told apart from floats, pipelines with those describe
+            //their vertex input themselves
+            Id& scalar = module.get(type_id);
+            if (scalar.operands[0] != 32) {
+                return VK_FORMAT_UNDEFINED;
+            }
+
+            static constexpr VkFormat float_formats[] = {VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT};
+            static constexpr VkFormat sint_formats[] = {VK_FORMAT_R32_SINT, VK_FORMAT_R32G32_SINT, VK_FORMAT_R32G32B32_SINT, VK_FORMAT_R32G32B32A32_SINT};
+            static constexpr VkFormat uint_formats[] = {VK_FORMAT_R32_UINT, VK_FORMAT_R32G32_UINT, VK_FORMAT_R32G32B32_UINT, VK_FORMAT_R32G32B32A32_UINT};
+
+            if (scalar.opcode == OpTypeFloat) {
+                return float_formats[components - 1];
+            }
+            return scalar.operands[1] ? sint_formats[components - 1] : uint_formats[components - 1];
+        }
+
+        //Descriptor type of a UniformConstant variable's (array element) type
+        VkDescriptorType opaque_descriptor_type(Module& module, uint32_t type_id) {
+            Id& type = module.get(type_id);
+            switch (type.opcode) {
+                case OpTypeSampler:
+                    return VK_DESCRIPTOR_TYPE_SAMPLER;
+                case OpTypeSampledImage:
+                    return VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+                case OpTypeAccelerationStructureKHR:
+                    return VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR;
+                case OpTypeImage: {
+                    //Sampled type, dim, depth, arrayed, multisampled, sampled
+                    uint32_t dim = type.operands[1];
+                    bool storage = type.operands[5] == 2;
+                    if (dim == DimBuffer) {
+                        return storage ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+                    }
+                    if (dim == DimSubpassData) {
+                        return VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+                    }
+                    return storage ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+                }
+                default:
+                    throw std::runtime_error("unsupported SPIR-V descriptor type!");
+            }
+        }
+    }
+
+    ShaderReflection reflect_spirv(const uint32_t* code, size_t word_count){
+        Module module(code, word_count);
+
+        ShaderReflection reflection;
+        reflection.stage = module.stage;
+
+        for (uint32_t variable_id : module.variables) {
+            Id& variable = module.get(variable_id);
+            uint32_t storage_class = variable.operands[0];
+            Id& pointer = module.get(variable.result_type);
+            uint32_t type_id = pointer.operands[1];
+
+            if (storage_class == StoragePushConstant) {
+                reflection.push_constants.stageFlags = module.stage;
+                reflection.push_constants.offset = 0;
+                reflection.push_constants.size = module.size_of(type_id);
+                continue;
+            }
+
+            if (storage_class == StorageInput) {
+                if (module.stage != VK_SHADER_STAGE_VERTEX_BIT || variable.builtin || module.get(type_id).builtin || variable.location == NONE) {
+                    continue;
+                }
+
+                //A matrix input is one vector input per column
+                Id& type = module.get(type_id);
+                uint32_t columns = type.opcode == OpTypeMatrix ? type.operands[1] : 1;
+                uint32_t column_type = type.opcode == OpTypeMatrix ? type.operands[0] : type_id;
+                for (uint32_t column = 0; column < columns; column++) {
+                    reflection.inputs.push_back({variable.location + column, input_format(module, column_type), module.size_of(column_type)});
+                }
+                continue;
+            }
+
+            if (storage_class != StorageUniformConstant && storage_class != StorageUniform && storage_class != StorageStorageBuffer) {
+                continue;
+            }
+
+            VkDescriptorSetLayoutBinding binding{};
+            binding.binding = variable.binding == NONE ? 0 : variable.binding;
+            binding.descriptorCount = 1;
+            binding.stageFlags = module.stage;
+
+            //Arrays of descriptors, runtime sized ones get a single descriptor unless the caller says otherwise
+            Id* type = &module.get(type_id);
+            if (type->opcode == OpTypeArray) {
+                binding.descriptorCount = module.constant(type->operands[1]);
+                type_id = type->operands[0];
+                type = &module.get(type_id);
+            } else if (type->opcode == OpTypeRuntimeArray) {
+                type_id = type->operands[0];
+                type = &module.get(type_id);
+            }
+
+            if (storage_class == StorageUniformConstant) {
+                binding.descriptorType = opaque_descriptor_type(module, type_id);
+            } else if (storage_class == StorageStorageBuffer || type->buffer_block) {
+                binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            } else {
+                binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+            }
+
+            reflection.bindings.push_back({variable.set == NONE ? 0 : variable.set, binding});
+        }
+
+        std::sort(reflection.bindings.begin(), reflection.bindings.end(), [](const auto& l, const auto& r) {
+            return l.first != r.first ? l.first < r.first : l.second.binding < r.second.binding;
+        });
+        std::sort(reflection.inputs.begin(), reflection.inputs.end(), [](const ReflectedInput& l, const ReflectedInput& r) {
+            return l.location < r.location;
+        });
+
+        return reflection;
+    }
+
+    PipelineReflection merge_reflections(const std::vector<ShaderReflection>& shaders){
+        PipelineReflection pipeline;
+
+        for (const ShaderReflection& shader : shaders) {
+            for (const auto& [set, binding] : shader.bindings) {
+                if (pipeline.sets.size() <= set) {
+                    pipeline.sets.resize(set + 1);
+                }
+
+                //The same binding seen from several stages becomes one binding visible to all of them
+                auto& bindings = pipeline.sets[set];
+                auto existing = std::find_if(bindings.begin(), bindings.end(), [&](const VkDescriptorSetLayoutBinding& b) { return b.binding == binding.binding; });
+                if (existing == bindings.end()) {
+                    bindings.push_back(binding);
+                } else if (existing->descriptorType != binding.descriptorType) {
+                    throw std::runtime_error("shader stages disagree on a descriptor type!");
+                } else {
+                    existing->stageFlags |= binding.stageFlags;
+                    existing->descriptorCount = std::max(existing->descriptorCount, binding.descriptorCount);
+                }
+            }
+
+            //One range covering every stage keeps vkCmdPushConstants calls simple
+            if (shader.push_constants.size > 0) {
+                pipeline.push_constants.stageFlags |= shader.push_constants.stageFlags;
+                pipeline.push_constants.size = std::max(pipeline.push_constants.size, shader.push_constants.size);
+            }
+
+            if (shader.stage == VK_SHADER_STAGE_VERTEX_BIT) {
+                pipeline.inputs = shader.inputs;
+            }
+        }
+
+        for (auto& bindings : pipeline.sets) {
+            std::sort(bindings.begin(), bindings.end(), [](const VkDescriptorSetLayoutBinding& l, const VkDescriptorSetLayoutBinding& r) {
+                return l.binding < r.binding;
+            });
+        }
+
+        return pipeline;
+    }
+
+    void make_vertex_input(const std::vector<ReflectedInput>& inputs, std::vector<VkVertexInputBindingDescription>& bindings, std::vector<VkVertexInputAttributeDescription>& attributes, uint32_t instance_location){
+        bindings.clear();
+        attributes.clear();
+
+        uint32_t strides[2] = {0, 0};
+        for (const ReflectedInput& input : inputs) {
+            if (input.format == VK_FORMAT_UNDEFINED) {
+                throw std::runtime_error("vertex input needs an explicit format!");
+            }
+            uint32_t binding = input.location >= instance_location ? 1 : 0;
+            attributes.push_back({input.location, binding, input.format, strides[binding]});
+            strides[binding] += input.size;
+        }
+
+        for (uint32_t binding = 0; binding < 2; binding++) {
+            if (strides[binding] > 0) {
+                bindings.push_back({binding, strides[binding], binding == 0 ? VK_VERTEX_INPUT_RATE_VERTEX : VK_VERTEX_INPUT_RATE_INSTANCE});
+            }
+        }
+    }
+}
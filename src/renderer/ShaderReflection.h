@@ -0,0 +1,41 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace evoke::vulkan {
+    //One vertex shader input, builtins are skipped. Matrices take one location per column.
+    struct ReflectedInput {
+        uint32_t location;
+        VkFormat format;
+        uint32_t size;
+    };
+
+    //What a pipeline layout and vertex input need to know about one SPIR-V module
+    struct ShaderReflection {
+        VkShaderStageFlagBits stage = VK_SHADER_STAGE_ALL;
+        //Sorted by set, then binding. stageFlags is this module's stage.
+        std::vector<std::pair<uint32_t, VkDescriptorSetLayoutBinding>> bindings;
+        //Size 0 without a push constant block
+        VkPushConstantRange push_constants{};
+        //Vertex stage only, sorted by location
+        std::vector<ReflectedInput> inputs;
+    };
+
+    //Layout of a whole pipeline, the stages of every module merged
+    struct PipelineReflection {
+        //Indexed by set number, sets a shader skips stay empty
+        std::vector<std::vector<VkDescriptorSetLayoutBinding>> sets;
+        VkPushConstantRange push_constants{};
+        std::vector<ReflectedInput> inputs;
+    };
+
+    //Parses the decorations and types of a SPIR-V module, throws on malformed code
+    ShaderReflection reflect_spirv(const uint32_t* code, size_t word_count);
+    PipelineReflection merge_reflections(const std::vector<ShaderReflection>& shaders);
+
+    //Interleaves the inputs in location order. Locations from instance_location on go to a
+    //second binding advanced per instance, e.g. a per instance model matrix.
+    void make_vertex_input(const std::vector<ReflectedInput>& inputs, std::vector<VkVertexInputBindingDescription>& bindings, std::vector<VkVertexInputAttributeDescription>& attributes, uint32_t instance_location = UINT32_MAX);
+}
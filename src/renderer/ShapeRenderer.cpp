@@ -0,0 +1,361 @@
+#include "ShapeRenderer.h"
+#include <glm/gtc/packing.hpp>
+#include <algorithm>
+#include <cstring>
+
+namespace evoke::vulkan {
+    namespace {
+        constexpr uint32_t INITIAL_CAPACITY = 16384;
+        constexpr uint32_t MAX_TEXTURES = 256;
+        //Slots are 16 bit in ShapeInstance, far below the update after bind limits of bindless devices
+        constexpr uint32_t MAX_BINDLESS_TEXTURES = 4096;
+
+        struct ShapePushConstants {
+            glm::vec2 scale;
+            glm::vec2 translate;
+        };
+    }
+
+    void ShapeRenderer::init(VkDevice device, const FeatureTiers& tiers, const VkSurfaceFormatKHR& surface_format, evResources& resources, ImageHandle white_texture, uint32_t frames_in_flight){
+        m_device = device;
+        m_resources = &resources;
+        m_white_texture = white_texture;
+        m_descriptors = tiers.descriptors;
+        m_streaming_memory = streaming_memory(tiers);
+        m_frames.resize(frames_in_flight);
+
+        bool bindless = m_descriptors == DescriptorTier::Bindless;
+        uint32_t texture_count = bindless ? MAX_BINDLESS_TEXTURES : 1;
+
+        VkDescriptorSetLayoutBinding sampler_binding{};
+        sampler_binding.binding = 0;
+        sampler_binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        sampler_binding.descriptorCount = texture_count;
+        sampler_binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+        VkDescriptorPoolSize pool_size{};
+        pool_size.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+
+        VkDescriptorPoolCreateInfo pool_info{};
+        pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        pool_info.poolSizeCount = 1;
+        pool_info.pPoolSizes = &pool_size;
+
+        if (bindless) {
+            //Slots are filled while earlier frames may still be reading the set
+            m_set_layout = resources.get_set_layout({sampler_binding}, {VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT});
+            pool_size.descriptorCount = MAX_BINDLESS_TEXTURES;
+            pool_info.maxSets = 1;
+            pool_info.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+        } else {
+            //Same layout the reflection of shape.frag asks for, so both resolve to one cached handle
+            m_set_layout = resources.get_set_layout({sampler_binding});
+            pool_size.descriptorCount = MAX_TEXTURES;
+            pool_info.maxSets = MAX_TEXTURES;
+        }
+
+        if (vkCreateDescriptorPool(device, &pool_info, nullptr, &m_descriptor_pool) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create shape descriptor pool!");
+        }
+
+        VkSamplerCreateInfo sampler_info{};
+        sampler_info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+        sampler_info.magFilter = VK_FILTER_LINEAR;
+        sampler_info.minFilter = VK_FILTER_LINEAR;
+        sampler_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+        sampler_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        sampler_info.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        sampler_info.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        sampler_info.maxLod = VK_LOD_CLAMP_NONE;
+
+        if (vkCreateSampler(device, &sampler_info, nullptr, &m_sampler) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create shape sampler!");
+        }
+
+        if (bindless) {
+            VkDescriptorSetAllocateInfo alloc_info{};
+            alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+            alloc_info.descriptorPool = m_descriptor_pool;
+            alloc_info.descriptorSetCount = 1;
+            alloc_info.pSetLayouts = &m_set_layout;
+
+            if (vkAllocateDescriptorSets(device, &alloc_info, &m_bindless_set) != VK_SUCCESS) {
+                throw std::runtime_error("failed to allocate shape bindless descriptor set!");
+            }
+
+            write_texture(m_bindless_set, 0, white_texture);
+            m_texture_slots.emplace(white_texture.value, 0);
+
+            m_allocate = &ShapeRenderer::allocate_tier<DescriptorTier::Bindless>;
+            m_record_draw = &ShapeRenderer::record_draw_tier<DescriptorTier::Bindless>;
+        } else {
+            m_allocate = &ShapeRenderer::allocate_tier<DescriptorTier::Classic>;
+            m_record_draw = &ShapeRenderer::record_draw_tier<DescriptorTier::Classic>;
+        }
+
+        //Instance attributes only, the quad corners come from gl_VertexIndex
+        VkVertexInputBindingDescription instance_binding{};
+        instance_binding.binding = 0;
+        instance_binding.stride = sizeof(ShapeInstance);
+        instance_binding.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+
+        GraphicsPipelineConfig config{};
+        config.shaders = {
+            {VK_SHADER_STAGE_VERTEX_BIT, "shape_vert.spv"},
+            {VK_SHADER_STAGE_FRAGMENT_BIT, "shape_frag.spv"}
+        };
+        config.bindings = {instance_binding};
+        config.attributes = {
+            {0, 0, VK_FORMAT_R32G32_SFLOAT, offsetof(ShapeInstance, p0)},
+            {1, 0, VK_FORMAT_R32G32_SFLOAT, offsetof(ShapeInstance, p1)},
+            {2, 0, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(ShapeInstance, uv)},
+            {3, 0, VK_FORMAT_R8G8B8A8_UNORM, offsetof(ShapeInstance, color)},
+            {4, 0, VK_FORMAT_R32G32_SFLOAT, offsetof(ShapeInstance, thickness)},
+            {5, 0, VK_FORMAT_R16G16_UINT, offsetof(ShapeInstance, kind)}
+        };
+        config.specialization.set(0, bindless).set(1, texture_count);
+        config.set_layouts = {m_set_layout};
+        config.push_constant_stages = VK_SHADER_STAGE_VERTEX_BIT;
+        config.push_constant_size = sizeof(ShapePushConstants);
+        //Rotated and mirrored shapes may end up with either winding
+        config.cull_mode = VK_CULL_MODE_NONE;
+
+        m_pipeline = m_pipeline_builder.create_graphics_pipeline(device, surface_format, config, resources);
+    }
+
+    void ShapeRenderer::clean_up(){
+        for (auto& frame : m_frames) {
+            if (!frame.instances.is_null()) {
+                m_resources->destroy_buffer(frame.instances);
+            }
+            frame = {};
+        }
+        m_texture_sets.clear();
+        m_free_sets.clear();
+        m_texture_slots.clear();
+        m_free_slots.clear();
+        m_next_slot = 1;
+        m_bindless_set = VK_NULL_HANDLE;
+
+        vkDestroySampler(m_device, m_sampler, nullptr);
+        vkDestroyDescriptorPool(m_device, m_descriptor_pool, nullptr);
+    }
+
+    void ShapeRenderer::hash_state(utils::Hasher& hasher, uint32_t frame) const {
+        const FrameBuffers& buffers = m_frames[frame];
+        hasher.add(m_pipeline).add(buffers.instances).add(buffers.count);
+        hasher.add_bytes(buffers.batches.data(), sizeof(Batch) * buffers.batches.size());
+    }
+
+    void ShapeRenderer::end_frame(uint32_t frame){
+        FrameBuffers& buffers = m_frames[frame];
+        m_submitted = {buffers.count, static_cast<uint32_t>(buffers.batches.size())};
+        buffers.count = 0;
+        buffers.batches.clear();
+    }
+
+    void ShapeRenderer::begin_frame(uint32_t frame){
+        m_current_frame = frame;
+        FrameBuffers& buffers = m_frames[frame];
+        buffers.count = 0;
+        buffers.batches.clear();
+
+        //Frames before this one were submitted earlier, so they are done too
+        std::lock_guard<std::mutex> lock(m_texture_mutex);
+        m_free_sets.insert(m_free_sets.end(), buffers.released_sets.begin(), buffers.released_sets.end());
+        buffers.released_sets.clear();
+        m_free_slots.insert(m_free_slots.end(), buffers.released_slots.begin(), buffers.released_slots.end());
+        buffers.released_slots.clear();
+    }
+
+    template<DescriptorTier Tier>
+    ShapeInstance* ShapeRenderer::allocate_tier(uint32_t count, ImageHandle texture){
+        FrameBuffers& frame = m_frames[m_current_frame];
+        if (frame.count + count > frame.capacity) {
+            grow(frame, frame.count + count);
+        }
+
+        bool new_batch = frame.batches.empty();
+        if constexpr (Tier == DescriptorTier::Classic) {
+            //Shapes that do not sample join whatever batch is open, sprites only split on a texture change
+            if (!new_batch && !texture.is_null()) {
+                Batch& open = frame.batches.back();
+                if (open.texture.is_null()) {
+                    open.texture = texture;
+                } else {
+                    new_batch = open.texture != texture;
+                }
+            }
+        }
+        //Bindless instances carry their texture slot, the frame stays one batch
+        if (new_batch) {
+            frame.batches.push_back({texture, frame.count, 0});
+        }
+
+        ShapeInstance* instances = frame.mapped + frame.count;
+        frame.batches.back().instance_count += count;
+        frame.count += count;
+        return instances;
+    }
+
+    void ShapeRenderer::grow(FrameBuffers& frame, uint32_t required){
+        uint32_t capacity = std::max({required, frame.capacity * 2, INITIAL_CAPACITY});
+
+        BufferHandle instances = m_resources->create_buffer(sizeof(ShapeInstance) * capacity, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, m_streaming_memory);
+        ShapeInstance* mapped = static_cast<ShapeInstance*>(m_resources->map_buffer(instances));
+
+        //The old buffer belongs to this frame, so the GPU is done with it
+        if (!frame.instances.is_null()) {
+            memcpy(mapped, frame.mapped, sizeof(ShapeInstance) * frame.count);
+            m_resources->destroy_buffer(frame.instances);
+        }
+
+        frame.instances = instances;
+        frame.mapped = mapped;
+        frame.capacity = capacity;
+    }
+
+    void ShapeRenderer::draw_quad(const glm::vec2& center, const glm::vec2& size, const glm::vec4& color, float rotation){
+        *allocate(1) = {center, size * 0.5f, glm::vec4(0.0f), glm::packUnorm4x8(color), 0.0f, rotation, ShapeKind::Quad};
+    }
+
+    void ShapeRenderer::draw_circle(const glm::vec2& center, float radius, const glm::vec4& color, float thickness){
+        *allocate(1) = {center, glm::vec2(radius), glm::vec4(0.0f), glm::packUnorm4x8(color), thickness, 0.0f, ShapeKind::Circle};
+    }
+
+    void ShapeRenderer::draw_line(const glm::vec2& from, const glm::vec2& to, float thickness, const glm::vec4& color){
+        *allocate(1) = {from, to, glm::vec4(0.0f), glm::packUnorm4x8(color), thickness, 0.0f, ShapeKind::Line};
+    }
+
+    void ShapeRenderer::draw_sprite(const glm::vec2& center, const glm::vec2& size, ImageHandle texture, const glm::vec4& uv, const glm::vec4& color, float rotation){
+        uint16_t slot = texture_slot(texture);
+        *allocate(1, texture) = {center, size * 0.5f, uv, glm::packUnorm4x8(color), 0.0f, rotation, ShapeKind::Sprite, slot};
+    }
+
+    uint16_t ShapeRenderer::texture_slot(ImageHandle texture){
+        if (m_descriptors == DescriptorTier::Classic || texture.is_null()) {
+            return 0;
+        }
+
+        std::lock_guard<std::mutex> lock(m_texture_mutex);
+        auto found = m_texture_slots.find(texture.value);
+        if (found != m_texture_slots.end()) {
+            return found->second;
+        }
+
+        uint16_t slot;
+        if (!m_free_slots.empty()) {
+            slot = m_free_slots.back();
+            m_free_slots.pop_back();
+        } else if (m_next_slot < MAX_BINDLESS_TEXTURES) {
+            slot = m_next_slot++;
+        } else {
+            throw std::runtime_error("out of bindless shape texture slots, release textures before destroying them!");
+        }
+
+        write_texture(m_bindless_set, slot, texture);
+        m_texture_slots.emplace(texture.value, slot);
+        return slot;
+    }
+
+    void ShapeRenderer::release_texture(ImageHandle texture){
+        if (texture.is_null() || texture == m_white_texture) {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(m_texture_mutex);
+        auto found = m_texture_sets.find(texture.value);
+        if (found != m_texture_sets.end()) {
+            m_frames[m_current_frame].released_sets.push_back(found->second);
+            m_texture_sets.erase(found);
+        }
+
+        auto slot = m_texture_slots.find(texture.value);
+        if (slot != m_texture_slots.end()) {
+            m_frames[m_current_frame].released_slots.push_back(slot->second);
+            m_texture_slots.erase(slot);
+        }
+    }
+
+    void ShapeRenderer::write_texture(VkDescriptorSet descriptor_set, uint32_t element, ImageHandle texture){
+        VkDescriptorImageInfo image_info{};
+        image_info.sampler = m_sampler;
+        image_info.imageView = m_resources->get(texture).view;
+        image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+        VkWriteDescriptorSet write{};
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstSet = descriptor_set;
+        write.dstBinding = 0;
+        write.dstArrayElement = element;
+        write.descriptorCount = 1;
+        write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        write.pImageInfo = &image_info;
+        vkUpdateDescriptorSets(m_device, 1, &write, 0, nullptr);
+    }
+
+    VkDescriptorSet ShapeRenderer::get_texture_set(ImageHandle texture){
+        if (texture.is_null()) {
+            texture = m_white_texture;
+        }
+
+        std::lock_guard<std::mutex> lock(m_texture_mutex);
+        auto found = m_texture_sets.find(texture.value);
+        if (found != m_texture_sets.end()) {
+            return found->second;
+        }
+
+        VkDescriptorSet descriptor_set;
+        if (!m_free_sets.empty()) {
+            descriptor_set = m_free_sets.back();
+            m_free_sets.pop_back();
+        } else {
+            VkDescriptorSetAllocateInfo alloc_info{};
+            alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+            alloc_info.descriptorPool = m_descriptor_pool;
+            alloc_info.descriptorSetCount = 1;
+            alloc_info.pSetLayouts = &m_set_layout;
+
+            if (vkAllocateDescriptorSets(m_device, &alloc_info, &descriptor_set) != VK_SUCCESS) {
+                throw std::runtime_error("out of shape texture descriptor sets, release textures before destroying them!");
+            }
+        }
+
+        write_texture(descriptor_set, 0, texture);
+        m_texture_sets.emplace(texture.value, descriptor_set);
+        return descriptor_set;
+    }
+
+    template<DescriptorTier Tier>
+    void ShapeRenderer::record_draw_tier(VkCommandBuffer command_buffer, uint32_t frame, VkExtent2D extent){
+        const FrameBuffers& buffers = m_frames[frame];
+
+        if (buffers.count == 0) {
+            return;
+        }
+
+        const evPipeline& pipeline = m_resources->get(m_pipeline);
+        vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.handle);
+
+        //Pixels to clip space
+        ShapePushConstants push_constants{};
+        push_constants.scale = glm::vec2(2.0f / static_cast<float>(extent.width), 2.0f / static_cast<float>(extent.height));
+        push_constants.translate = glm::vec2(-1.0f);
+        vkCmdPushConstants(command_buffer, pipeline.layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(push_constants), &push_constants);
+
+        VkBuffer instance_buffer = m_resources->get(buffers.instances).handle;
+        VkDeviceSize offset = 0;
+        vkCmdBindVertexBuffers(command_buffer, 0, 1, &instance_buffer, &offset);
+
+        if constexpr (Tier == DescriptorTier::Bindless) {
+            vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.layout, 0, 1, &m_bindless_set, 0, nullptr);
+            vkCmdDraw(command_buffer, 6, buffers.count, 0, 0);
+        } else {
+            for (const Batch& batch : buffers.batches) {
+                VkDescriptorSet descriptor_set = get_texture_set(batch.texture);
+                vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.layout, 0, 1, &descriptor_set, 0, nullptr);
+                vkCmdDraw(command_buffer, 6, batch.instance_count, 0, batch.first_instance);
+            }
+        }
+    }
+}
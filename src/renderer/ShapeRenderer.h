@@ -0,0 +1,145 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <mutex>
+#include <unordered_map>
+#include "VulkanPipeline.h"
+#include "FeatureTiers.h"
+#include "evResources.h"
+#include "../utils/Hasher.h"
+
+namespace evoke::vulkan {
+    enum class ShapeKind : uint16_t {
+        Quad,
+        Circle,
+        Line,
+        Sprite
+    };
+
+    //One instance per shape, the vertex shader expands it into a quad. Matches the attributes of shape.vert.
+    struct ShapeInstance {
+        glm::vec2 p0;           //Center, or line start
+        glm::vec2 p1;           //Half size, radius in x, or line end
+        glm::vec4 uv;           //Sprite texture rect, min then max
+        uint32_t color;         //RGBA8
+        float thickness;        //Line width, ring width for circles, 0 fills the circle
+        float rotation;         //Radians, quads and sprites only
+        ShapeKind kind;
+        uint16_t texture;       //Bindless slot of the sprite texture, see texture_slot
+    };
+    static_assert(sizeof(ShapeInstance) == 48, "shape instances must match the vertex input stride");
+
+    struct ShapeStats {
+        uint32_t shapes = 0;
+        uint32_t batches = 0;
+    };
+
+    //Immediate mode 2D renderer in pixel coordinates, origin top left. Shapes are written straight into
+    //a persistently mapped instance buffer per frame in flight and drawn in submission order, one
+    //instanced draw per run of shapes sharing a texture. On the bindless tier the instances index one
+    //texture array instead and the whole frame is a single draw. Circles and lines are signed distance
+    //fields so they stay antialiased at any size.
+    class ShapeRenderer {
+    public:
+        //white_texture is bound for batches without sprites
+        void init(VkDevice device, const FeatureTiers& tiers, const VkSurfaceFormatKHR& surface_format, evResources& resources, ImageHandle white_texture, uint32_t frames_in_flight);
+        void clean_up();
+
+        //The frame's buffers must no longer be in use by the GPU
+        void begin_frame(uint32_t frame);
+
+        void draw_quad(const glm::vec2& center, const glm::vec2& size, const glm::vec4& color, float rotation = 0.0f);
+        void draw_circle(const glm::vec2& center, float radius, const glm::vec4& color, float thickness = 0.0f);
+        void draw_line(const glm::vec2& from, const glm::vec2& to, float thickness, const glm::vec4& color);
+        void draw_sprite(const glm::vec2& center, const glm::vec2& size, ImageHandle texture, const glm::vec4& uv = {0.0f, 0.0f, 1.0f, 1.0f}, const glm::vec4& color = glm::vec4(1.0f), float rotation = 0.0f);
+
+        //Reserves count instances for bulk writes. Allocation belongs to the drawing thread, the returned
+        //range may then be filled from the job system. A null texture joins any batch, so only sprites may
+        //pass one, and sprites set their texture to texture_slot. The pointer is valid until the next allocation.
+        ShapeInstance* allocate(uint32_t count, ImageHandle texture = {}){
+            return (this->*m_allocate)(count, texture);
+        }
+        //Index into the bindless texture array, 0 is the white texture and the only slot on the classic tier.
+        //Safe from worker threads.
+        uint16_t texture_slot(ImageHandle texture);
+        //Call before destroying a texture that was drawn. Its descriptor set or bindless slot is reused once
+        //the frames in flight that may sample it are done. Safe from worker threads.
+        void release_texture(ImageHandle texture);
+
+        //Draws everything submitted since begin_frame. Replayed recordings skip it, the shapes stay until end_frame.
+        void record_draw(VkCommandBuffer command_buffer, uint32_t frame, VkExtent2D extent){
+            (this->*m_record_draw)(command_buffer, frame, extent);
+        }
+        //The batch layout record_draw turns into commands. Instance data lives in the buffer, so moving
+        //shapes around keeps the hash as long as their number and textures stay. See CommandCache.
+        void hash_state(utils::Hasher& hasher, uint32_t frame) const;
+
+        //After the frame's submit, whether its pass was recorded or replayed. Immediate mode, nothing carries
+        //over to the next time this frame comes around.
+        void end_frame(uint32_t frame);
+
+        //Shapes the last submitted frame drew
+        ShapeStats get_stats() const { return m_submitted; }
+
+    private:
+        struct Batch {
+            ImageHandle texture;
+            uint32_t first_instance;
+            uint32_t instance_count;
+        };
+
+        //Per frame in flight, persistently mapped
+        struct FrameBuffers {
+            BufferHandle instances;
+            ShapeInstance* mapped = nullptr;
+            uint32_t capacity = 0;
+            uint32_t count = 0;
+            std::vector<Batch> batches;
+            //Released while this frame was current, free again when it comes around
+            std::vector<VkDescriptorSet> released_sets;
+            std::vector<uint16_t> released_slots;
+        };
+
+        VkDevice m_device = VK_NULL_HANDLE;
+        evResources* m_resources = nullptr;
+        Pipeline m_pipeline_builder;
+        PipelineHandle m_pipeline;
+
+        DescriptorTier m_descriptors = DescriptorTier::Classic;
+        VkMemoryPropertyFlags m_streaming_memory = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+        using AllocateFunction = ShapeInstance* (ShapeRenderer::*)(uint32_t, ImageHandle);
+        using RecordFunction = void (ShapeRenderer::*)(VkCommandBuffer, uint32_t, VkExtent2D);
+        //Instantiations for the device's descriptor tier, picked once in init
+        AllocateFunction m_allocate = nullptr;
+        RecordFunction m_record_draw = nullptr;
+
+        VkDescriptorSetLayout m_set_layout = VK_NULL_HANDLE;
+        VkDescriptorPool m_descriptor_pool = VK_NULL_HANDLE;
+        VkSampler m_sampler = VK_NULL_HANDLE;
+        ImageHandle m_white_texture;
+        //Classic: one set per texture. Bindless: one set, textures get a slot in its array.
+        //Both keyed by handle value so a reused handle slot gets a fresh entry.
+        std::unordered_map<uint32_t, VkDescriptorSet> m_texture_sets;
+        //Sets of released textures, rewritten for the next texture instead of allocating
+        std::vector<VkDescriptorSet> m_free_sets;
+        VkDescriptorSet m_bindless_set = VK_NULL_HANDLE;
+        std::unordered_map<uint32_t, uint16_t> m_texture_slots;
+        //Bindless slots of released textures, taken before growing into unused slots
+        std::vector<uint16_t> m_free_slots;
+        uint16_t m_next_slot = 1;
+        //Guards the texture tables, sprites may be written from worker threads
+        std::mutex m_texture_mutex;
+
+        std::vector<FrameBuffers> m_frames;
+        uint32_t m_current_frame = 0;
+        ShapeStats m_submitted;
+
+        void grow(FrameBuffers& frame, uint32_t required);
+        VkDescriptorSet get_texture_set(ImageHandle texture);
+        void write_texture(VkDescriptorSet descriptor_set, uint32_t element, ImageHandle texture);
+
+        template<DescriptorTier Tier>
+        ShapeInstance* allocate_tier(uint32_t count, ImageHandle texture);
+        template<DescriptorTier Tier>
+        void record_draw_tier(VkCommandBuffer command_buffer, uint32_t frame, VkExtent2D extent);
+    };
+}
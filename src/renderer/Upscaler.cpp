@@ -0,0 +1,117 @@
+#include "Upscaler.h"
+#include <glm/glm.hpp>
+
+namespace evoke::vulkan {
+    namespace {
+        //Matches the push constant block in upscale.frag
+        struct UpscalePushConstants {
+            glm::vec2 uv_scale;
+            glm::vec2 texel_size;
+            float sharpness;
+        };
+    }
+
+    void Upscaler::init(VkDevice device, const VkSurfaceFormatKHR& surface_format, evResources& resources){
+        m_device = device;
+        m_resources = &resources;
+
+        VkDescriptorSetLayoutBinding source_binding{};
+        source_binding.binding = 0;
+        source_binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        source_binding.descriptorCount = 1;
+        source_binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+        m_set_layout = resources.get_set_layout({source_binding});
+
+        VkDescriptorPoolSize pool_size{};
+        pool_size.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        pool_size.descriptorCount = 1;
+
+        VkDescriptorPoolCreateInfo pool_info{};
+        pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        pool_info.maxSets = 1;
+        pool_info.poolSizeCount = 1;
+        pool_info.pPoolSizes = &pool_size;
+
+        if (vkCreateDescriptorPool(device, &pool_info, nullptr, &m_descriptor_pool) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create upscale descriptor pool!");
+        }
+
+        VkDescriptorSetAllocateInfo alloc_info{};
+        alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        alloc_info.descriptorPool = m_descriptor_pool;
+        alloc_info.descriptorSetCount = 1;
+        alloc_info.pSetLayouts = &m_set_layout;
+
+        if (vkAllocateDescriptorSets(device, &alloc_info, &m_descriptor_set) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate upscale descriptor set!");
+        }
+
+        //Clamped, the shader keeps its taps inside the rendered corner itself
+        VkSamplerCreateInfo sampler_info{};
+        sampler_info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+        sampler_info.magFilter = VK_FILTER_LINEAR;
+        sampler_info.minFilter = VK_FILTER_LINEAR;
+        sampler_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+        sampler_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        sampler_info.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        sampler_info.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+
+        if (vkCreateSampler(device, &sampler_info, nullptr, &m_sampler) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create upscale sampler!");
+        }
+
+        //No vertex input, the triangle comes from gl_VertexIndex
+        GraphicsPipelineConfig config{};
+        config.shaders = {
+            {VK_SHADER_STAGE_VERTEX_BIT, "upscale_vert.spv"},
+            {VK_SHADER_STAGE_FRAGMENT_BIT, "upscale_frag.spv"}
+        };
+        config.set_layouts = {m_set_layout};
+        config.push_constant_stages = VK_SHADER_STAGE_FRAGMENT_BIT;
+        config.push_constant_size = sizeof(UpscalePushConstants);
+        config.cull_mode = VK_CULL_MODE_NONE;
+        config.blend = BlendMode::None;
+
+        m_pipeline = m_pipeline_builder.create_graphics_pipeline(device, surface_format, config, resources);
+    }
+
+    void Upscaler::clean_up(){
+        m_descriptor_set = VK_NULL_HANDLE;
+        vkDestroySampler(m_device, m_sampler, nullptr);
+        vkDestroyDescriptorPool(m_device, m_descriptor_pool, nullptr);
+    }
+
+    void Upscaler::set_source(ImageHandle source, VkExtent2D extent){
+        m_source_extent = extent;
+
+        VkDescriptorImageInfo image_info{};
+        image_info.sampler = m_sampler;
+        image_info.imageView = m_resources->get(source).view;
+        image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+        VkWriteDescriptorSet write{};
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstSet = m_descriptor_set;
+        write.dstBinding = 0;
+        write.descriptorCount = 1;
+        write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        write.pImageInfo = &image_info;
+        vkUpdateDescriptorSets(m_device, 1, &write, 0, nullptr);
+    }
+
+    void Upscaler::record(VkCommandBuffer command_buffer, VkExtent2D render_extent, float sharpness){
+        const evPipeline& pipeline = m_resources->get(m_pipeline);
+        vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.handle);
+        vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.layout, 0, 1, &m_descriptor_set, 0, nullptr);
+
+        UpscalePushConstants push_constants{};
+        push_constants.uv_scale = glm::vec2(
+            static_cast<float>(render_extent.width) / static_cast<float>(m_source_extent.width),
+            static_cast<float>(render_extent.height) / static_cast<float>(m_source_extent.height));
+        push_constants.texel_size = glm::vec2(1.0f / static_cast<float>(m_source_extent.width), 1.0f / static_cast<float>(m_source_extent.height));
+        push_constants.sharpness = sharpness;
+        vkCmdPushConstants(command_buffer, pipeline.layout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(push_constants), &push_constants);
+
+        vkCmdDraw(command_buffer, 3, 1, 0, 0);
+    }
+}
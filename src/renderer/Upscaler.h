@@ -0,0 +1,39 @@
+#pragma once
+#include "VulkanPipeline.h"
+#include "evResources.h"
+#include "../utils/Hasher.h"
+
+namespace evoke::vulkan {
+    //Composites the scene rendered at a reduced scale into the swapchain image: a full screen triangle
+    //samples the rendered corner of the source bilinearly and sharpens it, weaker where the
+    //neighbourhood already has contrast so edges do not ring.
+    class Upscaler {
+    public:
+        void init(VkDevice device, const VkSurfaceFormatKHR& surface_format, evResources& resources);
+        void clean_up();
+
+        //Full size of the source image, which must be in SHADER_READ_ONLY_OPTIMAL when recorded.
+        //The GPU must no longer use the previous source.
+        void set_source(ImageHandle source, VkExtent2D extent);
+
+        //Inside a rendering pass on the target, render_extent is the part of the source the scene covers
+        void record(VkCommandBuffer command_buffer, VkExtent2D render_extent, float sharpness);
+        //Everything record reads besides the arguments, see CommandCache
+        void hash_state(utils::Hasher& hasher) const {
+            hasher.add(m_pipeline).add(m_descriptor_set).add(m_source_extent);
+        }
+
+    private:
+        VkDevice m_device = VK_NULL_HANDLE;
+        evResources* m_resources = nullptr;
+        Pipeline m_pipeline_builder;
+        PipelineHandle m_pipeline;
+
+        VkDescriptorSetLayout m_set_layout = VK_NULL_HANDLE;
+        VkDescriptorPool m_descriptor_pool = VK_NULL_HANDLE;
+        VkDescriptorSet m_descriptor_set = VK_NULL_HANDLE;
+        VkSampler m_sampler = VK_NULL_HANDLE;
+
+        VkExtent2D m_source_extent{};
+    };
+}
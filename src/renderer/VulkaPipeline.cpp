@@ -1,38 +1,226 @@
 #include "VulkanPipeline.h"
-#include "../utils/VulkanUtils.h"
+#include "ShaderLibrary.h"
 #include "../shapes/Vertex.h"
 
 namespace evoke::vulkan {
-    void Pipeline::create_pipeline(VkDevice device, const VkSurfaceFormatKHR& surface_format){
+    namespace {
+        ShaderReflection reflect(std::span<const uint32_t> code){
+            return reflect_spirv(code.data(), code.size());
+        }
+
+        struct DepthState {
+            bool test;
+            bool write;
+            VkCompareOp compare;
+        };
+
+        //Reverse-Z, the shading pass after a pre-pass only keeps the fragments the pre-pass left
+        DepthState depth_state(DepthPass pass){
+            if (pass == DepthPass::Shade) {
+                return {true, false, VK_COMPARE_OP_EQUAL};
+            }
+            return {true, true, VK_COMPARE_OP_GREATER_OR_EQUAL};
+        }
+
+        void apply_depth_state(GraphicsPipelineConfig& config, DepthPass pass){
+            DepthState depth = depth_state(pass);
+            config.depth_test = depth.test;
+            config.depth_write = depth.write;
+            config.depth_compare = depth.compare;
+            config.depth_only = pass == DepthPass::Prepass;
+        }
+
+        VkPipelineColorBlendAttachmentState blend_attachment(BlendMode blend){
+            VkPipelineColorBlendAttachmentState attachment{};
+            attachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+            attachment.blendEnable = blend != BlendMode::None;
+            attachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+            attachment.dstColorBlendFactor = blend == BlendMode::Additive ? VK_BLEND_FACTOR_ONE : VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+            attachment.colorBlendOp = VK_BLEND_OP_ADD;
+            attachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+            attachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+            attachment.alphaBlendOp = VK_BLEND_OP_ADD;
+            return attachment;
+        }
+    }
+
+    OpaquePipelines Pipeline::create_pipeline(VkDevice device, const VkSurfaceFormatKHR& surface_format, VkFormat depth_format, evResources& resources, StateTier state){
+        //Vertex input comes from vert.spv, the stride check catches the shader and Vertex drifting apart
+        GraphicsPipelineConfig config{};
+        config.shaders = {
+            {VK_SHADER_STAGE_VERTEX_BIT, "vert.spv"},
+            {VK_SHADER_STAGE_FRAGMENT_BIT, "frag.spv"}
+        };
+        config.vertex_stride = sizeof(Vertex);
+        config.depth_format = depth_format;
+        config.state = state;
+        
+        return create_opaque_pipelines(device, surface_format, config, resources);
+    }
+    
+    OpaquePipelines Pipeline::create_opaque_pipelines(VkDevice device, const VkSurfaceFormatKHR& surface_format, const GraphicsPipelineConfig& config, evResources& resources){
+        OpaquePipelines pipelines;
+        pipelines.state = config.state;
+        pipelines.cull_mode = config.cull_mode;
+        pipelines.front_face = config.front_face;
+        pipelines.blend = config.blend;
+        
+        if (config.state == StateTier::DynamicBlend && m_set_color_blend_enable == nullptr) {
+            m_set_color_blend_enable = reinterpret_cast<PFN_vkCmdSetColorBlendEnableEXT>(vkGetDeviceProcAddr(device, "vkCmdSetColorBlendEnableEXT"));
+            m_set_color_blend_equation = reinterpret_cast<PFN_vkCmdSetColorBlendEquationEXT>(vkGetDeviceProcAddr(device, "vkCmdSetColorBlendEquationEXT"));
+        }
+        
+        GraphicsPipelineConfig single = config;
+        apply_depth_state(single, DepthPass::Single);
+        pipelines.single = create_graphics_pipeline(device, surface_format, single, resources);
+        
+        GraphicsPipelineConfig prepass = config;
+        apply_depth_state(prepass, DepthPass::Prepass);
+        pipelines.prepass = create_graphics_pipeline(device, surface_format, prepass, resources);
+        
+        //Same vertex stage as the pre-pass, the shaders declare gl_Position invariant so depths match exactly.
+        //Only the depth state differs from single, which bind_opaque sets when it is dynamic.
+        if (config.state == StateTier::Static) {
+            GraphicsPipelineConfig shade = config;
+            apply_depth_state(shade, DepthPass::Shade);
+            pipelines.shade = create_graphics_pipeline(device, surface_format, shade, resources);
+        } else {
+            pipelines.shade = pipelines.single;
+        }
+        
+        return pipelines;
+    }
+    
+    void Pipeline::bind_opaque(VkCommandBuffer command_buffer, const OpaquePipelines& pipelines, DepthPass pass, const evResources& resources) const{
+        vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, resources.get(pipelines.get(pass)).handle);
+        if (pipelines.state == StateTier::Static) {
+            return;
+        }
+        
+        DepthState depth = depth_state(pass);
+        vkCmdSetCullMode(command_buffer, pipelines.cull_mode);
+        vkCmdSetFrontFace(command_buffer, pipelines.front_face);
+        vkCmdSetDepthTestEnable(command_buffer, depth.test ? VK_TRUE : VK_FALSE);
+        vkCmdSetDepthWriteEnable(command_buffer, depth.write ? VK_TRUE : VK_FALSE);
+        vkCmdSetDepthCompareOp(command_buffer, depth.compare);
+        
+        //The pre-pass has no color attachment to blend
+        if (pipelines.state == StateTier::DynamicBlend && pass != DepthPass::Prepass) {
+            VkPipelineColorBlendAttachmentState attachment = blend_attachment(pipelines.blend);
+            
+            VkColorBlendEquationEXT equation{};
+            equation.srcColorBlendFactor = attachment.srcColorBlendFactor;
+            equation.dstColorBlendFactor = attachment.dstColorBlendFactor;
+            equation.colorBlendOp = attachment.colorBlendOp;
+            equation.srcAlphaBlendFactor = attachment.srcAlphaBlendFactor;
+            equation.dstAlphaBlendFactor = attachment.dstAlphaBlendFactor;
+            equation.alphaBlendOp = attachment.alphaBlendOp;
+            
+            m_set_color_blend_enable(command_buffer, 0, 1, &attachment.blendEnable);
+            m_set_color_blend_equation(command_buffer, 0, 1, &equation);
+        }
+    }
+    
+    PipelineHandle Pipeline::create_graphics_pipeline(VkDevice device, const VkSurfaceFormatKHR& surface_format, const GraphicsPipelineConfig& config, evResources& resources){
         utils::Logger::info("Creating grapics pipeline!");
         
-        auto vert_shader_code = read_file("../src/shaders/vert.spv");
-        auto frag_shader_code = read_file("../src/shaders/frag.spv");
+        VkPipelineLayout pipeline_layout;
+        VkPipeline graphics_pipeline = build_graphics_pipeline(device, surface_format, config, resources, pipeline_layout);
+        PipelineHandle handle = resources.add_pipeline(graphics_pipeline, pipeline_layout, false);
         
-        auto bindingDescription = Vertex::getBindingDescription();
-        auto attributeDescriptions = Vertex::getAttributeDescriptions();
+        ShaderLibrary& library = resources.get_shader_library();
+        if (library.hot_reload_enabled()) {
+            std::vector<std::string> shaders;
+            for (const auto& [stage, name] : config.shaders) {
+                shaders.push_back(name);
+            }
+            library.track(handle, std::move(shaders), [device, surface_format, config, handle, &resources] {
+                VkPipelineLayout layout;
+                VkPipeline pipeline = build_graphics_pipeline(device, surface_format, config, resources, layout);
+                resources.replace_pipeline(handle, pipeline, layout, false);
+            });
+        }
         
-        VkShaderModule vert_shader_module = create_shader_module(vert_shader_code, device);
-        VkShaderModule frag_shader_module = create_shader_module(frag_shader_code, device);
+        utils::Logger::info("Graphics pipeline created successfully!");
         
-        VkPipelineShaderStageCreateInfo vert_shader_stage_info{};
-        vert_shader_stage_info.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-        vert_shader_stage_info.stage = VK_SHADER_STAGE_VERTEX_BIT;
-        vert_shader_stage_info.module = vert_shader_module;
-        vert_shader_stage_info.pName = "main";
+        return handle;
+    }
+    
+    VkPipeline Pipeline::build_graphics_pipeline(VkDevice device, const VkSurfaceFormatKHR& surface_format, const GraphicsPipelineConfig& config, evResources& resources, VkPipelineLayout& layout){
+        ShaderLibrary& library = resources.get_shader_library();
+        VkSpecializationInfo specialization_info = config.specialization.info();
         
-        VkPipelineShaderStageCreateInfo frag_shader_stage_info{};
-        frag_shader_stage_info.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-        frag_shader_stage_info.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-        frag_shader_stage_info.module = frag_shader_module;
-        frag_shader_stage_info.pName = "main";
+        //Reflection first, it throws on shaders that do not fit and nothing is created yet
+        std::vector<ShaderReflection> reflections;
+        bool has_mesh_stage = false;
+        
+        //Depth only pipelines rasterize without a fragment stage
+        std::vector<std::pair<VkShaderStageFlagBits, std::string>> stages;
+        for (const auto& shader : config.shaders) {
+            if (!config.depth_only || shader.first != VK_SHADER_STAGE_FRAGMENT_BIT) {
+                stages.push_back(shader);
+            }
+        }
+        
+        for (const auto& [stage, name] : stages) {
+            reflections.push_back(reflect(library.get(name)));
+            has_mesh_stage |= stage == VK_SHADER_STAGE_MESH_BIT_EXT;
+        }
         
-        VkPipelineShaderStageCreateInfo shader_stages[] = {vert_shader_stage_info, frag_shader_stage_info};
+        PipelineReflection reflection = merge_reflections(reflections);
+        
+        std::vector<VkVertexInputBindingDescription> bindings = config.bindings;
+        std::vector<VkVertexInputAttributeDescription> attributes = config.attributes;
+        if (!has_mesh_stage && bindings.empty() && attributes.empty()) {
+            make_vertex_input(reflection.inputs, bindings, attributes, config.instance_location);
+            if (config.vertex_stride > 0 && (bindings.empty() || bindings[0].stride != config.vertex_stride)) {
+                throw std::runtime_error("vertex shader inputs do not match the vertex struct!");
+            }
+        }
+        
+        VkPushConstantRange push_constant_range{};
+        push_constant_range.stageFlags = config.push_constant_stages;
+        push_constant_range.offset = 0;
+        push_constant_range.size = config.push_constant_size;
+        
+        layout = get_layout(reflection, config.set_layouts, push_constant_range, resources);
+        
+        std::vector<VkShaderModule> shader_modules;
+        std::vector<VkPipelineShaderStageCreateInfo> shader_stages;
+        
+        for (const auto& [stage, name] : stages) {
+            VkShaderModule shader_module = create_shader_module(library.get(name), device);
+            shader_modules.push_back(shader_module);
+            
+            VkPipelineShaderStageCreateInfo shader_stage_info{};
+            shader_stage_info.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+            shader_stage_info.stage = stage;
+            shader_stage_info.module = shader_module;
+            shader_stage_info.pName = "main";
+            shader_stage_info.pSpecializationInfo = config.specialization.empty() ? nullptr : &specialization_info;
+            shader_stages.push_back(shader_stage_info);
+        }
         
         std::vector<VkDynamicState> dynamic_states = {
             VK_DYNAMIC_STATE_VIEWPORT,
             VK_DYNAMIC_STATE_SCISSOR
         };
+        //Everything that varies between the permutations of a draw, one pipeline serves them all
+        if (config.state != StateTier::Static) {
+            dynamic_states.insert(dynamic_states.end(), {
+                VK_DYNAMIC_STATE_CULL_MODE,
+                VK_DYNAMIC_STATE_FRONT_FACE,
+                VK_DYNAMIC_STATE_DEPTH_TEST_ENABLE,
+                VK_DYNAMIC_STATE_DEPTH_WRITE_ENABLE,
+                VK_DYNAMIC_STATE_DEPTH_COMPARE_OP
+            });
+        }
+        if (config.state == StateTier::DynamicBlend && !config.depth_only) {
+            dynamic_states.insert(dynamic_states.end(), {
+                VK_DYNAMIC_STATE_COLOR_BLEND_ENABLE_EXT,
+                VK_DYNAMIC_STATE_COLOR_BLEND_EQUATION_EXT
+            });
+        }
 
         VkPipelineDynamicStateCreateInfo dynamic_state_info{};
         dynamic_state_info.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
@@ -41,10 +229,10 @@ namespace evoke::vulkan {
         
         VkPipelineVertexInputStateCreateInfo vertex_input_info{};
         vertex_input_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-        vertex_input_info.vertexBindingDescriptionCount = 1;
-        vertex_input_info.pVertexBindingDescriptions = &bindingDescription;
-        vertex_input_info.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
-        vertex_input_info.pVertexAttributeDescriptions = attributeDescriptions.data();
+        vertex_input_info.vertexBindingDescriptionCount = static_cast<uint32_t>(bindings.size());
+        vertex_input_info.pVertexBindingDescriptions = bindings.data();
+        vertex_input_info.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributes.size());
+        vertex_input_info.pVertexAttributeDescriptions = attributes.data();
         
         VkPipelineInputAssemblyStateCreateInfo input_assembly{};
         input_assembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
@@ -62,8 +250,8 @@ namespace evoke::vulkan {
         rasterizer.rasterizerDiscardEnable = VK_FALSE;
         rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
         rasterizer.lineWidth = 1.0f;
-        rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
-        rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
+        rasterizer.cullMode = config.cull_mode;
+        rasterizer.frontFace = config.front_face;
         rasterizer.depthBiasEnable = VK_FALSE;
         rasterizer.depthBiasConstantFactor = 0.0f; // Optional
         rasterizer.depthBiasClamp = 0.0f; // Optional
@@ -78,80 +266,145 @@ namespace evoke::vulkan {
         multisampling.alphaToCoverageEnable = VK_FALSE; // Optional
         multisampling.alphaToOneEnable = VK_FALSE; // Optional
         
-        VkPipelineColorBlendAttachmentState color_blend_attachment{};
-        color_blend_attachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-        color_blend_attachment.blendEnable = VK_TRUE;
-        color_blend_attachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
-        color_blend_attachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
-        color_blend_attachment.colorBlendOp = VK_BLEND_OP_ADD;
-        color_blend_attachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
-        color_blend_attachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
-        color_blend_attachment.alphaBlendOp = VK_BLEND_OP_ADD;
+        VkPipelineColorBlendAttachmentState color_blend_attachment = blend_attachment(config.blend);
         
         VkPipelineColorBlendStateCreateInfo color_blending{};
         color_blending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
         color_blending.logicOpEnable = VK_FALSE;
         color_blending.logicOp = VK_LOGIC_OP_COPY; // Optional
-        color_blending.attachmentCount = 1;
+        color_blending.attachmentCount = config.depth_only ? 0 : 1;
         color_blending.pAttachments = &color_blend_attachment;
         color_blending.blendConstants[0] = 0.0f; // Optional
         color_blending.blendConstants[1] = 0.0f; // Optional
         color_blending.blendConstants[2] = 0.0f; // Optional
         color_blending.blendConstants[3] = 0.0f; // Optional
         
-        VkPipelineLayoutCreateInfo pipeline_layout_info{};
-        pipeline_layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-        pipeline_layout_info.setLayoutCount = 0; // Optional
-        pipeline_layout_info.pSetLayouts = nullptr; // Optional
-        pipeline_layout_info.pushConstantRangeCount = 0; // Optional
-        pipeline_layout_info.pPushConstantRanges = nullptr; // Optional
-
-        if (vkCreatePipelineLayout(device, &pipeline_layout_info, nullptr, &m_pipeline_layout) != VK_SUCCESS) {
-            throw std::runtime_error("failed to create pipeline layout!");
-        }
+        VkPipelineDepthStencilStateCreateInfo depth_stencil{};
+        depth_stencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+        depth_stencil.depthTestEnable = config.depth_test ? VK_TRUE : VK_FALSE;
+        depth_stencil.depthWriteEnable = config.depth_write ? VK_TRUE : VK_FALSE;
+        depth_stencil.depthCompareOp = config.depth_test ? config.depth_compare : VK_COMPARE_OP_ALWAYS;
+        depth_stencil.depthBoundsTestEnable = VK_FALSE;
+        depth_stencil.stencilTestEnable = VK_FALSE;
         
         VkPipelineRenderingCreateInfo pipeline_rendering_create_info{};
         pipeline_rendering_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
-        pipeline_rendering_create_info.colorAttachmentCount = 1;
+        pipeline_rendering_create_info.colorAttachmentCount = config.depth_only ? 0 : 1;
         pipeline_rendering_create_info.pColorAttachmentFormats = &surface_format.format;
+        pipeline_rendering_create_info.depthAttachmentFormat = config.depth_format;
         
         VkGraphicsPipelineCreateInfo pipeline_info{};
         pipeline_info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
         pipeline_info.pNext = &pipeline_rendering_create_info;
-        pipeline_info.stageCount = 2;
-        pipeline_info.pStages = shader_stages;
-        pipeline_info.pVertexInputState = &vertex_input_info;
-        pipeline_info.pInputAssemblyState = &input_assembly;
+        pipeline_info.stageCount = static_cast<uint32_t>(shader_stages.size());
+        pipeline_info.pStages = shader_stages.data();
+        //Mesh shader pipelines have no vertex input stage
+        pipeline_info.pVertexInputState = has_mesh_stage ? nullptr : &vertex_input_info;
+        pipeline_info.pInputAssemblyState = has_mesh_stage ? nullptr : &input_assembly;
         pipeline_info.pViewportState = &viewport_state_info;
         pipeline_info.pRasterizationState = &rasterizer;
         pipeline_info.pMultisampleState = &multisampling;
+        pipeline_info.pDepthStencilState = &depth_stencil;
         pipeline_info.pColorBlendState = &color_blending;
         pipeline_info.pDynamicState = &dynamic_state_info;
-        pipeline_info.layout = m_pipeline_layout;
+        pipeline_info.layout = layout;
         pipeline_info.renderPass = nullptr;
         
-        if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipeline_info, nullptr, &m_graphics_pipeline) != VK_SUCCESS) {
+        VkPipeline graphics_pipeline;
+        VkResult result = vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipeline_info, nullptr, &graphics_pipeline);
+        
+        for (VkShaderModule shader_module : shader_modules) {
+            vkDestroyShaderModule(device, shader_module, nullptr);
+        }
+        
+        if (result != VK_SUCCESS) {
             throw std::runtime_error("failed to create graphics pipeline!");
         }
         
-        utils::Logger::info("Graphics pipeline created successfully!");
+        return graphics_pipeline;
+    }
+    
+    PipelineHandle Pipeline::create_compute_pipeline(VkDevice device, const std::string& shader_name, uint32_t push_constant_size, evResources& resources, const SpecializationConstants& specialization){
+        utils::Logger::info("Creating compute pipeline!");
         
-        vkDestroyShaderModule(device, frag_shader_module, nullptr);
-        vkDestroyShaderModule(device, vert_shader_module, nullptr);
+        VkPipelineLayout pipeline_layout;
+        VkPipeline compute_pipeline = build_compute_pipeline(device, shader_name, push_constant_size, resources, specialization, pipeline_layout);
+        PipelineHandle handle = resources.add_pipeline(compute_pipeline, pipeline_layout, false);
+        
+        ShaderLibrary& library = resources.get_shader_library();
+        if (library.hot_reload_enabled()) {
+            library.track(handle, {shader_name}, [device, shader_name, push_constant_size, specialization, handle, &resources] {
+                VkPipelineLayout layout;
+                VkPipeline pipeline = build_compute_pipeline(device, shader_name, push_constant_size, resources, specialization, layout);
+                resources.replace_pipeline(handle, pipeline, layout, false);
+            });
+        }
+        
+        utils::Logger::info("Compute pipeline created successfully!");
+        
+        return handle;
+    }
+    
+    VkPipeline Pipeline::build_compute_pipeline(VkDevice device, const std::string& shader_name, uint32_t push_constant_size, evResources& resources, const SpecializationConstants& specialization, VkPipelineLayout& layout){
+        std::span<const uint32_t> shader_code = resources.get_shader_library().get(shader_name);
+        PipelineReflection reflection = merge_reflections({reflect(shader_code)});
+        
+        VkPushConstantRange push_constant_range{};
+        push_constant_range.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        push_constant_range.offset = 0;
+        push_constant_range.size = push_constant_size;
+        
+        layout = get_layout(reflection, {}, push_constant_range, resources);
+        
+        VkShaderModule shader_module = create_shader_module(shader_code, device);
+        VkSpecializationInfo specialization_info = specialization.info();
+        
+        VkPipelineShaderStageCreateInfo shader_stage_info{};
+        shader_stage_info.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        shader_stage_info.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        shader_stage_info.module = shader_module;
+        shader_stage_info.pName = "main";
+        shader_stage_info.pSpecializationInfo = specialization.empty() ? nullptr : &specialization_info;
+        
+        VkComputePipelineCreateInfo pipeline_info{};
+        pipeline_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipeline_info.stage = shader_stage_info;
+        pipeline_info.layout = layout;
+        
+        VkPipeline compute_pipeline;
+        VkResult result = vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipeline_info, nullptr, &compute_pipeline);
+        
+        vkDestroyShaderModule(device, shader_module, nullptr);
+        
+        if (result != VK_SUCCESS) {
+            throw std::runtime_error("failed to create compute pipeline!");
+        }
+        
+        return compute_pipeline;
     }
     
-    void Pipeline::clean_up(VkDevice device){
-        utils::Logger::info("Cleaning up graphics pipeline!");
-        vkDestroyPipeline(device, m_graphics_pipeline, nullptr);
-        vkDestroyPipelineLayout(device, m_pipeline_layout, nullptr);
-        utils::Logger::info("Graphics pipeline cleaned up successfully!");
+    VkPipelineLayout Pipeline::get_layout(const PipelineReflection& reflection, const std::vector<VkDescriptorSetLayout>& set_layouts, const VkPushConstantRange& push_constants, evResources& resources){
+        std::vector<VkDescriptorSetLayout> layouts = set_layouts;
+        if (layouts.empty()) {
+            //Sets the shaders skip still need a layout, the empty one is shared like any other
+            for (const auto& set : reflection.sets) {
+                layouts.push_back(resources.get_set_layout(set));
+            }
+        }
+        
+        VkPushConstantRange range = push_constants.size > 0 ? push_constants : reflection.push_constants;
+        if (range.size < reflection.push_constants.size) {
+            throw std::runtime_error("push constant range is smaller than the shader's block!");
+        }
+        
+        return resources.get_pipeline_layout(layouts, range);
     }
     
-    VkShaderModule Pipeline::create_shader_module(const std::vector<char>& bytecode, VkDevice device){
+    VkShaderModule Pipeline::create_shader_module(std::span<const uint32_t> code, VkDevice device){
         VkShaderModuleCreateInfo create_info{};
         create_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-        create_info.codeSize = bytecode.size();
-        create_info.pCode = reinterpret_cast<const uint32_t*>(bytecode.data());
+        create_info.codeSize = code.size_bytes();
+        create_info.pCode = code.data();
         
         VkShaderModule shader_module;
         if (vkCreateShaderModule(device, &create_info, nullptr, &shader_module) != VK_SUCCESS) {
@@ -1,22 +1,82 @@
 #include "VulkanCore.h"
+#include "../utils/Profiler.h"
+#include "../utils/Hasher.h"
+#include "../core/StartupGraph.h"
 #include <set>
 #include "../shapes/Vertex.h"
+#include "../shapes/Meshlet.h"
+#include "../shapes/MeshLod.h"
+#include "../shapes/MeshOptimizer.h"
+#include "PrimitiveBenchmark.h"
+#include <cstdlib>
 
 namespace evoke::vulkan {
-    void VulkanCore::init_vulkan(GLFWwindow *window){
-        create_instance();
-        create_surface(window);
-        ev_physical_device.init(m_instance, m_surface);
-        ev_device.init(ev_physical_device);
+    void VulkanCore::init_vulkan(GLFWwindow *window, core::Clock::time_point startup_start){
+        m_startup_start = startup_start;
+        m_job_system.init();
+        m_frame_arenas.init(m_job_system.get_thread_count(), MAX_FRAMES_IN_FLIGHT);
+        m_window = window;
         
-        create_command_pool();
-        create_vertex_buffer();
-        create_index_buffer();
-        create_sync_objects();
-        create_command_buffer();
+        //Serial up to the device, after that only real dependencies order the stages.
+        //Stages that overlap share nothing but evResources, the shader library and the queues.
+        core::StartupGraph startup;
+        core::StageId instance = startup.add("instance", {}, [this] { create_instance(); });
+        core::StageId surface = startup.add("surface", {instance}, [this, window] { create_surface(window); });
+        core::StageId device = startup.add("device", {surface}, [this] {
+            ev_physical_device.init(m_instance, m_surface, m_device_selection);
+            ev_device.init(ev_physical_device);
+            m_tiers = select_feature_tiers(ev_physical_device);
+            m_depth_format = ev_physical_device.get().depth_format;
+        });
+        core::StageId resources = startup.add("resources", {device}, [this] {
+            ev_resources.init(ev_device.get().handle, ev_physical_device.get().handle);
+            m_memory_budget.init(ev_physical_device.get().handle, ev_physical_device.get().feature_support.memory_budget);
+            ev_resources.set_memory_budget(&m_memory_budget);
+            m_shader_library.init();
+            ev_resources.set_shader_library(&m_shader_library);
+            m_readback.init(ev_resources);
+            //Cheapest first: pooled staging is reallocated on demand
+            m_memory_budget.add_eviction([this](uint32_t heap, VkDeviceSize) { return m_readback.trim(heap); });
+        });
+        core::StageId queues = startup.add("queues", {resources}, [this] {
+            m_frame_pacer.init(ev_device.get().handle, ev_physical_device, MAX_FRAMES_IN_FLIGHT);
+            m_queues.init(ev_device, ev_physical_device);
+            ev_resources.set_queue_families(m_queues.get_families());
+        });
+        core::StageId commands = startup.add("commands", {device}, [this] {
+            create_command_pool();
+            create_command_buffer();
+            create_sync_objects();
+        });
+        startup.add("uploads", {queues, commands}, [this] { create_quad_buffers(); });
+        core::StageId swapchain = startup.add("swapchain", {device}, [this, window] {
+            ev_swapchain.init(ev_device.get().handle, ev_physical_device, m_surface, window);
+        });
+        core::StageId upscaler = startup.add("upscaler", {resources, swapchain}, [this] {
+            m_upscaler.init(ev_device.get().handle, ev_swapchain.get().surface_format, ev_resources);
+        });
+        startup.add("render_targets", {upscaler}, [this] { create_render_targets(); });
+        startup.add("lighting", {resources}, [this] {
+            m_lighting.init(ev_device.get().handle, m_tiers, ev_resources, m_readback, MAX_FRAMES_IN_FLIGHT);
+        });
+        startup.add("pipelines", {resources, swapchain}, [this] {
+            m_graphics_pipelines = m_pipeline.create_pipeline(ev_device.get().handle, ev_swapchain.get().surface_format, m_depth_format, ev_resources, m_tiers.state);
+        });
+        if (const char* benchmark = std::getenv("EVOKE_PRIMITIVE_BENCHMARK")) {
+            //Element count, any non-number runs the default
+            uint32_t count = static_cast<uint32_t>(std::strtoul(benchmark, nullptr, 10));
+            startup.add("primitive_benchmark", {queues}, [this, count] {
+                for (const PrimitiveBenchmarkResult& result : benchmark_primitives(ev_device.get().handle, ev_physical_device, ev_resources, m_queues, count > 0 ? count : 1u << 20)) {
+                    if (!result.matches_reference) {
+                        utils::Logger::error("Primitive benchmark: ", result.name, " does not match the CPU reference!");
+                    }
+                    utils::Logger::info("Primitive benchmark: ", result.name, ", ", result.count, " elements in ", result.milliseconds, " ms, ", result.keys_per_second / 1e6, " M/s!");
+                }
+            });
+        }
         
-        ev_swapchain.init(ev_device.get().handle, ev_physical_device, m_surface, window);
-        m_pipeline.create_pipeline(ev_device.get().handle, ev_swapchain.get().surface_format);
+        startup.run(m_job_system);
+        startup.report();
     }
     
     void VulkanCore::clean_up(){
@@ -24,6 +84,10 @@ namespace evoke::vulkan {
                 vkDeviceWaitIdle(ev_device.get().handle);
             }
         
+        //Hand out what the last frames read back so captures end with the final frame
+        m_readback.poll(UINT64_MAX);
+        m_frame_capture.stop();
+        
         utils::Logger::info("Cleaning up semaphores and fences!");
         for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
                 vkDestroySemaphore(ev_device.get().handle, m_render_finished_semaphores[i], nullptr);
@@ -36,15 +100,27 @@ namespace evoke::vulkan {
         vkDestroyCommandPool(ev_device.get().handle, m_command_pool, nullptr);
         utils::Logger::info("Command pool cleaned up successfully!");
         
-        m_pipeline.clean_up(ev_device.get().handle);
-        
         ev_swapchain.clean_up(ev_device.get().handle);
+        m_scene_passes.clean_up();
+        m_composite_passes.clean_up();
         
-        vkDestroyBuffer(ev_device.get().handle, m_index_buffer, nullptr);
-        vkFreeMemory(ev_device.get().handle, m_index_buffer_memory, nullptr);
-        
-        vkDestroyBuffer(ev_device.get().handle, m_vertex_buffer, nullptr);
-        vkFreeMemory(ev_device.get().handle, m_vertex_buffer_memory, nullptr);
+        if (m_shape_renderer_ready) {
+            m_shape_renderer.clean_up();
+        }
+        if (m_particle_system_ready) {
+            m_particle_system.clean_up();
+        }
+        for (const ReleasedTexture& released : m_released_textures) {
+            ev_resources.destroy_image(released.texture);
+        }
+        m_released_textures.clear();
+        m_upscaler.clean_up();
+        m_lighting.clean_up();
+        m_readback.clean_up();
+        m_shader_library.clean_up();
+        ev_resources.clean_up();
+        m_frame_pacer.clean_up();
+        m_queues.clean_up();
         
         utils::Logger::info("Cleaning up logical device!");
         ev_device.clean_up();
@@ -57,6 +133,8 @@ namespace evoke::vulkan {
         utils::Logger::info("Cleaning up vulkan instance!");
         vkDestroyInstance(m_instance, nullptr);
         utils::Logger::info("Vulkan instance cleaned up successfully!");
+        
+        m_job_system.clean_up();
     }
     
     void VulkanCore::create_instance(){
@@ -141,23 +219,145 @@ namespace evoke::vulkan {
             throw std::runtime_error("failed to begin recording command buffer!");
         }
         
+        m_frame_pacer.record_begin(command_buffer, m_current_frame);
+        
+        //Changed instance transforms, scattered before any pass draws them
+        if (m_lod_renderer_ready) {
+            m_lod_renderer.record_upload(command_buffer, m_current_frame);
+        }
+        m_lighting.record_binning(command_buffer, m_current_frame);
+        
+        //Unchanged passes replay their last recording, only this primary is recorded every frame
+        if (!m_incremental_recording) {
+            m_scene_passes.invalidate();
+            m_composite_passes.invalidate();
+        }
+        VkCommandBuffer passes[] = {record_scene_pass(), record_composite_pass(image_index)};
+        vkCmdExecuteCommands(command_buffer, 2, passes);
+        
+        bool read_image = record_readbacks(command_buffer, image_index);
+        
         transition_image_layout(
             command_buffer,
             image_index,
+            read_image ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+            VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+            read_image ? VK_ACCESS_2_TRANSFER_READ_BIT : VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+            0,
+            read_image ? VK_PIPELINE_STAGE_2_COPY_BIT : VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+            VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT
+        );
+        
+        m_frame_pacer.record_end(command_buffer, m_current_frame);
+        
+        vkEndCommandBuffer(command_buffer);
+    }
+    
+    VkCommandBuffer VulkanCore::record_scene_pass(){
+        VkExtent2D extent = ev_swapchain.get().extent;
+        glm::mat4 view_proj = m_camera.view_projection(static_cast<float>(extent.width) / static_cast<float>(extent.height));
+        bool depth_prepass = m_depth_prepass;
+        
+        //Everything the recording below reads
+        utils::Hasher hasher;
+        hasher.add(view_proj).add(m_camera.position).add(m_render_extent).add(depth_prepass);
+        hasher.add(m_depth_image).add(m_scene_color).add(m_graphics_pipelines).add(m_vertex_buffer).add(m_index_buffer).add(m_index_type).add(m_index_count);
+        hasher.add(m_meshlet_renderer_ready).add(m_lod_renderer_ready).add(m_particle_system_ready);
+        hasher.add(m_lighting.get_descriptor_set(m_current_frame));
+        if (m_meshlet_renderer_ready) {
+            m_meshlet_renderer.hash_state(hasher);
+        }
+        if (m_lod_renderer_ready) {
+            m_lod_renderer.hash_state(hasher, m_current_frame);
+        }
+        if (m_particle_system_ready) {
+            hasher.add(m_camera.view());
+            m_particle_system.hash_state(hasher);
+        }
+        
+        VkCommandBuffer command_buffer;
+        if (!m_scene_passes.begin(m_current_frame, hasher.get(), command_buffer)) {
+            return command_buffer;
+        }
+        
+        if (m_meshlet_renderer_ready) {
+            m_meshlet_renderer.record_cull(command_buffer, view_proj, m_camera.position);
+        }
+        
+        //Last frame's upscale pass read the scene color, its depth is no longer needed
+        transition_render_target(
+            command_buffer,
+            m_scene_color,
+            VK_IMAGE_ASPECT_COLOR_BIT,
             VK_IMAGE_LAYOUT_UNDEFINED,
             VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
             0,
             VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
-            VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+            VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
             VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT
         );
+        transition_render_target(
+            command_buffer,
+            m_depth_image,
+            VK_IMAGE_ASPECT_DEPTH_BIT,
+            VK_IMAGE_LAYOUT_UNDEFINED,
+            VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
+            VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+            VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+            VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+            VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT
+        );
+        
+        //The scene covers the top left corner of the render targets, sized by the resolution scaler
+        set_viewport(command_buffer, m_render_extent);
+        
+        //Reverse-Z, 0 is the far plane
+        VkClearValue clear_depth = { .depthStencil = { 0.0f, 0 } };
+        
+        VkRenderingAttachmentInfo depth_attachment_info{};
+        depth_attachment_info.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+        depth_attachment_info.imageView = ev_resources.get(m_depth_image).view;
+        depth_attachment_info.imageLayout = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL;
+        depth_attachment_info.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        depth_attachment_info.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        depth_attachment_info.clearValue = clear_depth;
+        
+        if (depth_prepass) {
+            depth_attachment_info.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+            
+            VkRenderingInfo prepass_info{};
+            prepass_info.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+            prepass_info.renderArea = { .offset = { 0, 0 }, .extent = m_render_extent };
+            prepass_info.layerCount = 1;
+            prepass_info.pDepthAttachment = &depth_attachment_info;
+            
+            vkCmdBeginRendering(command_buffer, &prepass_info);
+            record_opaque_draws(command_buffer, view_proj, DepthPass::Prepass);
+            vkCmdEndRendering(command_buffer);
+            
+            transition_render_target(
+                command_buffer,
+                m_depth_image,
+                VK_IMAGE_ASPECT_DEPTH_BIT,
+                VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
+                VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
+                VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT,
+                VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+                VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT
+            );
+            
+            //The main pass only tests against the pre-pass result
+            depth_attachment_info.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+            depth_attachment_info.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        }
         
         VkClearValue clear_color = { .color = { .float32 = { 0.5f, 0.9f, 0.6f, 1.0f } } };
 
         VkRenderingAttachmentInfo color_attachment_info{};
         color_attachment_info.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
         color_attachment_info.pNext = NULL;
-        color_attachment_info.imageView = ev_swapchain.get().image_views[image_index];
+        color_attachment_info.imageView = ev_resources.get(m_scene_color).view;
         color_attachment_info.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
         color_attachment_info.resolveMode = VK_RESOLVE_MODE_NONE;
         color_attachment_info.resolveImageView = VK_NULL_HANDLE;
@@ -170,132 +370,431 @@ namespace evoke::vulkan {
         rendering_info.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
         rendering_info.pNext = NULL;
         rendering_info.flags = 0;
-        rendering_info.renderArea = { .offset = { 0, 0 }, .extent = ev_swapchain.get().extent };
+        rendering_info.renderArea = { .offset = { 0, 0 }, .extent = m_render_extent };
         rendering_info.layerCount = 1;
         rendering_info.viewMask = 0;
         rendering_info.colorAttachmentCount = 1;
         rendering_info.pColorAttachments = &color_attachment_info;
-        rendering_info.pDepthAttachment = NULL;
+        rendering_info.pDepthAttachment = &depth_attachment_info;
         rendering_info.pStencilAttachment = NULL;
         
         vkCmdBeginRendering(command_buffer, &rendering_info);
         
-        vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline.get_graphics_pipeline());
+        record_opaque_draws(command_buffer, view_proj, depth_prepass ? DepthPass::Shade : DepthPass::Single);
         
-        VkBuffer vertexBuffers[] = {m_vertex_buffer};
-        VkDeviceSize offsets[] = {0};
-        vkCmdBindVertexBuffers(command_buffer, 0, 1, vertexBuffers, offsets);
-        vkCmdBindIndexBuffer(command_buffer, m_index_buffer, 0, VK_INDEX_TYPE_UINT16);
+        //Blended, so after the opaque geometry
+        if (m_particle_system_ready) {
+            m_particle_system.record_draw(command_buffer, m_camera.view(), view_proj);
+        }
         
-        VkViewport viewport{};
-        viewport.x = 0.0f;
-        viewport.y = 0.0f;
-        viewport.width = static_cast<float>(ev_swapchain.get().extent.width);
-        viewport.height = static_cast<float>(ev_swapchain.get().extent.height);
-        viewport.minDepth = 0.0f;
-        viewport.maxDepth = 1.0f;
-        vkCmdSetViewport(command_buffer, 0, 1, &viewport);
-
-        VkRect2D scissor{};
-        scissor.offset = {0, 0};
-        scissor.extent = ev_swapchain.get().extent;
-        vkCmdSetScissor(command_buffer, 0, 1, &scissor);
+        vkCmdEndRendering(command_buffer);
+        
+        transition_render_target(
+            command_buffer,
+            m_scene_color,
+            VK_IMAGE_ASPECT_COLOR_BIT,
+            VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+            VK_ACCESS_2_SHADER_SAMPLED_READ_BIT,
+            VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+            VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT
+        );
         
-        vkCmdDrawIndexed(command_buffer, static_cast<uint32_t>(indices.size()), 1, 0, 0, 0);
+        vkEndCommandBuffer(command_buffer);
+        return command_buffer;
+    }
+    
+    VkCommandBuffer VulkanCore::record_composite_pass(uint32_t image_index){
+        VkExtent2D extent = ev_swapchain.get().extent;
+        float sharpness = m_resolution.get_sharpness();
         
-        vkCmdEndRendering(command_buffer);
+        utils::Hasher hasher;
+        hasher.add(extent).add(m_render_extent).add(sharpness).add(m_shape_renderer_ready);
+        m_upscaler.hash_state(hasher);
+        if (m_shape_renderer_ready) {
+            m_shape_renderer.hash_state(hasher, m_current_frame);
+        }
+        
+        //Per image and frame in flight, the image view is baked in and the frame's fence covers its last use
+        VkCommandBuffer command_buffer;
+        if (!m_composite_passes.begin(image_index * MAX_FRAMES_IN_FLIGHT + m_current_frame, hasher.get(), command_buffer)) {
+            return command_buffer;
+        }
         
         transition_image_layout(
             command_buffer,
             image_index,
+            VK_IMAGE_LAYOUT_UNDEFINED,
             VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-            VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
-            VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
             0,
+            VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
             VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
-            VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT
+            VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT
         );
         
+        //Every pixel is written by the upscale, nothing to load
+        VkRenderingAttachmentInfo swapchain_attachment_info{};
+        swapchain_attachment_info.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+        swapchain_attachment_info.imageView = ev_swapchain.get().image_views[image_index];
+        swapchain_attachment_info.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        swapchain_attachment_info.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        swapchain_attachment_info.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        
+        VkRenderingInfo composite_info{};
+        composite_info.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+        composite_info.renderArea = { .offset = { 0, 0 }, .extent = extent };
+        composite_info.layerCount = 1;
+        composite_info.colorAttachmentCount = 1;
+        composite_info.pColorAttachments = &swapchain_attachment_info;
+        
+        set_viewport(command_buffer, extent);
+        vkCmdBeginRendering(command_buffer, &composite_info);
+        
+        m_upscaler.record(command_buffer, m_render_extent, sharpness);
+        
+        //2D goes on top of the scene at full resolution
+        if (m_shape_renderer_ready) {
+            m_shape_renderer.record_draw(command_buffer, m_current_frame, extent);
+        }
+        
+        vkCmdEndRendering(command_buffer);
+        
         vkEndCommandBuffer(command_buffer);
+        return command_buffer;
     }
     
-    void VulkanCore::create_vertex_buffer(){
-        VkDeviceSize bufferSize = sizeof(vertices[0]) * vertices.size();
-
-        VkBuffer stagingBuffer;
-        VkDeviceMemory stagingBufferMemory;
-        createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
-
-        void* data;
-        vkMapMemory(ev_device.get().handle, stagingBufferMemory, 0, bufferSize, 0, &data);
-            memcpy(data, vertices.data(), (size_t) bufferSize);
-        vkUnmapMemory(ev_device.get().handle, stagingBufferMemory);
-
-        createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_vertex_buffer, m_vertex_buffer_memory);
+    void VulkanCore::create_quad_buffers(){
+        //Same import pass as loaded meshes, cache order first then fetch order
+        std::vector<Vertex> quad_vertices = vertices;
+        std::vector<uint32_t> quad_indices = optimize_vertex_cache(indices, quad_vertices.size());
+        deduplicate_vertices(quad_vertices, quad_indices);
+        optimize_vertex_fetch(quad_vertices, quad_indices);
+        PackedIndices packed = pack_indices(quad_indices, quad_vertices.size());
         
-        copyBuffer(stagingBuffer, m_vertex_buffer, bufferSize);
-
-        vkDestroyBuffer(ev_device.get().handle, stagingBuffer, nullptr);
-        vkFreeMemory(ev_device.get().handle, stagingBufferMemory, nullptr);
+        m_vertex_buffer = create_device_local_buffer(quad_vertices.data(), sizeof(Vertex) * quad_vertices.size(), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+        m_index_buffer = create_device_local_buffer(packed.data.data(), packed.data.size(), VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+        m_index_type = packed.type;
+        m_index_count = packed.count;
     }
     
-    uint32_t VulkanCore::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
-        VkPhysicalDeviceMemoryProperties memProperties;
-        vkGetPhysicalDeviceMemoryProperties(ev_physical_device.get().handle, &memProperties);
-
-        for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
-            if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
-                return i;
-            }
+    BufferHandle VulkanCore::create_device_local_buffer(const void* data, VkDeviceSize size, VkBufferUsageFlags usage){
+        if (m_tiers.uploads == UploadTier::ReBar) {
+            return upload_buffer<UploadTier::ReBar>(data, size, usage);
         }
-
-        throw std::runtime_error("failed to find suitable memory type!");
+        return upload_buffer<UploadTier::Staging>(data, size, usage);
     }
     
-    void VulkanCore::create_index_buffer() {
-        VkDeviceSize bufferSize = sizeof(indices[0]) * indices.size();
+    template<UploadTier Tier>
+    BufferHandle VulkanCore::upload_buffer(const void* data, VkDeviceSize size, VkBufferUsageFlags usage){
+        if constexpr (Tier == UploadTier::ReBar) {
+            //Written straight into VRAM, no staging copy and no queue submission
+            BufferHandle buffer = ev_resources.create_buffer(size, usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
 
-        VkBuffer stagingBuffer;
-        VkDeviceMemory stagingBufferMemory;
-        createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+            void* mapped;
+            vkMapMemory(ev_device.get().handle, ev_resources.get(buffer).memory, 0, size, 0, &mapped);
+                memcpy(mapped, data, (size_t) size);
+            vkUnmapMemory(ev_device.get().handle, ev_resources.get(buffer).memory);
 
-        void* data;
-        vkMapMemory(ev_device.get().handle, stagingBufferMemory, 0, bufferSize, 0, &data);
-        memcpy(data, indices.data(), (size_t) bufferSize);
-        vkUnmapMemory(ev_device.get().handle, stagingBufferMemory);
+            return buffer;
+        } else {
+            BufferHandle stagingBuffer = ev_resources.create_buffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
 
-        createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_index_buffer, m_index_buffer_memory);
+            void* mapped;
+            vkMapMemory(ev_device.get().handle, ev_resources.get(stagingBuffer).memory, 0, size, 0, &mapped);
+                memcpy(mapped, data, (size_t) size);
+            vkUnmapMemory(ev_device.get().handle, ev_resources.get(stagingBuffer).memory);
 
-        copyBuffer(stagingBuffer, m_index_buffer, bufferSize);
+            BufferHandle buffer = ev_resources.create_buffer(size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+            
+            copyBuffer(ev_resources.get(stagingBuffer).handle, ev_resources.get(buffer).handle, size);
 
-        vkDestroyBuffer(ev_device.get().handle, stagingBuffer, nullptr);
-        vkFreeMemory(ev_device.get().handle, stagingBufferMemory, nullptr);
+            ev_resources.destroy_buffer(stagingBuffer);
+            
+            return buffer;
+        }
     }
     
-    void VulkanCore::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory) {
-        VkBufferCreateInfo bufferInfo{};
-        bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-        bufferInfo.size = size;
-        bufferInfo.usage = usage;
-        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-
-        if (vkCreateBuffer(ev_device.get().handle, &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
-            throw std::runtime_error("failed to create buffer!");
+    void VulkanCore::load_mesh(const Mesh& mesh){
+        utils::Logger::info("Loading mesh with ", mesh.indices.size() / 3, " triangles!");
+        
+        vkDeviceWaitIdle(ev_device.get().handle);
+        
+        //Pipelines are only built once a mesh is actually used
+        if (!m_meshlet_renderer_ready) {
+            m_meshlet_renderer.init(ev_device.get().handle, ev_physical_device, m_tiers, ev_swapchain.get().surface_format, m_depth_format, ev_resources);
+            m_meshlet_renderer_ready = true;
         }
-
-        VkMemoryRequirements memRequirements;
-        vkGetBufferMemoryRequirements(ev_device.get().handle, buffer, &memRequirements);
-
-        VkMemoryAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize = memRequirements.size;
-        allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
-
-        if (vkAllocateMemory(ev_device.get().handle, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) {
-            throw std::runtime_error("failed to allocate buffer memory!");
+        
+        if (m_meshlet_renderer.has_geometry()) {
+            ev_resources.destroy_buffer(m_meshlet_geometry.vertices);
+            ev_resources.destroy_buffer(m_meshlet_geometry.indices);
+            ev_resources.destroy_buffer(m_meshlet_geometry.meshlets);
+            ev_resources.destroy_buffer(m_meshlet_geometry.meshlet_vertices);
+            ev_resources.destroy_buffer(m_meshlet_geometry.meshlet_triangles);
         }
-
-        vkBindBufferMemory(ev_device.get().handle, buffer, bufferMemory, 0);
+        
+        //Cache and fetch ordering also keeps meshlets spatially coherent, so fewer of them are needed
+        Mesh optimized = mesh;
+        optimize_mesh(optimized);
+        
+        MeshletData meshlet_data = build_meshlets(optimized);
+        PackedIndices expanded_indices = pack_indices(meshlet_data.expanded_indices(), optimized.vertices.size());
+        VkBufferUsageFlags usage = m_meshlet_renderer.geometry_usage();
+        
+        m_meshlet_geometry.vertices = create_device_local_buffer(optimized.vertices.data(), sizeof(MeshVertex) * optimized.vertices.size(), usage);
+        m_meshlet_geometry.indices = create_device_local_buffer(expanded_indices.data.data(), expanded_indices.data.size(), usage);
+        m_meshlet_geometry.meshlets = create_device_local_buffer(meshlet_data.meshlets.data(), sizeof(Meshlet) * meshlet_data.meshlets.size(), usage);
+        m_meshlet_geometry.meshlet_vertices = create_device_local_buffer(meshlet_data.meshlet_vertices.data(), sizeof(uint32_t) * meshlet_data.meshlet_vertices.size(), usage);
+        m_meshlet_geometry.meshlet_triangles = create_device_local_buffer(meshlet_data.meshlet_triangles.data(), sizeof(uint32_t) * meshlet_data.meshlet_triangles.size(), usage);
+        m_meshlet_geometry.meshlet_count = static_cast<uint32_t>(meshlet_data.meshlets.size());
+        m_meshlet_geometry.index_count = expanded_indices.count;
+        m_meshlet_geometry.index_type = expanded_indices.type;
+        
+        m_meshlet_renderer.set_geometry(m_meshlet_geometry);
+        
+        utils::Logger::info("Mesh loaded as ", m_meshlet_geometry.meshlet_count, " meshlets!");
+    }
+    
+    void VulkanCore::load_instanced_mesh(const Mesh& mesh, const std::vector<glm::mat4>& transforms){
+        vkDeviceWaitIdle(ev_device.get().handle);
+        
+        if (!m_lod_renderer_ready) {
+            m_lod_renderer.init(ev_device.get().handle, ev_physical_device, m_tiers, ev_swapchain.get().surface_format, m_depth_format, ev_resources, m_job_system, MAX_FRAMES_IN_FLIGHT);
+            m_lod_renderer_ready = true;
+        }
+        
+        if (!m_lod_vertex_buffer.is_null()) {
+            ev_resources.destroy_buffer(m_lod_vertex_buffer);
+            ev_resources.destroy_buffer(m_lod_index_buffer);
+        }
+        
+        Mesh lod_mesh = mesh;
+        if (lod_mesh.lods.empty()) {
+            generate_lods(lod_mesh);
+        }
+        optimize_mesh(lod_mesh);
+        PackedIndices lod_indices = pack_indices(lod_mesh.indices, lod_mesh.vertices.size());
+        
+        utils::Logger::info("Instanced mesh has ", lod_mesh.lods.size(), " LODs for ", transforms.size(), " instances!");
+        
+        m_lod_vertex_buffer = create_device_local_buffer(lod_mesh.vertices.data(), sizeof(MeshVertex) * lod_mesh.vertices.size(), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+        m_lod_index_buffer = create_device_local_buffer(lod_indices.data.data(), lod_indices.data.size(), VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+        
+        m_lod_renderer.set_geometry(m_lod_vertex_buffer, m_lod_index_buffer, lod_indices.type, lod_mesh.lods, compute_mesh_bounds(lod_mesh));
+        m_lod_renderer.set_instances(transforms);
+    }
+    
+    void VulkanCore::set_instance_transforms(const std::vector<glm::mat4>& transforms, const scene::DirtyBits& dirty){
+        if (!m_lod_renderer_ready) {
+            return;
+        }
+        
+        //Resizing replaces instance buffers that frames in flight may still read, otherwise only the
+        //transforms the scene marked are uploaded
+        if (transforms.size() != m_lod_renderer.get_instance_count()) {
+            vkDeviceWaitIdle(ev_device.get().handle);
+            m_lod_renderer.set_instances(transforms);
+            return;
+        }
+        m_lod_renderer.update_instances(transforms, dirty);
+    }
+    
+    void VulkanCore::pick_instances(std::span<const glm::vec2> points, std::vector<scene::RayHit>& hits){
+        hits.assign(points.size(), {});
+        if (!m_lod_renderer_ready || points.empty()) {
+            return;
+        }
+        
+        VkExtent2D extent = ev_swapchain.get().extent;
+        float aspect = static_cast<float>(extent.width) / static_cast<float>(extent.height);
+        glm::mat4 inverse_view_proj = glm::inverse(m_camera.view_projection(aspect));
+        
+        std::vector<scene::Ray> rays(points.size());
+        for (size_t i = 0; i < points.size(); i++) {
+            //Window y points down like Vulkan clip space, and with reverse-Z depth 1 is the near plane
+            glm::vec2 clip = points[i] * 2.0f - 1.0f;
+            glm::vec4 near_point = inverse_view_proj * glm::vec4(clip, 1.0f, 1.0f);
+            glm::vec4 far_point = inverse_view_proj * glm::vec4(clip, 0.0f, 1.0f);
+            glm::vec3 origin = glm::vec3(near_point) / near_point.w;
+            glm::vec3 offset = glm::vec3(far_point) / far_point.w - origin;
+            
+            rays[i].origin = origin;
+            rays[i].max_distance = glm::length(offset);
+            rays[i].direction = offset / rays[i].max_distance;
+        }
+        
+        m_lod_renderer.get_bvh().raycast_batch(m_job_system, rays, hits);
+    }
+    
+    ShapeRenderer& VulkanCore::begin_shapes(){
+        if (!m_shape_renderer_ready) {
+            const uint32_t white = 0xFFFFFFFF;
+            m_white_texture = create_texture(&white, 1, 1);
+            m_shape_renderer.init(ev_device.get().handle, m_tiers, ev_swapchain.get().surface_format, ev_resources, m_white_texture, MAX_FRAMES_IN_FLIGHT);
+            m_shape_renderer_ready = true;
+        }
+        
+        //draw_frame waits on the same fence, it is already signaled by then
+        vkWaitForFences(ev_device.get().handle, 1, &m_in_flight_fences[m_current_frame], VK_TRUE, UINT64_MAX);
+        m_shape_renderer.begin_frame(m_current_frame);
+        
+        return m_shape_renderer;
+    }
+    
+    bool VulkanCore::record_readbacks(VkCommandBuffer command_buffer, uint32_t image_index){
+        for (BufferRead& read : m_buffer_reads) {
+            m_readback.read_buffer(command_buffer, ev_resources.get(read.buffer).handle, read.offset, read.size, std::move(read.callback));
+        }
+        m_buffer_reads.clear();
+        
+        bool capture = m_frame_capture.should_capture();
+        if (!capture && m_frame_reads.empty()) {
+            return false;
+        }
+        
+        transition_image_layout(
+            command_buffer,
+            image_index,
+            VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+            VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+            VK_ACCESS_2_TRANSFER_READ_BIT,
+            VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+            VK_PIPELINE_STAGE_2_COPY_BIT
+        );
+        
+        std::vector<FrameReadbackCallback> callbacks = std::move(m_frame_reads);
+        m_frame_reads.clear();
+        if (capture) {
+            callbacks.push_back([this](const void* pixels, VkExtent2D extent, VkFormat format) {
+                m_frame_capture.submit(pixels, extent, format);
+            });
+        }
+        
+        //Every swapchain format in use has 32 bit texels
+        VkExtent2D extent = ev_swapchain.get().extent;
+        VkFormat format = ev_swapchain.get().surface_format.format;
+        m_readback.read_image(command_buffer, ev_swapchain.get().images[image_index], extent, 4, [callbacks = std::move(callbacks), extent, format](const void* data, VkDeviceSize) {
+            for (const FrameReadbackCallback& callback : callbacks) {
+                callback(data, extent, format);
+            }
+        });
+        
+        return true;
+    }
+    
+    void VulkanCore::read_buffer(BufferHandle buffer, VkDeviceSize offset, VkDeviceSize size, ReadbackCallback callback){
+        m_buffer_reads.push_back({buffer, offset, size, std::move(callback)});
+    }
+    
+    void VulkanCore::capture_frame(FrameReadbackCallback callback){
+        if (!(ev_swapchain.get().image_usage & VK_IMAGE_USAGE_TRANSFER_SRC_BIT)) {
+            utils::Logger::error("Swapchain images cannot be read back on this surface!");
+            return;
+        }
+        m_frame_reads.push_back(std::move(callback));
+    }
+    
+    void VulkanCore::start_capture(const FrameCaptureSettings& settings){
+        if (!(ev_swapchain.get().image_usage & VK_IMAGE_USAGE_TRANSFER_SRC_BIT)) {
+            utils::Logger::error("Swapchain images cannot be read back on this surface!");
+            return;
+        }
+        m_frame_capture.start(settings);
+    }
+    
+    ParticleSystem& VulkanCore::create_particles(uint32_t capacity, BlendMode blend){
+        if (!m_particle_system_ready) {
+            m_particle_system.init(ev_device.get().handle, ev_physical_device, ev_swapchain.get().surface_format, m_depth_format, ev_resources, m_queues, MAX_FRAMES_IN_FLIGHT, capacity, blend);
+            m_particle_system_ready = true;
+        }
+        return m_particle_system;
+    }
+    
+    ImageHandle VulkanCore::create_texture(const void* pixels, uint32_t width, uint32_t height){
+        VkDeviceSize size = VkDeviceSize(width) * height * 4;
+        BufferHandle staging_buffer = ev_resources.create_buffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        memcpy(ev_resources.map_buffer(staging_buffer), pixels, (size_t) size);
+        
+        ImageHandle texture = ev_resources.create_image({width, height}, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_ASPECT_COLOR_BIT);
+        copy_buffer_to_image(ev_resources.get(staging_buffer).handle, ev_resources.get(texture).handle, {width, height});
+        
+        ev_resources.destroy_buffer(staging_buffer);
+        
+        return texture;
+    }
+    
+    void VulkanCore::destroy_texture(ImageHandle texture){
+        if (m_shape_renderer_ready) {
+            m_shape_renderer.release_texture(texture);
+        }
+        m_released_textures.push_back({texture});
+    }
+    
+    void VulkanCore::copy_buffer_to_image(VkBuffer buffer, VkImage image, VkExtent2D extent){
+        VkCommandBufferAllocateInfo alloc_info{};
+        alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        alloc_info.commandPool = m_command_pool;
+        alloc_info.commandBufferCount = 1;
+        
+        VkCommandBuffer command_buffer;
+        vkAllocateCommandBuffers(ev_device.get().handle, &alloc_info, &command_buffer);
+        
+        VkCommandBufferBeginInfo begin_info{};
+        begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        
+        vkBeginCommandBuffer(command_buffer, &begin_info);
+        
+        VkImageMemoryBarrier2 barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+        barrier.srcStageMask = VK_PIPELINE_STAGE_2_NONE;
+        barrier.srcAccessMask = 0;
+        barrier.dstStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+        barrier.dstAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = image;
+        barrier.subresourceRange = {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .baseMipLevel = 0,
+            .levelCount = 1,
+            .baseArrayLayer = 0,
+            .layerCount = 1
+        };
+        
+        VkDependencyInfo dependency_info{};
+        dependency_info.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+        dependency_info.imageMemoryBarrierCount = 1;
+        dependency_info.pImageMemoryBarriers = &barrier;
+        vkCmdPipelineBarrier2(command_buffer, &dependency_info);
+        
+        VkBufferImageCopy region{};
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.layerCount = 1;
+        region.imageExtent = {extent.width, extent.height, 1};
+        vkCmdCopyBufferToImage(command_buffer, buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+        
+        barrier.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+        barrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+        barrier.dstStageMask = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT;
+        barrier.dstAccessMask = VK_ACCESS_2_SHADER_SAMPLED_READ_BIT;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        vkCmdPipelineBarrier2(command_buffer, &dependency_info);
+        
+        vkEndCommandBuffer(command_buffer);
+        
+        //Waits on this copy only instead of draining the queue
+        QueueSubmit submit{};
+        submit.command_buffers = {command_buffer};
+        m_queues.wait(QueueType::Graphics, m_queues.submit(QueueType::Graphics, submit));
+        
+        vkFreeCommandBuffers(ev_device.get().handle, m_command_pool, 1, &command_buffer);
     }
     
     void VulkanCore::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size) {
@@ -320,13 +819,9 @@ namespace evoke::vulkan {
 
         vkEndCommandBuffer(commandBuffer);
 
-        VkSubmitInfo submitInfo{};
-        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-        submitInfo.commandBufferCount = 1;
-        submitInfo.pCommandBuffers = &commandBuffer;
-
-        vkQueueSubmit(ev_device.get().graphics_queue, 1, &submitInfo, VK_NULL_HANDLE);
-        vkQueueWaitIdle(ev_device.get().graphics_queue);
+        QueueSubmit submit{};
+        submit.command_buffers = {commandBuffer};
+        m_queues.wait(QueueType::Graphics, m_queues.submit(QueueType::Graphics, submit));
 
         vkFreeCommandBuffers(ev_device.get().handle, m_command_pool, 1, &commandBuffer);
     }
@@ -360,6 +855,98 @@ namespace evoke::vulkan {
         vkCmdPipelineBarrier2(command_buffer, &dependency_info);
     }
     
+    void VulkanCore::record_opaque_draws(VkCommandBuffer command_buffer, const glm::mat4& view_proj, DepthPass pass){
+        const evPipeline& pipeline = ev_resources.get(m_graphics_pipelines.get(pass));
+        m_pipeline.bind_opaque(command_buffer, m_graphics_pipelines, pass, ev_resources);
+        
+        //Every pipeline shading with frag.spv reads the lights, the pre-pass has no fragment stage
+        VkDescriptorSet lighting = m_lighting.get_descriptor_set(m_current_frame);
+        if (pass != DepthPass::Prepass) {
+            vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.layout, 0, 1, &lighting, 0, nullptr);
+        }
+        
+        VkBuffer vertexBuffers[] = {ev_resources.get(m_vertex_buffer).handle};
+        VkDeviceSize offsets[] = {0};
+        vkCmdBindVertexBuffers(command_buffer, 0, 1, vertexBuffers, offsets);
+        vkCmdBindIndexBuffer(command_buffer, ev_resources.get(m_index_buffer).handle, 0, m_index_type);
+        
+        vkCmdDrawIndexed(command_buffer, m_index_count, 1, 0, 0, 0);
+        
+        if (m_meshlet_renderer_ready) {
+            m_meshlet_renderer.record_draw(command_buffer, view_proj, m_camera.position, pass, lighting);
+        }
+        
+        if (m_lod_renderer_ready) {
+            m_lod_renderer.record_draw(command_buffer, m_current_frame, view_proj, pass, lighting);
+        }
+    }
+    
+    void VulkanCore::transition_render_target(VkCommandBuffer command_buffer, ImageHandle image, VkImageAspectFlags aspect, VkImageLayout old_layout, VkImageLayout new_layout, VkAccessFlags2 src_access_mask, VkAccessFlags2 dst_access_mask, VkPipelineStageFlags2 src_stage_mask, VkPipelineStageFlags2 dst_stage_mask){
+        VkImageMemoryBarrier2 barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+        barrier.srcStageMask = src_stage_mask;
+        barrier.srcAccessMask = src_access_mask;
+        barrier.dstStageMask = dst_stage_mask;
+        barrier.dstAccessMask = dst_access_mask;
+        barrier.oldLayout = old_layout;
+        barrier.newLayout = new_layout;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = ev_resources.get(image).handle;
+        barrier.subresourceRange = {
+            .aspectMask = aspect,
+            .baseMipLevel = 0,
+            .levelCount = 1,
+            .baseArrayLayer = 0,
+            .layerCount = 1
+        };
+        
+        VkDependencyInfo dependency_info{};
+        dependency_info.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+        dependency_info.imageMemoryBarrierCount = 1;
+        dependency_info.pImageMemoryBarriers = &barrier;
+        
+        vkCmdPipelineBarrier2(command_buffer, &dependency_info);
+    }
+    
+    void VulkanCore::set_viewport(VkCommandBuffer command_buffer, VkExtent2D extent){
+        VkViewport viewport{};
+        viewport.x = 0.0f;
+        viewport.y = 0.0f;
+        viewport.width = static_cast<float>(extent.width);
+        viewport.height = static_cast<float>(extent.height);
+        viewport.minDepth = 0.0f;
+        viewport.maxDepth = 1.0f;
+        vkCmdSetViewport(command_buffer, 0, 1, &viewport);
+
+        VkRect2D scissor{};
+        scissor.offset = {0, 0};
+        scissor.extent = extent;
+        vkCmdSetScissor(command_buffer, 0, 1, &scissor);
+    }
+    
+    void VulkanCore::create_render_targets(){
+        //Swapchain sized, lower render scales only use a corner so changing the scale never reallocates
+        VkExtent2D extent = ev_swapchain.get().extent;
+        m_depth_image = ev_resources.create_image(extent, m_depth_format, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_IMAGE_ASPECT_DEPTH_BIT);
+        m_scene_color = ev_resources.create_image(extent, ev_swapchain.get().surface_format.format, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_ASPECT_COLOR_BIT);
+        m_upscaler.set_source(m_scene_color, extent);
+        m_render_extent = m_resolution.scale_extent(extent);
+        
+        //Recorded passes bake in the targets and swapchain views, so they start over with them
+        uint32_t graphics_family = ev_physical_device.get().queue_family_indices.graphics_family.value();
+        uint32_t image_count = static_cast<uint32_t>(ev_swapchain.get().images.size());
+        m_scene_passes.init(ev_device.get().handle, graphics_family, MAX_FRAMES_IN_FLIGHT);
+        m_composite_passes.init(ev_device.get().handle, graphics_family, image_count * MAX_FRAMES_IN_FLIGHT);
+    }
+    
+    void VulkanCore::destroy_render_targets(){
+        m_scene_passes.clean_up();
+        m_composite_passes.clean_up();
+        ev_resources.destroy_image(m_depth_image);
+        ev_resources.destroy_image(m_scene_color);
+    }
+    
     void VulkanCore::create_sync_objects(){
         m_image_available_semaphores.resize(MAX_FRAMES_IN_FLIGHT);
         m_render_finished_semaphores.resize(MAX_FRAMES_IN_FLIGHT);
@@ -381,34 +968,138 @@ namespace evoke::vulkan {
         }
     }
     
+    void VulkanCore::recreate_swapchain(){
+        vkDeviceWaitIdle(ev_device.get().handle);
+        
+        //Surface format stays the same, so pipelines survive
+        ev_swapchain.clean_up(ev_device.get().handle);
+        ev_swapchain.init(ev_device.get().handle, ev_physical_device, m_surface, m_window);
+        destroy_render_targets();
+        create_render_targets();
+        m_frame_pacer.reset();
+        
+        utils::Logger::info("Swapchain recreated with present mode ", ev_swapchain.get().present_mode, "!");
+    }
+    
     void VulkanCore::draw_frame(){
+        VkPresentModeKHR requested_present_mode = m_requested_present_mode.exchange(VK_PRESENT_MODE_MAX_ENUM_KHR);
+        if (requested_present_mode != VK_PRESENT_MODE_MAX_ENUM_KHR) {
+            ev_swapchain.set_preferred_present_mode(requested_present_mode);
+            recreate_swapchain();
+        }
+        
+        //Rebuilt pipelines replace ones earlier frames may still be using
+        if (m_shader_library.hot_reload_enabled() && m_shader_library.has_reloads()) {
+            vkDeviceWaitIdle(ev_device.get().handle);
+            m_shader_library.apply_reloads();
+            //Rebuilt pipelines keep their handles, so hashes cannot tell
+            m_scene_passes.invalidate();
+            m_composite_passes.invalidate();
+        }
+        
+        //Sleeps until the frame has to start to be ready for the next vblank
+        uint32_t previous_frame = (m_current_frame + MAX_FRAMES_IN_FLIGHT - 1) % MAX_FRAMES_IN_FLIGHT;
+        m_frame_pacer.wait_for_frame_start(ev_swapchain.get().handle, m_in_flight_fences[previous_frame]);
+        
         vkWaitForFences(ev_device.get().handle, 1, &m_in_flight_fences[m_current_frame], VK_TRUE, UINT64_MAX);
         vkResetFences(ev_device.get().handle, 1, &m_in_flight_fences[m_current_frame]);
+        m_frame_pacer.begin_frame(m_current_frame, m_input_time);
+        m_frame_arenas.begin_frame(m_current_frame);
+        
+        //Everything allocated since the last frame started, on any thread
+        core::AllocationStats allocations = core::AllocationCounter::get_total();
+        m_frame_allocations = allocations - m_allocations_at_frame_start;
+        m_allocations_at_frame_start = allocations;
+        utils::Profiler::set_counter("memory.cpu_allocations", static_cast<double>(m_frame_allocations.allocations));
+        utils::Profiler::set_counter("memory.cpu_allocated_kib", static_cast<double>(m_frame_allocations.bytes) / 1024.0);
+        utils::Profiler::set_counter("memory.arena_peak_kib", static_cast<double>(m_frame_arenas.get_peak()) / 1024.0);
+        
+        //Scene resolution for this frame from the newest GPU time
+        m_resolution.update(m_frame_pacer.get_last_gpu_time());
+        m_render_extent = m_resolution.scale_extent(ev_swapchain.get().extent);
+        
+        //Delivers readbacks of frames the GPU finished by now
+        uint64_t graphics_completed = m_queues.get_completed(QueueType::Graphics);
+        m_readback.poll(graphics_completed);
+        
+        //Released textures whose last possible frame finished
+        std::erase_if(m_released_textures, [&](const ReleasedTexture& released) {
+            if (released.frame_done == 0 || released.frame_done > graphics_completed) {
+                return false;
+            }
+            ev_resources.destroy_image(released.texture);
+            return true;
+        });
+        
+        //Readbacks just released their staging, so evictions here can reclaim it
+        m_memory_budget.update();
         
         uint32_t image_index;
         vkAcquireNextImageKHR(ev_device.get().handle, ev_swapchain.get().handle, UINT64_MAX, m_image_available_semaphores[m_current_frame], VK_NULL_HANDLE, &image_index);
         
+        //This frame's instance, draw and light buffers are free again once its fence signaled
+        m_lighting.prepare(m_current_frame, m_camera, m_render_extent);
+        utils::Profiler::set_counter("lighting.lights", m_lighting.get_stats().lights);
+        utils::Profiler::set_counter("lighting.occupied_clusters", m_lighting.get_stats().occupied_clusters);
+        utils::Profiler::set_counter("lighting.overflowed_clusters", m_lighting.get_stats().overflowed_clusters);
+        utils::Profiler::set_counter("lighting.dropped_lights", m_lighting.get_stats().dropped_lights);
+        utils::Profiler::set_counter("lighting.max_cluster_lights", m_lighting.get_stats().max_cluster_lights);
+        
+        if (m_lod_renderer_ready) {
+            m_lod_renderer.prepare(m_current_frame, m_camera, m_render_extent, &m_frame_arenas.get());
+            utils::Profiler::set_counter("lod.uploaded_instances", m_lod_renderer.get_stats().uploaded_instances);
+            utils::Profiler::set_counter("lod.uploaded_kib", static_cast<double>(m_lod_renderer.get_stats().uploaded_bytes) / 1024.0);
+        }
+        
+        //Simulated on the compute queue while the graphics queue may still be drawing the previous frame
+        core::Clock::time_point frame_time = core::Clock::now();
+        float delta_time = m_last_frame_time == core::Clock::time_point{} ? 0.0f : std::min(std::chrono::duration<float>(frame_time - m_last_frame_time).count(), 0.1f);
+        m_last_frame_time = frame_time;
+        
+        uint64_t particles_done = 0;
+        if (m_particle_system_ready) {
+            particles_done = m_particle_system.update(m_current_frame, delta_time, m_camera.position);
+        }
+        
         vkResetCommandBuffer(m_command_buffers[m_current_frame], 0);
         record_command_buffer(m_command_buffers[m_current_frame], image_index);
         
-        VkSubmitInfo submit_info{};
-        submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-        submit_info.pCommandBuffers = &m_command_buffers[m_current_frame];
-
-        VkSemaphore wait_semaphores[] = {m_image_available_semaphores[m_current_frame]};
-        VkPipelineStageFlags wait_stages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-        submit_info.waitSemaphoreCount = 1;
-        submit_info.pWaitSemaphores = wait_semaphores;
-        submit_info.pWaitDstStageMask = wait_stages;
-        submit_info.commandBufferCount = 1;
-        submit_info.pCommandBuffers = &m_command_buffers[m_current_frame];
+        CommandCacheStats scene_passes = m_scene_passes.take_stats();
+        CommandCacheStats composite_passes = m_composite_passes.take_stats();
+        utils::Profiler::set_counter("recording.passes_recorded", scene_passes.recorded + composite_passes.recorded);
+        utils::Profiler::set_counter("recording.passes_replayed", scene_passes.replayed + composite_passes.replayed);
+        
+        VkSemaphoreSubmitInfo wait_semaphore{};
+        wait_semaphore.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+        wait_semaphore.semaphore = m_image_available_semaphores[m_current_frame];
+        wait_semaphore.stageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
         
         VkSemaphore signal_semaphores[] = {m_render_finished_semaphores[m_current_frame]};
-        submit_info.signalSemaphoreCount = 1;
-        submit_info.pSignalSemaphores = signal_semaphores;
+        VkSemaphoreSubmitInfo signal_semaphore{};
+        signal_semaphore.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+        signal_semaphore.semaphore = signal_semaphores[0];
+        signal_semaphore.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
         
-        if (vkQueueSubmit(ev_device.get().graphics_queue, 1, &submit_info, m_in_flight_fences[m_current_frame]) != VK_SUCCESS) {
-            throw std::runtime_error("failed to submit draw command buffer!");
+        QueueSubmit submit(&m_frame_arenas.get());
+        submit.command_buffers = {m_command_buffers[m_current_frame]};
+        submit.binary_waits = {wait_semaphore};
+        submit.binary_signals = {signal_semaphore};
+        submit.fence = m_in_flight_fences[m_current_frame];
+        if (particles_done > 0) {
+            submit.waits.push_back({QueueType::Compute, particles_done, VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT});
+        }
+        uint64_t graphics_done = m_queues.submit(QueueType::Graphics, submit);
+        if (m_particle_system_ready) {
+            m_particle_system.end_frame(graphics_done);
+        }
+        m_readback.end_frame(graphics_done);
+        if (m_shape_renderer_ready) {
+            m_shape_renderer.end_frame(m_current_frame);
+        }
+        for (ReleasedTexture& released : m_released_textures) {
+            if (released.frame_done == 0) {
+                released.frame_done = graphics_done;
+            }
         }
         
         VkPresentInfoKHR presentInfo{};
@@ -421,8 +1112,18 @@ namespace evoke::vulkan {
         presentInfo.swapchainCount = 1;
         presentInfo.pSwapchains = swapchains;
         presentInfo.pImageIndices = &image_index;
+        
+        VkPresentIdKHR present_id{};
+        m_frame_pacer.prepare_present(presentInfo, present_id);
                 
-        vkQueuePresentKHR(ev_device.get().presentation_queue, &presentInfo);
+        m_queues.present(presentInfo);
+        
+        if (!m_first_frame_presented) {
+            m_first_frame_presented = true;
+            double time_to_first_frame = std::chrono::duration<double, std::milli>(core::Clock::now() - m_startup_start).count();
+            utils::Profiler::set_counter("startup.time_to_first_frame_ms", time_to_first_frame);
+            utils::Logger::info("First frame presented ", time_to_first_frame, " ms after startup!");
+        }
         
         m_current_frame = (m_current_frame + 1) % MAX_FRAMES_IN_FLIGHT;
     }
@@ -5,34 +5,196 @@
 #include "evPhysicalDevice.h"
 #include "evDevice.h"
 #include "evSwapchain.h"
+#include "evResources.h"
+#include "MeshletRenderer.h"
+#include "LodRenderer.h"
+#include "ShapeRenderer.h"
+#include "FeatureTiers.h"
+#include "ParticleSystem.h"
+#include "FramePacer.h"
+#include "QueueSet.h"
+#include "ReadbackService.h"
+#include "ShaderLibrary.h"
+#include "MemoryBudget.h"
+#include "FrameCapture.h"
+#include "ResolutionScaler.h"
+#include "Upscaler.h"
+#include "CommandCache.h"
+#include "ClusteredLighting.h"
+#include "../core/JobSystem.h"
+#include "../core/FrameArenas.h"
+#include "../core/AllocationCounter.h"
+#include "../scene/Camera.h"
+#include "../shapes/Mesh.h"
 
 namespace evoke::vulkan {
+    //Tightly packed pixels in the swapchain format, only valid during the callback
+    using FrameReadbackCallback = std::function<void(const void* pixels, VkExtent2D extent, VkFormat format)>;
+    
     class VulkanCore{
     public:
-        void init_vulkan(GLFWwindow* window);
+        //Must be called before init_vulkan to take effect
+        void set_device_selection(const DeviceSelection& selection) { m_device_selection = selection; }
+        //Runs as a startup graph, everything after device creation overlaps on the job system.
+        //Time to first frame is measured from startup_start.
+        void init_vulkan(GLFWwindow* window, core::Clock::time_point startup_start = core::Clock::now());
         void clean_up();
         
         void draw_frame();
         
+        //Splits the mesh into meshlets and uploads it, replaces any previously loaded mesh
+        void load_mesh(const Mesh& mesh);
+        //Generates LODs if the mesh has none and draws it once per transform
+        void load_instanced_mesh(const Mesh& mesh, const std::vector<glm::mat4>& transforms);
+        //Replaces the transforms of the instanced mesh, only stalls the GPU when the instance count changes
+        //Only the transforms marked in dirty are read, unless the instance count changed
+        void set_instance_transforms(const std::vector<glm::mat4>& transforms, const scene::DirtyBits& dirty);
+        void set_camera(const scene::Camera& camera) { m_camera = camera; }
+        
+        const LodStats& get_lod_stats() const { return m_lod_renderer.get_stats(); }
+        //Instanced mesh instance under each point in [0, 1] window coordinates, against the bounds of
+        //the last drawn frame. Rays are cast in parallel on the job system.
+        void pick_instances(std::span<const glm::vec2> points, std::vector<scene::RayHit>& hits);
+        
+        //Waits until the current frame's buffers are free and opens its shape batch, shapes go out with the next draw_frame
+        ShapeRenderer& begin_shapes();
+        ShapeStats get_shape_stats() const { return m_shape_renderer.get_stats(); }
+        //Creates the GPU particle pool on first use, later calls return it unchanged
+        ParticleSystem& create_particles(uint32_t capacity, BlendMode blend = BlendMode::Alpha);
+        const ParticleStats& get_particle_stats() const { return m_particle_system.get_stats(); }
+        //Point lights for the opaque geometry, binned into clusters every frame
+        void set_lights(const std::vector<PointLight>& lights) { m_lighting.set_lights(lights); }
+        void set_ambient_light(const glm::vec3& ambient) { m_lighting.set_ambient(ambient); }
+        const LightingStats& get_lighting_stats() const { return m_lighting.get_stats(); }
+        //Safe from any thread, the swapchain is recreated at the start of the next frame
+        void set_present_mode(VkPresentModeKHR present_mode) { m_requested_present_mode = present_mode; }
+        void set_pacing_mode(PacingMode mode) { m_frame_pacer.set_mode(mode); }
+        //Safe from any thread. Lays down depth first so opaque fragments are shaded once, worth it on overdraw heavy scenes.
+        void set_depth_prepass(bool enabled) { m_depth_prepass = enabled; }
+        //Passes whose inputs did not change since their last recording are replayed, on by default
+        void set_incremental_recording(bool enabled) { m_incremental_recording = enabled; }
+        //Safe from any thread, see ResolutionScaler
+        void set_resolution_settings(const ResolutionSettings& settings) { m_resolution.set_settings(settings); }
+        float get_render_scale() const { return m_resolution.get_scale(); }
+        //Timestamp of the newest input the next frame shows, for latency measurement
+        void set_input_time(core::Clock::time_point input_time) { m_input_time = input_time; }
+        const FramePacingStats& get_pacing_stats() const { return m_frame_pacer.get_stats(); }
+        
+        //Copies the range back at the end of the next frame, the callback runs from a later draw_frame once the GPU is done
+        void read_buffer(BufferHandle buffer, VkDeviceSize offset, VkDeviceSize size, ReadbackCallback callback);
+        //Reads back the next rendered image the same way
+        void capture_frame(FrameReadbackCallback callback);
+        //Streams frames to disk until stopped, see FrameCaptureSettings
+        void start_capture(const FrameCaptureSettings& settings);
+        void stop_capture() { m_frame_capture.stop(); }
+        FrameCaptureStats get_capture_stats() const { return m_frame_capture.get_stats(); }
+        
+        //Uploads RGBA8 pixels into a sampled image
+        ImageHandle create_texture(const void* pixels, uint32_t width, uint32_t height);
+        //Destroys the texture once the frames that may still sample it are done, its shape descriptors are reused
+        void destroy_texture(ImageHandle texture);
+        
         const VkDevice get_device() const {return ev_device.get().handle;}
+        //Graphics, async compute and transfer queues with their timelines
+        QueueSet& get_queues() { return m_queues; }
+        //Per heap budget and usage, allocations by category
+        const MemoryStats& get_memory_stats() const { return m_memory_budget.get_stats(); }
+        //Runs before an allocation would exceed the budget, see MemoryBudget
+        void add_eviction(EvictionCallback callback) { m_memory_budget.add_eviction(std::move(callback)); }
+        //Temporaries of the current frame on the calling thread, valid until the frame slot comes around again
+        core::LinearArena& get_frame_arena() { return m_frame_arenas.get(); }
+        //Heap allocations of the previous frame on all threads, 0 once the renderer is warmed up
+        const core::AllocationStats& get_frame_allocations() const { return m_frame_allocations; }
+        //Render paths picked for this device, report says why
+        const FeatureTiers& get_feature_tiers() const { return m_tiers; }
         
     private:
         VkInstance m_instance;
         VkSurfaceKHR m_surface;
+        GLFWwindow* m_window = nullptr;
         evPhysicalDevice ev_physical_device;
+        DeviceSelection m_device_selection;
         evDevice ev_device;
+        FeatureTiers m_tiers;
+        QueueSet m_queues;
         
         evSwapchain ev_swapchain;
+        evResources ev_resources;
+        MemoryBudget m_memory_budget;
+        ShaderLibrary m_shader_library;
         Pipeline m_pipeline;
+        OpaquePipelines m_graphics_pipelines;
+        
+        //Recreated with the swapchain. The scene renders into them at the scaled extent, the upscaler
+        //composites it into the swapchain image.
+        VkFormat m_depth_format = VK_FORMAT_UNDEFINED;
+        ImageHandle m_depth_image;
+        ImageHandle m_scene_color;
+        VkExtent2D m_render_extent{};
+        std::atomic<bool> m_depth_prepass{false};
+        std::atomic<bool> m_incremental_recording{true};
+        //Scene pass per frame in flight, composite pass per swapchain image and frame in flight
+        CommandCache m_scene_passes;
+        CommandCache m_composite_passes;
+        ResolutionScaler m_resolution;
+        Upscaler m_upscaler;
+        ClusteredLighting m_lighting;
         
         VkCommandPool m_command_pool;
         std::vector<VkCommandBuffer> m_command_buffers;
         
-        VkBuffer m_vertex_buffer;
-        VkDeviceMemory m_vertex_buffer_memory;
+        BufferHandle m_vertex_buffer;
+        BufferHandle m_index_buffer;
+        VkIndexType m_index_type = VK_INDEX_TYPE_UINT32;
+        uint32_t m_index_count = 0;
+        
+        MeshletRenderer m_meshlet_renderer;
+        MeshletGeometry m_meshlet_geometry;
+        bool m_meshlet_renderer_ready = false;
+        
+        LodRenderer m_lod_renderer;
+        BufferHandle m_lod_vertex_buffer;
+        BufferHandle m_lod_index_buffer;
+        bool m_lod_renderer_ready = false;
+        
+        ShapeRenderer m_shape_renderer;
+        ImageHandle m_white_texture;
+        bool m_shape_renderer_ready = false;
+        
+        struct ReleasedTexture {
+            ImageHandle texture;
+            //Graphics timeline value of the first frame submitted after the release, 0 until then
+            uint64_t frame_done = 0;
+        };
+        std::vector<ReleasedTexture> m_released_textures;
+        
+        ParticleSystem m_particle_system;
+        bool m_particle_system_ready = false;
+        core::Clock::time_point m_last_frame_time;
         
-        VkBuffer m_index_buffer;
-        VkDeviceMemory m_index_buffer_memory;
+        struct BufferRead {
+            BufferHandle buffer;
+            VkDeviceSize offset;
+            VkDeviceSize size;
+            ReadbackCallback callback;
+        };
+        
+        ReadbackService m_readback;
+        FrameCapture m_frame_capture;
+        std::vector<BufferRead> m_buffer_reads;
+        std::vector<FrameReadbackCallback> m_frame_reads;
+        
+        FramePacer m_frame_pacer;
+        std::atomic<VkPresentModeKHR> m_requested_present_mode{VK_PRESENT_MODE_MAX_ENUM_KHR};
+        core::Clock::time_point m_input_time;
+        
+        core::JobSystem m_job_system;
+        core::FrameArenas m_frame_arenas;
+        core::AllocationStats m_frame_allocations;
+        core::AllocationStats m_allocations_at_frame_start;
+        core::Clock::time_point m_startup_start;
+        bool m_first_frame_presented = false;
+        scene::Camera m_camera;
         
         std::vector<VkSemaphore> m_image_available_semaphores;
         std::vector<VkSemaphore> m_render_finished_semaphores;
@@ -47,15 +209,26 @@ namespace evoke::vulkan {
         void create_command_pool();
         void create_command_buffer();
         void record_command_buffer(VkCommandBuffer command_buffer, uint32_t image_index);
+        //Secondary command buffers from the caches, recorded only when out of date
+        VkCommandBuffer record_scene_pass();
+        VkCommandBuffer record_composite_pass(uint32_t image_index);
+        //Returns true if the image was left in TRANSFER_SRC_OPTIMAL
+        bool record_readbacks(VkCommandBuffer command_buffer, uint32_t image_index);
         
-        void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory);
         void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
+        void copy_buffer_to_image(VkBuffer buffer, VkImage image, VkExtent2D extent);
+        BufferHandle create_device_local_buffer(const void* data, VkDeviceSize size, VkBufferUsageFlags usage);
+        template<UploadTier Tier>
+        BufferHandle upload_buffer(const void* data, VkDeviceSize size, VkBufferUsageFlags usage);
         
-        void create_vertex_buffer();
-        uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
-        void create_index_buffer();
+        void create_quad_buffers();
         
         void create_sync_objects();
+        void create_render_targets();
+        void destroy_render_targets();
+        void recreate_swapchain();
+        void set_viewport(VkCommandBuffer command_buffer, VkExtent2D extent);
+        void record_opaque_draws(VkCommandBuffer command_buffer, const glm::mat4& view_proj, DepthPass pass);
         
         void transition_image_layout(
             VkCommandBuffer command_buffer,
@@ -67,5 +240,16 @@ namespace evoke::vulkan {
             VkPipelineStageFlags2 src_stage_mask,
             VkPipelineStageFlags2 dst_stage_mask
                                      );
+        void transition_render_target(
+            VkCommandBuffer command_buffer,
+            ImageHandle image,
+            VkImageAspectFlags aspect,
+            VkImageLayout old_layout,
+            VkImageLayout new_layout,
+            VkAccessFlags2 src_access_mask,
+            VkAccessFlags2 dst_access_mask,
+            VkPipelineStageFlags2 src_stage_mask,
+            VkPipelineStageFlags2 dst_stage_mask
+        );
     };
 }
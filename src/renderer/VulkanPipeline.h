@@ -1,23 +1,137 @@
-
 #pragma once
 #define GLFW_EXPOSE_NATIVE_COCOA
 #define VK_USE_PLATFORM_METAL_EXT
 #define GLFW_INCLUDE_VULKAN
 
 #include <GLFW/glfw3.h>
+#include <cstring>
+#include <span>
+#include <type_traits>
 #include <vector>
+#include <string>
+#include <utility>
+#include "evResources.h"
+#include "FeatureTiers.h"
+#include "ShaderReflection.h"
 
 namespace evoke::vulkan {
+    enum class BlendMode {
+        Alpha,          //Source over destination, needs back to front order
+        Additive,       //Order independent
+        None            //Overwrites the destination
+    };
+
+    //How an opaque draw treats depth. Depth is reverse-Z: cleared to 0, nearer is greater.
+    enum class DepthPass {
+        Single,         //No pre-pass, test and write while shading
+        Prepass,        //Depth only, nothing is shaded
+        Shade           //After a pre-pass, EQUAL test without writes so only visible fragments are shaded
+    };
+
+    //Values for the constant_id constants of a pipeline's shaders, so permutations are picked at pipeline
+    //creation instead of compiled from separate sources. Ids a stage does not declare are ignored.
+    class SpecializationConstants {
+    public:
+        template<typename T>
+        SpecializationConstants& set(uint32_t id, T value){
+            static_assert(sizeof(T) == 4 && std::is_trivially_copyable_v<T>, "specialization constants are 32 bit scalars!");
+            VkSpecializationMapEntry entry{id, static_cast<uint32_t>(m_data.size()), sizeof(T)};
+            m_entries.push_back(entry);
+            m_data.resize(m_data.size() + sizeof(T));
+            memcpy(m_data.data() + entry.offset, &value, sizeof(T));
+            return *this;
+        }
+        //GLSL bools are 32 bit
+        SpecializationConstants& set(uint32_t id, bool value) { return set(id, static_cast<VkBool32>(value)); }
+
+        bool empty() const { return m_entries.empty(); }
+        //Points into this object, which has to outlive pipeline creation
+        VkSpecializationInfo info() const {
+            return {static_cast<uint32_t>(m_entries.size()), m_entries.data(), m_data.size(), m_data.data()};
+        }
+
+    private:
+        std::vector<VkSpecializationMapEntry> m_entries;
+        std::vector<uint8_t> m_data;
+    };
+
+    //Everything that differs between the graphics pipelines of the render paths
+    struct GraphicsPipelineConfig {
+        //Shader library names, e.g. "shape_vert.spv" for src/shaders/shape.vert
+        std::vector<std::pair<VkShaderStageFlagBits, std::string>> shaders;
+        SpecializationConstants specialization;
+
+        //Reflected from the vertex shader when left empty, ignored for mesh shader pipelines
+        std::vector<VkVertexInputBindingDescription> bindings;
+        std::vector<VkVertexInputAttributeDescription> attributes;
+        //Reflected inputs from this location on are read per instance from binding 1
+        uint32_t instance_location = UINT32_MAX;
+        //Size of the C++ vertex struct, when set a reflected binding 0 of another stride throws
+        uint32_t vertex_stride = 0;
+
+        //Reflected and taken from the layout cache when left empty, otherwise owned by the caller
+        std::vector<VkDescriptorSetLayout> set_layouts;
+
+        //Reflected when the size is left 0
+        VkShaderStageFlags push_constant_stages = 0;
+        uint32_t push_constant_size = 0;
+
+        VkCullModeFlags cull_mode = VK_CULL_MODE_BACK_BIT;
+        VkFrontFace front_face = VK_FRONT_FACE_CLOCKWISE;
+        BlendMode blend = BlendMode::Alpha;
+
+        //Depth attachment of the pass, UNDEFINED for passes without one
+        VkFormat depth_format = VK_FORMAT_UNDEFINED;
+        bool depth_test = false;
+        bool depth_write = false;
+        VkCompareOp depth_compare = VK_COMPARE_OP_GREATER_OR_EQUAL;
+        //Drops the fragment stage and the color attachment
+        bool depth_only = false;
+
+        //Which of the cull, front face, depth and blend states above are left to record time,
+        //only for pipelines bound through Pipeline::bind_opaque
+        StateTier state = StateTier::Static;
+    };
+
+    //An opaque draw's pipeline for every DepthPass, built together so the pre-pass can be toggled at runtime.
+    //With dynamic state single and shade are the same pipeline, the state below is set by Pipeline::bind_opaque.
+    struct OpaquePipelines {
+        PipelineHandle single;
+        PipelineHandle prepass;
+        PipelineHandle shade;
+
+        StateTier state = StateTier::Static;
+        VkCullModeFlags cull_mode = VK_CULL_MODE_BACK_BIT;
+        VkFrontFace front_face = VK_FRONT_FACE_CLOCKWISE;
+        BlendMode blend = BlendMode::Alpha;
+
+        PipelineHandle get(DepthPass pass) const {
+            return pass == DepthPass::Prepass ? prepass : pass == DepthPass::Shade ? shade : single;
+        }
+    };
+
     class Pipeline{
     public:
-        void create_pipeline(VkDevice device, const VkSurfaceFormatKHR& surface_format);
-        void clean_up(VkDevice device);
-        
-        VkPipeline get_graphics_pipeline() { return m_graphics_pipeline; }
+        //Builds the graphics pipeline and hands ownership to the resource pools. With shader hot reload
+        //on, the pipeline is rebuilt under the same handle whenever one of its shaders changes.
+        OpaquePipelines create_pipeline(VkDevice device, const VkSurfaceFormatKHR& surface_format, VkFormat depth_format, evResources& resources, StateTier state = StateTier::Static);
+        PipelineHandle create_graphics_pipeline(VkDevice device, const VkSurfaceFormatKHR& surface_format, const GraphicsPipelineConfig& config, evResources& resources);
+        //The config's depth state is replaced per pass, depth_format has to be set
+        OpaquePipelines create_opaque_pipelines(VkDevice device, const VkSurfaceFormatKHR& surface_format, const GraphicsPipelineConfig& config, evResources& resources);
+        //Binds the pass's pipeline and sets whatever state it leaves dynamic, only for pipelines from this builder
+        void bind_opaque(VkCommandBuffer command_buffer, const OpaquePipelines& pipelines, DepthPass pass, const evResources& resources) const;
+        //A push_constant_size of 0 takes the size of the shader's push constant block
+        PipelineHandle create_compute_pipeline(VkDevice device, const std::string& shader_name, uint32_t push_constant_size, evResources& resources, const SpecializationConstants& specialization = {});
+
     private:
-        VkPipelineLayout m_pipeline_layout;
-        VkPipeline m_graphics_pipeline;
-        
-        VkShaderModule create_shader_module(const std::vector<char>& bytecode, VkDevice device);
+        //Loaded by create_opaque_pipelines for StateTier::DynamicBlend
+        PFN_vkCmdSetColorBlendEnableEXT m_set_color_blend_enable = nullptr;
+        PFN_vkCmdSetColorBlendEquationEXT m_set_color_blend_equation = nullptr;
+
+        static VkPipeline build_graphics_pipeline(VkDevice device, const VkSurfaceFormatKHR& surface_format, const GraphicsPipelineConfig& config, evResources& resources, VkPipelineLayout& layout);
+        static VkPipeline build_compute_pipeline(VkDevice device, const std::string& shader_name, uint32_t push_constant_size, evResources& resources, const SpecializationConstants& specialization, VkPipelineLayout& layout);
+        static VkShaderModule create_shader_module(std::span<const uint32_t> code, VkDevice device);
+        //Cached layout for the reflected sets and push constants, explicit ones win
+        static VkPipelineLayout get_layout(const PipelineReflection& reflection, const std::vector<VkDescriptorSetLayout>& set_layouts, const VkPushConstantRange& push_constants, evResources& resources);
     };
 }
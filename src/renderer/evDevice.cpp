@@ -11,7 +11,14 @@ void evDevice::create_device(evPhysicalDevice& physical_device){
     std::vector<VkDeviceQueueCreateInfo> queue_create_infos;
     
     //Unique queue families stored in physical device wrapper
-    std::set<uint32_t> unique_queue_families = {physical_device.get().queue_family_indices.graphics_family.value(), physical_device.get().queue_family_indices.present_family.value()};
+    const QueueFamilyIndices& indices = physical_device.get().queue_family_indices;
+    std::set<uint32_t> unique_queue_families = {indices.graphics_family.value(), indices.present_family.value()};
+    if (indices.compute_family.has_value()) {
+        unique_queue_families.insert(indices.compute_family.value());
+    }
+    if (indices.transfer_family.has_value()) {
+        unique_queue_families.insert(indices.transfer_family.value());
+    }
     
     float queue_priority = 1.0f;
     for (uint32_t queue_family : unique_queue_families) {
@@ -24,13 +31,73 @@ void evDevice::create_device(evPhysicalDevice& physical_device){
         queue_create_infos.push_back(queue_create_info);
     }
     
+    const DeviceFeatureSupport& support = physical_device.get().feature_support;
+    
+    //Dynamic rendering, synchronization2 and timeline semaphores are used by every frame, the rest only when supported
+    VkPhysicalDeviceMeshShaderFeaturesEXT mesh_shader_features{};
+    mesh_shader_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_EXT;
+    mesh_shader_features.taskShader = support.task_shader;
+    mesh_shader_features.meshShader = support.mesh_shader;
+    
+    VkPhysicalDevicePresentIdFeaturesKHR present_id_features{};
+    present_id_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+    present_id_features.presentId = VK_TRUE;
+    
+    VkPhysicalDevicePresentWaitFeaturesKHR present_wait_features{};
+    present_wait_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+    present_wait_features.presentWait = VK_TRUE;
+    
+    VkPhysicalDeviceExtendedDynamicState3FeaturesEXT dynamic_state3_features{};
+    dynamic_state3_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_3_FEATURES_EXT;
+    dynamic_state3_features.extendedDynamicState3ColorBlendEnable = VK_TRUE;
+    dynamic_state3_features.extendedDynamicState3ColorBlendEquation = VK_TRUE;
+    
+    VkPhysicalDeviceVulkan13Features features13{};
+    features13.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+    features13.dynamicRendering = VK_TRUE;
+    features13.synchronization2 = VK_TRUE;
+    
+    VkPhysicalDeviceVulkan12Features features12{};
+    features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    features12.pNext = &features13;
+    features12.bufferDeviceAddress = support.buffer_device_address;
+    features12.drawIndirectCount = support.draw_indirect_count;
+    features12.timelineSemaphore = VK_TRUE;
+    features12.runtimeDescriptorArray = support.bindless_textures;
+    features12.descriptorBindingPartiallyBound = support.bindless_textures;
+    features12.shaderSampledImageArrayNonUniformIndexing = support.bindless_textures;
+    features12.descriptorBindingSampledImageUpdateAfterBind = support.bindless_textures;
+    
+    VkPhysicalDeviceFeatures2 device_features{};
+    device_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    device_features.pNext = &features12;
+    device_features.features.multiDrawIndirect = support.multi_draw_indirect;
+    
+    void** chain_end = &features13.pNext;
+    if (support.task_shader || support.mesh_shader) {
+        *chain_end = &mesh_shader_features;
+        chain_end = &mesh_shader_features.pNext;
+    }
+    if (support.present_id) {
+        *chain_end = &present_id_features;
+        chain_end = &present_id_features.pNext;
+    }
+    if (support.present_wait) {
+        *chain_end = &present_wait_features;
+        chain_end = &present_wait_features.pNext;
+    }
+    if (support.dynamic_blend) {
+        *chain_end = &dynamic_state3_features;
+        chain_end = &dynamic_state3_features.pNext;
+    }
+    
     //Logical device create info
-    VkPhysicalDeviceFeatures device_features{};
     VkDeviceCreateInfo create_info{};
     create_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    create_info.pNext = &device_features;
     create_info.queueCreateInfoCount = static_cast<uint32_t>(queue_create_infos.size());
     create_info.pQueueCreateInfos = queue_create_infos.data();
-    create_info.pEnabledFeatures = &device_features;
+    create_info.pEnabledFeatures = nullptr;
     create_info.enabledExtensionCount = static_cast<uint32_t>(physical_device.get().extensions_info.extensions.size());
     create_info.ppEnabledExtensionNames = physical_device.get().extensions_info.extensions.data();
     
@@ -43,6 +110,16 @@ void evDevice::create_device(evPhysicalDevice& physical_device){
     vkGetDeviceQueue(device_info.handle, physical_device.get().queue_family_indices.graphics_family.value(), 0, &device_info.graphics_queue);
     vkGetDeviceQueue(device_info.handle, physical_device.get().queue_family_indices.present_family.value(), 0, &device_info.presentation_queue);
     
+    device_info.compute_queue = device_info.graphics_queue;
+    if (indices.compute_family.has_value()) {
+        vkGetDeviceQueue(device_info.handle, indices.compute_family.value(), 0, &device_info.compute_queue);
+    }
+    
+    device_info.transfer_queue = device_info.graphics_queue;
+    if (indices.transfer_family.has_value()) {
+        vkGetDeviceQueue(device_info.handle, indices.transfer_family.value(), 0, &device_info.transfer_queue);
+    }
+    
 }
 
 void evDevice::clean_up() {
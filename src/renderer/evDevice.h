@@ -9,6 +9,9 @@ struct evDeviceInfo {
     VkDevice handle;
     VkQueue graphics_queue;
     VkQueue presentation_queue;
+    //Same as graphics_queue when the device has no dedicated family
+    VkQueue compute_queue;
+    VkQueue transfer_queue;
 };
 
 class evDevice {
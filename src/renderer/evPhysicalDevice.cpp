@@ -1,11 +1,51 @@
 #include "evPhysicalDevice.h"
+#include "DeviceBenchmark.h"
 #include "../utils/Logger.h"
+#include <cctype>
+#include <cstdlib>
 
-void evPhysicalDevice::init(VkInstance instance, VkSurfaceKHR surface){
-    pick_physical_device(instance, surface);
+namespace {
+    //Devices scoring this close to the best are benchmarked against each other
+    constexpr double BENCHMARK_TIE_RANGE = 0.1;
+
+    const char* device_type_name(VkPhysicalDeviceType type){
+        switch (type) {
+            case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU: return "discrete";
+            case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU: return "integrated";
+            case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU: return "virtual";
+            case VK_PHYSICAL_DEVICE_TYPE_CPU: return "cpu";
+            default: return "other";
+        }
+    }
+
+    bool matches_preferred(const std::string& preferred, uint32_t index, const char* name){
+        //Only a whole string of digits is an index, out of range numbers match no device
+        char* end = nullptr;
+        unsigned long number = std::strtoul(preferred.c_str(), &end, 10);
+        if (!preferred.empty() && std::isdigit(static_cast<unsigned char>(preferred[0])) && *end == '\0') {
+            return number == index;
+        }
+
+        auto lower = [](std::string text) {
+            std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+            return text;
+        };
+        return lower(name).find(lower(preferred)) != std::string::npos;
+    }
+}
+
+void evPhysicalDevice::init(VkInstance instance, VkSurfaceKHR surface, const DeviceSelection& selection){
+    pick_physical_device(instance, surface, selection);
 }
 
-void evPhysicalDevice::pick_physical_device(VkInstance instance, VkSurfaceKHR surface){
+void evPhysicalDevice::pick_physical_device(VkInstance instance, VkSurfaceKHR surface, DeviceSelection selection){
+    if (const char* preferred = std::getenv("EVOKE_GPU")) {
+        selection.preferred = preferred;
+    }
+    if (const char* benchmark = std::getenv("EVOKE_GPU_BENCHMARK")) {
+        selection.benchmark = strcmp(benchmark, "0") != 0;
+    }
+    
     //Check if physical devices exist
     uint32_t physical_device_count = 0;
     vkEnumeratePhysicalDevices(instance, &physical_device_count, nullptr);
@@ -18,41 +58,160 @@ void evPhysicalDevice::pick_physical_device(VkInstance instance, VkSurfaceKHR su
     std::vector<VkPhysicalDevice> physical_devices(physical_device_count);
     vkEnumeratePhysicalDevices(instance, &physical_device_count, physical_devices.data());
     
-    //Check which device is suitable
-    for (const auto& physical_device : physical_devices) {
-        if(is_device_suitable(physical_device, surface)){
-            //Store handle in wrapper struct
-            physical_device_info.handle = physical_device;
-            
-            //Query and store physical device properties and features in wrapper struct
-            vkGetPhysicalDeviceProperties(physical_device, &physical_device_info.properties);
-            vkGetPhysicalDeviceFeatures(physical_device, &physical_device_info.features);
-            
-            //Query and store queue family indices in wrapper struct
-            physical_device_info.queue_family_indices = query_queue_families(physical_device, surface);
-            
-            //Query and store all supported extensions
-            physical_device_info.extensions_info = query_extension_support(physical_device);
-            
-            //Query and store swapchain support info in wrapper struct
-            physical_device_info.swapchain_support = query_swapchain_support(physical_device, surface);
-            break;
+    struct Candidate {
+        evPhysicalDeviceInfo info;
+        uint32_t index;
+        uint64_t score;
+    };
+    
+    //Query each device once, the chosen one keeps its info
+    std::vector<Candidate> candidates;
+    for (uint32_t i = 0; i < physical_device_count; i++) {
+        evPhysicalDeviceInfo info = query_device(physical_devices[i], surface);
+        
+        if (!is_device_suitable(info)) {
+            evoke::utils::Logger::info("GPU ", i, ": ", info.properties.deviceName, " is not suitable!");
+            continue;
         }
+        
+        uint64_t score = score_device(info);
+        evoke::utils::Logger::info("GPU ", i, ": ", info.properties.deviceName, ", ", device_type_name(info.properties.deviceType), ", ", info.device_memory / (1024 * 1024), " MiB, score ", score, "!");
+        candidates.push_back({info, i, score});
     }
     
-    if (physical_device_info.handle == VK_NULL_HANDLE) {
+    if (candidates.empty()) {
         evoke::utils::Logger::error("No suitable physical devices found");
+        return;
     }
+    
+    std::stable_sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) { return a.score > b.score; });
+    const Candidate* chosen = nullptr;
+    
+    if (!selection.preferred.empty()) {
+        for (const Candidate& candidate : candidates) {
+            if (matches_preferred(selection.preferred, candidate.index, candidate.info.properties.deviceName)) {
+                chosen = &candidate;
+                break;
+            }
+        }
+        if (chosen == nullptr) {
+            evoke::utils::Logger::error("No suitable GPU matches ", selection.preferred, ", ranking by score!");
+        }
+    }
+    
+    if (chosen == nullptr) {
+        chosen = &candidates.front();
+        
+        uint64_t tie_score = static_cast<uint64_t>(static_cast<double>(chosen->score) * (1.0 - BENCHMARK_TIE_RANGE));
+        size_t tied = std::count_if(candidates.begin(), candidates.end(), [&](const Candidate& candidate) { return candidate.score >= tie_score; });
+        
+        if (selection.benchmark && tied > 1) {
+            double best_result = 0.0;
+            for (size_t i = 0; i < tied; i++) {
+                evoke::vulkan::DeviceBenchmarkResult result = evoke::vulkan::benchmark_device(candidates[i].info);
+                if (!result.valid) {
+                    evoke::utils::Logger::error("Benchmark failed on GPU ", candidates[i].index, "!");
+                    continue;
+                }
+                
+                evoke::utils::Logger::info("GPU ", candidates[i].index, " benchmark: ", result.fill_rate, " Gpixel/s fill, ", result.compute, " GFLOP/s compute!");
+                if (result.score() > best_result) {
+                    best_result = result.score();
+                    chosen = &candidates[i];
+                }
+            }
+        }
+    }
+    
+    physical_device_info = chosen->info;
+    evoke::utils::Logger::info("Using GPU ", chosen->index, ": ", physical_device_info.properties.deviceName, "!");
 }
 
-bool evPhysicalDevice::is_device_suitable(VkPhysicalDevice physical_device, VkSurfaceKHR surface){
-    QueueFamilyIndices indices = query_queue_families(physical_device, surface);
+evPhysicalDeviceInfo evPhysicalDevice::query_device(VkPhysicalDevice physical_device, VkSurfaceKHR surface){
+    evPhysicalDeviceInfo info = {};
+    info.handle = physical_device;
+    
+    //Query properties, features and memory layout
+    vkGetPhysicalDeviceProperties(physical_device, &info.properties);
+    vkGetPhysicalDeviceFeatures(physical_device, &info.features);
+    vkGetPhysicalDeviceMemoryProperties(physical_device, &info.memory_properties);
+    
+    for (uint32_t i = 0; i < info.memory_properties.memoryHeapCount; i++) {
+        const VkMemoryHeap& heap = info.memory_properties.memoryHeaps[i];
+        if (heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) {
+            info.device_memory = std::max(info.device_memory, heap.size);
+        }
+    }
+    
+    //Query queue families, extensions, swapchain support and optional features
+    info.queue_family_indices = query_queue_families(physical_device, surface);
+    info.extensions_info = query_extension_support(physical_device);
+    info.swapchain_support = query_swapchain_support(physical_device, surface);
+    info.feature_support = query_feature_support(physical_device, info.extensions_info, info.memory_properties);
+    info.depth_format = query_depth_format(physical_device);
     
-    ExtensionSupportInfo extension_info = query_extension_support(physical_device);
+    return info;
+}
+
+VkFormat evPhysicalDevice::query_depth_format(VkPhysicalDevice physical_device){
+    //Reverse-Z spreads float precision evenly over distance, unorm formats gain nothing from it
+    const VkFormat candidates[] = {VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT, VK_FORMAT_D16_UNORM};
     
-    SwapchainSupportInfo swapchain_info = query_swapchain_support(physical_device, surface);
+    for (VkFormat format : candidates) {
+        VkFormatProperties properties;
+        vkGetPhysicalDeviceFormatProperties(physical_device, format, &properties);
+        if (properties.optimalTilingFeatures & VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT) {
+            return format;
+        }
+    }
     
-    return indices.is_complete() && extension_info.is_adequate() && swapchain_info.is_adequate();
+    return VK_FORMAT_UNDEFINED;
+}
+
+bool evPhysicalDevice::is_device_suitable(const evPhysicalDeviceInfo& info){
+    return info.properties.apiVersion >= VK_API_VERSION_1_3 && info.depth_format != VK_FORMAT_UNDEFINED && info.queue_family_indices.is_complete()
+        && info.extensions_info.is_adequate() && info.swapchain_support.is_adequate();
+}
+
+uint64_t evPhysicalDevice::score_device(const evPhysicalDeviceInfo& info){
+    //Type outweighs everything else, a software rasterizer never beats real hardware
+    uint64_t score = 0;
+    switch (info.properties.deviceType) {
+        case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU: score += 1000000; break;
+        case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU: score += 500000; break;
+        case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU: score += 250000; break;
+        default: break;
+    }
+    
+    //One point per MiB of VRAM, capped so it cannot cross device types
+    score += std::min<uint64_t>(info.device_memory / (1024 * 1024), 200000);
+    
+    //Async compute and copies overlap with graphics
+    if (info.queue_family_indices.compute_family.has_value()) {
+        score += 4000;
+    }
+    if (info.queue_family_indices.transfer_family.has_value()) {
+        score += 2000;
+    }
+    
+    const DeviceFeatureSupport& support = info.feature_support;
+    if (support.mesh_shader && support.task_shader) {
+        score += 4000;
+    }
+    if (support.buffer_device_address && support.multi_draw_indirect) {
+        score += 2000;
+    }
+    if (support.draw_indirect_count) {
+        score += 1000;
+    }
+    if (support.bindless_textures) {
+        score += 2000;
+    }
+    if (support.host_visible_device_memory > 256ull * 1024 * 1024) {
+        score += 1000;
+    }
+    
+    return score;
 }
 
 QueueFamilyIndices evPhysicalDevice::query_queue_families(VkPhysicalDevice physical_device, VkSurfaceKHR surface){
@@ -69,20 +228,29 @@ QueueFamilyIndices evPhysicalDevice::query_queue_families(VkPhysicalDevice physi
     //Check if graphic and present families are supported and store indices
     uint32_t i = 0;
     for (const auto& queue_family : queue_families) {
-        if (queue_family.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+        if ((queue_family.queueFlags & VK_QUEUE_GRAPHICS_BIT) && !indices.graphics_family.has_value()) {
             indices.graphics_family = i;
         }
         
         VkBool32 present_support = false;
         vkGetPhysicalDeviceSurfaceSupportKHR(physical_device, i, surface, &present_support);
         
-        if (present_support) {
+        //Prefer presenting from the graphics family
+        if (present_support && (!indices.present_family.has_value() || indices.graphics_family == i)) {
             indices.present_family = i;
         }
         
-        if (indices.is_complete()) {
-                break;
-            }
+        //Async compute runs on a family without graphics, copies on one with neither
+        bool graphics = queue_family.queueFlags & VK_QUEUE_GRAPHICS_BIT;
+        bool compute = queue_family.queueFlags & VK_QUEUE_COMPUTE_BIT;
+        bool transfer = queue_family.queueFlags & VK_QUEUE_TRANSFER_BIT;
+        
+        if (compute && !graphics && !indices.compute_family.has_value()) {
+            indices.compute_family = i;
+        }
+        if (transfer && !graphics && !compute && !indices.transfer_family.has_value()) {
+            indices.transfer_family = i;
+        }
 
         i++;
     }
@@ -131,20 +299,103 @@ ExtensionSupportInfo evPhysicalDevice::query_extension_support(VkPhysicalDevice
     vkEnumerateDeviceExtensionProperties(physical_device, nullptr, &count, available_extensions.data());
 
     
-    //Fill extensions based on which required ones are available
-    for (const auto& required : info.required) {
-        bool found = false;
+    //Fill extensions based on which required and optional ones are available
+    auto add_if_available = [&](const char* wanted) {
         for (const auto& available : available_extensions) {
-            if (strcmp(required, available.extensionName) == 0) {
-                found = true;
-                break;
+            if (strcmp(wanted, available.extensionName) == 0) {
+                info.extensions.push_back(wanted);
+                return;
             }
         }
-
-        if (found) {
-            info.extensions.push_back(required);
-        }
+    };
+    
+    for (const auto& required : info.required) {
+        add_if_available(required);
+    }
+    
+    for (const auto& optional : info.optional) {
+        add_if_available(optional);
     }
 
     return info;
+}
+
+DeviceFeatureSupport evPhysicalDevice::query_feature_support(VkPhysicalDevice physical_device, const ExtensionSupportInfo& extensions_info, const VkPhysicalDeviceMemoryProperties& memory_properties){
+    DeviceFeatureSupport support;
+    
+    //Chain the feature structs we care about
+    VkPhysicalDeviceMeshShaderFeaturesEXT mesh_shader_features{};
+    mesh_shader_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_EXT;
+    
+    VkPhysicalDevicePresentIdFeaturesKHR present_id_features{};
+    present_id_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+    
+    VkPhysicalDevicePresentWaitFeaturesKHR present_wait_features{};
+    present_wait_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+    
+    VkPhysicalDeviceExtendedDynamicState3FeaturesEXT dynamic_state3_features{};
+    dynamic_state3_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_3_FEATURES_EXT;
+    
+    VkPhysicalDeviceVulkan12Features features12{};
+    features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    
+    VkPhysicalDeviceFeatures2 features2{};
+    features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features2.pNext = &features12;
+    
+    //Extension structs may only be chained when the extension exists
+    void** chain_end = &features12.pNext;
+    if (extensions_info.has(VK_EXT_MESH_SHADER_EXTENSION_NAME)) {
+        *chain_end = &mesh_shader_features;
+        chain_end = &mesh_shader_features.pNext;
+    }
+    if (extensions_info.has(VK_KHR_PRESENT_ID_EXTENSION_NAME)) {
+        *chain_end = &present_id_features;
+        chain_end = &present_id_features.pNext;
+    }
+    if (extensions_info.has(VK_KHR_PRESENT_WAIT_EXTENSION_NAME)) {
+        *chain_end = &present_wait_features;
+        chain_end = &present_wait_features.pNext;
+    }
+    if (extensions_info.has(VK_EXT_EXTENDED_DYNAMIC_STATE_3_EXTENSION_NAME)) {
+        *chain_end = &dynamic_state3_features;
+        chain_end = &dynamic_state3_features.pNext;
+    }
+    
+    vkGetPhysicalDeviceFeatures2(physical_device, &features2);
+    
+    support.buffer_device_address = features12.bufferDeviceAddress;
+    support.draw_indirect_count = features12.drawIndirectCount;
+    support.multi_draw_indirect = features2.features.multiDrawIndirect;
+    support.task_shader = mesh_shader_features.taskShader;
+    support.mesh_shader = mesh_shader_features.meshShader;
+    support.present_id = present_id_features.presentId;
+    //Waiting needs ids to wait on
+    support.present_wait = present_wait_features.presentWait && support.present_id;
+    support.timeline_semaphore = features12.timelineSemaphore;
+    support.memory_budget = extensions_info.has(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    support.bindless_textures = features12.runtimeDescriptorArray && features12.descriptorBindingPartiallyBound
+        && features12.shaderSampledImageArrayNonUniformIndexing && features12.descriptorBindingSampledImageUpdateAfterBind;
+    VkPhysicalDeviceSubgroupProperties subgroup_properties{};
+    subgroup_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SUBGROUP_PROPERTIES;
+    
+    VkPhysicalDeviceProperties2 properties2{};
+    properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties2.pNext = &subgroup_properties;
+    vkGetPhysicalDeviceProperties2(physical_device, &properties2);
+    
+    support.subgroup_arithmetic = (subgroup_properties.supportedStages & VK_SHADER_STAGE_COMPUTE_BIT)
+        && (subgroup_properties.supportedOperations & VK_SUBGROUP_FEATURE_ARITHMETIC_BIT);
+    support.dynamic_blend = dynamic_state3_features.extendedDynamicState3ColorBlendEnable && dynamic_state3_features.extendedDynamicState3ColorBlendEquation;
+    
+    //Without resizable BAR only a 256 MiB window of VRAM is host visible
+    const VkMemoryPropertyFlags mappable_vram = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    for (uint32_t i = 0; i < memory_properties.memoryTypeCount; i++) {
+        const VkMemoryType& type = memory_properties.memoryTypes[i];
+        if ((type.propertyFlags & mappable_vram) == mappable_vram) {
+            support.host_visible_device_memory = std::max(support.host_visible_device_memory, memory_properties.memoryHeaps[type.heapIndex].size);
+        }
+    }
+    
+    return support;
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 #include "vulkan/vulkan.h"
 #include <optional>
+#include <string>
 #include <vector>
 #include <algorithm>
 #include <cstring>
@@ -10,6 +11,9 @@
 struct QueueFamilyIndices {
     std::optional<uint32_t> graphics_family;
     std::optional<uint32_t> present_family;
+    //Dedicated families without graphics, empty if the device has none
+    std::optional<uint32_t> compute_family;
+    std::optional<uint32_t> transfer_family;
 
     bool is_complete() const {
         return graphics_family.has_value() && present_family.has_value();
@@ -32,39 +36,94 @@ struct ExtensionSupportInfo {
     std::vector<const char*> required = {
         VK_KHR_SWAPCHAIN_EXTENSION_NAME
     };
+    //Enabled when available, render paths check for them with has()
+    std::vector<const char*> optional = {
+        VK_EXT_MESH_SHADER_EXTENSION_NAME,
+        VK_KHR_PRESENT_ID_EXTENSION_NAME,
+        VK_KHR_PRESENT_WAIT_EXTENSION_NAME,
+        VK_EXT_MEMORY_BUDGET_EXTENSION_NAME,
+        VK_EXT_EXTENDED_DYNAMIC_STATE_3_EXTENSION_NAME
+    };
     std::vector<const char*> extensions;
     
+    bool has(const char* extension) const {
+        return std::find_if(extensions.begin(), extensions.end(), [&](const char* name) { return strcmp(name, extension) == 0; }) != extensions.end();
+    }
+    
     bool is_adequate() const {
         for (const char* required_extension : required) {
-            if (std::find(extensions.begin(), extensions.end(), required_extension) == extensions.end())
+            if (!has(required_extension))
                 return false;
         }
         return true;
     }
 };
 
+//Wrapper for optional device features
+struct DeviceFeatureSupport {
+    bool buffer_device_address = false;
+    bool draw_indirect_count = false;
+    bool multi_draw_indirect = false;
+    bool task_shader = false;
+    bool mesh_shader = false;
+    bool present_id = false;
+    bool present_wait = false;
+    bool timeline_semaphore = false;
+    //Per heap budget and usage from the driver
+    bool memory_budget = false;
+    //Sampled image arrays indexed per draw and written while bound
+    bool bindless_textures = false;
+    //Blend enable and equation set while recording, the rest of extended dynamic state is core since 1.3
+    bool dynamic_blend = false;
+    //Subgroup scans and reductions in compute shaders, core since 1.1 but optional
+    bool subgroup_arithmetic = false;
+    //Largest device local heap the CPU can map directly
+    VkDeviceSize host_visible_device_memory = 0;
+};
+
 //Wrapper for physical device
 struct evPhysicalDeviceInfo {
     VkPhysicalDevice handle;
     VkPhysicalDeviceProperties properties;
     VkPhysicalDeviceFeatures features;
+    VkPhysicalDeviceMemoryProperties memory_properties;
     QueueFamilyIndices queue_family_indices;
     SwapchainSupportInfo swapchain_support;
     ExtensionSupportInfo extensions_info;
+    DeviceFeatureSupport feature_support;
+    //Largest device local heap
+    VkDeviceSize device_memory;
+    //Most precise depth attachment format, float first for reverse-Z
+    VkFormat depth_format;
+};
+
+//How to choose between several suitable GPUs. The EVOKE_GPU and EVOKE_GPU_BENCHMARK
+//environment variables override the fields of the same meaning.
+struct DeviceSelection {
+    //Enumeration index or case insensitive part of the device name, empty ranks by score
+    std::string preferred;
+    //Breaks near ties in score with a short fill rate and compute benchmark
+    bool benchmark = false;
 };
 
 class evPhysicalDevice {
 public:
-    void init(VkInstance instance, VkSurfaceKHR surface);
+    void init(VkInstance instance, VkSurfaceKHR surface, const DeviceSelection& selection = {});
     
     const evPhysicalDeviceInfo& get() const { return physical_device_info; }
     
 private:
     evPhysicalDeviceInfo physical_device_info = {};
     
-    void pick_physical_device(VkInstance instance, VkSurfaceKHR surface);
-    bool is_device_suitable(VkPhysicalDevice physical_device, VkSurfaceKHR surface);
+    void pick_physical_device(VkInstance instance, VkSurfaceKHR surface, DeviceSelection selection);
+    //Every query for one device, each device is queried once
+    evPhysicalDeviceInfo query_device(VkPhysicalDevice physical_device, VkSurfaceKHR surface);
+    bool is_device_suitable(const evPhysicalDeviceInfo& info);
+    //Device type first, then VRAM, queue topology and optional features
+    uint64_t score_device(const evPhysicalDeviceInfo& info);
+    VkFormat query_depth_format(VkPhysicalDevice physical_device);
     QueueFamilyIndices query_queue_families(VkPhysicalDevice physical_device, VkSurfaceKHR surface);
     SwapchainSupportInfo query_swapchain_support(VkPhysicalDevice physical_device, VkSurfaceKHR surface);
     ExtensionSupportInfo query_extension_support(VkPhysicalDevice physical_device);
+    DeviceFeatureSupport query_feature_support(VkPhysicalDevice physical_device, const ExtensionSupportInfo& extensions_info, const VkPhysicalDeviceMemoryProperties& memory_properties);
 };
\ No newline at end of file
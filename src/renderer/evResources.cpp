@@ -0,0 +1,415 @@
+#include "evResources.h"
+#include "ShaderLibrary.h"
+#include <algorithm>
+
+using evoke::vulkan::MemoryCategory;
+
+namespace {
+    MemoryCategory buffer_category(VkBufferUsageFlags usage, VkMemoryPropertyFlags properties){
+        if (!(properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)) {
+            return MemoryCategory::Geometry;
+        }
+        const VkBufferUsageFlags transfer = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+        if ((usage & ~transfer) == 0 && !(properties & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)) {
+            return MemoryCategory::Staging;
+        }
+        return MemoryCategory::Transient;
+    }
+
+    MemoryCategory image_category(VkImageUsageFlags usage){
+        //Render targets are sampled too, but recreated with the swapchain
+        if (usage & (VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT)) {
+            return MemoryCategory::Transient;
+        }
+        return (usage & VK_IMAGE_USAGE_SAMPLED_BIT) ? MemoryCategory::Textures : MemoryCategory::Transient;
+    }
+}
+
+void evResources::init(VkDevice device, VkPhysicalDevice physical_device){
+    this->device = device;
+
+    //Memory properties never change for a device, query them once
+    vkGetPhysicalDeviceMemoryProperties(physical_device, &memory_properties);
+}
+
+void evResources::clean_up(){
+    evoke::utils::Logger::info("Cleaning up resources!");
+
+    pipelines.for_each([&](PipelineHandle, evPipeline& pipeline) {
+        vkDestroyPipeline(device, pipeline.handle, nullptr);
+        if (pipeline.owns_layout) {
+            vkDestroyPipelineLayout(device, pipeline.layout, nullptr);
+        }
+    });
+    pipelines.clear();
+
+    for (auto& [key, layout] : pipeline_layouts) {
+        vkDestroyPipelineLayout(device, layout, nullptr);
+    }
+    pipeline_layouts.clear();
+
+    for (auto& [key, layout] : set_layouts) {
+        vkDestroyDescriptorSetLayout(device, layout, nullptr);
+    }
+    set_layouts.clear();
+
+    images.for_each([&](ImageHandle, evImage& image) {
+        vkDestroyImageView(device, image.view, nullptr);
+        vkDestroyImage(device, image.handle, nullptr);
+        free_memory(image.memory, image.allocation_size, image.heap, image.category);
+    });
+    images.clear();
+
+    buffers.for_each([&](BufferHandle, evBuffer& buffer) {
+        vkDestroyBuffer(device, buffer.handle, nullptr);
+        free_memory(buffer.memory, buffer.allocation_size, buffer.heap, buffer.category);
+    });
+    buffers.clear();
+
+    evoke::utils::Logger::info("Resources cleaned up successfully!");
+}
+
+BufferHandle evResources::create_buffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, bool shared){
+    evBuffer buffer{};
+    buffer.size = size;
+
+    VkBufferCreateInfo buffer_info{};
+    buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    buffer_info.size = size;
+    buffer_info.usage = usage;
+    buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    
+    //Concurrent sharing only means something with more than one family
+    if (shared && queue_families.size() > 1) {
+        buffer_info.sharingMode = VK_SHARING_MODE_CONCURRENT;
+        buffer_info.queueFamilyIndexCount = static_cast<uint32_t>(queue_families.size());
+        buffer_info.pQueueFamilyIndices = queue_families.data();
+    }
+
+    if (vkCreateBuffer(device, &buffer_info, nullptr, &buffer.handle) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create buffer!");
+    }
+
+    VkMemoryRequirements requirements;
+    vkGetBufferMemoryRequirements(device, buffer.handle, &requirements);
+
+    //Buffers read through buffer references need device address capable memory
+    bool device_address = (usage & VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT) != 0;
+    
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    buffer.category = buffer_category(usage, properties);
+    buffer.allocation_size = requirements.size;
+    buffer.memory = allocate_memory(requirements, properties, buffer.category, buffer.heap, device_address ? VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT : 0);
+    vkBindBufferMemory(device, buffer.handle, buffer.memory, 0);
+    
+    if (device_address) {
+        VkBufferDeviceAddressInfo address_info{};
+        address_info.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO;
+        address_info.buffer = buffer.handle;
+        buffer.address = vkGetBufferDeviceAddress(device, &address_info);
+    }
+
+    return buffers.insert(buffer);
+}
+
+void evResources::destroy_buffer(BufferHandle handle){
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    evBuffer buffer = buffers.remove(handle);
+    vkDestroyBuffer(device, buffer.handle, nullptr);
+    free_memory(buffer.memory, buffer.allocation_size, buffer.heap, buffer.category);
+}
+
+void* evResources::map_buffer(BufferHandle handle){
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    evBuffer& buffer = buffers.get(handle);
+    
+    if (buffer.mapped == nullptr) {
+        if (vkMapMemory(device, buffer.memory, 0, VK_WHOLE_SIZE, 0, &buffer.mapped) != VK_SUCCESS) {
+            throw std::runtime_error("failed to map buffer memory!");
+        }
+    }
+    
+    return buffer.mapped;
+}
+
+void evResources::invalidate_buffer(BufferHandle handle){
+    const evBuffer& buffer = buffers.get(handle);
+
+    VkMappedMemoryRange range{};
+    range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+    range.memory = buffer.memory;
+    range.offset = 0;
+    range.size = VK_WHOLE_SIZE;
+    vkInvalidateMappedMemoryRanges(device, 1, &range);
+}
+
+ImageHandle evResources::create_image(VkExtent2D extent, VkFormat format, VkImageUsageFlags usage, VkImageAspectFlags aspect){
+    evImage image{};
+    image.format = format;
+    image.extent = extent;
+
+    VkImageCreateInfo image_info{};
+    image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    image_info.imageType = VK_IMAGE_TYPE_2D;
+    image_info.extent = {extent.width, extent.height, 1};
+    image_info.mipLevels = 1;
+    image_info.arrayLayers = 1;
+    image_info.format = format;
+    image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+    image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    image_info.usage = usage;
+    image_info.samples = VK_SAMPLE_COUNT_1_BIT;
+    image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    if (vkCreateImage(device, &image_info, nullptr, &image.handle) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create image!");
+    }
+
+    VkMemoryRequirements requirements;
+    vkGetImageMemoryRequirements(device, image.handle, &requirements);
+
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    image.category = image_category(usage);
+    image.allocation_size = requirements.size;
+    image.memory = allocate_memory(requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image.category, image.heap);
+    vkBindImageMemory(device, image.handle, image.memory, 0);
+
+    VkImageViewCreateInfo view_info{};
+    view_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    view_info.image = image.handle;
+    view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    view_info.format = format;
+    view_info.subresourceRange.aspectMask = aspect;
+    view_info.subresourceRange.baseMipLevel = 0;
+    view_info.subresourceRange.levelCount = 1;
+    view_info.subresourceRange.baseArrayLayer = 0;
+    view_info.subresourceRange.layerCount = 1;
+
+    if (vkCreateImageView(device, &view_info, nullptr, &image.view) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create image view!");
+    }
+
+    return images.insert(image);
+}
+
+void evResources::destroy_image(ImageHandle handle){
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    evImage image = images.remove(handle);
+    vkDestroyImageView(device, image.view, nullptr);
+    vkDestroyImage(device, image.handle, nullptr);
+    free_memory(image.memory, image.allocation_size, image.heap, image.category);
+}
+
+PipelineHandle evResources::add_pipeline(VkPipeline pipeline, VkPipelineLayout layout, bool owns_layout){
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    return pipelines.insert({pipeline, layout, owns_layout});
+}
+
+void evResources::replace_pipeline(PipelineHandle handle, VkPipeline pipeline, VkPipelineLayout layout, bool owns_layout){
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    evPipeline& current = pipelines.get(handle);
+    vkDestroyPipeline(device, current.handle, nullptr);
+    if (current.owns_layout) {
+        vkDestroyPipelineLayout(device, current.layout, nullptr);
+    }
+    current = {pipeline, layout, owns_layout};
+}
+
+void evResources::destroy_pipeline(PipelineHandle handle){
+    if (shader_library) {
+        shader_library->untrack(handle);
+    }
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    evPipeline pipeline = pipelines.remove(handle);
+    vkDestroyPipeline(device, pipeline.handle, nullptr);
+    if (pipeline.owns_layout) {
+        vkDestroyPipelineLayout(device, pipeline.layout, nullptr);
+    }
+}
+
+namespace {
+    template<typename T>
+    void append_key(std::string& key, const T& value){
+        key.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+}
+
+VkDescriptorSetLayout evResources::get_set_layout(const std::vector<VkDescriptorSetLayoutBinding>& bindings, const std::vector<VkDescriptorBindingFlags>& binding_flags){
+    if (!binding_flags.empty() && binding_flags.size() != bindings.size()) {
+        throw std::runtime_error("descriptor binding flags do not match the bindings!");
+    }
+
+    std::string key;
+    for (const VkDescriptorSetLayoutBinding& binding : bindings) {
+        append_key(key, binding.binding);
+        append_key(key, binding.descriptorType);
+        append_key(key, binding.descriptorCount);
+        append_key(key, binding.stageFlags);
+    }
+    for (VkDescriptorBindingFlags flags : binding_flags) {
+        append_key(key, flags);
+    }
+
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    auto found = set_layouts.find(key);
+    if (found != set_layouts.end()) {
+        return found->second;
+    }
+
+    VkDescriptorSetLayoutCreateInfo layout_info{};
+    layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layout_info.bindingCount = static_cast<uint32_t>(bindings.size());
+    layout_info.pBindings = bindings.data();
+
+    VkDescriptorSetLayoutBindingFlagsCreateInfo flags_info{};
+    if (!binding_flags.empty()) {
+        flags_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+        flags_info.bindingCount = static_cast<uint32_t>(binding_flags.size());
+        flags_info.pBindingFlags = binding_flags.data();
+        layout_info.pNext = &flags_info;
+
+        bool update_after_bind = std::any_of(binding_flags.begin(), binding_flags.end(), [](VkDescriptorBindingFlags flags) { return (flags & VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT) != 0; });
+        if (update_after_bind) {
+            layout_info.flags |= VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+        }
+    }
+
+    VkDescriptorSetLayout layout;
+    if (vkCreateDescriptorSetLayout(device, &layout_info, nullptr, &layout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create descriptor set layout!");
+    }
+
+    set_layouts.emplace(std::move(key), layout);
+    return layout;
+}
+
+VkPipelineLayout evResources::get_pipeline_layout(const std::vector<VkDescriptorSetLayout>& layouts, const VkPushConstantRange& push_constants){
+    std::string key;
+    for (VkDescriptorSetLayout layout : layouts) {
+        append_key(key, layout);
+    }
+    append_key(key, push_constants.stageFlags);
+    append_key(key, push_constants.size);
+
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    auto found = pipeline_layouts.find(key);
+    if (found != pipeline_layouts.end()) {
+        return found->second;
+    }
+
+    VkPipelineLayoutCreateInfo pipeline_layout_info{};
+    pipeline_layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipeline_layout_info.setLayoutCount = static_cast<uint32_t>(layouts.size());
+    pipeline_layout_info.pSetLayouts = layouts.data();
+    pipeline_layout_info.pushConstantRangeCount = push_constants.size > 0 ? 1 : 0;
+    pipeline_layout_info.pPushConstantRanges = &push_constants;
+
+    VkPipelineLayout layout;
+    if (vkCreatePipelineLayout(device, &pipeline_layout_info, nullptr, &layout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create pipeline layout!");
+    }
+
+    pipeline_layouts.emplace(std::move(key), layout);
+    return layout;
+}
+
+uint32_t evResources::find_memory_type(uint32_t type_filter, VkMemoryPropertyFlags properties) const {
+    for (uint32_t i = 0; i < memory_properties.memoryTypeCount; i++) {
+        if ((type_filter & (1 << i)) && (memory_properties.memoryTypes[i].propertyFlags & properties) == properties) {
+            return i;
+        }
+    }
+
+    throw std::runtime_error("failed to find suitable memory type!");
+}
+
+bool evResources::has_memory_type(VkMemoryPropertyFlags properties) const {
+    for (uint32_t i = 0; i < memory_properties.memoryTypeCount; i++) {
+        if ((memory_properties.memoryTypes[i].propertyFlags & properties) == properties) {
+            return true;
+        }
+    }
+    return false;
+}
+
+VkDeviceMemory evResources::allocate_memory(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, MemoryCategory category, uint32_t& heap, VkMemoryAllocateFlags flags){
+    uint32_t memory_type = find_memory_type(requirements.memoryTypeBits, properties);
+    heap = memory_properties.memoryTypes[memory_type].heapIndex;
+
+    //Same properties minus device local, on a heap outside VRAM
+    auto find_fallback = [&]() -> int32_t {
+        if (!(properties & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)) {
+            return -1;
+        }
+        VkMemoryPropertyFlags fallback_properties = properties & ~VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+        for (uint32_t i = 0; i < memory_properties.memoryTypeCount; i++) {
+            const VkMemoryType& type = memory_properties.memoryTypes[i];
+            bool system_heap = !(memory_properties.memoryHeaps[type.heapIndex].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT);
+            if ((requirements.memoryTypeBits & (1 << i)) && system_heap && (type.propertyFlags & fallback_properties) == fallback_properties) {
+                return static_cast<int32_t>(i);
+            }
+        }
+        return -1;
+    };
+
+    //Let the eviction callbacks make room before going over budget
+    bool fits = memory_budget == nullptr || memory_budget->reserve(heap, requirements.size);
+    int32_t fallback_type = fits ? -1 : find_fallback();
+
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkResult result = VK_ERROR_OUT_OF_DEVICE_MEMORY;
+
+    //Over budget with nowhere else to go still tries, the driver may page rather than fail
+    if (fallback_type < 0) {
+        result = try_allocate(requirements, memory_type, flags, memory);
+        
+        if (result == VK_ERROR_OUT_OF_DEVICE_MEMORY && memory_budget != nullptr && memory_budget->evict(heap, requirements.size) > 0) {
+            result = try_allocate(requirements, memory_type, flags, memory);
+        }
+        if (result != VK_SUCCESS) {
+            fallback_type = find_fallback();
+        }
+    }
+
+    //Slower system memory instead of a crash
+    if (result != VK_SUCCESS && fallback_type >= 0) {
+        result = try_allocate(requirements, static_cast<uint32_t>(fallback_type), flags, memory);
+        if (result == VK_SUCCESS) {
+            heap = memory_properties.memoryTypes[fallback_type].heapIndex;
+            evoke::utils::Logger::error("Out of VRAM, placed ", requirements.size / 1024, " KiB of ", evoke::vulkan::to_string(category), " in system memory!");
+            if (memory_budget != nullptr) {
+                memory_budget->track_fallback();
+            }
+        }
+    }
+
+    if (result != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate memory!");
+    }
+
+    if (memory_budget != nullptr) {
+        memory_budget->track_allocation(heap, category, requirements.size);
+    }
+    return memory;
+}
+
+VkResult evResources::try_allocate(const VkMemoryRequirements& requirements, uint32_t memory_type, VkMemoryAllocateFlags flags, VkDeviceMemory& memory){
+    VkMemoryAllocateFlagsInfo flags_info{};
+    flags_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO;
+    flags_info.flags = flags;
+    
+    VkMemoryAllocateInfo alloc_info{};
+    alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    alloc_info.pNext = flags != 0 ? &flags_info : nullptr;
+    alloc_info.allocationSize = requirements.size;
+    alloc_info.memoryTypeIndex = memory_type;
+
+    return vkAllocateMemory(device, &alloc_info, nullptr, &memory);
+}
+
+void evResources::free_memory(VkDeviceMemory memory, VkDeviceSize size, uint32_t heap, MemoryCategory category){
+    vkFreeMemory(device, memory, nullptr);
+    if (memory_budget != nullptr) {
+        memory_budget->track_free(heap, category, size);
+    }
+}
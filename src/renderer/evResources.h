@@ -0,0 +1,126 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "../utils/HandlePool.h"
+#include "../utils/Logger.h"
+#include "MemoryBudget.h"
+
+//Wrapper for buffer
+struct evBuffer {
+    VkBuffer handle = VK_NULL_HANDLE;
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize size = 0;
+    VkDeviceAddress address = 0;
+    void* mapped = nullptr;
+    //Budget accounting of the allocation behind memory
+    VkDeviceSize allocation_size = 0;
+    uint32_t heap = 0;
+    evoke::vulkan::MemoryCategory category = evoke::vulkan::MemoryCategory::Geometry;
+};
+
+//Wrapper for image and its default view
+struct evImage {
+    VkImage handle = VK_NULL_HANDLE;
+    VkImageView view = VK_NULL_HANDLE;
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkFormat format = VK_FORMAT_UNDEFINED;
+    VkExtent2D extent = {0, 0};
+    VkDeviceSize allocation_size = 0;
+    uint32_t heap = 0;
+    evoke::vulkan::MemoryCategory category = evoke::vulkan::MemoryCategory::Textures;
+};
+
+//Wrapper for pipeline and its layout
+struct evPipeline {
+    VkPipeline handle = VK_NULL_HANDLE;
+    VkPipelineLayout layout = VK_NULL_HANDLE;
+    //False when the layout comes from the layout cache and is shared with other pipelines
+    bool owns_layout = true;
+};
+
+using BufferHandle = evoke::utils::Handle<struct BufferTag>;
+using ImageHandle = evoke::utils::Handle<struct ImageTag>;
+using PipelineHandle = evoke::utils::Handle<struct PipelineTag>;
+
+namespace evoke::vulkan {
+    class ShaderLibrary;
+}
+
+//Owns every renderer-created buffer, image and pipeline. Everything else refers to them by handle.
+//Creating and destroying may happen from several threads, e.g. startup stages. Lookups take no lock
+//and stay valid while other threads create, a handle just must not be destroyed while in use.
+class evResources {
+public:
+    void init(VkDevice device, VkPhysicalDevice physical_device);
+    void clean_up();
+
+    //Queue families that shared resources are visible to without ownership transfers
+    void set_queue_families(const std::vector<uint32_t>& families) { queue_families = families; }
+
+    //Owned by the caller. Allocations are reported to it and evict before they exceed the budget.
+    //Buffers are categorized by usage and memory: host only transfer buffers are staging, other host
+    //visible ones transient, the rest geometry. Sampled images are textures, the rest transient.
+    void set_memory_budget(evoke::vulkan::MemoryBudget* budget) { memory_budget = budget; }
+
+    //shared buffers can be used from every queue family at once, e.g. written by async compute and read by graphics
+    BufferHandle create_buffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, bool shared = false);
+    void destroy_buffer(BufferHandle handle);
+    //Maps host visible memory once, the mapping lives until the buffer is destroyed
+    void* map_buffer(BufferHandle handle);
+    //Makes GPU writes visible through the mapping, needed for host cached memory that is not coherent
+    void invalidate_buffer(BufferHandle handle);
+
+    ImageHandle create_image(VkExtent2D extent, VkFormat format, VkImageUsageFlags usage, VkImageAspectFlags aspect);
+    void destroy_image(ImageHandle handle);
+
+    PipelineHandle add_pipeline(VkPipeline pipeline, VkPipelineLayout layout, bool owns_layout = true);
+    //Swaps a rebuilt pipeline in under the same handle and destroys the old one, the GPU must be idle
+    void replace_pipeline(PipelineHandle handle, VkPipeline pipeline, VkPipelineLayout layout, bool owns_layout = true);
+
+    //Layouts are cached by their contents, identical requests get the same handle back. Pipelines with
+    //the same layout stay compatible, so switching between them keeps bound descriptor sets valid.
+    //Cached layouts live until clean_up. Binding flags, one per binding, may mark bindings update after bind.
+    VkDescriptorSetLayout get_set_layout(const std::vector<VkDescriptorSetLayoutBinding>& bindings, const std::vector<VkDescriptorBindingFlags>& binding_flags = {});
+    VkPipelineLayout get_pipeline_layout(const std::vector<VkDescriptorSetLayout>& set_layouts, const VkPushConstantRange& push_constants);
+    void destroy_pipeline(PipelineHandle handle);
+
+    const evBuffer& get(BufferHandle handle) const { return buffers.get(handle); }
+    const evImage& get(ImageHandle handle) const { return images.get(handle); }
+    const evPipeline& get(PipelineHandle handle) const { return pipelines.get(handle); }
+
+    //Owned by the caller, pipelines load their SPIR-V through it
+    void set_shader_library(evoke::vulkan::ShaderLibrary* library) { shader_library = library; }
+    evoke::vulkan::ShaderLibrary& get_shader_library() const { return *shader_library; }
+
+    uint32_t find_memory_type(uint32_t type_filter, VkMemoryPropertyFlags properties) const;
+    //Whether any memory type has all of the properties, e.g. to prefer host cached memory for readbacks
+    bool has_memory_type(VkMemoryPropertyFlags properties) const;
+
+private:
+    VkDevice device = VK_NULL_HANDLE;
+    VkPhysicalDeviceMemoryProperties memory_properties{};
+    std::vector<uint32_t> queue_families;
+    evoke::vulkan::ShaderLibrary* shader_library = nullptr;
+    evoke::vulkan::MemoryBudget* memory_budget = nullptr;
+
+    evoke::utils::HandlePool<evBuffer, struct BufferTag> buffers;
+    evoke::utils::HandlePool<evImage, struct ImageTag> images;
+    evoke::utils::HandlePool<evPipeline, struct PipelineTag> pipelines;
+
+    //Keyed by the serialized create info, so equal hashes with different contents cannot collide
+    std::unordered_map<std::string, VkDescriptorSetLayout> set_layouts;
+    std::unordered_map<std::string, VkPipelineLayout> pipeline_layouts;
+
+    //Recursive since allocations may evict, and eviction callbacks destroy resources
+    std::recursive_mutex mutex;
+
+    //Evicts when over budget, and when VRAM stays exhausted falls back to system memory for requests that
+    //allow it instead of failing. Throws only when no memory type can hold the allocation.
+    VkDeviceMemory allocate_memory(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, evoke::vulkan::MemoryCategory category, uint32_t& heap, VkMemoryAllocateFlags flags = 0);
+    void free_memory(VkDeviceMemory memory, VkDeviceSize size, uint32_t heap, evoke::vulkan::MemoryCategory category);
+    VkResult try_allocate(const VkMemoryRequirements& requirements, uint32_t memory_type, VkMemoryAllocateFlags flags, VkDeviceMemory& memory);
+};
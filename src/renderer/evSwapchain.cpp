@@ -26,7 +26,12 @@ void evSwapchain::create_swapchain(VkDevice device, evPhysicalDevice& physical_d
     create_info.imageColorSpace = swapchain_info.surface_format.colorSpace;
     create_info.imageExtent = swapchain_info.extent;
     create_info.imageArrayLayers = 1;
-    create_info.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+    //Transfer source lets frames be read back for captures
+    swapchain_info.image_usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+    if (physical_device.get().swapchain_support.capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_SRC_BIT) {
+        swapchain_info.image_usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    }
+    create_info.imageUsage = swapchain_info.image_usage;
 
     //Check if graphics and presentation family is the same
     uint32_t queue_family_indices[] = {
@@ -76,7 +81,12 @@ VkSurfaceFormatKHR evSwapchain::choose_surface_format(const std::vector<VkSurfac
     return available_formats[0];
 }
 VkPresentModeKHR evSwapchain::choose_present_mode(const std::vector<VkPresentModeKHR>& available_present_modes){
-    //Loop through present modes and find one that meets requirements
+    //Loop through present modes and find the preferred one, then mailbox
+    for (const auto& available_present_mode : available_present_modes) {
+        if (available_present_mode == preferred_present_mode) {
+            return available_present_mode;
+        }
+    }
     for (const auto& available_present_mode : available_present_modes) {
         if (available_present_mode == VK_PRESENT_MODE_MAILBOX_KHR) {
             return available_present_mode;
@@ -13,17 +13,22 @@ struct evSwapchainInfo{
     VkSurfaceFormatKHR surface_format;
     VkPresentModeKHR present_mode;
     VkExtent2D extent;
+    VkImageUsageFlags image_usage;
 };
 
 class evSwapchain{
 public:
     void init(VkDevice device, evPhysicalDevice& physical_device, VkSurfaceKHR surface, GLFWwindow* window);
     void clean_up(VkDevice device);
+    
+    //Used on the next init when the surface supports it, MAILBOX otherwise, falling back to FIFO
+    void set_preferred_present_mode(VkPresentModeKHR present_mode) { preferred_present_mode = present_mode; }
 
     const evSwapchainInfo& get() const { return swapchain_info;}
 
 private:
     evSwapchainInfo swapchain_info;
+    VkPresentModeKHR preferred_present_mode = VK_PRESENT_MODE_MAILBOX_KHR;
 
     void create_swapchain(VkDevice device, evPhysicalDevice& physical_device, VkSurfaceKHR surface, GLFWwindow* window);
     VkSurfaceFormatKHR choose_surface_format(const std::vector<VkSurfaceFormatKHR>& available_formats);
@@ -0,0 +1,64 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+namespace evoke::scene {
+    //Six normalized clip planes (left, right, bottom, top, then near and far, or far and near
+    //for a reverse-Z matrix), xyz = normal, w = distance
+    struct Frustum {
+        glm::vec4 planes[6];
+
+        //Gribb/Hartmann extraction for a Vulkan style [0, 1] depth range
+        static Frustum from_matrix(const glm::mat4& view_proj) {
+            glm::mat4 m = glm::transpose(view_proj);
+
+            Frustum frustum;
+            frustum.planes[0] = m[3] + m[0];
+            frustum.planes[1] = m[3] - m[0];
+            frustum.planes[2] = m[3] + m[1];
+            frustum.planes[3] = m[3] - m[1];
+            frustum.planes[4] = m[2];
+            frustum.planes[5] = m[3] - m[2];
+
+            for (auto& plane : frustum.planes) {
+                plane /= glm::length(glm::vec3(plane));
+            }
+
+            return frustum;
+        }
+
+        bool intersects_sphere(const glm::vec3& center, float radius) const {
+            for (const auto& plane : planes) {
+                if (glm::dot(glm::vec3(plane), center) + plane.w < -radius) {
+                    return false;
+                }
+            }
+            return true;
+        }
+    };
+
+    struct Camera {
+        glm::vec3 position = {0.0f, 0.0f, 3.0f};
+        glm::vec3 target = {0.0f, 0.0f, 0.0f};
+        glm::vec3 up = {0.0f, 1.0f, 0.0f};
+        float fov_y = glm::radians(60.0f);
+        float near_plane = 0.1f;
+        float far_plane = 100.0f;
+
+        glm::mat4 view() const {
+            return glm::lookAt(position, target, up);
+        }
+
+        //Right handed, reverse-Z [1, 0] depth and y flipped for Vulkan clip space. Swapping near and
+        //far puts the float precision where the distance is, clear depth to 0 and test GREATER.
+        glm::mat4 projection(float aspect) const {
+            glm::mat4 proj = glm::perspectiveRH_ZO(fov_y, aspect, far_plane, near_plane);
+            proj[1][1] *= -1.0f;
+            return proj;
+        }
+
+        glm::mat4 view_projection(float aspect) const {
+            return projection(aspect) * view();
+        }
+    };
+}
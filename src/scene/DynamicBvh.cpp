@@ -0,0 +1,551 @@
+#include "DynamicBvh.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define EVOKE_BVH_SSE
+#endif
+
+namespace evoke::scene {
+    namespace {
+        constexpr uint32_t RAY_BATCH_SIZE = 16;
+
+        //Four floats, one per child of a flat node
+#ifdef EVOKE_BVH_SSE
+        using Lanes = __m128;
+
+        Lanes load(const float* values) { return _mm_load_ps(values); }
+        Lanes splat(float value) { return _mm_set1_ps(value); }
+        void store(float* values, Lanes lanes) { _mm_store_ps(values, lanes); }
+        Lanes add(Lanes l, Lanes r) { return _mm_add_ps(l, r); }
+        Lanes sub(Lanes l, Lanes r) { return _mm_sub_ps(l, r); }
+        Lanes mul(Lanes l, Lanes r) { return _mm_mul_ps(l, r); }
+        Lanes min(Lanes l, Lanes r) { return _mm_min_ps(l, r); }
+        Lanes max(Lanes l, Lanes r) { return _mm_max_ps(l, r); }
+        //Bit i set where lane i of l is below r
+        uint32_t less_mask(Lanes l, Lanes r) { return static_cast<uint32_t>(_mm_movemask_ps(_mm_cmplt_ps(l, r))); }
+        uint32_t less_equal_mask(Lanes l, Lanes r) { return static_cast<uint32_t>(_mm_movemask_ps(_mm_cmple_ps(l, r))); }
+#else
+        struct Lanes {
+            float v[4];
+        };
+
+        template <typename Op>
+        Lanes apply(Lanes l, Lanes r, Op op) {
+            Lanes result;
+            for (int i = 0; i < 4; i++) {
+                result.v[i] = op(l.v[i], r.v[i]);
+            }
+            return result;
+        }
+
+        Lanes load(const float* values) { return {{values[0], values[1], values[2], values[3]}}; }
+        Lanes splat(float value) { return {{value, value, value, value}}; }
+        void store(float* values, Lanes lanes) { std::copy(lanes.v, lanes.v + 4, values); }
+        Lanes add(Lanes l, Lanes r) { return apply(l, r, [](float a, float b) { return a + b; }); }
+        Lanes sub(Lanes l, Lanes r) { return apply(l, r, [](float a, float b) { return a - b; }); }
+        Lanes mul(Lanes l, Lanes r) { return apply(l, r, [](float a, float b) { return a * b; }); }
+        Lanes min(Lanes l, Lanes r) { return apply(l, r, [](float a, float b) { return a < b ? a : b; }); }
+        Lanes max(Lanes l, Lanes r) { return apply(l, r, [](float a, float b) { return a > b ? a : b; }); }
+
+        uint32_t less_mask(Lanes l, Lanes r) {
+            uint32_t mask = 0;
+            for (int i = 0; i < 4; i++) {
+                mask |= (l.v[i] < r.v[i] ? 1u : 0u) << i;
+            }
+            return mask;
+        }
+
+        uint32_t less_equal_mask(Lanes l, Lanes r) {
+            uint32_t mask = 0;
+            for (int i = 0; i < 4; i++) {
+                mask |= (l.v[i] <= r.v[i] ? 1u : 0u) << i;
+            }
+            return mask;
+        }
+#endif
+
+        struct RayCandidate {
+            int32_t node;
+            float distance;
+        };
+
+        //Traversal stacks, reused by every query on the same thread
+        thread_local std::vector<int32_t> t_node_stack;
+        thread_local std::vector<RayCandidate> t_ray_stack;
+    }
+
+    int32_t DynamicBvh::allocate_node(){
+        int32_t index;
+        if (m_free_list == NULL_NODE) {
+            index = static_cast<int32_t>(m_nodes.size());
+            m_nodes.emplace_back();
+        } else {
+            index = m_free_list;
+            m_free_list = m_nodes[index].parent;
+            m_nodes[index] = Node{};
+        }
+        return index;
+    }
+
+    void DynamicBvh::free_node(int32_t index){
+        m_nodes[index].parent = m_free_list;
+        m_nodes[index].height = -1;
+        m_free_list = index;
+    }
+
+    ProxyId DynamicBvh::create_proxy(const Aabb& bounds, uint32_t user_data){
+        int32_t leaf = allocate_node();
+        Node& node = m_nodes[leaf];
+        node.bounds = {bounds.min - glm::vec3(m_margin), bounds.max + glm::vec3(m_margin)};
+        node.user_data = user_data;
+
+        insert_leaf(leaf);
+        m_proxy_count++;
+        m_flat_dirty = true;
+        return leaf;
+    }
+
+    void DynamicBvh::destroy_proxy(ProxyId proxy){
+        remove_leaf(proxy);
+        free_node(proxy);
+        m_proxy_count--;
+        m_flat_dirty = true;
+    }
+
+    bool DynamicBvh::move_proxy(ProxyId proxy, const Aabb& bounds){
+        Node& leaf = m_nodes[proxy];
+        if (leaf.bounds.contains(bounds)) {
+            return false;
+        }
+
+        Aabb fat = {bounds.min - glm::vec3(m_margin), bounds.max + glm::vec3(m_margin)};
+
+        //Refitting after a jump would stretch every box up to the root, those are reinserted instead
+        if (!leaf.bounds.overlaps(fat)) {
+            remove_leaf(proxy);
+            m_nodes[proxy].bounds = fat;
+            insert_leaf(proxy);
+        } else {
+            leaf.bounds = fat;
+            refit(leaf.parent);
+        }
+
+        m_flat_dirty = true;
+        return true;
+    }
+
+    void DynamicBvh::clear(){
+        m_nodes.clear();
+        m_root = NULL_NODE;
+        m_free_list = NULL_NODE;
+        m_proxy_count = 0;
+        m_flat_nodes.clear();
+        m_flat_leaves.clear();
+        m_flat_dirty = false;
+    }
+
+    int32_t DynamicBvh::find_best_sibling(const Aabb& bounds){
+        //Branch and bound over the cost of pairing the new leaf with a node: the area of the new
+        //parent plus how much every ancestor grows. Subtrees that cannot beat the best are skipped.
+        float area = bounds.surface_area();
+        int32_t best = m_root;
+        float best_cost = Aabb::merge(m_nodes[m_root].bounds, bounds).surface_area();
+
+        m_search_stack.clear();
+        m_search_stack.push_back({m_root, 0.0f});
+
+        while (!m_search_stack.empty()) {
+            Candidate candidate = m_search_stack.back();
+            m_search_stack.pop_back();
+
+            const Node& node = m_nodes[candidate.node];
+            float direct_cost = Aabb::merge(node.bounds, bounds).surface_area();
+            float cost = direct_cost + candidate.inherited_cost;
+            if (cost < best_cost) {
+                best = candidate.node;
+                best_cost = cost;
+            }
+
+            if (node.is_leaf()) {
+                continue;
+            }
+
+            float child_inherited_cost = candidate.inherited_cost + direct_cost - node.bounds.surface_area();
+            if (area + child_inherited_cost < best_cost) {
+                m_search_stack.push_back({node.children[0], child_inherited_cost});
+                m_search_stack.push_back({node.children[1], child_inherited_cost});
+            }
+        }
+
+        return best;
+    }
+
+    void DynamicBvh::insert_leaf(int32_t leaf){
+        if (m_root == NULL_NODE) {
+            m_root = leaf;
+            m_nodes[leaf].parent = NULL_NODE;
+            return;
+        }
+
+        int32_t sibling = find_best_sibling(m_nodes[leaf].bounds);
+        int32_t old_parent = m_nodes[sibling].parent;
+        int32_t new_parent = allocate_node();
+
+        Node& parent = m_nodes[new_parent];
+        parent.parent = old_parent;
+        parent.children[0] = sibling;
+        parent.children[1] = leaf;
+        m_nodes[sibling].parent = new_parent;
+        m_nodes[leaf].parent = new_parent;
+
+        if (old_parent == NULL_NODE) {
+            m_root = new_parent;
+        } else {
+            Node& grand_parent = m_nodes[old_parent];
+            grand_parent.children[grand_parent.children[0] == sibling ? 0 : 1] = new_parent;
+        }
+
+        refit(new_parent);
+    }
+
+    void DynamicBvh::remove_leaf(int32_t leaf){
+        if (leaf == m_root) {
+            m_root = NULL_NODE;
+            return;
+        }
+
+        int32_t parent = m_nodes[leaf].parent;
+        int32_t grand_parent = m_nodes[parent].parent;
+        int32_t sibling = m_nodes[parent].children[m_nodes[parent].children[0] == leaf ? 1 : 0];
+
+        //The sibling takes the parent's place
+        m_nodes[sibling].parent = grand_parent;
+        free_node(parent);
+
+        if (grand_parent == NULL_NODE) {
+            m_root = sibling;
+            return;
+        }
+
+        Node& node = m_nodes[grand_parent];
+        node.children[node.children[0] == parent ? 0 : 1] = sibling;
+        refit(grand_parent);
+    }
+
+    void DynamicBvh::refit(int32_t index){
+        while (index != NULL_NODE) {
+            Node& node = m_nodes[index];
+            const Node& left = m_nodes[node.children[0]];
+            const Node& right = m_nodes[node.children[1]];
+            node.bounds = Aabb::merge(left.bounds, right.bounds);
+            node.height = 1 + std::max(left.height, right.height);
+
+            rotate(index);
+            index = node.parent;
+        }
+    }
+
+    void DynamicBvh::rotate(int32_t index){
+        //Swaps a child with a grandchild under its sibling when that shrinks the sibling. The node's
+        //own box holds the same leaves either way, so only the sibling's area changes.
+        Node& node = m_nodes[index];
+        if (node.height < 2) {
+            return;
+        }
+
+        float best_gain = 0.0f;
+        int32_t best_child = -1;
+        int32_t best_grand_child = -1;
+
+        for (int32_t child = 0; child < 2; child++) {
+            const Node& moving = m_nodes[node.children[child]];
+            const Node& sibling = m_nodes[node.children[1 - child]];
+            if (sibling.is_leaf()) {
+                continue;
+            }
+
+            float area = sibling.bounds.surface_area();
+            for (int32_t grand_child = 0; grand_child < 2; grand_child++) {
+                const Node& kept = m_nodes[sibling.children[1 - grand_child]];
+                float gain = area - Aabb::merge(moving.bounds, kept.bounds).surface_area();
+                if (gain > best_gain) {
+                    best_gain = gain;
+                    best_child = child;
+                    best_grand_child = grand_child;
+                }
+            }
+        }
+
+        if (best_child < 0) {
+            return;
+        }
+
+        int32_t down = node.children[best_child];
+        int32_t sibling_index = node.children[1 - best_child];
+        Node& sibling = m_nodes[sibling_index];
+        int32_t up = sibling.children[best_grand_child];
+
+        node.children[best_child] = up;
+        m_nodes[up].parent = index;
+        sibling.children[best_grand_child] = down;
+        m_nodes[down].parent = sibling_index;
+
+        const Node& left = m_nodes[sibling.children[0]];
+        const Node& right = m_nodes[sibling.children[1]];
+        sibling.bounds = Aabb::merge(left.bounds, right.bounds);
+        sibling.height = 1 + std::max(left.height, right.height);
+        node.height = 1 + std::max(m_nodes[node.children[0]].height, m_nodes[node.children[1]].height);
+    }
+
+    void DynamicBvh::flatten(){
+        if (!m_flat_dirty) {
+            return;
+        }
+        m_flat_dirty = false;
+
+        m_flat_nodes.clear();
+        m_flat_leaves.clear();
+        if (m_root == NULL_NODE) {
+            return;
+        }
+
+        //A 4-wide tree has at most one node per leaf
+        m_flat_nodes.reserve(m_proxy_count);
+        m_flat_leaves.reserve(m_proxy_count);
+        flatten_node(m_root);
+    }
+
+    int32_t DynamicBvh::flatten_node(int32_t index){
+        //Collapses up to two levels, opening the largest inner child until there are four
+        int32_t gathered[4] = {index, NULL_NODE, NULL_NODE, NULL_NODE};
+        int32_t count = 1;
+        while (count < 4) {
+            int32_t widest = -1;
+            float widest_area = -1.0f;
+            for (int32_t i = 0; i < count; i++) {
+                const Node& node = m_nodes[gathered[i]];
+                if (!node.is_leaf() && node.bounds.surface_area() > widest_area) {
+                    widest = i;
+                    widest_area = node.bounds.surface_area();
+                }
+            }
+            if (widest < 0) {
+                break;
+            }
+
+            const Node& opened = m_nodes[gathered[widest]];
+            gathered[widest] = opened.children[0];
+            gathered[count++] = opened.children[1];
+        }
+
+        int32_t flat = static_cast<int32_t>(m_flat_nodes.size());
+        m_flat_nodes.emplace_back();
+        m_flat_nodes[flat].leaf_begin = static_cast<uint32_t>(m_flat_leaves.size());
+
+        for (int32_t slot = 0; slot < 4; slot++) {
+            int32_t child = EMPTY_CHILD;
+            Aabb bounds{};
+
+            if (slot < count) {
+                const Node& node = m_nodes[gathered[slot]];
+                bounds = node.bounds;
+                if (node.is_leaf()) {
+                    child = ~static_cast<int32_t>(m_flat_leaves.size());
+                    m_flat_leaves.push_back(node.user_data);
+                } else {
+                    child = flatten_node(gathered[slot]);
+                }
+            }
+
+            //Children are appended after their parent, so the reference is taken once they are
+            FlatNode& node = m_flat_nodes[flat];
+            node.children[slot] = child;
+            node.min_x[slot] = bounds.min.x;
+            node.min_y[slot] = bounds.min.y;
+            node.min_z[slot] = bounds.min.z;
+            node.max_x[slot] = bounds.max.x;
+            node.max_y[slot] = bounds.max.y;
+            node.max_z[slot] = bounds.max.z;
+        }
+
+        m_flat_nodes[flat].leaf_end = static_cast<uint32_t>(m_flat_leaves.size());
+        return flat;
+    }
+
+    void DynamicBvh::query_frustum(const Frustum& frustum, std::vector<uint32_t>& results) const {
+        if (m_flat_nodes.empty()) {
+            return;
+        }
+
+        std::vector<int32_t>& stack = t_node_stack;
+        stack.clear();
+        stack.push_back(0);
+
+        while (!stack.empty()) {
+            const FlatNode& node = m_flat_nodes[stack.back()];
+            stack.pop_back();
+
+            //A box is outside if its corner furthest along a plane's normal is behind it, and fully
+            //inside if even the nearest corner is in front of every plane
+            uint32_t outside = 0;
+            uint32_t partial = 0;
+            for (const glm::vec4& plane : frustum.planes) {
+                Lanes far_x = load(plane.x >= 0.0f ? node.max_x : node.min_x);
+                Lanes far_y = load(plane.y >= 0.0f ? node.max_y : node.min_y);
+                Lanes far_z = load(plane.z >= 0.0f ? node.max_z : node.min_z);
+                Lanes near_x = load(plane.x >= 0.0f ? node.min_x : node.max_x);
+                Lanes near_y = load(plane.y >= 0.0f ? node.min_y : node.max_y);
+                Lanes near_z = load(plane.z >= 0.0f ? node.min_z : node.max_z);
+
+                Lanes normal_x = splat(plane.x);
+                Lanes normal_y = splat(plane.y);
+                Lanes normal_z = splat(plane.z);
+                Lanes distance = splat(plane.w);
+                Lanes zero = splat(0.0f);
+
+                outside |= less_mask(add(add(mul(normal_x, far_x), mul(normal_y, far_y)), add(mul(normal_z, far_z), distance)), zero);
+                partial |= less_mask(add(add(mul(normal_x, near_x), mul(normal_y, near_y)), add(mul(normal_z, near_z), distance)), zero);
+            }
+
+            for (uint32_t visible = ~outside & 0xF; visible != 0; visible &= visible - 1) {
+                int32_t slot = std::countr_zero(visible);
+                int32_t child = node.children[slot];
+                if (child == EMPTY_CHILD) {
+                    continue;
+                }
+
+                if (child < 0) {
+                    results.push_back(m_flat_leaves[~child]);
+                } else if ((partial & (1u << slot)) == 0) {
+                    const FlatNode& inside = m_flat_nodes[child];
+                    results.insert(results.end(), m_flat_leaves.begin() + inside.leaf_begin, m_flat_leaves.begin() + inside.leaf_end);
+                } else {
+                    stack.push_back(child);
+                }
+            }
+        }
+    }
+
+    void DynamicBvh::query_aabb(const Aabb& bounds, std::vector<uint32_t>& results) const {
+        if (m_flat_nodes.empty()) {
+            return;
+        }
+
+        Lanes query_min_x = splat(bounds.min.x);
+        Lanes query_min_y = splat(bounds.min.y);
+        Lanes query_min_z = splat(bounds.min.z);
+        Lanes query_max_x = splat(bounds.max.x);
+        Lanes query_max_y = splat(bounds.max.y);
+        Lanes query_max_z = splat(bounds.max.z);
+
+        std::vector<int32_t>& stack = t_node_stack;
+        stack.clear();
+        stack.push_back(0);
+
+        while (!stack.empty()) {
+            const FlatNode& node = m_flat_nodes[stack.back()];
+            stack.pop_back();
+
+            uint32_t overlapping = less_equal_mask(load(node.min_x), query_max_x) & less_equal_mask(query_min_x, load(node.max_x))
+                                 & less_equal_mask(load(node.min_y), query_max_y) & less_equal_mask(query_min_y, load(node.max_y))
+                                 & less_equal_mask(load(node.min_z), query_max_z) & less_equal_mask(query_min_z, load(node.max_z));
+
+            for (; overlapping != 0; overlapping &= overlapping - 1) {
+                int32_t child = node.children[std::countr_zero(overlapping)];
+                if (child == EMPTY_CHILD) {
+                    continue;
+                }
+
+                if (child < 0) {
+                    results.push_back(m_flat_leaves[~child]);
+                } else {
+                    stack.push_back(child);
+                }
+            }
+        }
+    }
+
+    RayHit DynamicBvh::raycast(const Ray& ray) const {
+        RayHit best;
+        if (m_flat_nodes.empty()) {
+            return best;
+        }
+
+        //Axis parallel rays get a huge inverse instead of infinity, so the slabs never see inf * 0
+        auto inverse = [](float direction) {
+            return 1.0f / (std::abs(direction) > 1e-20f ? direction : std::copysign(1e-20f, direction));
+        };
+        Lanes inverse_x = splat(inverse(ray.direction.x));
+        Lanes inverse_y = splat(inverse(ray.direction.y));
+        Lanes inverse_z = splat(inverse(ray.direction.z));
+        Lanes origin_x = splat(ray.origin.x);
+        Lanes origin_y = splat(ray.origin.y);
+        Lanes origin_z = splat(ray.origin.z);
+
+        float limit = ray.max_distance;
+
+        std::vector<RayCandidate>& stack = t_ray_stack;
+        stack.clear();
+        stack.push_back({0, 0.0f});
+
+        while (!stack.empty()) {
+            RayCandidate candidate = stack.back();
+            stack.pop_back();
+            if (candidate.distance > limit) {
+                continue;
+            }
+
+            const FlatNode& node = m_flat_nodes[candidate.node];
+
+            //Slab test, the entry is the last slab entered and the exit the first one left
+            Lanes x0 = mul(sub(load(node.min_x), origin_x), inverse_x);
+            Lanes x1 = mul(sub(load(node.max_x), origin_x), inverse_x);
+            Lanes y0 = mul(sub(load(node.min_y), origin_y), inverse_y);
+            Lanes y1 = mul(sub(load(node.max_y), origin_y), inverse_y);
+            Lanes z0 = mul(sub(load(node.min_z), origin_z), inverse_z);
+            Lanes z1 = mul(sub(load(node.max_z), origin_z), inverse_z);
+
+            Lanes entry = max(max(min(x0, x1), min(y0, y1)), max(min(z0, z1), splat(0.0f)));
+            Lanes exit = min(min(max(x0, x1), max(y0, y1)), min(max(z0, z1), splat(limit)));
+
+            alignas(16) float entries[4];
+            store(entries, entry);
+
+            //Nearest child last so it is popped first and tightens the limit for the others
+            RayCandidate hits[4];
+            int32_t hit_count = 0;
+            for (uint32_t hit = less_equal_mask(entry, exit); hit != 0; hit &= hit - 1) {
+                int32_t slot = std::countr_zero(hit);
+                int32_t child = node.children[slot];
+                if (child == EMPTY_CHILD) {
+                    continue;
+                }
+
+                if (child < 0) {
+                    if (entries[slot] < best.distance) {
+                        best = {m_flat_leaves[~child], entries[slot]};
+                        limit = std::min(limit, entries[slot]);
+                    }
+                } else {
+                    hits[hit_count++] = {child, entries[slot]};
+                }
+            }
+
+            std::sort(hits, hits + hit_count, [](const RayCandidate& l, const RayCandidate& r) { return l.distance > r.distance; });
+            stack.insert(stack.end(), hits, hits + hit_count);
+        }
+
+        return best;
+    }
+
+    void DynamicBvh::raycast_batch(core::JobSystem& job_system, std::span<const Ray> rays, std::span<RayHit> hits) const {
+        job_system.parallel_for(static_cast<uint32_t>(rays.size()), RAY_BATCH_SIZE, [&](uint32_t begin, uint32_t end) {
+            for (uint32_t i = begin; i < end; i++) {
+                hits[i] = raycast(rays[i]);
+            }
+        });
+    }
+}
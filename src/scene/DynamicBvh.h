@@ -0,0 +1,143 @@
+#pragma once
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <vector>
+#include <glm/glm.hpp>
+#include "Camera.h"
+#include "../core/JobSystem.h"
+
+namespace evoke::scene {
+    struct Aabb {
+        glm::vec3 min = glm::vec3(0.0f);
+        glm::vec3 max = glm::vec3(0.0f);
+
+        float surface_area() const {
+            glm::vec3 size = max - min;
+            return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+        }
+
+        bool contains(const Aabb& other) const {
+            return glm::all(glm::lessThanEqual(min, other.min)) && glm::all(glm::greaterThanEqual(max, other.max));
+        }
+
+        bool overlaps(const Aabb& other) const {
+            return glm::all(glm::lessThanEqual(min, other.max)) && glm::all(glm::greaterThanEqual(max, other.min));
+        }
+
+        static Aabb merge(const Aabb& a, const Aabb& b) {
+            return {glm::min(a.min, b.min), glm::max(a.max, b.max)};
+        }
+    };
+
+    struct Ray {
+        glm::vec3 origin = glm::vec3(0.0f);
+        glm::vec3 direction = glm::vec3(0.0f, 0.0f, -1.0f);
+        float max_distance = std::numeric_limits<float>::max();
+    };
+
+    struct RayHit {
+        uint32_t user_data = 0;
+        //Where the ray enters the proxy's box, 0 if it starts inside
+        float distance = std::numeric_limits<float>::max();
+
+        bool hit() const { return distance != std::numeric_limits<float>::max(); }
+    };
+
+    using ProxyId = int32_t;
+    constexpr ProxyId NULL_PROXY = -1;
+
+    //Dynamic AABB tree over proxies that move every frame. Inserts pick the sibling with the lowest
+    //surface area cost, moves inside the margin are free and larger ones refit the path to the root,
+    //and every refit tries a rotation so the tree stays in shape without rebuilds. Queries run on a
+    //flattened 4-wide copy with SIMD box tests, rebuilt by flatten after a batch of changes. Editing
+    //is not thread safe, queries are once flatten returned.
+    class DynamicBvh {
+    public:
+        ProxyId create_proxy(const Aabb& bounds, uint32_t user_data);
+        void destroy_proxy(ProxyId proxy);
+        //Returns true if the tree changed
+        bool move_proxy(ProxyId proxy, const Aabb& bounds);
+        void clear();
+
+        uint32_t get_user_data(ProxyId proxy) const { return m_nodes[proxy].user_data; }
+        uint32_t get_proxy_count() const { return m_proxy_count; }
+        int32_t get_height() const { return m_root == NULL_NODE ? 0 : m_nodes[m_root].height; }
+
+        //Fat boxes are grown by this much on every side, so small moves do not touch the tree
+        void set_margin(float margin) { m_margin = margin; }
+
+        //Snapshot for the queries below, does nothing if the tree did not change since the last one
+        void flatten();
+        uint32_t get_flat_node_count() const { return static_cast<uint32_t>(m_flat_nodes.size()); }
+
+        //Append the user data of every proxy whose fat box touches the query, in tree order so
+        //neighbours end up next to each other
+        void query_frustum(const Frustum& frustum, std::vector<uint32_t>& results) const;
+        void query_aabb(const Aabb& bounds, std::vector<uint32_t>& results) const;
+        RayHit raycast(const Ray& ray) const;
+
+        //One ray per entry spread over the job system, for many picks at once
+        void raycast_batch(core::JobSystem& job_system, std::span<const Ray> rays, std::span<RayHit> hits) const;
+
+    private:
+        static constexpr int32_t NULL_NODE = -1;
+        //Children of a flat node that hold nothing
+        static constexpr int32_t EMPTY_CHILD = std::numeric_limits<int32_t>::min();
+
+        struct Node {
+            Aabb bounds;
+            //Next free node while on the free list
+            int32_t parent = NULL_NODE;
+            int32_t children[2] = {NULL_NODE, NULL_NODE};
+            uint32_t user_data = 0;
+            //0 for leaves, -1 for free nodes
+            int32_t height = 0;
+
+            bool is_leaf() const { return children[0] == NULL_NODE; }
+        };
+
+        //Bounds of four children as structure of arrays, one SIMD lane per child. Inner children
+        //are flat node indices, leaves are ~index into m_flat_leaves.
+        struct alignas(64) FlatNode {
+            float min_x[4];
+            float min_y[4];
+            float min_z[4];
+            float max_x[4];
+            float max_y[4];
+            float max_z[4];
+            int32_t children[4];
+            //Every leaf below this node, they are contiguous since the layout is depth first
+            uint32_t leaf_begin;
+            uint32_t leaf_end;
+        };
+
+        std::vector<Node> m_nodes;
+        int32_t m_root = NULL_NODE;
+        int32_t m_free_list = NULL_NODE;
+        uint32_t m_proxy_count = 0;
+        float m_margin = 0.1f;
+
+        std::vector<FlatNode> m_flat_nodes;
+        std::vector<uint32_t> m_flat_leaves;
+        bool m_flat_dirty = false;
+
+        struct Candidate {
+            int32_t node;
+            float inherited_cost;
+        };
+        std::vector<Candidate> m_search_stack;
+
+        int32_t allocate_node();
+        void free_node(int32_t index);
+
+        void insert_leaf(int32_t leaf);
+        void remove_leaf(int32_t leaf);
+        int32_t find_best_sibling(const Aabb& bounds);
+        //Recomputes bounds and heights from index up to the root, rotating on the way
+        void refit(int32_t index);
+        void rotate(int32_t index);
+
+        int32_t flatten_node(int32_t index);
+    };
+}
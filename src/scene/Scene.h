@@ -0,0 +1,137 @@
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include "Camera.h"
+
+namespace evoke::scene {
+    struct Transform {
+        glm::vec3 position = {0.0f, 0.0f, 0.0f};
+        glm::quat rotation = {1.0f, 0.0f, 0.0f, 0.0f};
+        glm::vec3 scale = {1.0f, 1.0f, 1.0f};
+
+        glm::mat4 matrix() const {
+            glm::mat4 result = glm::mat4_cast(rotation);
+            result[0] *= scale.x;
+            result[1] *= scale.y;
+            result[2] *= scale.z;
+            result[3] = glm::vec4(position, 1.0f);
+            return result;
+        }
+    };
+
+    inline Transform interpolate(const Transform& from, const Transform& to, float t) {
+        Transform result;
+        result.position = glm::mix(from.position, to.position, t);
+        result.rotation = glm::slerp(from.rotation, to.rotation, t);
+        result.scale = glm::mix(from.scale, to.scale, t);
+        return result;
+    }
+
+    inline Camera interpolate(const Camera& from, const Camera& to, float t) {
+        Camera result = to;
+        result.position = glm::mix(from.position, to.position, t);
+        result.target = glm::mix(from.target, to.target, t);
+        result.fov_y = glm::mix(from.fov_y, to.fov_y, t);
+        return result;
+    }
+
+    //One bit per instance, clean words are skipped 64 at a time. Clearing keeps the storage.
+    struct DirtyBits {
+        std::vector<uint64_t> words;
+
+        void set(size_t index) {
+            if (index / 64 >= words.size()) {
+                words.resize(index / 64 + 1, 0);
+            }
+            words[index / 64] |= uint64_t(1) << (index % 64);
+        }
+        void set_all(size_t count) {
+            words.assign((count + 63) / 64, ~uint64_t(0));
+            if (size_t tail = count % 64; tail != 0) {
+                words.back() = (uint64_t(1) << tail) - 1;
+            }
+        }
+        void merge(const DirtyBits& other) {
+            if (other.words.size() > words.size()) {
+                words.resize(other.words.size(), 0);
+            }
+            for (size_t i = 0; i < other.words.size(); i++) {
+                words[i] |= other.words[i];
+            }
+        }
+        void clear() { std::fill(words.begin(), words.end(), 0); }
+
+        template <typename Function>
+        void for_each(Function&& function) const {
+            for (size_t word = 0; word < words.size(); word++) {
+                for (uint64_t bits = words[word]; bits != 0; bits &= bits - 1) {
+                    function(word * 64 + std::countr_zero(bits));
+                }
+            }
+        }
+    };
+
+    //Everything the simulation owns that the renderer needs to see
+    struct SceneState {
+        Camera camera;
+        //Written through add_instance and set_instance, so the renderer only touches what moved
+        std::vector<Transform> instances;
+        //Instances written since the simulation last cleared the bits, once per tick
+        DirtyBits written;
+
+        size_t add_instance(const Transform& transform) {
+            instances.push_back(transform);
+            written.set(instances.size() - 1);
+            return instances.size() - 1;
+        }
+        void set_instance(size_t index, const Transform& transform) {
+            instances[index] = transform;
+            written.set(index);
+        }
+    };
+
+    //Published once per batch of simulation ticks. Holds the last two ticks so the renderer
+    //can interpolate between them at any point in time.
+    struct SceneSnapshot {
+        uint64_t tick = 0;
+        //Wall clock time the current state belongs to
+        std::chrono::steady_clock::time_point time;
+        //Timestamp of the newest input event the current state reflects
+        std::chrono::steady_clock::time_point input_time;
+        SceneState previous;
+        SceneState current;
+
+        //Instances written since the last snapshot the renderer acquired, skipped snapshots included
+        DirtyBits changed;
+
+        //alpha 0 is the previous tick, 1 the current one. result holds what the last frame showed, only
+        //instances that changed since, and the ones moving between the two ticks, are touched and marked
+        //in dirty. Reuses the storage of result, so a state kept across frames does not allocate once it
+        //holds the most instances.
+        void interpolate(float alpha, bool fresh, SceneState& result, DirtyBits& dirty) const {
+            result.camera = scene::interpolate(previous.camera, current.camera, alpha);
+
+            if (result.instances.size() != current.instances.size()) {
+                //Spawned or removed instances, the renderer replaces all of them anyway
+                result.instances.assign(current.instances.begin(), current.instances.end());
+                dirty.set_all(current.instances.size());
+            } else if (fresh) {
+                changed.for_each([&](size_t i) {
+                    result.instances[i] = current.instances[i];
+                    dirty.set(i);
+                });
+            }
+
+            current.written.for_each([&](size_t i) {
+                //Instances spawned this tick have no previous state
+                result.instances[i] = i < previous.instances.size() ? scene::interpolate(previous.instances[i], current.instances[i], alpha) : current.instances[i];
+                dirty.set(i);
+            });
+        }
+    };
+}
@@ -0,0 +1,42 @@
+// Shared by light_bin.comp and shader.frag.
+// Layouts must match PointLight and LightingHeader in src/renderer/ClusteredLighting.h and .cpp
+
+// Froxel grid, ClusteredLighting::CLUSTERS_X, CLUSTERS_Y and CLUSTERS_Z
+const uint CLUSTERS_X = 16;
+const uint CLUSTERS_Y = 9;
+const uint CLUSTERS_Z = 24;
+// Light count followed by the light indices of one cluster, ClusteredLighting::MAX_CLUSTER_LIGHTS + 1
+const uint CLUSTER_STRIDE = 128;
+
+struct PointLight {
+    vec3 position;
+    float radius;
+    vec3 color;
+    float intensity;
+};
+
+layout(set = 0, binding = 0, std430) readonly buffer LightBuffer {
+    mat4 view;
+    mat4 inverse_projection;
+    vec4 ambient;
+    vec2 extent;
+    float near_plane;
+    float far_plane;
+    uint light_count;
+    uint pad[3];
+    PointLight lights[];
+} light_data;
+
+uint cluster_index(uvec3 cluster) {
+    return (cluster.z * CLUSTERS_Y + cluster.y) * CLUSTERS_X + cluster.x;
+}
+
+// Exponential slices, each one as deep as it is wide on screen at its distance
+uint depth_slice(float depth) {
+    float slice = log(max(depth, light_data.near_plane) / light_data.near_plane) / log(light_data.far_plane / light_data.near_plane);
+    return min(uint(slice * float(CLUSTERS_Z)), CLUSTERS_Z - 1);
+}
+
+float slice_depth(uint slice) {
+    return light_data.near_plane * pow(light_data.far_plane / light_data.near_plane, float(slice) / float(CLUSTERS_Z));
+}
@@ -0,0 +1,26 @@
+#version 460
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inNormal;
+layout(location = 2) in vec3 inColor;
+layout(location = 3) in mat4 inModel;
+
+layout(push_constant) uniform PushConstants {
+    mat4 view_proj;
+} pc;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec3 fragPosition;
+layout(location = 2) out vec3 fragNormal;
+
+// The pre-pass and the shading pass must compute the same depth for the EQUAL test
+invariant gl_Position;
+
+void main() {
+    vec4 world = inModel * vec4(inPosition, 1.0);
+    gl_Position = pc.view_proj * world;
+    fragColor = inColor;
+    fragPosition = world.xyz;
+    // Inverse transpose, so non uniform scale keeps normals perpendicular to the surface
+    fragNormal = transpose(inverse(mat3(inModel))) * inNormal;
+}
@@ -0,0 +1,73 @@
+// Shared by the meshlet task, mesh and culling shaders.
+// Layouts must match Meshlet in src/shapes/Meshlet.h and MeshletPushConstants in src/renderer/MeshletRenderer.h
+
+struct Meshlet {
+    vec3 center;
+    float radius;
+    vec3 cone_axis;
+    float cone_cutoff;
+    uint vertex_offset;
+    uint triangle_offset;
+    uint vertex_count;
+    uint triangle_count;
+};
+
+struct MeshVertex {
+    float px, py, pz;
+    float nx, ny, nz;
+    float r, g, b;
+};
+
+struct DrawCommand {
+    uint index_count;
+    uint instance_count;
+    uint first_index;
+    int vertex_offset;
+    uint first_instance;
+};
+
+layout(buffer_reference, std430) readonly buffer VertexBuffer { MeshVertex vertices[]; };
+layout(buffer_reference, std430) readonly buffer MeshletBuffer { Meshlet meshlets[]; };
+layout(buffer_reference, std430) readonly buffer IndexBuffer { uint indices[]; };
+layout(buffer_reference, std430) buffer DrawBuffer {
+    uint count;
+    uint pad[3];
+    DrawCommand commands[];
+};
+
+layout(push_constant) uniform PushConstants {
+    mat4 view_proj;
+    vec4 camera_position;
+    uint meshlet_count;
+    uint compact_draws;
+    VertexBuffer vertices;
+    MeshletBuffer meshlets;
+    IndexBuffer meshlet_vertices;
+    IndexBuffer meshlet_triangles;
+    DrawBuffer draws;
+} pc;
+
+// Frustum test against planes extracted from the view projection matrix ([0, 1] depth, with reverse-Z
+// the last two planes are far and near instead of near and far)
+bool in_frustum(vec3 center, float radius) {
+    mat4 m = transpose(pc.view_proj);
+    vec4 planes[6] = vec4[6](m[3] + m[0], m[3] - m[0], m[3] + m[1], m[3] - m[1], m[2], m[3] - m[2]);
+
+    for (int i = 0; i < 6; i++) {
+        if (dot(planes[i].xyz, center) + planes[i].w < -radius * length(planes[i].xyz)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Backface test with the meshlet normal cone
+bool cone_culled(Meshlet meshlet) {
+    vec3 to_center = meshlet.center - pc.camera_position.xyz;
+    return dot(to_center, meshlet.cone_axis) >= meshlet.cone_cutoff * length(to_center) + meshlet.radius;
+}
+
+bool meshlet_visible(uint index) {
+    Meshlet meshlet = pc.meshlets.meshlets[index];
+    return in_frustum(meshlet.center, meshlet.radius) && !cone_culled(meshlet);
+}
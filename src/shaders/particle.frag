@@ -0,0 +1,15 @@
+#version 460
+
+layout(location = 0) in vec4 fragColor;
+layout(location = 1) in vec2 fragOffset;
+
+layout(location = 0) out vec4 outColor;
+
+// Soft round sprite
+void main() {
+    float falloff = 1.0 - smoothstep(0.5, 1.0, length(fragOffset));
+    if (falloff <= 0.0) {
+        discard;
+    }
+    outColor = vec4(fragColor.rgb, fragColor.a * falloff);
+}
@@ -0,0 +1,36 @@
+#version 460
+#extension GL_EXT_buffer_reference : require
+#extension GL_GOOGLE_include_directive : require
+
+#define PARTICLE_DRAW
+#include "particle_common.glsl"
+
+layout(push_constant) uniform PushConstants {
+    mat4 view_proj;
+    vec4 camera_right;
+    vec4 camera_up;
+    ParticleBuffer particles;
+    KeyBuffer keys;
+} pc;
+
+layout(location = 0) out vec4 fragColor;
+layout(location = 1) out vec2 fragOffset;
+
+const vec2 corners[6] = vec2[6](
+    vec2(-1.0, -1.0), vec2(1.0, -1.0), vec2(1.0, 1.0),
+    vec2(-1.0, -1.0), vec2(1.0, 1.0), vec2(-1.0, 1.0)
+);
+
+// Camera facing quad per instance, instances come in sorted key order
+void main() {
+    Particle particle = pc.particles.particles[pc.keys.keys[gl_InstanceIndex].index];
+    vec2 corner = corners[gl_VertexIndex];
+
+    vec3 position = particle.position + (pc.camera_right.xyz * corner.x + pc.camera_up.xyz * corner.y) * pc.camera_right.w;
+    gl_Position = pc.view_proj * vec4(position, 1.0);
+
+    // Fade out over the last part of the lifetime
+    float life = particle.age / particle.lifetime;
+    fragColor = vec4(particle.color.rgb, particle.color.a * (1.0 - smoothstep(0.7, 1.0, life)));
+    fragOffset = corner;
+}
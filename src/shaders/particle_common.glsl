@@ -0,0 +1,73 @@
+// Shared by the particle compute and render shaders.
+// Layouts must match Particle, ParticleBindings and ParticleComputePushConstants in src/renderer/ParticleSystem.h
+
+struct Particle {
+    vec3 position;
+    float age;
+    vec3 velocity;
+    float lifetime;
+    vec4 color;
+};
+
+struct SortKey {
+    float depth;
+    uint index;
+};
+
+struct DispatchCommand {
+    uint x;
+    uint y;
+    uint z;
+};
+
+layout(buffer_reference, std430) buffer ParticleBuffer { Particle particles[]; };
+layout(buffer_reference, std430) buffer IndexList {
+    uint count;
+    uint pad[3];
+    uint indices[];
+};
+// count is the alive count rounded up to a power of two, the tail holds sentinels
+layout(buffer_reference, std430) buffer KeyBuffer {
+    uint count;
+    uint pad[3];
+    SortKey keys[];
+};
+layout(buffer_reference, std430) buffer DrawBuffer {
+    uint vertex_count;
+    uint instance_count;
+    uint first_vertex;
+    uint first_instance;
+};
+// The simulate dispatch first, then one per bitonic sort pass
+layout(buffer_reference, std430) buffer DispatchBuffer { DispatchCommand commands[]; };
+
+layout(buffer_reference, std430) readonly buffer Bindings {
+    ParticleBuffer particles[2];
+    KeyBuffer keys[2];
+    DrawBuffer draws[2];
+    IndexList alive[2];
+    IndexList dead;
+    DispatchBuffer dispatches;
+};
+
+#ifndef PARTICLE_DRAW
+layout(push_constant) uniform PushConstants {
+    Bindings bindings;
+    uint source;
+    uint capacity;
+    vec4 emitter;
+    vec4 velocity;
+    vec4 gravity;
+    vec4 color;
+    vec3 camera_position;
+    float lifetime;
+    uint emit_count;
+    uint seed;
+    uint sort_j;
+    uint sort_k;
+} pc;
+
+uint target() {
+    return 1 - pc.source;
+}
+#endif
@@ -0,0 +1,70 @@
+// Shared by the scan, radix sort and compaction kernels.
+// Layouts must match the push constant structs in src/renderer/ComputePrimitives.h
+
+#define WORKGROUP_SIZE 256
+// Elements each scan invocation sums, SCAN_BLOCK in ComputePrimitives.h
+#define SCAN_ITEMS 4
+#define SCAN_BLOCK (WORKGROUP_SIZE * SCAN_ITEMS)
+#define RADIX_BITS 4
+#define RADIX_BINS (1 << RADIX_BITS)
+
+layout(buffer_reference, std430) buffer Words { uint words[]; };
+
+// Enough for the smallest subgroups
+shared uint s_subgroup_sums[WORKGROUP_SIZE];
+shared uint s_workgroup_total;
+
+// Exclusive prefix sum over the workgroup, every invocation has to call it. Subgroups scan
+// their values, the first subgroup scans the subgroup totals, in chunks when there are more
+// subgroups than invocations in one.
+uint workgroup_exclusive_scan(uint value, out uint total) {
+    uint inclusive = subgroupInclusiveAdd(value);
+    if (gl_SubgroupInvocationID == gl_SubgroupSize - 1) {
+        s_subgroup_sums[gl_SubgroupID] = inclusive;
+    }
+    barrier();
+
+    if (gl_SubgroupID == 0) {
+        uint carry = 0;
+        for (uint base = 0; base < gl_NumSubgroups; base += gl_SubgroupSize) {
+            uint i = base + gl_SubgroupInvocationID;
+            uint sum = i < gl_NumSubgroups ? s_subgroup_sums[i] : 0;
+            uint scanned = subgroupExclusiveAdd(sum) + carry;
+            if (i < gl_NumSubgroups) {
+                s_subgroup_sums[i] = scanned;
+            }
+            carry += subgroupAdd(sum);
+        }
+        if (gl_SubgroupInvocationID == 0) {
+            s_workgroup_total = carry;
+        }
+    }
+    barrier();
+
+    uint result = inclusive - value + s_subgroup_sums[gl_SubgroupID];
+    total = s_workgroup_total;
+    // The next call overwrites the shared sums
+    barrier();
+    return result;
+}
+
+#ifdef RADIX_SORT
+layout(push_constant) uniform PushConstants {
+    Words keys;
+    Words sorted_keys;
+    Words payloads;
+    Words sorted_payloads;
+    // Digit major, one count per digit and workgroup, exclusive scanned before the scatter
+    Words histogram;
+    uint count;
+    uint shift;
+    // 1 for 32 bit keys, 2 for 64 bit keys stored low word first
+    uint key_words;
+    uint has_payloads;
+} pc;
+
+uint key_digit(uint index) {
+    uint word = pc.keys.words[index * pc.key_words + pc.shift / 32];
+    return (word >> (pc.shift % 32)) & (RADIX_BINS - 1);
+}
+#endif
@@ -1,8 +1,41 @@
-#version 450
+#version 460
+#extension GL_GOOGLE_include_directive : require
+
+#include "lighting_common.glsl"
 
 layout(location = 0) out vec4 outColor;
 layout(location = 0) in vec3 fragColor;
+layout(location = 1) in vec3 fragPosition;
+layout(location = 2) in vec3 fragNormal;
+
+layout(set = 0, binding = 1, std430) readonly buffer ClusterBuffer { uint clusters[]; } cluster_data;
 
 void main() {
-    outColor = vec4(fragColor, 1.0);
-}
\ No newline at end of file
+    // Geometry without normals, like the clip space test triangle, stays unlit
+    if (dot(fragNormal, fragNormal) == 0.0) {
+        outColor = vec4(fragColor, 1.0);
+        return;
+    }
+
+    // Only the lights binned into this fragment's froxel can reach it
+    float depth = -(light_data.view * vec4(fragPosition, 1.0)).z;
+    uvec2 tile = min(uvec2(gl_FragCoord.xy / light_data.extent * vec2(CLUSTERS_X, CLUSTERS_Y)), uvec2(CLUSTERS_X - 1, CLUSTERS_Y - 1));
+    uint cluster = cluster_index(uvec3(tile, depth_slice(depth))) * CLUSTER_STRIDE;
+
+    vec3 normal = normalize(fragNormal);
+    vec3 light = light_data.ambient.rgb;
+
+    uint count = cluster_data.clusters[cluster];
+    for (uint i = 0; i < count; i++) {
+        PointLight point = light_data.lights[cluster_data.clusters[cluster + 1 + i]];
+        vec3 to_light = point.position - fragPosition;
+        float distance_squared = max(dot(to_light, to_light), 1e-4);
+
+        // Inverse square falloff windowed down to zero at the radius
+        float window = clamp(1.0 - pow(distance_squared / (point.radius * point.radius), 2.0), 0.0, 1.0);
+        float attenuation = window * window / distance_squared;
+        light += point.color * point.intensity * attenuation * max(dot(normal, to_light * inversesqrt(distance_squared)), 0.0);
+    }
+
+    outColor = vec4(fragColor * light, 1.0);
+}
@@ -4,8 +4,16 @@ layout(location = 0) in vec2 inPosition;
 layout(location = 1) in vec3 inColor;
 
 layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec3 fragPosition;
+layout(location = 2) out vec3 fragNormal;
+
+// The pre-pass and the shading pass must compute the same depth for the EQUAL test
+invariant gl_Position;
 
 void main() {
     gl_Position = vec4(inPosition, 0.0, 1.0);
     fragColor = inColor;
+    // Already in clip space, a zero normal keeps it unlit
+    fragPosition = vec3(inPosition, 0.0);
+    fragNormal = vec3(0.0);
 }
\ No newline at end of file
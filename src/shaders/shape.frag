@@ -0,0 +1,55 @@
+#version 460
+#extension GL_EXT_nonuniform_qualifier : require
+
+//Must match ShapeKind
+#define SHAPE_QUAD 0u
+#define SHAPE_CIRCLE 1u
+#define SHAPE_LINE 2u
+#define SHAPE_SPRITE 3u
+
+//Set by ShapeRenderer from the descriptor tier. Classic binds one texture per batch, bindless
+//indexes the whole array with the slot each instance carries.
+layout(constant_id = 0) const bool BINDLESS = false;
+layout(constant_id = 1) const uint TEXTURE_COUNT = 1;
+
+layout(set = 0, binding = 0) uniform sampler2D spriteTextures[TEXTURE_COUNT];
+
+layout(location = 0) in vec2 fragLocal;
+layout(location = 1) in vec2 fragUV;
+layout(location = 2) flat in vec4 fragColor;
+layout(location = 3) flat in vec2 fragParams;
+layout(location = 4) flat in uint fragKind;
+layout(location = 5) flat in uint fragTexture;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    vec4 color = fragColor;
+
+    if (fragKind == SHAPE_CIRCLE) {
+        float radius = fragParams.x;
+        float thickness = fragParams.y;
+        float distance = length(fragLocal) - radius;
+        //Rings are the band of the given width inside the radius
+        if (thickness > 0.0) {
+            distance = abs(distance + thickness * 0.5) - thickness * 0.5;
+        }
+        color.a *= clamp(0.5 - distance, 0.0, 1.0);
+    } else if (fragKind == SHAPE_LINE) {
+        //Capsule around the segment on the local x axis
+        vec2 offset = vec2(max(abs(fragLocal.x) - fragParams.x, 0.0), fragLocal.y);
+        float distance = length(offset) - fragParams.y;
+        color.a *= clamp(0.5 - distance, 0.0, 1.0);
+    } else if (fragKind == SHAPE_SPRITE) {
+        if (BINDLESS) {
+            color *= texture(spriteTextures[nonuniformEXT(fragTexture)], fragUV);
+        } else {
+            color *= texture(spriteTextures[0], fragUV);
+        }
+    }
+
+    if (color.a <= 0.0) {
+        discard;
+    }
+    outColor = color;
+}
@@ -0,0 +1,73 @@
+#version 460
+
+//Must match ShapeKind
+#define SHAPE_QUAD 0u
+#define SHAPE_CIRCLE 1u
+#define SHAPE_LINE 2u
+#define SHAPE_SPRITE 3u
+
+layout(location = 0) in vec2 inP0;
+layout(location = 1) in vec2 inP1;
+layout(location = 2) in vec4 inUV;
+layout(location = 3) in vec4 inColor;
+layout(location = 4) in vec2 inThicknessRotation;
+layout(location = 5) in uvec2 inKindTexture;
+
+layout(push_constant) uniform PushConstants {
+    vec2 scale;
+    vec2 translate;
+} pc;
+
+layout(location = 0) out vec2 fragLocal;
+layout(location = 1) out vec2 fragUV;
+layout(location = 2) flat out vec4 fragColor;
+layout(location = 3) flat out vec2 fragParams;
+layout(location = 4) flat out uint fragKind;
+layout(location = 5) flat out uint fragTexture;
+
+//Two triangles, corners in [-1, 1]
+const vec2 corners[6] = vec2[](
+    vec2(-1.0, -1.0), vec2(1.0, -1.0), vec2(1.0, 1.0),
+    vec2(1.0, 1.0), vec2(-1.0, 1.0), vec2(-1.0, -1.0)
+);
+
+//Distance fields get one pixel of margin for the antialiased edge
+const float AA_MARGIN = 1.0;
+
+void main() {
+    vec2 corner = corners[gl_VertexIndex];
+    uint inKind = inKindTexture.x;
+    float thickness = inThicknessRotation.x;
+    float rotation = inThicknessRotation.y;
+
+    vec2 center = inP0;
+    vec2 axis = vec2(1.0, 0.0);
+    vec2 half_size = inP1;
+    vec2 params = vec2(0.0);
+
+    if (inKind == SHAPE_CIRCLE) {
+        half_size = vec2(inP1.x + AA_MARGIN);
+        params = vec2(inP1.x, thickness);
+    } else if (inKind == SHAPE_LINE) {
+        vec2 delta = inP1 - inP0;
+        float half_length = length(delta) * 0.5;
+        center = (inP0 + inP1) * 0.5;
+        axis = half_length > 0.0 ? delta / (2.0 * half_length) : vec2(1.0, 0.0);
+        //Round caps extend by half the thickness
+        half_size = vec2(half_length, 0.0) + vec2(thickness * 0.5 + AA_MARGIN);
+        params = vec2(half_length, thickness * 0.5);
+    } else {
+        axis = vec2(cos(rotation), sin(rotation));
+    }
+
+    vec2 local = corner * half_size;
+    vec2 world = center + axis * local.x + vec2(-axis.y, axis.x) * local.y;
+
+    gl_Position = vec4(world * pc.scale + pc.translate, 0.0, 1.0);
+    fragLocal = local;
+    fragUV = mix(inUV.xy, inUV.zw, corner * 0.5 + 0.5);
+    fragColor = inColor;
+    fragParams = params;
+    fragKind = inKind;
+    fragTexture = inKindTexture.y;
+}
@@ -0,0 +1,45 @@
+#version 460
+
+layout(set = 0, binding = 0) uniform sampler2D source;
+
+//Must match UpscalePushConstants
+layout(push_constant) uniform PushConstants {
+    vec2 uv_scale;      //Rendered part of the source
+    vec2 texel_size;
+    float sharpness;
+} pc;
+
+layout(location = 0) in vec2 fragUV;
+
+layout(location = 0) out vec4 outColor;
+
+//Keeps bilinear taps off the stale texels next to the rendered corner
+vec3 tap(vec2 uv) {
+    vec2 limit = pc.uv_scale - 0.5 * pc.texel_size;
+    return texture(source, clamp(uv, 0.5 * pc.texel_size, limit)).rgb;
+}
+
+void main() {
+    vec2 uv = fragUV * pc.uv_scale;
+    vec3 center = tap(uv);
+
+    if (pc.sharpness <= 0.0) {
+        outColor = vec4(center, 1.0);
+        return;
+    }
+
+    vec3 north = tap(uv - vec2(0.0, pc.texel_size.y));
+    vec3 south = tap(uv + vec2(0.0, pc.texel_size.y));
+    vec3 west = tap(uv - vec2(pc.texel_size.x, 0.0));
+    vec3 east = tap(uv + vec2(pc.texel_size.x, 0.0));
+
+    //Contrast adaptive: the closer the neighbourhood already is to 0 or 1, the less it is sharpened
+    vec3 low = min(center, min(min(north, south), min(west, east)));
+    vec3 high = max(center, max(max(north, south), max(west, east)));
+    vec3 amplitude = clamp(min(low, 1.0 - high) / max(high, vec3(1e-4)), 0.0, 1.0);
+
+    //Negative lobe of at most 1/5, so the normalization below never gets close to 0
+    vec3 weight = -sqrt(amplitude) * 0.2 * pc.sharpness;
+    vec3 color = (center + (north + south + west + east) * weight) / (1.0 + 4.0 * weight);
+    outColor = vec4(clamp(color, 0.0, 1.0), 1.0);
+}
@@ -0,0 +1,10 @@
+#version 460
+
+layout(location = 0) out vec2 fragUV;
+
+//One triangle covering the screen, uv is [0, 1] over the visible part
+void main() {
+    vec2 uv = vec2((gl_VertexIndex << 1) & 2, gl_VertexIndex & 2);
+    gl_Position = vec4(uv * 2.0 - 1.0, 0.0, 1.0);
+    fragUV = uv;
+}
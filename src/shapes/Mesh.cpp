@@ -0,0 +1,56 @@
+#include "Mesh.h"
+#include <glm/gtc/constants.hpp>
+#include <algorithm>
+#include <limits>
+
+Mesh make_sphere(uint32_t rings, uint32_t segments, float radius, const glm::vec3& color){
+    Mesh mesh;
+    mesh.vertices.reserve((rings + 1) * (segments + 1));
+    mesh.indices.reserve(rings * segments * 6);
+
+    //One vertex per ring/segment crossing, the seam column is duplicated
+    for (uint32_t ring = 0; ring <= rings; ring++) {
+        float theta = glm::pi<float>() * static_cast<float>(ring) / static_cast<float>(rings);
+
+        for (uint32_t segment = 0; segment <= segments; segment++) {
+            float phi = glm::two_pi<float>() * static_cast<float>(segment) / static_cast<float>(segments);
+
+            glm::vec3 normal = {
+                std::sin(theta) * std::cos(phi),
+                std::cos(theta),
+                std::sin(theta) * std::sin(phi)
+            };
+
+            mesh.vertices.push_back({normal * radius, normal, color});
+        }
+    }
+
+    for (uint32_t ring = 0; ring < rings; ring++) {
+        for (uint32_t segment = 0; segment < segments; segment++) {
+            uint32_t a = ring * (segments + 1) + segment;
+            uint32_t b = a + segments + 1;
+
+            mesh.indices.insert(mesh.indices.end(), {a, a + 1, b});
+            mesh.indices.insert(mesh.indices.end(), {a + 1, b + 1, b});
+        }
+    }
+
+    return mesh;
+}
+
+MeshBounds compute_mesh_bounds(const Mesh& mesh){
+    glm::vec3 min_position(std::numeric_limits<float>::max());
+    glm::vec3 max_position(std::numeric_limits<float>::lowest());
+
+    for (const auto& vertex : mesh.vertices) {
+        min_position = glm::min(min_position, vertex.position);
+        max_position = glm::max(max_position, vertex.position);
+    }
+
+    MeshBounds bounds{(min_position + max_position) * 0.5f, 0.0f};
+    for (const auto& vertex : mesh.vertices) {
+        bounds.radius = std::max(bounds.radius, glm::length(vertex.position - bounds.center));
+    }
+
+    return bounds;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vulkan/vulkan.h>
+#include <array>
+#include <vector>
+#include <cstdint>
+
+//Vertex layout for 3D meshes, tightly packed so shaders can also read it through buffer references
+struct MeshVertex {
+    glm::vec3 position;
+    glm::vec3 normal;
+    glm::vec3 color;
+
+    static VkVertexInputBindingDescription getBindingDescription() {
+        VkVertexInputBindingDescription bindingDescription{};
+        bindingDescription.binding = 0;
+        bindingDescription.stride = sizeof(MeshVertex);
+        bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+        return bindingDescription;
+    }
+
+    static std::array<VkVertexInputAttributeDescription, 3> getAttributeDescriptions() {
+        std::array<VkVertexInputAttributeDescription, 3> attributeDescriptions{};
+        attributeDescriptions[0].binding = 0;
+        attributeDescriptions[0].location = 0;
+        attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
+        attributeDescriptions[0].offset = offsetof(MeshVertex, position);
+
+        attributeDescriptions[1].binding = 0;
+        attributeDescriptions[1].location = 1;
+        attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
+        attributeDescriptions[1].offset = offsetof(MeshVertex, normal);
+
+        attributeDescriptions[2].binding = 0;
+        attributeDescriptions[2].location = 2;
+        attributeDescriptions[2].format = VK_FORMAT_R32G32B32_SFLOAT;
+        attributeDescriptions[2].offset = offsetof(MeshVertex, color);
+
+        return attributeDescriptions;
+    }
+};
+
+//Range of Mesh::indices drawn for one level of detail
+struct MeshLod {
+    uint32_t index_offset;
+    uint32_t index_count;
+    //Object space deviation from the full detail mesh
+    float error;
+};
+
+struct Mesh {
+    std::vector<MeshVertex> vertices;
+    std::vector<uint32_t> indices;
+    //Empty until generate_lods ran, lods[0] is always the full detail range
+    std::vector<MeshLod> lods;
+};
+
+//Bounding sphere around all vertices of a mesh
+struct MeshBounds {
+    glm::vec3 center;
+    float radius;
+};
+
+MeshBounds compute_mesh_bounds(const Mesh& mesh);
+
+//Procedural UV sphere with counter-clockwise outward facing triangles
+Mesh make_sphere(uint32_t rings, uint32_t segments, float radius, const glm::vec3& color);
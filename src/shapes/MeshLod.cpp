@@ -0,0 +1,301 @@
+#include "MeshLod.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+
+namespace {
+    //Symmetric 4x4 matrix summing squared distances to a set of planes
+    struct Quadric {
+        double a00 = 0, a01 = 0, a02 = 0, a03 = 0;
+        double a11 = 0, a12 = 0, a13 = 0;
+        double a22 = 0, a23 = 0;
+        double a33 = 0;
+
+        void add_plane(const glm::dvec3& n, double d, double weight) {
+            a00 += weight * n.x * n.x; a01 += weight * n.x * n.y; a02 += weight * n.x * n.z; a03 += weight * n.x * d;
+            a11 += weight * n.y * n.y; a12 += weight * n.y * n.z; a13 += weight * n.y * d;
+            a22 += weight * n.z * n.z; a23 += weight * n.z * d;
+            a33 += weight * d * d;
+        }
+
+        Quadric& operator+=(const Quadric& other) {
+            a00 += other.a00; a01 += other.a01; a02 += other.a02; a03 += other.a03;
+            a11 += other.a11; a12 += other.a12; a13 += other.a13;
+            a22 += other.a22; a23 += other.a23;
+            a33 += other.a33;
+            return *this;
+        }
+
+        double error(const glm::dvec3& p) const {
+            double result = a00 * p.x * p.x + 2.0 * a01 * p.x * p.y + 2.0 * a02 * p.x * p.z + 2.0 * a03 * p.x
+                + a11 * p.y * p.y + 2.0 * a12 * p.y * p.z + 2.0 * a13 * p.y
+                + a22 * p.z * p.z + 2.0 * a23 * p.z
+                + a33;
+            return std::max(result, 0.0);
+        }
+    };
+
+    struct Collapse {
+        uint32_t from;
+        uint32_t to;
+        double cost;
+    };
+
+    //Boundary edges get a heavily weighted plane perpendicular to their face so open borders keep their shape
+    constexpr double BOUNDARY_WEIGHT = 10.0;
+
+    struct PositionKey {
+        uint32_t bits[3];
+        bool operator==(const PositionKey& other) const { return memcmp(bits, other.bits, sizeof(bits)) == 0; }
+    };
+
+    struct PositionHash {
+        size_t operator()(const PositionKey& key) const {
+            return (key.bits[0] * 73856093u) ^ (key.bits[1] * 19349663u) ^ (key.bits[2] * 83492791u);
+        }
+    };
+
+    //Maps every vertex to the first vertex sharing its position, so seams collapse as one
+    std::vector<uint32_t> weld_positions(const std::vector<MeshVertex>& vertices){
+        std::vector<uint32_t> canonical(vertices.size());
+        std::unordered_map<PositionKey, uint32_t, PositionHash> first_at_position;
+        first_at_position.reserve(vertices.size());
+
+        for (uint32_t i = 0; i < vertices.size(); i++) {
+            PositionKey key;
+            memcpy(key.bits, &vertices[i].position, sizeof(key.bits));
+            canonical[i] = first_at_position.emplace(key, i).first->second;
+        }
+
+        return canonical;
+    }
+
+    uint64_t edge_key(uint32_t a, uint32_t b){
+        return a < b ? (uint64_t(a) << 32) | b : (uint64_t(b) << 32) | a;
+    }
+}
+
+std::vector<uint32_t> simplify_indices(const std::vector<MeshVertex>& vertices, const std::vector<uint32_t>& indices, size_t target_index_count, float target_error, float* result_error){
+    const size_t vertex_count = vertices.size();
+    std::vector<uint32_t> canonical = weld_positions(vertices);
+
+    std::vector<uint32_t> work;
+    work.reserve(indices.size());
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        uint32_t a = canonical[indices[i]], b = canonical[indices[i + 1]], c = canonical[indices[i + 2]];
+        if (a != b && b != c && a != c) {
+            work.insert(work.end(), {a, b, c});
+        }
+    }
+
+    auto position = [&](uint32_t v) { return glm::dvec3(vertices[v].position); };
+
+    //Face quadrics plus boundary quadrics
+    std::vector<Quadric> quadrics(vertex_count);
+    std::unordered_map<uint64_t, uint32_t> edge_use;
+    for (size_t i = 0; i < work.size(); i += 3) {
+        for (uint32_t e = 0; e < 3; e++) {
+            edge_use[edge_key(work[i + e], work[i + (e + 1) % 3])]++;
+        }
+    }
+
+    for (size_t i = 0; i < work.size(); i += 3) {
+        glm::dvec3 p[3] = {position(work[i]), position(work[i + 1]), position(work[i + 2])};
+        glm::dvec3 normal = glm::cross(p[1] - p[0], p[2] - p[0]);
+        double length = glm::length(normal);
+        if (length == 0.0) {
+            continue;
+        }
+        normal /= length;
+
+        Quadric face;
+        face.add_plane(normal, -glm::dot(normal, p[0]), 1.0);
+        for (uint32_t corner = 0; corner < 3; corner++) {
+            quadrics[work[i + corner]] += face;
+        }
+
+        for (uint32_t e = 0; e < 3; e++) {
+            uint32_t a = work[i + e], b = work[i + (e + 1) % 3];
+            if (edge_use[edge_key(a, b)] != 1) {
+                continue;
+            }
+
+            glm::dvec3 edge = p[(e + 1) % 3] - p[e];
+            glm::dvec3 boundary_normal = glm::cross(edge, normal);
+            double boundary_length = glm::length(boundary_normal);
+            if (boundary_length == 0.0) {
+                continue;
+            }
+            boundary_normal /= boundary_length;
+
+            Quadric boundary;
+            boundary.add_plane(boundary_normal, -glm::dot(boundary_normal, p[e]), BOUNDARY_WEIGHT);
+            quadrics[a] += boundary;
+            quadrics[b] += boundary;
+        }
+    }
+
+    const double max_cost = double(target_error) * double(target_error);
+    double worst_cost = 0.0;
+
+    std::vector<uint32_t> remap(vertex_count);
+    std::vector<uint8_t> locked(vertex_count);
+    std::vector<uint32_t> adjacency_offsets(vertex_count + 1);
+    std::vector<uint32_t> adjacency;
+    std::vector<Collapse> collapses;
+    std::vector<uint64_t> edges;
+
+    //Each pass collapses a set of independent edges, cheapest first
+    while (work.size() > target_index_count) {
+        const uint32_t triangle_count = static_cast<uint32_t>(work.size() / 3);
+
+        //Vertex to triangle adjacency
+        std::fill(adjacency_offsets.begin(), adjacency_offsets.end(), 0);
+        for (uint32_t v : work) {
+            adjacency_offsets[v + 1]++;
+        }
+        for (size_t v = 0; v < vertex_count; v++) {
+            adjacency_offsets[v + 1] += adjacency_offsets[v];
+        }
+        adjacency.resize(work.size());
+        std::vector<uint32_t> fill(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+        for (uint32_t t = 0; t < triangle_count; t++) {
+            for (uint32_t corner = 0; corner < 3; corner++) {
+                adjacency[fill[work[t * 3 + corner]]++] = t;
+            }
+        }
+
+        //Unique edges, collapse in the cheaper direction
+        edges.clear();
+        for (size_t i = 0; i < work.size(); i += 3) {
+            for (uint32_t e = 0; e < 3; e++) {
+                edges.push_back(edge_key(work[i + e], work[i + (e + 1) % 3]));
+            }
+        }
+        std::sort(edges.begin(), edges.end());
+        edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+        collapses.clear();
+        for (uint64_t edge : edges) {
+            uint32_t a = uint32_t(edge >> 32), b = uint32_t(edge & 0xFFFFFFFF);
+            Quadric combined = quadrics[a];
+            combined += quadrics[b];
+
+            double cost_to_b = combined.error(position(b));
+            double cost_to_a = combined.error(position(a));
+            collapses.push_back(cost_to_b <= cost_to_a ? Collapse{a, b, cost_to_b} : Collapse{b, a, cost_to_a});
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse& l, const Collapse& r) { return l.cost < r.cost; });
+
+        for (size_t v = 0; v < vertex_count; v++) {
+            remap[v] = static_cast<uint32_t>(v);
+        }
+        std::fill(locked.begin(), locked.end(), 0);
+
+        size_t remaining_indices = work.size();
+        uint32_t collapsed = 0;
+
+        for (const Collapse& collapse : collapses) {
+            if (remaining_indices <= target_index_count || collapse.cost > max_cost) {
+                break;
+            }
+            if (locked[collapse.from] || locked[collapse.to]) {
+                continue;
+            }
+
+            //Reject collapses that flip a surviving triangle
+            bool flips = false;
+            uint32_t removed = 0;
+            for (uint32_t i = adjacency_offsets[collapse.from]; i < adjacency_offsets[collapse.from + 1] && !flips; i++) {
+                const uint32_t* triangle = &work[adjacency[i] * 3];
+                if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to) {
+                    removed++;
+                    continue;
+                }
+
+                glm::dvec3 before[3], after[3];
+                for (uint32_t corner = 0; corner < 3; corner++) {
+                    before[corner] = position(triangle[corner]);
+                    after[corner] = triangle[corner] == collapse.from ? position(collapse.to) : before[corner];
+                }
+
+                glm::dvec3 normal_before = glm::cross(before[1] - before[0], before[2] - before[0]);
+                glm::dvec3 normal_after = glm::cross(after[1] - after[0], after[2] - after[0]);
+                flips = glm::dot(normal_before, normal_after) <= 0.0;
+            }
+            if (flips) {
+                continue;
+            }
+
+            remap[collapse.from] = collapse.to;
+            quadrics[collapse.to] += quadrics[collapse.from];
+            remaining_indices -= removed * 3;
+            worst_cost = std::max(worst_cost, collapse.cost);
+            collapsed++;
+
+            //Lock the whole one-ring so the flip checks of later collapses stay valid
+            for (uint32_t i = adjacency_offsets[collapse.from]; i < adjacency_offsets[collapse.from + 1]; i++) {
+                const uint32_t* triangle = &work[adjacency[i] * 3];
+                locked[triangle[0]] = locked[triangle[1]] = locked[triangle[2]] = 1;
+            }
+        }
+
+        if (collapsed == 0) {
+            break;
+        }
+
+        size_t write = 0;
+        for (size_t i = 0; i < work.size(); i += 3) {
+            uint32_t a = remap[work[i]], b = remap[work[i + 1]], c = remap[work[i + 2]];
+            if (a != b && b != c && a != c) {
+                work[write++] = a;
+                work[write++] = b;
+                work[write++] = c;
+            }
+        }
+        work.resize(write);
+    }
+
+    if (result_error) {
+        *result_error = static_cast<float>(std::sqrt(worst_cost));
+    }
+
+    return work;
+}
+
+void generate_lods(Mesh& mesh, uint32_t max_lods, float reduction){
+    //Start over from the full detail range
+    if (!mesh.lods.empty()) {
+        mesh.indices.resize(mesh.lods[0].index_offset + mesh.lods[0].index_count);
+    }
+
+    mesh.lods.clear();
+    mesh.lods.push_back({0, static_cast<uint32_t>(mesh.indices.size()), 0.0f});
+
+    std::vector<uint32_t> current(mesh.indices.begin(), mesh.indices.end());
+
+    for (uint32_t level = 1; level < max_lods; level++) {
+        size_t target = static_cast<size_t>(static_cast<float>(current.size() / 3) * reduction) * 3;
+
+        float error = 0.0f;
+        std::vector<uint32_t> simplified = simplify_indices(mesh.vertices, current, target, std::numeric_limits<float>::max(), &error);
+
+        //Stop once simplification stalls, the extra level would cost memory for nothing
+        if (simplified.empty() || simplified.size() * 10 > current.size() * 9) {
+            break;
+        }
+
+        //Errors accumulate along the chain since each level starts from the previous one
+        MeshLod lod{};
+        lod.index_offset = static_cast<uint32_t>(mesh.indices.size());
+        lod.index_count = static_cast<uint32_t>(simplified.size());
+        lod.error = mesh.lods.back().error + error;
+
+        mesh.indices.insert(mesh.indices.end(), simplified.begin(), simplified.end());
+        mesh.lods.push_back(lod);
+
+        current = std::move(simplified);
+    }
+}
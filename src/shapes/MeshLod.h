@@ -0,0 +1,15 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include "Mesh.h"
+
+//Quadric error metric simplification by edge collapse. Vertices are never moved or added,
+//the result only references existing vertices so every LOD shares one vertex buffer.
+//Stops at target_index_count or once the next collapse would exceed target_error.
+//result_error receives the largest object space error introduced.
+std::vector<uint32_t> simplify_indices(const std::vector<MeshVertex>& vertices, const std::vector<uint32_t>& indices, size_t target_index_count, float target_error, float* result_error = nullptr);
+
+//Appends a chain of simplified index ranges to mesh.indices and describes them in mesh.lods.
+//Each level targets reduction times the triangles of the previous one.
+void generate_lods(Mesh& mesh, uint32_t max_lods = 6, float reduction = 0.5f);
@@ -0,0 +1,313 @@
+#include "MeshOptimizer.h"
+#include "../utils/Logger.h"
+#include <algorithm>
+#include <numeric>
+#include <string_view>
+#include <unordered_map>
+
+VertexCacheStats analyze_vertex_cache(const std::vector<uint32_t>& indices, size_t vertex_count, uint32_t cache_size){
+    VertexCacheStats stats;
+    //Not a single triangle, nothing to divide by
+    if (indices.size() < 3) {
+        return stats;
+    }
+
+    //FIFO cache, a vertex is in the cache while fewer than cache_size misses happened since it was loaded
+    std::vector<uint32_t> loaded_at(vertex_count, 0);
+    std::vector<uint8_t> referenced(vertex_count, 0);
+    uint32_t misses = 0;
+    uint32_t unique = 0;
+
+    for (uint32_t index : indices) {
+        if (loaded_at[index] == 0 || misses - loaded_at[index] >= cache_size) {
+            misses++;
+            loaded_at[index] = misses;
+        }
+        if (!referenced[index]) {
+            referenced[index] = 1;
+            unique++;
+        }
+    }
+
+    stats.acmr = static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+    stats.atvr = static_cast<float>(misses) / static_cast<float>(unique);
+    return stats;
+}
+
+std::vector<uint32_t> generate_vertex_remap(const void* vertices, size_t vertex_count, size_t vertex_size, size_t& unique_count){
+    const char* bytes = static_cast<const char*>(vertices);
+
+    std::vector<uint32_t> remap(vertex_count);
+    std::unordered_map<std::string_view, uint32_t> unique_vertices;
+    unique_vertices.reserve(vertex_count);
+
+    for (size_t i = 0; i < vertex_count; i++) {
+        std::string_view key(bytes + i * vertex_size, vertex_size);
+        remap[i] = unique_vertices.emplace(key, static_cast<uint32_t>(unique_vertices.size())).first->second;
+    }
+
+    unique_count = unique_vertices.size();
+    return remap;
+}
+
+std::vector<uint32_t> optimize_vertex_cache(const std::vector<uint32_t>& indices, size_t vertex_count, uint32_t cache_size, std::vector<uint32_t>* cluster_starts){
+    const size_t triangle_count = indices.size() / 3;
+
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+    if (cluster_starts) {
+        cluster_starts->clear();
+    }
+
+    //Vertex to triangle adjacency and live triangle count per vertex
+    std::vector<uint32_t> live_triangles(vertex_count, 0);
+    for (size_t i = 0; i < triangle_count * 3; i++) {
+        live_triangles[indices[i]]++;
+    }
+
+    std::vector<uint32_t> adjacency_offsets(vertex_count + 1, 0);
+    for (size_t v = 0; v < vertex_count; v++) {
+        adjacency_offsets[v + 1] = adjacency_offsets[v] + live_triangles[v];
+    }
+
+    std::vector<uint32_t> adjacency(triangle_count * 3);
+    std::vector<uint32_t> fill(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+    for (size_t t = 0; t < triangle_count; t++) {
+        for (uint32_t corner = 0; corner < 3; corner++) {
+            adjacency[fill[indices[t * 3 + corner]]++] = static_cast<uint32_t>(t);
+        }
+    }
+
+    std::vector<uint32_t> cache_time(vertex_count, 0);
+    std::vector<uint8_t> emitted(triangle_count, 0);
+    std::vector<uint32_t> dead_end_stack;
+    std::vector<uint32_t> candidates;
+
+    uint32_t timestamp = cache_size + 1;
+    size_t cursor = 0;
+
+    //Fans around one vertex at a time, then moves to the candidate that will stay longest in the cache
+    auto skip_dead_end = [&]() -> int64_t {
+        while (!dead_end_stack.empty()) {
+            uint32_t vertex = dead_end_stack.back();
+            dead_end_stack.pop_back();
+            if (live_triangles[vertex] > 0) {
+                return vertex;
+            }
+        }
+        while (cursor < vertex_count) {
+            if (live_triangles[cursor] > 0) {
+                return static_cast<int64_t>(cursor);
+            }
+            cursor++;
+        }
+        return -1;
+    };
+
+    int64_t fanning = triangle_count > 0 ? skip_dead_end() : -1;
+    bool cold_start = true;
+
+    while (fanning >= 0) {
+        if (cold_start && cluster_starts) {
+            cluster_starts->push_back(static_cast<uint32_t>(result.size() / 3));
+        }
+
+        candidates.clear();
+        for (uint32_t i = adjacency_offsets[fanning]; i < adjacency_offsets[fanning + 1]; i++) {
+            uint32_t triangle = adjacency[i];
+            if (emitted[triangle]) {
+                continue;
+            }
+
+            for (uint32_t corner = 0; corner < 3; corner++) {
+                uint32_t vertex = indices[triangle * 3 + corner];
+                result.push_back(vertex);
+                dead_end_stack.push_back(vertex);
+                candidates.push_back(vertex);
+                live_triangles[vertex]--;
+
+                if (timestamp - cache_time[vertex] > cache_size) {
+                    cache_time[vertex] = timestamp++;
+                }
+            }
+            emitted[triangle] = 1;
+        }
+
+        //Prefer vertices that will still be cached once all their remaining triangles are emitted
+        int64_t best = -1;
+        int64_t best_priority = -1;
+        for (uint32_t vertex : candidates) {
+            if (live_triangles[vertex] == 0) {
+                continue;
+            }
+
+            int64_t priority = 0;
+            if (timestamp - cache_time[vertex] + 2 * live_triangles[vertex] <= cache_size) {
+                priority = timestamp - cache_time[vertex];
+            }
+            if (priority > best_priority) {
+                best_priority = priority;
+                best = vertex;
+            }
+        }
+
+        cold_start = best < 0;
+        fanning = best >= 0 ? best : skip_dead_end();
+    }
+
+    return result;
+}
+
+std::vector<uint32_t> optimize_overdraw(const std::vector<uint32_t>& indices, const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& cluster_starts, float threshold){
+    const size_t triangle_count = indices.size() / 3;
+    if (cluster_starts.size() < 2) {
+        return indices;
+    }
+
+    //Area weighted mesh centroid
+    glm::vec3 mesh_centroid(0.0f);
+    float mesh_area = 0.0f;
+    for (size_t t = 0; t < triangle_count; t++) {
+        const glm::vec3& a = positions[indices[t * 3]];
+        const glm::vec3& b = positions[indices[t * 3 + 1]];
+        const glm::vec3& c = positions[indices[t * 3 + 2]];
+        float area = glm::length(glm::cross(b - a, c - a));
+        mesh_centroid += (a + b + c) * (area / 3.0f);
+        mesh_area += area;
+    }
+    if (mesh_area > 0.0f) {
+        mesh_centroid /= mesh_area;
+    }
+
+    struct Cluster {
+        uint32_t begin;
+        uint32_t end;
+        float sort_key;
+    };
+
+    std::vector<Cluster> clusters;
+    for (size_t i = 0; i < cluster_starts.size(); i++) {
+        Cluster cluster{};
+        cluster.begin = cluster_starts[i];
+        cluster.end = i + 1 < cluster_starts.size() ? cluster_starts[i + 1] : static_cast<uint32_t>(triangle_count);
+
+        glm::vec3 centroid(0.0f);
+        glm::vec3 normal(0.0f);
+        float area_sum = 0.0f;
+        for (uint32_t t = cluster.begin; t < cluster.end; t++) {
+            const glm::vec3& a = positions[indices[t * 3]];
+            const glm::vec3& b = positions[indices[t * 3 + 1]];
+            const glm::vec3& c = positions[indices[t * 3 + 2]];
+            glm::vec3 face_normal = glm::cross(b - a, c - a);
+            float area = glm::length(face_normal);
+            centroid += (a + b + c) * (area / 3.0f);
+            normal += face_normal;
+            area_sum += area;
+        }
+        if (area_sum > 0.0f) {
+            centroid /= area_sum;
+        }
+        float normal_length = glm::length(normal);
+        if (normal_length > 0.0f) {
+            normal /= normal_length;
+        }
+
+        //Clusters facing away from the center are likely to occlude the others
+        cluster.sort_key = glm::dot(centroid - mesh_centroid, normal);
+        clusters.push_back(cluster);
+    }
+
+    std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& l, const Cluster& r) { return l.sort_key > r.sort_key; });
+
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+    for (const Cluster& cluster : clusters) {
+        result.insert(result.end(), indices.begin() + cluster.begin * 3, indices.begin() + cluster.end * 3);
+    }
+
+    //Overdraw is only worth a bounded loss of vertex cache efficiency
+    float acmr_before = analyze_vertex_cache(indices, positions.size()).acmr;
+    float acmr_after = analyze_vertex_cache(result, positions.size()).acmr;
+    if (acmr_after > acmr_before * threshold) {
+        return indices;
+    }
+
+    return result;
+}
+
+size_t optimize_vertex_fetch_remap(std::vector<uint32_t>& remap, std::vector<uint32_t>& indices, size_t vertex_count){
+    remap.assign(vertex_count, ~0u);
+    uint32_t next = 0;
+
+    for (uint32_t& index : indices) {
+        if (remap[index] == ~0u) {
+            remap[index] = next++;
+        }
+        index = remap[index];
+    }
+
+    return next;
+}
+
+PackedIndices pack_indices(const std::vector<uint32_t>& indices, size_t vertex_count){
+    PackedIndices packed;
+    packed.count = static_cast<uint32_t>(indices.size());
+
+    //0xFFFF stays reserved for primitive restart
+    if (vertex_count < 0xFFFF) {
+        packed.type = VK_INDEX_TYPE_UINT16;
+        packed.data.resize(indices.size() * sizeof(uint16_t));
+        uint16_t* out = reinterpret_cast<uint16_t*>(packed.data.data());
+        for (size_t i = 0; i < indices.size(); i++) {
+            out[i] = static_cast<uint16_t>(indices[i]);
+        }
+    } else {
+        packed.type = VK_INDEX_TYPE_UINT32;
+        packed.data.resize(indices.size() * sizeof(uint32_t));
+        memcpy(packed.data.data(), indices.data(), packed.data.size());
+    }
+
+    return packed;
+}
+
+MeshOptimizeStats optimize_mesh(Mesh& mesh){
+    MeshOptimizeStats stats;
+    stats.vertices_before = mesh.vertices.size();
+
+    //Without LODs the whole index buffer is one range
+    std::vector<MeshLod> ranges = mesh.lods;
+    if (ranges.empty()) {
+        ranges.push_back({0, static_cast<uint32_t>(mesh.indices.size()), 0.0f});
+    }
+
+    auto range_indices = [&](const MeshLod& range) {
+        return std::vector<uint32_t>(mesh.indices.begin() + range.index_offset, mesh.indices.begin() + range.index_offset + range.index_count);
+    };
+
+    stats.cache_before = analyze_vertex_cache(range_indices(ranges[0]), mesh.vertices.size());
+
+    deduplicate_vertices(mesh.vertices, mesh.indices);
+
+    std::vector<glm::vec3> positions(mesh.vertices.size());
+    for (size_t i = 0; i < mesh.vertices.size(); i++) {
+        positions[i] = mesh.vertices[i].position;
+    }
+
+    for (const MeshLod& range : ranges) {
+        std::vector<uint32_t> cluster_starts;
+        std::vector<uint32_t> optimized = optimize_vertex_cache(range_indices(range), mesh.vertices.size(), 16, &cluster_starts);
+        optimized = optimize_overdraw(optimized, positions, cluster_starts);
+        std::copy(optimized.begin(), optimized.end(), mesh.indices.begin() + range.index_offset);
+    }
+
+    optimize_vertex_fetch(mesh.vertices, mesh.indices);
+
+    stats.vertices_after = mesh.vertices.size();
+    stats.cache_after = analyze_vertex_cache(range_indices(ranges[0]), mesh.vertices.size());
+
+    evoke::utils::Logger::info("Mesh optimized: vertices ", stats.vertices_before, " -> ", stats.vertices_after,
+        ", ACMR ", stats.cache_before.acmr, " -> ", stats.cache_after.acmr,
+        ", ATVR ", stats.cache_before.atvr, " -> ", stats.cache_after.atvr);
+
+    return stats;
+}
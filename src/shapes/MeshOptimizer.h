@@ -0,0 +1,81 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "Mesh.h"
+
+//Post-transform cache statistics for an index buffer, simulated with a FIFO cache
+struct VertexCacheStats {
+    //Average cache miss ratio: transformed vertices per triangle, 0.5 is the practical optimum
+    float acmr = 0.0f;
+    //Average transform to vertex ratio: transformed vertices per referenced vertex, 1.0 is optimal
+    float atvr = 0.0f;
+};
+
+VertexCacheStats analyze_vertex_cache(const std::vector<uint32_t>& indices, size_t vertex_count, uint32_t cache_size = 16);
+
+//Maps every vertex to a compact index shared by all bitwise identical vertices, in order of first occurrence.
+//unique_count receives the number of distinct vertices.
+std::vector<uint32_t> generate_vertex_remap(const void* vertices, size_t vertex_count, size_t vertex_size, size_t& unique_count);
+
+//Tipsify (Sander et al.) triangle reordering for the post-transform cache. Optional cluster_starts
+//receives the first triangle of every run that starts on a cold cache, the overdraw pass sorts those.
+std::vector<uint32_t> optimize_vertex_cache(const std::vector<uint32_t>& indices, size_t vertex_count, uint32_t cache_size = 16, std::vector<uint32_t>* cluster_starts = nullptr);
+
+//Sorts clusters front-to-back in a view independent way so outward facing ones come first.
+//Falls back to the input order if the cache miss ratio would grow beyond threshold times the original.
+std::vector<uint32_t> optimize_overdraw(const std::vector<uint32_t>& indices, const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& cluster_starts, float threshold = 1.05f);
+
+//Renumbers vertices in order of first use. Unreferenced vertices are dropped. Returns the new vertex count.
+size_t optimize_vertex_fetch_remap(std::vector<uint32_t>& remap, std::vector<uint32_t>& indices, size_t vertex_count);
+
+template <typename V>
+void remap_vertices(std::vector<V>& vertices, const std::vector<uint32_t>& remap, size_t new_count) {
+    std::vector<V> result(new_count);
+    for (size_t i = 0; i < vertices.size(); i++) {
+        if (remap[i] != ~0u) {
+            result[remap[i]] = vertices[i];
+        }
+    }
+    vertices = std::move(result);
+}
+
+template <typename V>
+void deduplicate_vertices(std::vector<V>& vertices, std::vector<uint32_t>& indices) {
+    size_t unique_count = 0;
+    std::vector<uint32_t> remap = generate_vertex_remap(vertices.data(), vertices.size(), sizeof(V), unique_count);
+
+    for (uint32_t& index : indices) {
+        index = remap[index];
+    }
+    remap_vertices(vertices, remap, unique_count);
+}
+
+template <typename V>
+void optimize_vertex_fetch(std::vector<V>& vertices, std::vector<uint32_t>& indices) {
+    std::vector<uint32_t> remap;
+    size_t new_count = optimize_vertex_fetch_remap(remap, indices, vertices.size());
+    remap_vertices(vertices, remap, new_count);
+}
+
+//Index data in the smallest type that can address every vertex
+struct PackedIndices {
+    VkIndexType type = VK_INDEX_TYPE_UINT32;
+    std::vector<uint8_t> data;
+    uint32_t count = 0;
+};
+
+PackedIndices pack_indices(const std::vector<uint32_t>& indices, size_t vertex_count);
+
+struct MeshOptimizeStats {
+    size_t vertices_before = 0;
+    size_t vertices_after = 0;
+    VertexCacheStats cache_before;
+    VertexCacheStats cache_after;
+};
+
+//Full import pass for a mesh: deduplication, per LOD cache and overdraw ordering, then vertex fetch ordering
+MeshOptimizeStats optimize_mesh(Mesh& mesh);
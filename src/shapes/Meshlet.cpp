@@ -0,0 +1,145 @@
+#include "Meshlet.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+    //Bounding sphere and normal cone of one finished meshlet
+    void compute_bounds(const Mesh& mesh, const MeshletData& data, Meshlet& meshlet){
+        glm::vec3 min_position(std::numeric_limits<float>::max());
+        glm::vec3 max_position(std::numeric_limits<float>::lowest());
+
+        for (uint32_t i = 0; i < meshlet.vertex_count; i++) {
+            const glm::vec3& position = mesh.vertices[data.meshlet_vertices[meshlet.vertex_offset + i]].position;
+            min_position = glm::min(min_position, position);
+            max_position = glm::max(max_position, position);
+        }
+
+        meshlet.center = (min_position + max_position) * 0.5f;
+        meshlet.radius = 0.0f;
+        for (uint32_t i = 0; i < meshlet.vertex_count; i++) {
+            const glm::vec3& position = mesh.vertices[data.meshlet_vertices[meshlet.vertex_offset + i]].position;
+            meshlet.radius = std::max(meshlet.radius, glm::length(position - meshlet.center));
+        }
+
+        //Face normals of all non-degenerate triangles
+        std::vector<glm::vec3> normals;
+        normals.reserve(meshlet.triangle_count);
+        glm::vec3 normal_sum(0.0f);
+
+        for (uint32_t i = 0; i < meshlet.triangle_count; i++) {
+            uint32_t packed = data.meshlet_triangles[meshlet.triangle_offset + i];
+            const glm::vec3& a = mesh.vertices[data.meshlet_vertices[meshlet.vertex_offset + (packed & 0xFF)]].position;
+            const glm::vec3& b = mesh.vertices[data.meshlet_vertices[meshlet.vertex_offset + ((packed >> 8) & 0xFF)]].position;
+            const glm::vec3& c = mesh.vertices[data.meshlet_vertices[meshlet.vertex_offset + ((packed >> 16) & 0xFF)]].position;
+
+            glm::vec3 normal = glm::cross(b - a, c - a);
+            float length = glm::length(normal);
+            if (length > 0.0f) {
+                normals.push_back(normal / length);
+                normal_sum += normal / length;
+            }
+        }
+
+        //A cone wider than ~84 degrees can never be fully backfacing, disable culling for it
+        meshlet.cone_axis = {0.0f, 0.0f, 1.0f};
+        meshlet.cone_cutoff = 1.0f;
+
+        float axis_length = glm::length(normal_sum);
+        if (normals.empty() || axis_length == 0.0f) {
+            return;
+        }
+
+        glm::vec3 axis = normal_sum / axis_length;
+        float min_dot = 1.0f;
+        for (const auto& normal : normals) {
+            min_dot = std::min(min_dot, glm::dot(axis, normal));
+        }
+
+        meshlet.cone_axis = axis;
+        if (min_dot > 0.1f) {
+            meshlet.cone_cutoff = std::sqrt(1.0f - min_dot * min_dot);
+        }
+    }
+}
+
+std::vector<uint32_t> MeshletData::expanded_indices() const {
+    std::vector<uint32_t> indices;
+    indices.reserve(meshlet_triangles.size() * 3);
+
+    for (const auto& meshlet : meshlets) {
+        for (uint32_t i = 0; i < meshlet.triangle_count; i++) {
+            uint32_t packed = meshlet_triangles[meshlet.triangle_offset + i];
+            indices.push_back(meshlet_vertices[meshlet.vertex_offset + (packed & 0xFF)]);
+            indices.push_back(meshlet_vertices[meshlet.vertex_offset + ((packed >> 8) & 0xFF)]);
+            indices.push_back(meshlet_vertices[meshlet.vertex_offset + ((packed >> 16) & 0xFF)]);
+        }
+    }
+
+    return indices;
+}
+
+MeshletData build_meshlets(const Mesh& mesh, uint32_t max_vertices, uint32_t max_triangles){
+    //Local indices are packed into 8 bits
+    max_vertices = std::min(max_vertices, 256u);
+
+    MeshletData data;
+
+    //Meshlet local index of every global vertex, ~0u when not part of the current meshlet
+    std::vector<uint32_t> local_index(mesh.vertices.size(), ~0u);
+
+    Meshlet current{};
+
+    auto finish_meshlet = [&]() {
+        if (current.triangle_count == 0) {
+            return;
+        }
+
+        compute_bounds(mesh, data, current);
+        data.meshlets.push_back(current);
+
+        for (uint32_t i = 0; i < current.vertex_count; i++) {
+            local_index[data.meshlet_vertices[current.vertex_offset + i]] = ~0u;
+        }
+
+        current = {};
+        current.vertex_offset = static_cast<uint32_t>(data.meshlet_vertices.size());
+        current.triangle_offset = static_cast<uint32_t>(data.meshlet_triangles.size());
+    };
+
+    //Only the full detail range is split, coarser LODs are drawn as plain index ranges
+    size_t index_begin = mesh.lods.empty() ? 0 : mesh.lods[0].index_offset;
+    size_t index_end = mesh.lods.empty() ? mesh.indices.size() : index_begin + mesh.lods[0].index_count;
+
+    for (size_t i = index_begin; i + 2 < index_end; i += 3) {
+        const uint32_t triangle[3] = {mesh.indices[i], mesh.indices[i + 1], mesh.indices[i + 2]};
+
+        uint32_t new_vertices = 0;
+        for (uint32_t vertex : triangle) {
+            if (local_index[vertex] == ~0u) {
+                new_vertices++;
+            }
+        }
+
+        if (current.vertex_count + new_vertices > max_vertices || current.triangle_count + 1 > max_triangles) {
+            finish_meshlet();
+        }
+
+        uint32_t packed = 0;
+        for (uint32_t corner = 0; corner < 3; corner++) {
+            uint32_t vertex = triangle[corner];
+            if (local_index[vertex] == ~0u) {
+                local_index[vertex] = current.vertex_count++;
+                data.meshlet_vertices.push_back(vertex);
+            }
+            packed |= local_index[vertex] << (corner * 8);
+        }
+
+        data.meshlet_triangles.push_back(packed);
+        current.triangle_count++;
+    }
+
+    finish_meshlet();
+
+    return data;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+#include "Mesh.h"
+
+constexpr uint32_t MESHLET_MAX_VERTICES = 64;
+constexpr uint32_t MESHLET_MAX_TRIANGLES = 124;
+
+//Layout matches the std430 Meshlet struct in meshlet_common.glsl
+struct Meshlet {
+    //Bounding sphere
+    glm::vec3 center;
+    float radius;
+
+    //Normal cone, the meshlet is backfacing for every camera with
+    //dot(normalize(center - camera), cone_axis) >= cone_cutoff (widened by radius)
+    glm::vec3 cone_axis;
+    float cone_cutoff;
+
+    uint32_t vertex_offset;
+    uint32_t triangle_offset;
+    uint32_t vertex_count;
+    uint32_t triangle_count;
+};
+
+struct MeshletData {
+    std::vector<Meshlet> meshlets;
+
+    //Global vertex index for every meshlet local vertex
+    std::vector<uint32_t> meshlet_vertices;
+
+    //One entry per triangle, three 8-bit meshlet local indices packed low to high
+    std::vector<uint32_t> meshlet_triangles;
+
+    //Meshlet triangles expanded to global indices, meshlet i starts at triangle_offset * 3
+    std::vector<uint32_t> expanded_indices() const;
+};
+
+//Greedily splits an indexed triangle list into meshlets and computes their culling bounds
+MeshletData build_meshlets(const Mesh& mesh, uint32_t max_vertices = MESHLET_MAX_VERTICES, uint32_t max_triangles = MESHLET_MAX_TRIANGLES);
@@ -6,30 +6,7 @@
 struct Vertex {
     glm::vec2 pos;
     glm::vec3 color;
-    
-    static VkVertexInputBindingDescription getBindingDescription() {
-        VkVertexInputBindingDescription bindingDescription{};
-        bindingDescription.binding = 0;
-        bindingDescription.stride = sizeof(Vertex);
-        bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-        
-        return bindingDescription;
-    }
-    
-    static std::array<VkVertexInputAttributeDescription, 2> getAttributeDescriptions() {
-        std::array<VkVertexInputAttributeDescription, 2> attributeDescriptions{};
-        attributeDescriptions[0].binding = 0;
-        attributeDescriptions[0].location = 0;
-        attributeDescriptions[0].format = VK_FORMAT_R32G32_SFLOAT;
-        attributeDescriptions[0].offset = offsetof(Vertex, pos);
-        
-        attributeDescriptions[1].binding = 0;
-        attributeDescriptions[1].location = 1;
-        attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-        attributeDescriptions[1].offset = offsetof(Vertex, color);
-
-        return attributeDescriptions;
-    }
+    //Vertex input is reflected from vert.spv, see Pipeline::create_pipeline
 };
 
 
@@ -40,7 +17,8 @@ const std::vector<Vertex> vertices = {
     {{-0.5f, 0.5f}, {0.478f, 0.396f, 0.388f}},
 };
 
-const std::vector<uint16_t> indices = {
+//Authored as 32 bit, the import pass packs to 16 bit when the vertex count allows
+const std::vector<uint32_t> indices = {
     0, 1, 2, 2, 3, 0
 };
 
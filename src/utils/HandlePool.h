@@ -0,0 +1,156 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <stdexcept>
+
+namespace evoke::utils {
+    //32-bit handle: low INDEX_BITS are the slot index, the rest is the slot generation.
+    //Generation 0 is never handed out, so a zero handle is always null.
+    template <typename Tag>
+    struct Handle {
+        static constexpr uint32_t INDEX_BITS = 20;
+        static constexpr uint32_t INDEX_MASK = (1u << INDEX_BITS) - 1;
+        static constexpr uint32_t GENERATION_MASK = (1u << (32 - INDEX_BITS)) - 1;
+
+        uint32_t value = 0;
+
+        static Handle make(uint32_t index, uint32_t generation) {
+            return Handle{ (generation << INDEX_BITS) | (index & INDEX_MASK) };
+        }
+
+        uint32_t index() const { return value & INDEX_MASK; }
+        uint32_t generation() const { return value >> INDEX_BITS; }
+        bool is_null() const { return value == 0; }
+
+        bool operator==(const Handle&) const = default;
+    };
+
+    //Slot array with free-list and generation counters. Lookups are a single array index,
+    //removed slots are recycled and bump their generation so old handles go stale.
+    //Slots live in fixed blocks that never move, so lookups stay valid while another thread inserts.
+    //Inserting and removing still have to be serialized by the owner.
+    template <typename T, typename Tag>
+    class HandlePool {
+    public:
+        using handle_type = Handle<Tag>;
+
+        static constexpr uint32_t BLOCK_SIZE = 1024;
+        static constexpr uint32_t MAX_BLOCKS = (handle_type::INDEX_MASK + 1) / BLOCK_SIZE;
+
+        handle_type insert(const T& value) {
+            uint32_t index;
+            if (!m_free_list.empty()) {
+                index = m_free_list.back();
+                m_free_list.pop_back();
+            } else {
+                index = m_size.load(std::memory_order_relaxed);
+                if (index > handle_type::INDEX_MASK) {
+                    throw std::runtime_error("handle pool is full!");
+                }
+                if (index % BLOCK_SIZE == 0) {
+                    m_blocks[index / BLOCK_SIZE] = std::make_unique<Slot[]>(BLOCK_SIZE);
+                }
+                m_size.store(index + 1, std::memory_order_release);
+            }
+
+            Slot& slot = get_slot(index);
+            slot.value = value;
+            slot.alive = true;
+            m_count++;
+
+            return handle_type::make(index, slot.generation);
+        }
+
+        T remove(handle_type handle) {
+            validate(handle);
+
+            uint32_t index = handle.index();
+            Slot& slot = get_slot(index);
+            T value = slot.value;
+            slot.value = T{};
+            slot.alive = false;
+
+            //Skip generation 0 on wrap around so recycled handles never look null
+            slot.generation = (slot.generation + 1) & handle_type::GENERATION_MASK;
+            if (slot.generation == 0) {
+                slot.generation = 1;
+            }
+
+            m_free_list.push_back(index);
+            m_count--;
+
+            return value;
+        }
+
+        bool is_valid(handle_type handle) const {
+            uint32_t index = handle.index();
+            if (handle.is_null() || index >= m_size.load(std::memory_order_acquire)) {
+                return false;
+            }
+            const Slot& slot = get_slot(index);
+            return slot.alive && slot.generation == handle.generation();
+        }
+
+        T& get(handle_type handle) {
+            validate(handle);
+            return get_slot(handle.index()).value;
+        }
+
+        const T& get(handle_type handle) const {
+            validate(handle);
+            return get_slot(handle.index()).value;
+        }
+
+        //Calls func(handle, value) for every live slot in index order
+        template <typename Func>
+        void for_each(Func&& func) {
+            for (uint32_t i = 0; i < capacity(); i++) {
+                Slot& slot = get_slot(i);
+                if (slot.alive) {
+                    func(handle_type::make(i, slot.generation), slot.value);
+                }
+            }
+        }
+
+        void clear() {
+            for (uint32_t i = 0; i < capacity(); i++) {
+                Slot& slot = get_slot(i);
+                if (slot.alive) {
+                    remove(handle_type::make(i, slot.generation));
+                }
+            }
+        }
+
+        uint32_t size() const { return m_count; }
+        uint32_t capacity() const { return m_size.load(std::memory_order_acquire); }
+
+    private:
+        struct Slot {
+            T value{};
+            uint32_t generation = 1;
+            bool alive = false;
+        };
+
+        std::array<std::unique_ptr<Slot[]>, MAX_BLOCKS> m_blocks;
+        std::atomic<uint32_t> m_size{0};
+        std::vector<uint32_t> m_free_list;
+        uint32_t m_count = 0;
+
+        Slot& get_slot(uint32_t index) { return m_blocks[index / BLOCK_SIZE][index % BLOCK_SIZE]; }
+        const Slot& get_slot(uint32_t index) const { return m_blocks[index / BLOCK_SIZE][index % BLOCK_SIZE]; }
+
+        //Stale or foreign handles are a programming error, only checked in debug builds
+        void validate(handle_type handle) const {
+#ifndef NDEBUG
+            if (!is_valid(handle)) {
+                throw std::runtime_error("stale or invalid resource handle!");
+            }
+#else
+            (void)handle;
+#endif
+        }
+    };
+}
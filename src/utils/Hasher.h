@@ -0,0 +1,33 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace evoke::utils {
+    //64-bit FNV-1a over raw bytes. Values are hashed as stored, so types with padding bytes
+    //must not be passed whole.
+    class Hasher {
+    public:
+        template <typename T>
+        Hasher& add(const T& value) {
+            static_assert(std::is_trivially_copyable_v<T>, "only plain values can be hashed by their bytes!");
+            return add_bytes(&value, sizeof(T));
+        }
+
+        Hasher& add_bytes(const void* data, size_t size) {
+            const uint8_t* bytes = static_cast<const uint8_t*>(data);
+            for (size_t i = 0; i < size; i++) {
+                m_hash = (m_hash ^ bytes[i]) * PRIME;
+            }
+            return *this;
+        }
+
+        uint64_t get() const { return m_hash; }
+
+    private:
+        static constexpr uint64_t OFFSET_BASIS = 14695981039346656037ull;
+        static constexpr uint64_t PRIME = 1099511628211ull;
+
+        uint64_t m_hash = OFFSET_BASIS;
+    };
+}
@@ -1,9 +1,9 @@
 #pragma once
-#include <string>
-#include <sstream>
-#include <iomanip>
-#include <iostream>
 #include <chrono>
+#include <cstddef>
+#include <ctime>
+#include <iostream>
+#include <mutex>
 
 namespace evoke::utils {
     class Logger {
@@ -19,20 +19,24 @@ namespace evoke::utils {
         }
 
     private:
-        static std::string current_time() {
+        static inline std::mutex s_mutex;
+
+        static void current_time(char* buffer, size_t size) {
             auto now = std::chrono::system_clock::now();
             auto in_time_t = std::chrono::system_clock::to_time_t(now);
-
-            std::stringstream ss;
-            ss << std::put_time(std::localtime(&in_time_t), "%H:%M:%S");
-            return ss.str();
+            std::strftime(buffer, size, "%H:%M:%S", std::localtime(&in_time_t));
         }
 
+        //Streams straight to the console without building a string, the lock keeps lines of different threads apart
         template <typename... Args>
-        static void log(const std::string& level, Args&&... args) {
-            std::ostringstream oss;
-            (oss << ... << args);
-            std::cout << current_time() << " " << level << " " << oss.str() << "\n";
+        static void log(const char* level, Args&&... args) {
+            char time[16];
+            current_time(time, sizeof(time));
+
+            std::lock_guard<std::mutex> lock(s_mutex);
+            std::cout << time << " " << level << " ";
+            (std::cout << ... << args);
+            std::cout << "\n";
         }
     };
-}
\ No newline at end of file
+}
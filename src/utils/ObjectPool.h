@@ -0,0 +1,68 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace evoke::utils {
+    //Fixed size slots for objects that are created and destroyed all the time. Slots come in blocks of
+    //BlockSize and are recycled through a free list, so churn never reaches the heap once the pool
+    //has grown to its peak. Pointers stay valid until destroyed. Not thread safe.
+    template <typename T, size_t BlockSize = 64>
+    class ObjectPool {
+    public:
+        ObjectPool() = default;
+        ObjectPool(const ObjectPool&) = delete;
+        ObjectPool& operator=(const ObjectPool&) = delete;
+
+        //Objects still alive are not destroyed, only their memory is released
+        ~ObjectPool() = default;
+
+        template <typename... Args>
+        T* create(Args&&... args) {
+            if (m_free == nullptr) {
+                grow();
+            }
+
+            Slot* slot = m_free;
+            m_free = slot->next;
+            m_live++;
+            return new (slot->storage) T(std::forward<Args>(args)...);
+        }
+
+        void destroy(T* object) {
+            if (object == nullptr) {
+                return;
+            }
+
+            object->~T();
+            Slot* slot = reinterpret_cast<Slot*>(object);
+            slot->next = m_free;
+            m_free = slot;
+            m_live--;
+        }
+
+        size_t get_live() const { return m_live; }
+        size_t get_capacity() const { return m_blocks.size() * BlockSize; }
+
+    private:
+        union Slot {
+            Slot* next;
+            alignas(T) std::byte storage[sizeof(T)];
+        };
+
+        std::vector<std::unique_ptr<Slot[]>> m_blocks;
+        Slot* m_free = nullptr;
+        size_t m_live = 0;
+
+        void grow() {
+            m_blocks.push_back(std::make_unique<Slot[]>(BlockSize));
+            Slot* block = m_blocks.back().get();
+            for (size_t i = 0; i < BlockSize; i++) {
+                block[i].next = i + 1 < BlockSize ? &block[i + 1] : m_free;
+            }
+            m_free = block;
+        }
+    };
+}
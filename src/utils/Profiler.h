@@ -0,0 +1,85 @@
+#pragma once
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace evoke::utils {
+    //Named counters any system can publish, e.g. "memory.textures_mib". Whoever displays them reads
+    //a copy. Safe from any thread, publishing a known name does not allocate.
+    class Profiler {
+    public:
+        //Samples kept per series, a few seconds of frames
+        static constexpr size_t HISTORY_LENGTH = 256;
+
+        static void set_counter(std::string_view name, double value) {
+            std::lock_guard<std::mutex> lock(s_mutex);
+            counter(name) = value;
+        }
+
+        //Appends to the series and sets the counter of the same name to the newest sample
+        static void add_sample(std::string_view name, double value) {
+            std::lock_guard<std::mutex> lock(s_mutex);
+            counter(name) = value;
+
+            auto it = s_histories.find(name);
+            if (it == s_histories.end()) {
+                it = s_histories.emplace(std::string(name), History{}).first;
+                it->second.samples.reserve(HISTORY_LENGTH);
+            }
+
+            //Ring buffer once full
+            History& history = it->second;
+            if (history.samples.size() < HISTORY_LENGTH) {
+                history.samples.push_back(value);
+            } else {
+                history.samples[history.next] = value;
+            }
+            history.next = (history.next + 1) % HISTORY_LENGTH;
+        }
+
+        //Sorted by name
+        static std::vector<std::pair<std::string, double>> get_counters() {
+            std::lock_guard<std::mutex> lock(s_mutex);
+            return {s_counters.begin(), s_counters.end()};
+        }
+
+        //Oldest sample first, empty for unknown series
+        static std::vector<double> get_history(std::string_view name) {
+            std::lock_guard<std::mutex> lock(s_mutex);
+            auto it = s_histories.find(name);
+            if (it == s_histories.end()) {
+                return {};
+            }
+
+            const History& history = it->second;
+            if (history.samples.size() < HISTORY_LENGTH) {
+                return history.samples;
+            }
+            std::vector<double> samples(history.samples.begin() + history.next, history.samples.end());
+            samples.insert(samples.end(), history.samples.begin(), history.samples.begin() + history.next);
+            return samples;
+        }
+
+    private:
+        struct History {
+            std::vector<double> samples;
+            size_t next = 0;
+        };
+
+        static inline std::mutex s_mutex;
+        //Transparent comparators, lookups by string_view
+        static inline std::map<std::string, double, std::less<>> s_counters;
+        static inline std::map<std::string, History, std::less<>> s_histories;
+
+        static double& counter(std::string_view name) {
+            auto it = s_counters.find(name);
+            if (it == s_counters.end()) {
+                it = s_counters.emplace(std::string(name), 0.0).first;
+            }
+            return it->second;
+        }
+    };
+}
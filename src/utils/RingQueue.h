@@ -0,0 +1,59 @@
+#pragma once
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace evoke::utils {
+    //First in, first out over a ring of slots that doubles when full and never shrinks, so a queue
+    //that is filled and drained every frame stops reaching the heap once it held its peak. Popped
+    //slots are reset to T{} so they let go of what they owned. Not thread safe.
+    template <typename T>
+    class RingQueue {
+    public:
+        void push_back(T value) {
+            if (m_size == m_slots.size()) {
+                grow();
+            }
+            m_slots[(m_head + m_size) & (m_slots.size() - 1)] = std::move(value);
+            m_size++;
+        }
+
+        T& front() { return m_slots[m_head]; }
+        const T& front() const { return m_slots[m_head]; }
+
+        void pop_front() {
+            m_slots[m_head] = T{};
+            m_head = (m_head + 1) & (m_slots.size() - 1);
+            m_size--;
+        }
+
+        //0 is the front
+        T& operator[](size_t index) { return m_slots[(m_head + index) & (m_slots.size() - 1)]; }
+
+        bool empty() const { return m_size == 0; }
+        size_t size() const { return m_size; }
+        size_t capacity() const { return m_slots.size(); }
+
+        //Keeps the slots
+        void clear() {
+            while (!empty()) {
+                pop_front();
+            }
+        }
+
+    private:
+        std::vector<T> m_slots;
+        size_t m_head = 0;
+        size_t m_size = 0;
+
+        //Powers of two so wrapping is a mask
+        void grow() {
+            std::vector<T> slots(m_slots.empty() ? 8 : m_slots.size() * 2);
+            for (size_t i = 0; i < m_size; i++) {
+                slots[i] = std::move((*this)[i]);
+            }
+            m_slots = std::move(slots);
+            m_head = 0;
+        }
+    };
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+namespace evoke::utils {
+    //Lock free single producer, single consumer triple buffer. The writer always has a buffer to fill,
+    //the reader always sees the most recently published one, and neither ever waits on the other.
+    template <typename T>
+    class TripleBuffer {
+    public:
+        //Writer side
+        T& write_buffer() { return m_buffers[m_write]; }
+        //Returns false if the previously published buffer was replaced before the reader acquired it
+        bool publish() {
+            uint32_t previous = m_shared.exchange(m_write | DIRTY_BIT, std::memory_order_acq_rel);
+            m_write = previous & INDEX_MASK;
+            return (previous & DIRTY_BIT) == 0;
+        }
+
+        //Reader side, returns false if nothing new was published since the last acquire
+        bool acquire() {
+            if ((m_shared.load(std::memory_order_relaxed) & DIRTY_BIT) == 0) {
+                return false;
+            }
+            m_read = m_shared.exchange(m_read, std::memory_order_acq_rel) & INDEX_MASK;
+            return true;
+        }
+        const T& read_buffer() const { return m_buffers[m_read]; }
+
+    private:
+        static constexpr uint32_t DIRTY_BIT = 4;
+        static constexpr uint32_t INDEX_MASK = 3;
+
+        T m_buffers[3];
+        uint32_t m_write = 0;
+        uint32_t m_read = 1;
+        //Index of the buffer between writer and reader, plus whether it holds unread data
+        std::atomic<uint32_t> m_shared{2};
+    };
+}
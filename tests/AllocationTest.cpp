@@ -0,0 +1,189 @@
+//Warmed up frame paths must not reach the heap: frame arenas, object pools, the pmr lists of
+//QueueSubmit and the readback queue. Runs without a device, only the allocators and the structs
+//the frame loop fills are exercised.
+#include <cstdio>
+#include <new>
+#include <vector>
+#include "src/core/AllocationCounter.h"
+#include "src/core/FrameArenas.h"
+#include "src/core/LinearArena.h"
+#include "src/renderer/QueueSet.h"
+#include "src/renderer/ReadbackService.h"
+#include "src/utils/ObjectPool.h"
+#include "src/utils/RingQueue.h"
+
+namespace {
+    int s_failures = 0;
+
+    void check(bool condition, const char* what){
+        if (!condition) {
+            std::printf("FAILED: %s\n", what);
+            s_failures++;
+        }
+    }
+
+    void check_no_allocations(const evoke::core::AllocationScope& scope, const char* what){
+        evoke::core::AllocationStats stats = scope.get();
+        if (stats.allocations != 0) {
+            std::printf("FAILED: %s allocated %llu times, %llu bytes\n", what, static_cast<unsigned long long>(stats.allocations), static_cast<unsigned long long>(stats.bytes));
+            s_failures++;
+        }
+    }
+
+    //Grows a pmr vector element by element, so the arena sees every reallocation
+    void fill(std::pmr::memory_resource* memory, uint32_t count){
+        std::pmr::vector<uint32_t> values(memory);
+        for (uint32_t i = 0; i < count; i++) {
+            values.push_back(i);
+        }
+    }
+
+    struct Particle {
+        float position[3];
+        float age;
+    };
+
+    void linear_arena(){
+        evoke::core::LinearArena arena(1024);
+
+        //The second frame overflows the first block, the reset after it merges into one of the peak size
+        for (uint32_t count : {100u, 10000u, 10000u}) {
+            fill(&arena, count);
+            arena.reset();
+        }
+
+        evoke::core::AllocationScope scope;
+        for (uint32_t frame = 0; frame < 100; frame++) {
+            fill(&arena, 10000);
+            arena.reset();
+        }
+        check_no_allocations(scope, "LinearArena after its peak frame");
+        check(arena.get_peak() > 0, "LinearArena tracks its peak");
+    }
+
+    void frame_arenas(){
+        const uint32_t frames_in_flight = 2;
+        evoke::core::FrameArenas arenas;
+        arenas.init(1, frames_in_flight, 1024);
+
+        auto run_frames = [&](uint32_t frames) {
+            for (uint32_t frame = 0; frame < frames; frame++) {
+                arenas.begin_frame(frame % frames_in_flight);
+                fill(&arenas.get(), 5000);
+            }
+        };
+        run_frames(frames_in_flight * 2);
+
+        evoke::core::AllocationScope scope;
+        run_frames(100);
+        check_no_allocations(scope, "FrameArenas after every frame slot saw its peak");
+    }
+
+    void object_pool(){
+        evoke::utils::ObjectPool<Particle, 64> pool;
+        std::vector<Particle*> live;
+        live.reserve(200);
+
+        auto churn = [&] {
+            for (uint32_t i = 0; i < 200; i++) {
+                live.push_back(pool.create(Particle{{0.0f, 0.0f, 0.0f}, 0.0f}));
+            }
+            for (Particle* particle : live) {
+                pool.destroy(particle);
+            }
+            live.clear();
+        };
+        churn();
+
+        evoke::core::AllocationScope scope;
+        for (uint32_t i = 0; i < 100; i++) {
+            churn();
+        }
+        check_no_allocations(scope, "ObjectPool churn below its peak");
+        check(pool.get_live() == 0, "ObjectPool destroyed every object");
+    }
+
+    void queue_submit(){
+        evoke::core::FrameArenas arenas;
+        arenas.init(1, 2, 4096);
+
+        //Same shape as the per frame graphics submit in VulkanCore::draw_frame
+        auto build_submit = [&](uint32_t frame) {
+            arenas.begin_frame(frame % 2);
+            evoke::vulkan::QueueSubmit submit(&arenas.get());
+            submit.command_buffers = {VK_NULL_HANDLE};
+            submit.binary_waits = {VkSemaphoreSubmitInfo{}};
+            submit.binary_signals = {VkSemaphoreSubmitInfo{}};
+            submit.waits.push_back({evoke::vulkan::QueueType::Compute, frame, VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT});
+            check(submit.waits.size() == 1 && submit.command_buffers.size() == 1, "QueueSubmit lists hold what was added");
+        };
+        for (uint32_t frame = 0; frame < 4; frame++) {
+            build_submit(frame);
+        }
+
+        evoke::core::AllocationScope scope;
+        for (uint32_t frame = 0; frame < 100; frame++) {
+            build_submit(frame);
+        }
+        check_no_allocations(scope, "QueueSubmit lists in a frame arena");
+    }
+
+    void per_frame_readback(){
+        //Same shape as ReadbackService's in flight requests
+        struct Request {
+            uint64_t staging = 0;
+            VkDeviceSize size = 0;
+            evoke::vulkan::ReadbackCallback callback;
+            uint64_t timeline_value = 0;
+        };
+        evoke::utils::RingQueue<Request> in_flight;
+        uint64_t delivered = 0;
+
+        //One readback a frame like ClusteredLighting's bin stats, delivered once the GPU is two frames behind
+        auto run_frames = [&](uint64_t first, uint64_t count, uint64_t latency) {
+            for (uint64_t frame = first; frame < first + count; frame++) {
+                in_flight.push_back({frame, 16, [&delivered](const void*, VkDeviceSize) { delivered++; }, frame});
+                while (!in_flight.empty() && in_flight.front().timeline_value + latency <= frame) {
+                    in_flight.front().callback(nullptr, in_flight.front().size);
+                    in_flight.pop_front();
+                }
+            }
+        };
+        //A stall backs up more requests than the steady state ever holds
+        run_frames(0, 100, 20);
+
+        evoke::core::AllocationScope scope;
+        run_frames(100, 1000, 2);
+        check_no_allocations(scope, "per frame readbacks after the queue saw its peak");
+        check(delivered > 1000 && in_flight.size() <= 20, "readbacks are delivered in order");
+    }
+
+    void counter_sees_the_heap(){
+        //Direct calls, new expressions may be elided by the optimizer
+        evoke::core::AllocationScope scope;
+        void* memory = ::operator new(16);
+        ::operator delete(memory);
+        check(scope.get().allocations == 1 && scope.get().bytes == 16, "AllocationScope counts operator new");
+
+        //Zero byte over-aligned requests are legal and must not throw
+        void* aligned = ::operator new(0, std::align_val_t{64});
+        check(aligned != nullptr, "aligned operator new of 0 bytes returns memory");
+        ::operator delete(aligned, std::align_val_t{64});
+    }
+}
+
+int main(){
+    counter_sees_the_heap();
+    linear_arena();
+    frame_arenas();
+    object_pool();
+    queue_submit();
+    per_frame_readback();
+
+    if (s_failures > 0) {
+        std::printf("%d allocation checks failed\n", s_failures);
+        return 1;
+    }
+    std::printf("All allocation checks passed\n");
+    return 0;
+}
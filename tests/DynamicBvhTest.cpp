@@ -0,0 +1,259 @@
+//DynamicBvh queries against a brute force walk over every proxy, after random sequences of creates,
+//moves and destroys. The brute force side keeps the same fat boxes the tree does, so both must agree
+//exactly on which proxies a frustum touches and on the distance of the nearest ray hit.
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <random>
+#include <vector>
+#include "src/core/JobSystem.h"
+#include "src/scene/DynamicBvh.h"
+
+namespace {
+    using evoke::scene::Aabb;
+    using evoke::scene::ProxyId;
+
+    int s_failures = 0;
+
+    void check(bool condition, const char* what, uint32_t round){
+        if (!condition) {
+            std::printf("FAILED: %s in round %u\n", what, round);
+            s_failures++;
+        }
+    }
+
+    constexpr float MARGIN = 0.25f;
+
+    struct Proxy {
+        ProxyId id = evoke::scene::NULL_PROXY;
+        uint32_t user_data = 0;
+        //What the tree stores, the bounds grown by the margin when they last left it
+        Aabb fat;
+    };
+
+    Aabb fatten(const Aabb& bounds){
+        return {bounds.min - glm::vec3(MARGIN), bounds.max + glm::vec3(MARGIN)};
+    }
+
+    //Same corner test and operation order as the flattened tree
+    bool outside_frustum(const evoke::scene::Frustum& frustum, const Aabb& box){
+        for (const glm::vec4& plane : frustum.planes) {
+            float far_x = plane.x >= 0.0f ? box.max.x : box.min.x;
+            float far_y = plane.y >= 0.0f ? box.max.y : box.min.y;
+            float far_z = plane.z >= 0.0f ? box.max.z : box.min.z;
+            if ((plane.x * far_x + plane.y * far_y) + (plane.z * far_z + plane.w) < 0.0f) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    //Entry distance of the ray into the box, or -1 if it misses
+    float ray_entry(const evoke::scene::Ray& ray, const Aabb& box){
+        auto inverse = [](float direction) {
+            return 1.0f / (std::abs(direction) > 1e-20f ? direction : std::copysign(1e-20f, direction));
+        };
+        glm::vec3 inverse_direction = {inverse(ray.direction.x), inverse(ray.direction.y), inverse(ray.direction.z)};
+        glm::vec3 t0 = (box.min - ray.origin) * inverse_direction;
+        glm::vec3 t1 = (box.max - ray.origin) * inverse_direction;
+
+        float entry = std::max(std::max(std::min(t0.x, t1.x), std::min(t0.y, t1.y)), std::max(std::min(t0.z, t1.z), 0.0f));
+        float exit = std::min(std::min(std::max(t0.x, t1.x), std::max(t0.y, t1.y)), std::min(std::max(t0.z, t1.z), ray.max_distance));
+        return entry <= exit ? entry : -1.0f;
+    }
+
+    class World {
+    public:
+        explicit World(uint32_t seed) : m_random(seed) {
+            m_bvh.set_margin(MARGIN);
+        }
+
+        evoke::scene::DynamicBvh& get_bvh() { return m_bvh; }
+        const std::vector<Proxy>& get_proxies() const { return m_proxies; }
+
+        void create(){
+            Proxy proxy;
+            proxy.user_data = m_next_user_data++;
+            Aabb bounds = random_box(random_point());
+            proxy.id = m_bvh.create_proxy(bounds, proxy.user_data);
+            proxy.fat = fatten(bounds);
+            m_proxies.push_back(proxy);
+        }
+
+        void destroy(){
+            if (m_proxies.empty()) {
+                return;
+            }
+            size_t index = pick();
+            m_bvh.destroy_proxy(m_proxies[index].id);
+            m_proxies[index] = m_proxies.back();
+            m_proxies.pop_back();
+        }
+
+        //Mostly jitter that stays inside the margin, sometimes a jump across the world
+        void move(){
+            if (m_proxies.empty()) {
+                return;
+            }
+            Proxy& proxy = m_proxies[pick()];
+            glm::vec3 center = (proxy.fat.min + proxy.fat.max) * 0.5f;
+            glm::vec3 target = uniform(0.0f, 1.0f) < 0.2f ? random_point() : center + glm::vec3(uniform(-0.3f, 0.3f), uniform(-0.3f, 0.3f), uniform(-0.3f, 0.3f));
+            Aabb bounds = random_box(target);
+
+            bool leaves_fat_box = !proxy.fat.contains(bounds);
+            if (leaves_fat_box) {
+                proxy.fat = fatten(bounds);
+            }
+            check(m_bvh.move_proxy(proxy.id, bounds) == leaves_fat_box, "move_proxy reports whether the fat box changed", 0);
+        }
+
+        void step(){
+            float choice = uniform(0.0f, 1.0f);
+            if (choice < 0.3f) {
+                create();
+            } else if (choice < 0.45f) {
+                destroy();
+            } else {
+                move();
+            }
+        }
+
+        evoke::scene::Frustum random_frustum(){
+            evoke::scene::Camera camera;
+            camera.position = random_point() * 1.5f;
+            camera.target = random_point();
+            camera.fov_y = glm::radians(uniform(30.0f, 90.0f));
+            camera.far_plane = uniform(10.0f, 80.0f);
+            return evoke::scene::Frustum::from_matrix(camera.view_projection(uniform(0.5f, 2.0f)));
+        }
+
+        evoke::scene::Ray random_ray(){
+            evoke::scene::Ray ray;
+            ray.origin = random_point() * 1.5f;
+            ray.direction = glm::normalize(random_point() - ray.origin);
+            //Now and then axis parallel, the slab test has to survive the zero components
+            if (uniform(0.0f, 1.0f) < 0.1f) {
+                ray.direction = {0.0f, 0.0f, ray.direction.z < 0.0f ? -1.0f : 1.0f};
+            }
+            ray.max_distance = uniform(0.0f, 1.0f) < 0.5f ? uniform(5.0f, 60.0f) : std::numeric_limits<float>::max();
+            return ray;
+        }
+
+    private:
+        std::mt19937 m_random;
+        evoke::scene::DynamicBvh m_bvh;
+        std::vector<Proxy> m_proxies;
+        uint32_t m_next_user_data = 0;
+
+        float uniform(float min, float max){
+            return std::uniform_real_distribution<float>(min, max)(m_random);
+        }
+        size_t pick(){
+            return std::uniform_int_distribution<size_t>(0, m_proxies.size() - 1)(m_random);
+        }
+        glm::vec3 random_point(){
+            return {uniform(-20.0f, 20.0f), uniform(-20.0f, 20.0f), uniform(-20.0f, 20.0f)};
+        }
+        Aabb random_box(const glm::vec3& center){
+            glm::vec3 extent = {uniform(0.1f, 1.0f), uniform(0.1f, 1.0f), uniform(0.1f, 1.0f)};
+            return {center - extent, center + extent};
+        }
+    };
+
+    void compare_frustum(World& world, const evoke::scene::Frustum& frustum, uint32_t round){
+        std::vector<uint32_t> found;
+        world.get_bvh().query_frustum(frustum, found);
+
+        std::vector<uint32_t> expected;
+        for (const Proxy& proxy : world.get_proxies()) {
+            if (!outside_frustum(frustum, proxy.fat)) {
+                expected.push_back(proxy.user_data);
+            }
+        }
+
+        std::sort(found.begin(), found.end());
+        std::sort(expected.begin(), expected.end());
+        check(std::adjacent_find(found.begin(), found.end()) == found.end(), "query_frustum returns every proxy once", round);
+        check(found == expected, "query_frustum matches brute force", round);
+    }
+
+    void compare_ray(World& world, const evoke::scene::Ray& ray, const evoke::scene::RayHit& hit, uint32_t round){
+        float nearest = std::numeric_limits<float>::max();
+        float hit_entry = -1.0f;
+        for (const Proxy& proxy : world.get_proxies()) {
+            float entry = ray_entry(ray, proxy.fat);
+            if (entry >= 0.0f) {
+                nearest = std::min(nearest, entry);
+            }
+            if (hit.hit() && proxy.user_data == hit.user_data) {
+                hit_entry = entry;
+            }
+        }
+
+        if (nearest == std::numeric_limits<float>::max()) {
+            check(!hit.hit(), "raycast misses when brute force does", round);
+            return;
+        }
+        check(hit.hit(), "raycast hits when brute force does", round);
+        //Ties may pick either proxy, but the distance is the nearest one's and belongs to the proxy returned
+        check(std::abs(hit.distance - nearest) <= 1e-4f * std::max(1.0f, nearest), "raycast finds the nearest entry", round);
+        check(std::abs(hit_entry - hit.distance) <= 1e-4f * std::max(1.0f, hit.distance), "raycast distance belongs to the proxy it returns", round);
+    }
+
+    void random_sequences(evoke::core::JobSystem& job_system){
+        for (uint32_t seed = 1; seed <= 8; seed++) {
+            World world(seed);
+            for (uint32_t i = 0; i < 200; i++) {
+                world.create();
+            }
+
+            for (uint32_t round = 0; round < 40; round++) {
+                for (uint32_t i = 0; i < 100; i++) {
+                    world.step();
+                }
+                world.get_bvh().flatten();
+                check(world.get_bvh().get_proxy_count() == world.get_proxies().size(), "proxy count follows creates and destroys", round);
+
+                for (uint32_t i = 0; i < 4; i++) {
+                    compare_frustum(world, world.random_frustum(), round);
+                }
+
+                std::vector<evoke::scene::Ray> rays(32);
+                for (auto& ray : rays) {
+                    ray = world.random_ray();
+                }
+                std::vector<evoke::scene::RayHit> hits(rays.size());
+                world.get_bvh().raycast_batch(job_system, rays, hits);
+                for (size_t i = 0; i < rays.size(); i++) {
+                    compare_ray(world, rays[i], world.get_bvh().raycast(rays[i]), round);
+                    compare_ray(world, rays[i], hits[i], round);
+                }
+            }
+
+            //Down to nothing, queries on an empty tree find nothing
+            while (!world.get_proxies().empty()) {
+                world.destroy();
+            }
+            world.get_bvh().flatten();
+            std::vector<uint32_t> found;
+            world.get_bvh().query_frustum(world.random_frustum(), found);
+            check(found.empty() && !world.get_bvh().raycast(world.random_ray()).hit(), "an empty tree finds nothing", 0);
+        }
+    }
+}
+
+int main(){
+    evoke::core::JobSystem job_system;
+    job_system.init(2);
+
+    random_sequences(job_system);
+    job_system.clean_up();
+
+    if (s_failures > 0) {
+        std::printf("%d BVH checks failed\n", s_failures);
+        return 1;
+    }
+    std::printf("All BVH checks passed\n");
+    return 0;
+}